@@ -0,0 +1,431 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Benchmark/RewindBenchmarkCommandlet.h"
+
+#include "RewindLearned.h"
+#include "Character/RewindCharacter.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/WorldSettings.h"
+#include "GameMode/RewindGameMode.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RewindableActor/RewindableStaticMeshActor.h"
+#include "Rollback/RewindRollbackSubsystem.h"
+#include "Stats/RewindFidelitySubsystem.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+URewindBenchmarkCommandlet::URewindBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 URewindBenchmarkCommandlet::Main(const FString& Params)
+{
+	FConfig Config;
+	FParse::Value(*Params, TEXT("N="), Config.NumStaticMeshActors);
+	FParse::Value(*Params, TEXT("M="), Config.NumCharacters);
+	FParse::Value(*Params, TEXT("FrameRate="), Config.FrameRate);
+	FParse::Value(*Params, TEXT("RecordSeconds="), Config.RecordSeconds);
+	FParse::Value(*Params, TEXT("PhaseSeconds="), Config.PhaseSeconds);
+	FParse::Value(*Params, TEXT("Baseline="), Config.BaselinePath);
+	FParse::Value(*Params, TEXT("Threshold="), Config.RegressionThreshold);
+	Config.bMeasureFidelity = FParse::Param(*Params, TEXT("Fidelity"));
+	FParse::Value(*Params, TEXT("Rollback="), Config.RollbackFrames);
+	if (!FParse::Value(*Params, TEXT("Output="), Config.OutputDirectory))
+	{
+		Config.OutputDirectory = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Rewind"), TEXT("Benchmark"));
+	}
+	Config.NumStaticMeshActors = FMath::Clamp(Config.NumStaticMeshActors, 0, 100000);
+	Config.NumCharacters = FMath::Max(Config.NumCharacters, 0);
+	Config.FrameRate = FMath::Max(Config.FrameRate, 1.0f);
+
+	UE_LOG(LogRewind, Display, TEXT("Rewind benchmark: %d static mesh actors, %d characters, %.0f fps"),
+		Config.NumStaticMeshActors, Config.NumCharacters, Config.FrameRate);
+
+	UWorld* World = CreateBenchmarkWorld();
+	if (!World)
+	{
+		UE_LOG(LogRewind, Error, TEXT("Failed to create the benchmark world"));
+		return 1;
+	}
+
+	SpawnScene(World, Config.NumStaticMeshActors, Config.NumCharacters);
+
+	URewindFidelitySubsystem* Fidelity = Config.bMeasureFidelity ? World->GetSubsystem<URewindFidelitySubsystem>() : nullptr;
+	if (Fidelity) Fidelity->StartMeasuring();
+
+	TArray<FPhaseResult> Results;
+	RunPhases(World, Config, MakeDefaultPhases(Config), Results);
+
+	const FString BaseFileName = FString::Printf(TEXT("RewindBenchmark_N%d_M%d_%s"),
+		Config.NumStaticMeshActors, Config.NumCharacters, *FDateTime::Now().ToString());
+	if (Fidelity)
+	{
+		// 子系统随世界销毁，先输出
+		Fidelity->StopMeasuring();
+		Fidelity->DumpReport(10);
+		Fidelity->WriteCsv(FPaths::Combine(Config.OutputDirectory, BaseFileName + TEXT("_Fidelity.csv")));
+	}
+
+	// 回滚会瞬移物体，在保真度统计结束之后进行
+	if (Config.RollbackFrames > 0) RunRollbackBenchmark(World, Config, Results);
+
+	DestroyBenchmarkWorld(World);
+
+	WriteReports(Config, Results, BaseFileName);
+
+	const bool bRegressed = !Config.BaselinePath.IsEmpty() && CompareWithBaseline(Config, Results);
+	return bRegressed ? 1 : 0;
+}
+
+UWorld* URewindBenchmarkCommandlet::CreateBenchmarkWorld()
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("RewindBenchmarkWorld"));
+	if (!World) return nullptr;
+	World->AddToRoot();
+
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	// 使用回溯GameMode，它会创建回溯GameState，回溯组件在BeginPlay时依赖它
+	World->GetWorldSettings()->DefaultGameMode = ARewindGameMode::StaticClass();
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+	return World;
+}
+
+void URewindBenchmarkCommandlet::DestroyBenchmarkWorld(UWorld* World)
+{
+	if (!World) return;
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	World->RemoveFromRoot();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void URewindBenchmarkCommandlet::SpawnScene(UWorld* World, int32 NumStaticMeshActors, int32 NumCharacters)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindBenchmarkCommandlet::SpawnScene);
+	UStaticMesh* CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	FRandomStream Random(0x5EED); // 固定种子，保证每次测试的场景相同
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// 静态网格体排成网格并从空中落下，给一个随机的初速度让它们相互碰撞
+	const int32 GridSize = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumStaticMeshActors))));
+	constexpr float Spacing = 150.0f;
+	for (int32 Index = 0; Index < NumStaticMeshActors; ++Index)
+	{
+		const FVector Location((Index % GridSize) * Spacing, (Index / GridSize) * Spacing, 500.0f + Random.FRandRange(0.0f, 500.0f));
+		ARewindableStaticMeshActor* Actor = World->SpawnActor<ARewindableStaticMeshActor>(Location, FRotator::ZeroRotator, SpawnParameters);
+		if (!Actor) continue;
+
+		UStaticMeshComponent* MeshComponent = Actor->GetStaticMeshComponent();
+		MeshComponent->SetStaticMesh(CubeMesh);
+		MeshComponent->SetSimulatePhysics(true);
+		MeshComponent->SetPhysicsLinearVelocity(Random.VRand() * 300.0f);
+		MeshComponent->SetPhysicsAngularVelocityInDegrees(Random.VRand() * 180.0f);
+	}
+
+	// 角色没有控制器，只靠起跳速度移动
+	for (int32 Index = 0; Index < NumCharacters; ++Index)
+	{
+		const FVector Location(-500.0f, Index * 200.0f, 200.0f);
+		ARewindCharacter* Character = World->SpawnActor<ARewindCharacter>(Location, FRotator::ZeroRotator, SpawnParameters);
+		if (!Character) continue;
+
+		Character->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+		Character->LaunchCharacter(FVector(Random.FRandRange(-600.0f, 600.0f), Random.FRandRange(-600.0f, 600.0f), 400.0f), true, true);
+	}
+}
+
+TArray<URewindBenchmarkCommandlet::FPhase> URewindBenchmarkCommandlet::MakeDefaultPhases(const FConfig& Config)
+{
+	TArray<FPhase> Phases;
+	Phases.Add({ TEXT("Record"), Config.RecordSeconds, nullptr });
+
+	// 每档速度：回溯一段时间，然后停止回溯（抹去未来快照）继续记录
+	const TPair<const TCHAR*, void (ARewindGameMode::*)()> SpeedPresets[] = {
+		{ TEXT("Slowest"), &ARewindGameMode::SetRewindSpeedSlowest },
+		{ TEXT("Slower"), &ARewindGameMode::SetRewindSpeedSlower },
+		{ TEXT("Normal"), &ARewindGameMode::SetRewindSpeedNormal },
+		{ TEXT("Faster"), &ARewindGameMode::SetRewindSpeedFaster },
+		{ TEXT("Fastest"), &ARewindGameMode::SetRewindSpeedFastest },
+	};
+	for (const TPair<const TCHAR*, void (ARewindGameMode::*)()>& Preset : SpeedPresets)
+	{
+		void (ARewindGameMode::*SetSpeed)() = Preset.Value;
+		Phases.Add({ FString::Printf(TEXT("Rewind_%s"), Preset.Key), Config.PhaseSeconds, [SetSpeed](ARewindGameMode& GameMode)
+		{
+			(GameMode.*SetSpeed)();
+			GameMode.StartGlobalRewind();
+		} });
+		Phases.Add({ FString::Printf(TEXT("Record_After_%s"), Preset.Key), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+		{
+			GameMode.StopGlobalRewind();
+		} });
+	}
+
+	// 时停：静止 -> 时停中回溯 -> 时停中快进 -> 退出时停
+	Phases.Add({ TEXT("Scrub"), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+	{
+		GameMode.SetRewindSpeedNormal();
+		GameMode.ToggleTimeScrub();
+	} });
+	Phases.Add({ TEXT("Scrub_Rewind"), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+	{
+		GameMode.StartGlobalRewind();
+	} });
+	Phases.Add({ TEXT("Scrub_Hold"), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+	{
+		GameMode.StopGlobalRewind();
+	} });
+	Phases.Add({ TEXT("Scrub_FastForward"), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+	{
+		GameMode.StartGlobalFastForward();
+	} });
+	Phases.Add({ TEXT("Resume"), Config.PhaseSeconds, [](ARewindGameMode& GameMode)
+	{
+		GameMode.StopGlobalFastForward();
+		GameMode.ToggleTimeScrub();
+	} });
+	return Phases;
+}
+
+void URewindBenchmarkCommandlet::RunPhases(UWorld* World, const FConfig& Config, const TArray<FPhase>& Phases, TArray<FPhaseResult>& OutResults)
+{
+	ARewindGameMode* GameMode = World->GetAuthGameMode<ARewindGameMode>();
+	check(GameMode);
+
+	// 固定的模拟步长，测量的是每帧的实际耗时
+	const float DeltaSeconds = 1.0f / Config.FrameRate;
+	auto TickWorld = [World, DeltaSeconds]()
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+		++GFrameCounter;
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	};
+
+	for (const FPhase& Phase : Phases)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(URewindBenchmarkCommandlet::RunPhase);
+		FPhaseResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Name = Phase.Name;
+
+		const int32 NumFrames = FMath::Max(1, FMath::RoundToInt(Phase.DurationSeconds * Config.FrameRate));
+		Result.FrameMilliseconds.Reserve(NumFrames);
+		for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			double FrameMilliseconds;
+			if (Frame == 0 && Phase.Enter)
+			{
+				// 状态切换：时间操作本身加上切换后的第一帧
+				const double StartTime = FPlatformTime::Seconds();
+				Phase.Enter(*GameMode);
+				const double EnterMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+				FrameMilliseconds = TickWorld();
+				Result.TransitionMilliseconds = EnterMilliseconds + FrameMilliseconds;
+			}
+			else
+			{
+				FrameMilliseconds = TickWorld();
+			}
+			Result.FrameMilliseconds.Add(FrameMilliseconds);
+			Result.PeakUsedPhysicalBytes = FMath::Max<uint64>(Result.PeakUsedPhysicalBytes, FPlatformMemory::GetStats().UsedPhysical);
+		}
+		Result.EndUsedPhysicalBytes = FPlatformMemory::GetStats().UsedPhysical;
+		FinalizePhaseResult(Result);
+	}
+}
+
+void URewindBenchmarkCommandlet::RunRollbackBenchmark(UWorld* World, const FConfig& Config, TArray<FPhaseResult>& OutResults)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindBenchmarkCommandlet::RunRollbackBenchmark);
+	URewindRollbackSubsystem* Rollback = World->GetSubsystem<URewindRollbackSubsystem>();
+	check(Rollback);
+
+	const float DeltaSeconds = 1.0f / Config.FrameRate;
+	Rollback->MaxRollbackFrames = Config.RollbackFrames + 1; // 回滚RollbackFrames帧需要再多保存一帧
+	Rollback->FixedStepSeconds = DeltaSeconds;
+
+	OutResults.Reserve(OutResults.Num() + 3);
+	FPhaseResult& SaveResult = OutResults.AddDefaulted_GetRef();
+	SaveResult.Name = TEXT("Rollback_Save");
+	FPhaseResult& LoadResult = OutResults.AddDefaulted_GetRef();
+	LoadResult.Name = TEXT("Rollback_Load");
+	FPhaseResult& ResimulateResult = OutResults.AddDefaulted_GetRef();
+	ResimulateResult.Name = TEXT("Rollback_ResimulatePerFrame");
+
+	// 每帧一个随机物体受到冲量，作为需要重放的输入；每帧都回滚最大帧数，是最坏情况
+	// 内置模型只修正有输入的物体，其余物体停在LoadFrame恢复的状态，最后再载入现在的帧回到现在
+	FRandomStream Random(1);
+	const int32 NumFrames = FMath::Max(1, FMath::RoundToInt(Config.PhaseSeconds * Config.FrameRate));
+	Rollback->SaveFrame(0);
+	for (int32 Frame = 0; Frame < Config.RollbackFrames + NumFrames; ++Frame)
+	{
+		if (Rollback->GetNumBodies() > 0)
+		{
+			FRewindRollbackInput Input;
+			Input.Frame = Frame;
+			Input.BodyIndex = Random.RandHelper(Rollback->GetNumBodies());
+			Input.LinearVelocityChange = Random.GetUnitVector() * 300.0f;
+			Rollback->AddInput(Input);
+		}
+		World->Tick(LEVELTICK_All, DeltaSeconds);
+		++GFrameCounter;
+
+		double StartTime = FPlatformTime::Seconds();
+		Rollback->SaveFrame(Frame + 1);
+		const double SaveMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		// 保存的帧足够之后才开始统计
+		if (Frame < Config.RollbackFrames) continue;
+		SaveResult.FrameMilliseconds.Add(SaveMilliseconds);
+
+		const int32 RollbackFrame = Frame + 1 - Config.RollbackFrames;
+		StartTime = FPlatformTime::Seconds();
+		Rollback->LoadFrame(RollbackFrame);
+		LoadResult.FrameMilliseconds.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+		StartTime = FPlatformTime::Seconds();
+		Rollback->Resimulate(RollbackFrame, Config.RollbackFrames);
+		ResimulateResult.FrameMilliseconds.Add((FPlatformTime::Seconds() - StartTime) * 1000.0 / Config.RollbackFrames);
+		Rollback->LoadFrame(Frame + 1);
+	}
+
+	UE_LOG(LogRewind, Display, TEXT("Rollback: %d bodies, %.1f KB per frame, %d frames"),
+		Rollback->GetNumBodies(), Rollback->GetFrameSizeBytes() / 1024.0, Config.RollbackFrames);
+	const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+	for (FPhaseResult* Result : { &SaveResult, &LoadResult, &ResimulateResult })
+	{
+		Result->PeakUsedPhysicalBytes = Result->EndUsedPhysicalBytes = UsedPhysical;
+		FinalizePhaseResult(*Result);
+	}
+}
+
+void URewindBenchmarkCommandlet::FinalizePhaseResult(FPhaseResult& Result)
+{
+	TArray<double> Sorted = Result.FrameMilliseconds;
+	Sorted.Sort();
+	double Sum = 0.0;
+	for (double Value : Sorted) Sum += Value;
+	Result.AverageMilliseconds = Sum / Sorted.Num();
+	Result.P95Milliseconds = Sorted[FMath::Min(Sorted.Num() - 1, FMath::FloorToInt(Sorted.Num() * 0.95))];
+	Result.MaxMilliseconds = Sorted.Last();
+
+	UE_LOG(LogRewind, Display, TEXT("%-20s avg %7.3f ms  p95 %7.3f ms  max %7.3f ms  transition %7.3f ms  mem %.1f MB"),
+		*Result.Name, Result.AverageMilliseconds, Result.P95Milliseconds, Result.MaxMilliseconds,
+		Result.TransitionMilliseconds, Result.EndUsedPhysicalBytes / (1024.0 * 1024.0));
+}
+
+void URewindBenchmarkCommandlet::WriteReports(const FConfig& Config, const TArray<FPhaseResult>& Results, const FString& BaseFileName)
+{
+	constexpr double BytesToMegabytes = 1.0 / (1024.0 * 1024.0);
+
+	// CSV：每个阶段一行
+	FString Csv = TEXT("Phase,Frames,AvgMs,P95Ms,MaxMs,TransitionMs,PeakMB,SteadyMB\n");
+	for (const FPhaseResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%s,%d,%.4f,%.4f,%.4f,%.4f,%.2f,%.2f\n"),
+			*Result.Name, Result.FrameMilliseconds.Num(), Result.AverageMilliseconds, Result.P95Milliseconds,
+			Result.MaxMilliseconds, Result.TransitionMilliseconds,
+			Result.PeakUsedPhysicalBytes * BytesToMegabytes, Result.EndUsedPhysicalBytes * BytesToMegabytes);
+	}
+
+	// JSON：同样的数据加上测试配置，可直接作为以后的基准文件
+	const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("NumStaticMeshActors"), Config.NumStaticMeshActors);
+	Root->SetNumberField(TEXT("NumCharacters"), Config.NumCharacters);
+	Root->SetNumberField(TEXT("FrameRate"), Config.FrameRate);
+	TArray<TSharedPtr<FJsonValue>> Phases;
+	for (const FPhaseResult& Result : Results)
+	{
+		const TSharedRef<FJsonObject> Phase = MakeShared<FJsonObject>();
+		Phase->SetStringField(TEXT("Name"), Result.Name);
+		Phase->SetNumberField(TEXT("Frames"), Result.FrameMilliseconds.Num());
+		Phase->SetNumberField(TEXT("AvgMs"), Result.AverageMilliseconds);
+		Phase->SetNumberField(TEXT("P95Ms"), Result.P95Milliseconds);
+		Phase->SetNumberField(TEXT("MaxMs"), Result.MaxMilliseconds);
+		Phase->SetNumberField(TEXT("TransitionMs"), Result.TransitionMilliseconds);
+		Phase->SetNumberField(TEXT("PeakMB"), Result.PeakUsedPhysicalBytes * BytesToMegabytes);
+		Phase->SetNumberField(TEXT("SteadyMB"), Result.EndUsedPhysicalBytes * BytesToMegabytes);
+		Phases.Add(MakeShared<FJsonValueObject>(Phase));
+	}
+	Root->SetArrayField(TEXT("Phases"), Phases);
+
+	FString Json;
+	FJsonSerializer::Serialize(Root, TJsonWriterFactory<>::Create(&Json));
+
+	const FString CsvPath = FPaths::Combine(Config.OutputDirectory, BaseFileName + TEXT(".csv"));
+	const FString JsonPath = FPaths::Combine(Config.OutputDirectory, BaseFileName + TEXT(".json"));
+	if (FFileHelper::SaveStringToFile(Csv, *CsvPath) && FFileHelper::SaveStringToFile(Json, *JsonPath))
+	{
+		UE_LOG(LogRewind, Display, TEXT("Benchmark reports written to %s(.csv/.json)"), *FPaths::Combine(Config.OutputDirectory, BaseFileName));
+	}
+	else
+	{
+		UE_LOG(LogRewind, Error, TEXT("Failed to write benchmark reports to %s"), *Config.OutputDirectory);
+	}
+}
+
+bool URewindBenchmarkCommandlet::CompareWithBaseline(const FConfig& Config, const TArray<FPhaseResult>& Results)
+{
+	FString Json;
+	TSharedPtr<FJsonObject> Root;
+	if (!FFileHelper::LoadFileToString(Json, *Config.BaselinePath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Root) || !Root.IsValid())
+	{
+		UE_LOG(LogRewind, Error, TEXT("Failed to read benchmark baseline %s"), *Config.BaselinePath);
+		return true;
+	}
+
+	if (Root->GetIntegerField(TEXT("NumStaticMeshActors")) != Config.NumStaticMeshActors
+		|| Root->GetIntegerField(TEXT("NumCharacters")) != Config.NumCharacters)
+	{
+		UE_LOG(LogRewind, Warning, TEXT("Baseline %s was recorded with a different scene size"), *Config.BaselinePath);
+	}
+
+	TMap<FString, TSharedPtr<FJsonObject>> BaselinePhases;
+	for (const TSharedPtr<FJsonValue>& Value : Root->GetArrayField(TEXT("Phases")))
+	{
+		const TSharedPtr<FJsonObject> Phase = Value->AsObject();
+		if (Phase.IsValid()) BaselinePhases.Add(Phase->GetStringField(TEXT("Name")), Phase);
+	}
+
+	// 平均帧耗时和切换尖峰超过基准(1 + 阈值)倍时视为退化
+	bool bRegressed = false;
+	auto CompareMetric = [&Config, &bRegressed](const FString& PhaseName, const TCHAR* Metric, double Baseline, double Current)
+	{
+		if (Baseline <= 0.0) return;
+		const double Ratio = Current / Baseline - 1.0;
+		const bool bMetricRegressed = Ratio > Config.RegressionThreshold;
+		bRegressed |= bMetricRegressed;
+		UE_LOG(LogRewind, Display, TEXT("%-20s %-13s baseline %7.3f ms  current %7.3f ms  %+6.1f%%%s"),
+			*PhaseName, Metric, Baseline, Current, Ratio * 100.0, bMetricRegressed ? TEXT("  REGRESSION") : TEXT(""));
+	};
+
+	for (const FPhaseResult& Result : Results)
+	{
+		const TSharedPtr<FJsonObject>* BaselinePhase = BaselinePhases.Find(Result.Name);
+		if (!BaselinePhase) continue;
+
+		CompareMetric(Result.Name, TEXT("AvgMs"), (*BaselinePhase)->GetNumberField(TEXT("AvgMs")), Result.AverageMilliseconds);
+		CompareMetric(Result.Name, TEXT("TransitionMs"), (*BaselinePhase)->GetNumberField(TEXT("TransitionMs")), Result.TransitionMilliseconds);
+	}
+	return bRegressed;
+}
@@ -7,6 +7,7 @@
 #include "GameMode/RewindGameMode.h"
 #include "EnhancedInputComponent.h"
 #include "RewindLearned/Public/Component/RewindComponent.h"
+#include "Events/RewindEventLogSubsystem.h"
 
 // Sets default values
 ARewindCharacter::ARewindCharacter()
@@ -35,76 +36,103 @@ void ARewindCharacter::BeginPlay()
 		}
 	}
 
-	// 获取GameMode
+	// 获取GameMode（只在服务器上存在，客户端通过RPC请求服务器）
 	GameMode = Cast<ARewindGameMode>(GetWorld()->GetAuthGameMode());
 }
 
 void ARewindCharacter::ToggleTimeScrub(const FInputActionValue& Value)
 {
-	check(GameMode);
-	//GEngine->AddOnScreenDebugMessage(-1, 10, FColor::Blue, FString::Printf(TEXT("ToggleTimeScrubAction")));
-	if (GameMode) GameMode->ToggleTimeScrub();
+	IssueTimeCommand(ERewindTimeCommand::ToggleTimeScrub);
 }
 
 void ARewindCharacter::Rewind(const FInputActionValue& Value)
 {
-	check(GameMode);
-	//GEngine->AddOnScreenDebugMessage(-1, 10, FColor::Blue, FString::Printf(TEXT("RewindAction")));
-	if (GameMode) GameMode->StartGlobalRewind();
+	IssueTimeCommand(ERewindTimeCommand::StartRewind);
 }
 
 void ARewindCharacter::StopRewinding(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->StopGlobalRewind();
+	IssueTimeCommand(ERewindTimeCommand::StopRewind);
 }
 
 void ARewindCharacter::FastForward(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->StartGlobalFastForward();
+	IssueTimeCommand(ERewindTimeCommand::StartFastForward);
 }
 
 void ARewindCharacter::StopFastForwarding(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->StopGlobalFastForward();
+	IssueTimeCommand(ERewindTimeCommand::StopFastForward);
 }
 
 void ARewindCharacter::SetRewindSpeedSlowest(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->SetRewindSpeedSlowest();
+	IssueTimeCommand(ERewindTimeCommand::SetSpeedSlowest);
 }
 
 void ARewindCharacter::SetRewindSpeedSlower(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->SetRewindSpeedSlower();
+	IssueTimeCommand(ERewindTimeCommand::SetSpeedSlower);
 }
 
 void ARewindCharacter::SetRewindSpeedNormal(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->SetRewindSpeedNormal();
+	IssueTimeCommand(ERewindTimeCommand::SetSpeedNormal);
 }
 
 void ARewindCharacter::SetRewindSpeedFaster(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->SetRewindSpeedFaster();
+	IssueTimeCommand(ERewindTimeCommand::SetSpeedFaster);
 }
 
 void ARewindCharacter::SetRewindSpeedFastest(const FInputActionValue& Value)
 {
-	check(GameMode);
-	if (GameMode) GameMode->SetRewindSpeedFastest();
+	IssueTimeCommand(ERewindTimeCommand::SetSpeedFastest);
 }
 
 void ARewindCharacter::ToggleRewindParticipation(const FInputActionValue& Value)
 {
-	// 自身是否参与时间回溯可以通过开关自身的component实现
-	RewindComponent->SetIsRewindingEnabled(!RewindComponent->IsRewindingEnabled());
+	ServerToggleRewindParticipation();
+}
+
+void ARewindCharacter::IssueTimeCommand(ERewindTimeCommand Command)
+{
+	if (HasAuthority())
+	{
+		check(GameMode);
+		if (GameMode) GameMode->ExecuteTimeCommand(Command);
+	}
+	else
+	{
+		ServerIssueTimeCommand(Command);
+	}
+}
+
+void ARewindCharacter::ServerIssueTimeCommand_Implementation(ERewindTimeCommand Command)
+{
+	IssueTimeCommand(Command);
+}
+
+void ARewindCharacter::ServerToggleRewindParticipation_Implementation()
+{
+	// 自身是否参与时间回溯可以通过开关自身的component实现，开关状态会复制给客户端
+	const bool bWasEnabled = RewindComponent->IsRewindingEnabled();
+	RewindComponent->SetIsRewindingEnabled(!bWasEnabled);
+
+	// 正常时间流逝时的开关是时间线的一部分，回溯越过时恢复原来的状态；时间操作期间的开关不记录
+	if (URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>())
+	{
+		TWeakObjectPtr<URewindComponent> WeakComponent(RewindComponent);
+		EventLog->RecordEvent(TEXT("RewindParticipation"), this,
+			[WeakComponent, bWasEnabled]()
+			{
+				if (URewindComponent* Component = WeakComponent.Get()) Component->SetIsRewindingEnabled(bWasEnabled);
+			},
+			[WeakComponent, bWasEnabled](float)
+			{
+				if (URewindComponent* Component = WeakComponent.Get()) Component->SetIsRewindingEnabled(!bWasEnabled);
+			});
+	}
 }
 
 // Called every frame
@@ -3,9 +3,15 @@
 
 #include "RewindLearned/Public/Component/RewindComponent.h"
 
+#include "Algo/BinarySearch.h"
+#include "Async/Async.h"
+#include "Component/RewindHistorySimplifier.h"
 #include "GameFramework/Character.h"
 #include "GameFramework/CharacterMovementComponent.h"
-#include "RewindLearned/Public/GameMode/RewindGameMode.h"
+#include "GameMode/RewindGameState.h"
+#include "Net/UnrealNetwork.h"
+#include "Stats/RewindStats.h"
+#include "Streaming/RewindHistoryColdStorage.h"
 
 // Sets default values for this component's properties
 URewindComponent::URewindComponent()
@@ -16,6 +22,9 @@ URewindComponent::URewindComponent()
 
 	// 时间回溯需要基于最新的物理状态，物理模拟完成后可以避免“脏读数据”
 	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	// 时间操作期间由服务器把回放结果发送给客户端
+	SetIsReplicatedByDefault(true);
 }
 
 
@@ -26,15 +35,26 @@ void URewindComponent::BeginPlay()
 	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::BeginPlay);
 	Super::BeginPlay();
 
-	// 获得GameMode
-	GameMode = Cast<ARewindGameMode>(GetWorld()->GetAuthGameMode());
-	if (!GameMode)
+	// 获得GameState（GameMode只存在于服务器，客户端通过GameState获得全局时间状态）
+	GameState = GetWorld()->GetGameState<ARewindGameState>();
+	if (!GameState)
 	{
-		// 没有GameMode无法全体同步，禁用Tick
+		// 没有GameState无法全体同步，禁用Tick
 		SetComponentTickEnabled(false);
 		return;
 	}
 
+	// 判断网络角色：服务器负责发送回放结果，客户端上复制的Actor跟随服务器回放
+	AActor* Owner = GetOwner();
+	bIsNetPlaybackAuthority = Owner->GetIsReplicated() && Owner->HasAuthority() && GetNetMode() != NM_Standalone;
+	bIsNetPlaybackFollower = ShouldFollowNetPlayback();
+
+	// 客户端的控制器在BeginPlay之后才复制过来，拥有控制权时改为本地记录和回放
+	if (APawn* OwnerPawn = Cast<APawn>(Owner))
+	{
+		OwnerPawn->ReceiveControllerChangedDelegate.AddUniqueDynamic(this, &URewindComponent::OnOwnerControllerChanged);
+	}
+
 	// 获取Owner相关的组件
 	OwnerRootComponent = Cast<UPrimitiveComponent>(GetOwner()->GetRootComponent());
 	const ACharacter* Character = Cast<ACharacter>(GetOwner());
@@ -48,49 +68,280 @@ void URewindComponent::BeginPlay()
 		OwnerSkeletalMesh = Character ? Character->GetMesh() : nullptr;
 	}
 
-	// 绑定GameMode的全局事件
-	GameMode->OnGlobalRewindStarted.AddUniqueDynamic(this, &URewindComponent::OnGlobalRewindStarted);
-	GameMode->OnGlobalRewindCompleted.AddUniqueDynamic(this, &URewindComponent::OnGlobalRewindCompleted);
-	GameMode->OnGlobalFastForwardStarted.AddUniqueDynamic(this, &URewindComponent::OnGlobalFastForwardStarted);
-	GameMode->OnGlobalFastForwardCompleted.AddUniqueDynamic(this, &URewindComponent::URewindComponent::OnGlobalFastForwardCompleted);
-	GameMode->OnGlobalTimeScrubStarted.AddUniqueDynamic(this, &URewindComponent::OnGlobalTimeScrubStarted);
-	GameMode->OnGlobalTimeScrubCompleted.AddUniqueDynamic(this, &URewindComponent::URewindComponent::OnGlobalTimeScrubCompleted);
+	// 检查点+重新模拟：只用于模拟物理的owner，重新模拟使用owner当前的重力和阻尼
+	PhysicsResimulationSettings = GameState->GetPhysicsResimulationSettings();
+	bUsePhysicsResimulation = PhysicsResimulationSettings.bEnabled && !bIsNetPlaybackFollower && OwnerRootComponent && OwnerRootComponent->IsSimulatingPhysics();
+	if (bUsePhysicsResimulation)
+	{
+		ResimulationModel.Gravity = OwnerRootComponent->IsGravityEnabled() ? FVector(0.0f, 0.0f, GetWorld()->GetGravityZ()) : FVector::ZeroVector;
+		ResimulationModel.LinearDamping = OwnerRootComponent->GetLinearDamping();
+		ResimulationModel.AngularDamping = OwnerRootComponent->GetAngularDamping();
+	}
+
+	// 注册到回溯注册表，GameState的全局状态变化（服务器和客户端都会分发）通过注册表直接调用组件
+	Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	if (Registry) Registry->Register(this);
 
-	// 分配环形缓冲区
-	InitializeRingBuffers(GameMode->MaxRewindSeconds);
+	OwnerBaseTimeDilation = Owner->CustomTimeDilation;
+
+	// 跟随服务器回放的客户端组件不需要本地历史，也不需要Tick
+	UpdateTickSchedule();
+	if (!bIsNetPlaybackFollower) InitializeLocalHistory();
+
+	// 加入的时钟（例如生成在正在回溯的时间泡中）可能已经处于时间操作中
+	ApplyRewindingEnabledState();
+	ApplyClockTimeDilation();
 }
 
+void URewindComponent::InitializeLocalHistory()
+{
+	if (bHasLocalHistory) return;
+	bHasLocalHistory = true;
+	const AActor* Owner = GetOwner();
+
+	// 分配快照历史
+	InitializeSnapshotHistory(GameState->GetMaxRewindSeconds());
 
+	// 需要记录的子组件，根组件的Transform已经由快照记录
+	TArray<USceneComponent*> SceneComponents;
+	GetOwner()->GetComponents(SceneComponents);
+	for (USceneComponent* SceneComponent : SceneComponents)
+	{
+		if (SceneComponent != Owner->GetRootComponent() && RecordedChildComponents.Contains(SceneComponent->GetFName()))
+		{
+			ChildTracks.AddDefaulted_GetRef().Component = SceneComponent;
+		}
+	}
+
+	// 所在单元之前被卸载过：冷历史留在冷存储中，第一次进入时间操作时才接回
+	const URewindHistoryColdStorage* ColdStorage = GetWorld()->GetSubsystem<URewindHistoryColdStorage>();
+	ColdHistoryKey = URewindHistoryColdStorage::GetActorKey(Owner);
+	bHasColdHistory = ColdStorage && !ColdHistoryKey.IsEmpty() && ColdStorage->Contains(ColdHistoryKey);
+}
+
+bool URewindComponent::ShouldFollowNetPlayback() const
+{
+	/* 客户端上复制的Actor跟随服务器的回放；本地控制的Pawn正在被客户端预测，跟随服务器的锚点会与预测冲突，改为在本地回放自己的历史 */
+	const AActor* Owner = GetOwner();
+	const APawn* OwnerPawn = Cast<APawn>(Owner);
+	return Owner->GetIsReplicated() && !Owner->HasAuthority() && !(OwnerPawn && OwnerPawn->IsLocallyControlled());
+}
+
+void URewindComponent::OnOwnerControllerChanged(APawn* Pawn, AController* OldController, AController* NewController)
+{
+	const bool bWasFollower = bIsNetPlaybackFollower;
+	bIsNetPlaybackFollower = ShouldFollowNetPlayback();
+	if (bWasFollower == bIsNetPlaybackFollower || !GameState) return;
+
+	// 开始在本地记录：从此刻起的历史可以在本地回放
+	if (!bIsNetPlaybackFollower) InitializeLocalHistory();
+	UpdateTickSchedule();
+	ApplyRewindingEnabledState();
+}
+
+void URewindComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// World Partition单元或流送关卡被卸载，owner之后会随单元重新加载
+	if (EndPlayReason == EEndPlayReason::RemovedFromWorld) StoreColdHistory();
+
+	if (Registry) Registry->Unregister(this);
+	Registry = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
 
 // Called every frame
 void URewindComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
 {
 	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
+	// 回放受注册表的帧预算调度，没有轮到的组件只推进时间轴
+	const bool bIsPlayback = IsTimeBeingManipulated();
+	bDeferPlaybackApply = bIsPlayback && Registry && !Registry->ShouldApplyPlayback(this);
+	const uint64 PlaybackStartCycles = bIsPlayback ? FPlatformTime::Cycles64() : 0;
+
 	// 按照状态变量进行对应的操作
-	if (bIsRewinding) PlaySnapshots(DeltaTime, true);
-	else if (bIsFastForwarding) PlaySnapshots(DeltaTime, false);
-	else if (bIsTimeScrubbing) PauseTime(DeltaTime, bLastTimeManipulationWasRewind);
-	else RecordSnapshot(DeltaTime);
+	if (bIsRewinding)
+	{
+		REWIND_STATS_ACTIVE_COMPONENT(ERewindStatsState::Rewinding);
+		PlaySnapshots(DeltaTime, true);
+	}
+	else if (bIsFastForwarding)
+	{
+		REWIND_STATS_ACTIVE_COMPONENT(ERewindStatsState::FastForwarding);
+		PlaySnapshots(DeltaTime, false);
+	}
+	else if (bIsTimeScrubbing)
+	{
+		REWIND_STATS_ACTIVE_COMPONENT(ERewindStatsState::Scrubbing);
+		PauseTime(DeltaTime, bLastTimeManipulationWasRewind);
+	}
+	else
+	{
+		REWIND_STATS_ACTIVE_COMPONENT(ERewindStatsState::Recording);
+		RecordSnapshot(GetUndilatedDeltaTime(DeltaTime));
+
+		// 到达自己的记录相位后，改为按快照频率Tick
+		if (bAwaitingSnapshotPhase)
+		{
+			bAwaitingSnapshotPhase = false;
+			SetComponentTickInterval(GetRecordTickIntervalSeconds());
+		}
+	}
+
+	if (bIsPlayback && !bDeferPlaybackApply)
+	{
+		// 服务器把本帧的回放结果写入复制变量
+		if (bIsNetPlaybackAuthority) UpdateNetPlaybackState();
+		if (Registry) Registry->ReportPlaybackCost(this, FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - PlaybackStartCycles));
+	}
+	bDeferPlaybackApply = false;
+}
+
+void URewindComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(URewindComponent, bIsRewindingEnabled);
+
+	// 回放数据由PreReplication按是否处于时间操作开关，只有COND_Custom的属性才会响应开关
+	FDoRepLifetimeParams PlaybackParams;
+	PlaybackParams.Condition = COND_Custom;
+	DOREPLIFETIME_WITH_PARAMS_FAST(URewindComponent, NetPlaybackAnchor, PlaybackParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(URewindComponent, NetPlaybackState, PlaybackParams);
+}
+
+void URewindComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// 回放数据只在时间操作期间有效；owner不相关（超出裁剪距离）的连接本身就不会复制该组件
+	const bool bStreamPlayback = IsTimeBeingManipulated();
+	DOREPLIFETIME_ACTIVE_OVERRIDE_FAST(URewindComponent, NetPlaybackAnchor, bStreamPlayback);
+	DOREPLIFETIME_ACTIVE_OVERRIDE_FAST(URewindComponent, NetPlaybackState, bStreamPlayback);
 }
 
 void URewindComponent::SetIsRewindingEnabled(bool bEnabled)
 {
 	/* 该函数可关闭组件时间操作功能，当角色不参加时间操作的时候会调用该函数关闭时间操作功能 */
 	bIsRewindingEnabled = bEnabled;
+	ApplyRewindingEnabledState();
+}
+
+void URewindComponent::OnRep_IsRewindingEnabled()
+{
+	ApplyRewindingEnabledState();
+}
+
+void URewindComponent::ApplyRewindingEnabledState()
+{
+	// BeginPlay之前收到的复制值会在BeginPlay之后由全局事件自然同步
+	if (!GameState) return;
+
 	if (!bIsRewindingEnabled) // 关闭回溯功能后，则对所有正在进行的时间操作进行终止
 	{
-		if (bIsRewinding) {OnGlobalRewindStarted();}
+		if (bIsRewinding) {OnGlobalRewindCompleted();}
 		if (bIsFastForwarding) {OnGlobalFastForwardCompleted();}
 		if (bIsTimeScrubbing) {OnGlobalTimeScrubCompleted();}
 	}
 	else
 	{
-		check(GameMode);
-		/* 同步全局的状态（状态一致性：该操作让世界中的所有可时间操作的物体进行同步） */
-		if (!bIsRewinding && GameMode->IsGlobalRewinding()) OnGlobalRewindStarted();
-		if (!bIsFastForwarding && GameMode->IsGlobalFastForwarding()) OnGlobalFastForwardStarted();
-		if (!bIsTimeScrubbing && GameMode->IsGlobalTimeScrubbing()) OnGlobalTimeScrubStarted();
+		/* 同步所在时钟的状态（状态一致性：该操作让同一时钟下所有可时间操作的物体进行同步） */
+		const FRewindGlobalTimeState ClockState = Registry ? Registry->GetClock(ClockIndex).State : GameState->GetTimeState();
+		if (!bIsTimeScrubbing && ClockState.bIsTimeScrubbing) OnGlobalTimeScrubStarted();
+		if (!bIsRewinding && ClockState.bIsRewinding) OnGlobalRewindStarted();
+		if (!bIsFastForwarding && ClockState.bIsFastForwarding) OnGlobalFastForwardStarted();
+	}
+}
+
+void URewindComponent::BeginExternalPlayback()
+{
+	/* 外部回放直接设置owner的变换：记录、角色移动和物理模拟继续运行会与回放的姿势互相覆盖，并把回放的姿势记进历史 */
+	if (bIsExternalPlayback) return;
+
+	// 先结束进行中的时间操作（与关闭回溯功能相同），owner回到时间线的最新姿势
+	if (bIsRewinding) {OnGlobalRewindCompleted();}
+	if (bIsFastForwarding) {OnGlobalFastForwardCompleted();}
+	if (bIsTimeScrubbing) {OnGlobalTimeScrubCompleted();}
+
+	// 补记当前时刻，历史以接管前的姿势结束
+	if (bHasLocalHistory) RecordCurrentSnapshot();
+	bIsExternalPlayback = true;
+
+	// 与时间操作相同的运动学路径：根组件停止模拟，角色运动组件停止Tick
+	PausePhysics();
+	if (OwnerMovementComponent && OwnerMovementComponent->IsComponentTickEnabled())
+	{
+		bPausedMovementComponent = true;
+		OwnerMovementComponent->StopMovementImmediately();
+		OwnerMovementComponent->SetComponentTickEnabled(false);
+	}
+	UpdateTickSchedule();
+}
+
+void URewindComponent::EndExternalPlayback()
+{
+	if (!bIsExternalPlayback) return;
+	bIsExternalPlayback = false;
+
+	if (bPausedMovementComponent)
+	{
+		bPausedMovementComponent = false;
+		OwnerMovementComponent->SetComponentTickEnabled(true);
+	}
+	// 回放没有速度信息，从回放结束的姿势静止开始模拟
+	UnpausePhysics(nullptr);
+
+	if (bHasLocalHistory && TransformAndVelocitySnapshots.Num() != 0)
+	{
+		// 间隔为0的快照：插值不会跨越回放期间从接管前的姿势滑到回放结束的姿势
+		TimeSinceSnapshotsChanged = 0.0f;
+		RecordSnapshot(0.0f, true);
+	}
+
+	bIsPauseSettled = false;
+	UpdateTickSchedule();
+
+	// 回放期间错过的全局时间操作
+	ApplyRewindingEnabledState();
+}
+
+void URewindComponent::SyncToClockState(const FRewindGlobalTimeState& OldState, const FRewindGlobalTimeState& NewState)
+{
+	TArray<ERewindGlobalTransition, TInlineAllocator<6>> Transitions;
+	URewindComponentRegistry::GetTransitions(OldState, NewState, Transitions);
+	for (const ERewindGlobalTransition Transition : Transitions) HandleGlobalTransition(Transition);
+	ApplyClockTimeDilation();
+}
+
+void URewindComponent::ApplyClockTimeDilation()
+{
+	/* 慢动作区域：正常时间流逝时通过owner的CustomTimeDilation减慢其Tick和物理以外的逻辑，回放速度由时钟的回溯速度控制 */
+	if (!Registry || bIsNetPlaybackFollower) return;
+
+	const float ClockTimeDilation = IsTimeBeingManipulated() ? 1.0f : Registry->GetClock(ClockIndex).TimeDilation;
+	if (ClockTimeDilation == 1.0f && !bAppliedClockTimeDilation) return; // 没有修改过，不覆盖owner自己的设置
+
+	GetOwner()->CustomTimeDilation = OwnerBaseTimeDilation * ClockTimeDilation;
+	bAppliedClockTimeDilation = ClockTimeDilation != 1.0f;
+}
+
+float URewindComponent::GetClockRewindSpeed() const
+{
+	return Registry ? Registry->GetClock(ClockIndex).State.GlobalRewindSpeed : GameState->GetGlobalRewindSpeed();
+}
+
+void URewindComponent::HandleGlobalTransition(ERewindGlobalTransition Transition)
+{
+	switch (Transition)
+	{
+	case ERewindGlobalTransition::TimeScrubStarted: OnGlobalTimeScrubStarted(); break;
+	case ERewindGlobalTransition::RewindStarted: OnGlobalRewindStarted(); break;
+	case ERewindGlobalTransition::FastForwardStarted: OnGlobalFastForwardStarted(); break;
+	case ERewindGlobalTransition::RewindCompleted: OnGlobalRewindCompleted(); break;
+	case ERewindGlobalTransition::FastForwardCompleted: OnGlobalFastForwardCompleted(); break;
+	case ERewindGlobalTransition::TimeScrubCompleted: OnGlobalTimeScrubCompleted(); break;
+	default: checkNoEntry();
 	}
 }
 
@@ -120,7 +371,7 @@ void URewindComponent::OnGlobalTimeScrubStarted()
 	const bool bAlreadyManipulatingTime = IsTimeBeingManipulated();
 	if (TryStartTimeManipulation(bIsTimeScrubbing, false))
 	{
-		OnFastForwardStarted.Broadcast();
+		OnTimeScrubStarted.Broadcast();
 		if (!bAlreadyManipulatingTime) OnTimeManipulationStarted.Broadcast(); 
 	}
 }
@@ -148,7 +399,7 @@ bool URewindComponent::HandleInsufficientSnapshots()
 	// 一快照的情况： 无法进行插值，则直接使用仅剩的一个快照
 	if (TransformAndVelocitySnapshots.Num() == 1)
 	{
-		ApplySnapshot(TransformAndVelocitySnapshots[0], false);
+		ApplySnapshot(TransformAndVelocitySnapshots[0]);
 		if (bSnapshotMovementVelocityAndMode) ApplySnapshot(MovementVelocityAndModeSnapshots[0], true);
 		return true;
 	}
@@ -161,6 +412,8 @@ bool URewindComponent::HandleInsufficientSnapshots()
 void URewindComponent::InterpolateAndApplySnapshots(bool bRewinding)
 {
 	/* 寻找并计算两个snapshot之间的平滑插值状态，并应用至Actor */
+	if (bDeferPlaybackApply) return;
+
 	// 前置安全性检查
 	constexpr int MinSnapshotForInterpolation = 2; // 设置至少2个snapshot进行线性插值
 	check(TransformAndVelocitySnapshots.Num() >= MinSnapshotForInterpolation);
@@ -181,10 +434,26 @@ void URewindComponent::InterpolateAndApplySnapshots(bool bRewinding)
 		// Alpha = 当前的插值进度 / 两个快照间的总时长
 		// NextSnapshot.TimeSinceLastSnapshot 存储了 A 和 B 之间的时间间隔。
 		// TimeSinceSnapshotsChanged 存储了我们在这段间隔中“走”了多远。
-		const float Alpha = TimeSinceSnapshotsChanged / NextSnapshot.TimeSinceLastSnapshot;
+		// 间隔为0的快照是不连续点（例如冷历史的间隙），直接跳到目标快照
+		const float Alpha = NextSnapshot.TimeSinceLastSnapshot > UE_KINDA_SMALL_NUMBER ? TimeSinceSnapshotsChanged / NextSnapshot.TimeSinceLastSnapshot : 1.0f;
 		
-		const FTransformAndVelocitySnapshot BlendSnapshotResult = BlendSnapshots(PreviousSnapshot, NextSnapshot, Alpha);
-		ApplySnapshot(BlendSnapshotResult, false);
+		FTransformAndVelocitySnapshot BlendSnapshotResult;
+		BlendSnapshotResult.RecordedTime = FMath::Lerp(PreviousSnapshot.RecordedTime, NextSnapshot.RecordedTime, FMath::Clamp(Alpha, 0.0f, 1.0f));
+		if (bUsePhysicsResimulation)
+		{
+			// 检查点之间的状态由重新模拟得到；区间从较早的检查点开始，同时预先计算回放方向上的下一个区间
+			const int32 FirstIndex = FMath::Min(PreviousIndex, LatestSnapshotIndex);
+			const float Interval = TransformAndVelocitySnapshots[FirstIndex + 1].TimeSinceLastSnapshot;
+			const float IntervalAlpha = FMath::Clamp(bRewinding ? 1.0f - Alpha : Alpha, 0.0f, 1.0f);
+			BlendSnapshotResult = GetResimulatedSnapshot(FirstIndex, IntervalAlpha * Interval);
+			PrefetchResimulatedInterval(bRewinding ? FirstIndex - 1 : FirstIndex + 1);
+		}
+		else
+		{
+			REWIND_SCOPE_CYCLE_COUNTER(Blend);
+			BlendSnapshotResult = BlendSnapshots(PreviousSnapshot, NextSnapshot, Alpha, InterpolationMode);
+		}
+		ApplySnapshot(BlendSnapshotResult);
 	}
 
 	if (bSnapshotMovementVelocityAndMode) // 角色的运动状态选项
@@ -192,15 +461,211 @@ void URewindComponent::InterpolateAndApplySnapshots(bool bRewinding)
 		const FMovementVelocityAndModeSnapshot &PreviousSnapshot = MovementVelocityAndModeSnapshots[PreviousIndex];
 		const FMovementVelocityAndModeSnapshot &NextSnapshot = MovementVelocityAndModeSnapshots[LatestSnapshotIndex];
 
-		const float Alpha = TimeSinceSnapshotsChanged / NextSnapshot.TimeSinceLastSnapshot;
+		const float Alpha = NextSnapshot.TimeSinceLastSnapshot > UE_KINDA_SMALL_NUMBER ? TimeSinceSnapshotsChanged / NextSnapshot.TimeSinceLastSnapshot : 1.0f;
 
-		const FMovementVelocityAndModeSnapshot BlendSnapshotResult = BlendSnapshots(PreviousSnapshot, NextSnapshot, Alpha);
+		FMovementVelocityAndModeSnapshot BlendSnapshotResult;
+		{
+			REWIND_SCOPE_CYCLE_COUNTER(Blend);
+			BlendSnapshotResult = BlendSnapshots(PreviousSnapshot, NextSnapshot, Alpha);
+		}
 		ApplySnapshot(BlendSnapshotResult, true);
 	}
 }
 
+bool URewindComponent::GetSnapshotAtTime(float Time, FTransformAndVelocitySnapshot& OutSnapshot) const
+{
+	/* 线程安全：读取期间若游戏线程记录了新快照，seqlock会让本次读取重试 */
+	REWIND_SCOPE_CYCLE_COUNTER(Seek);
+	FTransformAndVelocitySnapshot Result;
+	const bool bFound = HistoryLock.Read([this, Time, &Result]()
+	{
+		return FindSnapshotAtTimeUnsynchronized(Time, Result);
+	});
+	if (bFound) OutSnapshot = Result;
+	return bFound;
+}
+
+bool URewindComponent::GetTransformAtTime(float Time, FTransform& OutTransform) const
+{
+	FTransformAndVelocitySnapshot Snapshot;
+	if (!GetSnapshotAtTime(Time, Snapshot)) return false;
+	OutTransform = Snapshot.Transform;
+	return true;
+}
+
+bool URewindComponent::GetVelocityAtTime(float Time, FVector& OutLinearVelocity, FVector& OutAngularVelocityInRadians) const
+{
+	FTransformAndVelocitySnapshot Snapshot;
+	if (!GetSnapshotAtTime(Time, Snapshot)) return false;
+	OutLinearVelocity = Snapshot.LinearVelocity;
+	OutAngularVelocityInRadians = Snapshot.AngularVelocityInRadians;
+	return true;
+}
+
+void URewindComponent::GetSnapshotsAtTime(TConstArrayView<const URewindComponent*> Components, float Time,
+	TArray<FTransformAndVelocitySnapshot>& OutSnapshots, TBitArray<>& OutValid)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::GetSnapshotsAtTime);
+	OutSnapshots.SetNum(Components.Num());
+	OutValid.Init(false, Components.Num());
+	for (int32 Index = 0; Index < Components.Num(); ++Index)
+	{
+		const URewindComponent* Component = Components[Index];
+		OutValid[Index] = Component && Component->GetSnapshotAtTime(Time, OutSnapshots[Index]);
+	}
+}
+
+float URewindComponent::GetPlaybackTime() const
+{
+	/* 与InterpolateAndApplySnapshots相同的插值进度；没有轮到应用回放的组件同样推进了时间轴，结果与其他成员一致 */
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (!IsTimeBeingManipulated() || LatestSnapshotIndex < 0 || LatestSnapshotIndex >= NumSnapshots) return GetWorld()->GetTimeSeconds();
+
+	const bool bRewinding = bIsRewinding || (!bIsFastForwarding && bLastTimeManipulationWasRewind);
+	const int32 PreviousIndex = bRewinding ? LatestSnapshotIndex + 1 : LatestSnapshotIndex - 1;
+	const FTransformAndVelocitySnapshot& NextSnapshot = TransformAndVelocitySnapshots[LatestSnapshotIndex];
+	if (PreviousIndex < 0 || PreviousIndex >= NumSnapshots) return NextSnapshot.RecordedTime;
+
+	const float Alpha = NextSnapshot.TimeSinceLastSnapshot > UE_KINDA_SMALL_NUMBER ? TimeSinceSnapshotsChanged / NextSnapshot.TimeSinceLastSnapshot : 1.0f;
+	return FMath::Lerp(TransformAndVelocitySnapshots[PreviousIndex].RecordedTime, NextSnapshot.RecordedTime, FMath::Clamp(Alpha, 0.0f, 1.0f));
+}
+
+bool URewindComponent::GetHistoryTimeRange(float& OutOldestTime, float& OutNewestTime) const
+{
+	TPair<float, float> Range;
+	const bool bHasHistory = HistoryLock.Read([this, &Range]()
+	{
+		const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+		if (NumSnapshots == 0) return false;
+		Range.Key = TransformAndVelocitySnapshots.ReadUnchecked(0).RecordedTime;
+		Range.Value = TransformAndVelocitySnapshots.ReadUnchecked(NumSnapshots - 1).RecordedTime;
+		return true;
+	});
+	if (!bHasHistory) return false;
+	OutOldestTime = Range.Key;
+	OutNewestTime = Range.Value;
+	return true;
+}
+
+bool URewindComponent::GetLocationBoundsInTimeRange(float StartTime, float EndTime, FBox& OutBounds) const
+{
+	/* 线程安全：与FindSnapshotAtTimeUnsynchronized相同，只使用ReadUnchecked，读到不一致的数据时由seqlock重试 */
+	FBox Bounds(ForceInit);
+	const bool bHasHistory = HistoryLock.Read([this, StartTime, EndTime, &Bounds]()
+	{
+		Bounds = FBox(ForceInit);
+		const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+		if (NumSnapshots == 0 || NumSnapshots > TransformAndVelocitySnapshots.Max()) return false;
+
+		// 第一个RecordedTime大于StartTime的快照，它前面的快照是StartTime所在区间的起点
+		int32 Low = 0;
+		int32 High = NumSnapshots;
+		while (Low < High)
+		{
+			const int32 Middle = Low + (High - Low) / 2;
+			if (TransformAndVelocitySnapshots.ReadUnchecked(Middle).RecordedTime <= StartTime) Low = Middle + 1;
+			else High = Middle;
+		}
+
+		for (int32 Index = FMath::Max(Low - 1, 0); Index < NumSnapshots; ++Index)
+		{
+			const FTransformAndVelocitySnapshot Snapshot = TransformAndVelocitySnapshots.ReadUnchecked(Index);
+			Bounds += Snapshot.Transform.GetLocation();
+			if (Snapshot.RecordedTime >= EndTime) break;
+		}
+		return true;
+	});
+	if (!bHasHistory) return false;
+	OutBounds = Bounds;
+	return true;
+}
+
+void URewindComponent::CopyHistory(TArray<FTransformAndVelocitySnapshot>& OutTransformSnapshots,
+	TArray<FMovementVelocityAndModeSnapshot>& OutMovementSnapshots) const
+{
+	HistoryLock.Read([this, &OutTransformSnapshots, &OutMovementSnapshots]()
+	{
+		const int32 NumSnapshots = FMath::Min(TransformAndVelocitySnapshots.Num(), TransformAndVelocitySnapshots.Max());
+		OutTransformSnapshots.SetNum(NumSnapshots);
+		for (int32 Index = 0; Index < NumSnapshots; ++Index) OutTransformSnapshots[Index] = TransformAndVelocitySnapshots.ReadUnchecked(Index);
+
+		const int32 NumMovementSnapshots = FMath::Min(MovementVelocityAndModeSnapshots.Num(), MovementVelocityAndModeSnapshots.Max());
+		OutMovementSnapshots.SetNum(NumMovementSnapshots);
+		for (int32 Index = 0; Index < NumMovementSnapshots; ++Index) OutMovementSnapshots[Index] = MovementVelocityAndModeSnapshots.ReadUnchecked(Index);
+		return true;
+	});
+}
+
+void URewindComponent::GetMemoryUsage(FRewindMemoryUsage& OutUsage) const
+{
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	OutUsage.BytesReserved = TransformAndVelocitySnapshots.GetAllocatedSize() + MovementVelocityAndModeSnapshots.GetAllocatedSize()
+		+ GetTimelineBranchesAllocatedSize();
+	OutUsage.BytesUsed = NumSnapshots * sizeof(FTransformAndVelocitySnapshot)
+		+ MovementVelocityAndModeSnapshots.Num() * sizeof(FMovementVelocityAndModeSnapshot);
+
+	// 检查点模式：输入日志和重新模拟的区间缓存
+	OutUsage.BytesReserved += PhysicsInputs.GetAllocatedSize() + ResimulatedIntervals.GetAllocatedSize();
+	for (const FRewindChildTrack& ChildTrack : ChildTracks)
+	{
+		OutUsage.BytesReserved += ChildTrack.Samples.GetAllocatedSize();
+		OutUsage.BytesUsed += ChildTrack.Samples.Num() * sizeof(FRewindChildTransformSample);
+	}
+	OutUsage.BytesUsed += PhysicsInputs.Num() * sizeof(FRewindPhysicsInput);
+	for (const FResimulatedInterval& ResimulatedInterval : ResimulatedIntervals)
+	{
+		OutUsage.BytesReserved += ResimulatedInterval.Samples.GetAllocatedSize();
+		OutUsage.BytesUsed += ResimulatedInterval.Samples.Num() * sizeof(FRewindRigidBodyState);
+	}
+	OutUsage.NumSamples = NumSnapshots;
+	OutUsage.HistorySeconds = NumSnapshots > 1
+		? TransformAndVelocitySnapshots[NumSnapshots - 1].RecordedTime - TransformAndVelocitySnapshots[0].RecordedTime
+		: 0.0f;
+}
+
+bool URewindComponent::FindSnapshotAtTimeUnsynchronized(float Time, FTransformAndVelocitySnapshot& OutSnapshot) const
+{
+	/*
+	 * 按世界时间查询历史：二分查找Time所在的两个快照，再进行插值
+	 * 可能与游戏线程的写入交错，因此只使用ReadUnchecked，并且不能因为读到不一致的数据而断言
+	 */
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (NumSnapshots == 0 || NumSnapshots > TransformAndVelocitySnapshots.Max()) return false;
+
+	const FTransformAndVelocitySnapshot OldestSnapshot = TransformAndVelocitySnapshots.ReadUnchecked(0);
+	const FTransformAndVelocitySnapshot NewestSnapshot = TransformAndVelocitySnapshots.ReadUnchecked(NumSnapshots - 1);
+	if (Time < OldestSnapshot.RecordedTime || Time > NewestSnapshot.RecordedTime) return false;
+
+	// 找到第一个RecordedTime大于Time的快照
+	int32 Low = 0;
+	int32 High = NumSnapshots;
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (TransformAndVelocitySnapshots.ReadUnchecked(Middle).RecordedTime <= Time) Low = Middle + 1;
+		else High = Middle;
+	}
+
+	// Time正好是最后一个快照
+	if (Low >= NumSnapshots)
+	{
+		OutSnapshot = NewestSnapshot;
+		return true;
+	}
+
+	const FTransformAndVelocitySnapshot PreviousSnapshot = TransformAndVelocitySnapshots.ReadUnchecked(FMath::Max(Low - 1, 0));
+	const FTransformAndVelocitySnapshot NextSnapshot = TransformAndVelocitySnapshots.ReadUnchecked(Low);
+	const float Interval = NextSnapshot.RecordedTime - PreviousSnapshot.RecordedTime;
+	const float Alpha = Interval > UE_KINDA_SMALL_NUMBER ? (Time - PreviousSnapshot.RecordedTime) / Interval : 1.0f;
+
+	OutSnapshot = BlendSnapshots(PreviousSnapshot, NextSnapshot, Alpha, InterpolationMode);
+	OutSnapshot.RecordedTime = Time;
+	return true;
+}
+
 FTransformAndVelocitySnapshot URewindComponent::BlendSnapshots(const FTransformAndVelocitySnapshot& A,
-                                                               const FTransformAndVelocitySnapshot& B, float Alpha)
+                                                               const FTransformAndVelocitySnapshot& B, float Alpha,
+                                                               ERewindInterpolationMode Mode)
 {
 	Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f); // 安全检查
 	FTransformAndVelocitySnapshot BlendSnapshot;
@@ -212,6 +677,53 @@ FTransformAndVelocitySnapshot URewindComponent::BlendSnapshots(const FTransformA
 	BlendSnapshot.LinearVelocity = FMath::Lerp(A.LinearVelocity, B.LinearVelocity, Alpha);
 	BlendSnapshot.AngularVelocityInRadians = FMath::Lerp(A.AngularVelocityInRadians, B.AngularVelocityInRadians, Alpha);
 
+	// 两端都休眠时整个区间静止
+	BlendSnapshot.bIsSleeping = A.bIsSleeping && B.bIsSleeping;
+
+	if (Mode != ERewindInterpolationMode::Hermite) return BlendSnapshot;
+
+	/*
+	 * 以速度为切线的三次插值：参数Alpha对应的时间跨度是两个快照的记录间隔（较晚快照的TimeSinceLastSnapshot），
+	 * 倒序混合（回溯）时跨度为负，切线随之反向；两个速度都为零时没有切线信息（例如非物理Actor的旋转），保持线性插值
+	 */
+	const bool bBIsLater = B.RecordedTime >= A.RecordedTime;
+	const float Interval = (bBIsLater ? B : A).TimeSinceLastSnapshot * (bBIsLater ? 1.0f : -1.0f);
+	if (FMath::IsNearlyZero(Interval)) return BlendSnapshot;
+
+	if (!A.LinearVelocity.IsNearlyZero() || !B.LinearVelocity.IsNearlyZero())
+	{
+		// 三次Hermite基函数
+		const float Alpha2 = Alpha * Alpha;
+		const float Alpha3 = Alpha2 * Alpha;
+		const float H00 = 2.0f * Alpha3 - 3.0f * Alpha2 + 1.0f;
+		const float H10 = Alpha3 - 2.0f * Alpha2 + Alpha;
+		const float H01 = -2.0f * Alpha3 + 3.0f * Alpha2;
+		const float H11 = Alpha3 - Alpha2;
+		BlendSnapshot.Transform.SetLocation(
+			H00 * A.Transform.GetLocation() + H10 * Interval * A.LinearVelocity +
+			H01 * B.Transform.GetLocation() + H11 * Interval * B.LinearVelocity);
+	}
+
+	if (!A.AngularVelocityInRadians.IsNearlyZero() || !B.AngularVelocityInRadians.IsNearlyZero())
+	{
+		/*
+		 * 四元数上的三次Bezier：控制点由世界空间角速度沿切线方向前进/后退三分之一个跨度得到，用de Casteljau逐层球面插值求值；
+		 * 角速度恒定时四个控制点等距地落在同一条测地线上，结果与两端的Slerp完全一致
+		 */
+		const FQuat RotationA = A.Transform.GetRotation();
+		FQuat RotationB = B.Transform.GetRotation();
+		if ((RotationA | RotationB) < 0.0f) RotationB = -RotationB; // 走最短路径
+		const FQuat ControlA = FQuat::MakeFromRotationVector(A.AngularVelocityInRadians * (Interval / 3.0f)) * RotationA;
+		const FQuat ControlB = FQuat::MakeFromRotationVector(B.AngularVelocityInRadians * (-Interval / 3.0f)) * RotationB;
+
+		const FQuat Q01 = FQuat::Slerp(RotationA, ControlA, Alpha);
+		const FQuat Q12 = FQuat::Slerp(ControlA, ControlB, Alpha);
+		const FQuat Q23 = FQuat::Slerp(ControlB, RotationB, Alpha);
+		const FQuat Q012 = FQuat::Slerp(Q01, Q12, Alpha);
+		const FQuat Q123 = FQuat::Slerp(Q12, Q23, Alpha);
+		BlendSnapshot.Transform.SetRotation(FQuat::Slerp(Q012, Q123, Alpha));
+	}
+
 	return BlendSnapshot;
 }
 
@@ -230,24 +742,30 @@ FMovementVelocityAndModeSnapshot URewindComponent::BlendSnapshots(const FMovemen
 	return BlendSnapshot;
 }
 
-void URewindComponent::ApplySnapshot(const FTransformAndVelocitySnapshot& Snapshot, bool bApplyPhysics)
+void URewindComponent::ApplySnapshot(const FTransformAndVelocitySnapshot& Snapshot)
 {
-	/* 回溯到对应的Transform和速度, 第二个参数恢复物理效果的参数是结束时间操作时才传入true */
+	/* 回溯到对应的Transform，速度和休眠状态在结束时间操作时由UnpausePhysics恢复 */
+	if (bDeferPlaybackApply) return;
+	REWIND_SCOPE_CYCLE_COUNTER(Apply);
+
+	// 子组件只写入相对值，随下面owner的一次层级更新一起生效；owner没有移动时单独更新一次子组件
+	const bool bChildrenChanged = !ChildTracks.IsEmpty() && WriteChildTransforms(Snapshot.RecordedTime);
+	const bool bOwnerMoves = !GetOwner()->GetActorTransform().Equals(Snapshot.Transform);
 	GetOwner()->SetActorTransform(Snapshot.Transform);
-	if (OwnerRootComponent && bApplyPhysics) // 回到正常世界时间流逝时调用该函数传入的bApplyPhysics为true
-	{
-		OwnerRootComponent->SetPhysicsLinearVelocity(Snapshot.LinearVelocity);
-		OwnerRootComponent->SetPhysicsAngularVelocityInRadians(Snapshot.AngularVelocityInRadians);
-	}
+	if (bChildrenChanged && !bOwnerMoves) GetOwner()->GetRootComponent()->UpdateChildTransforms(EUpdateTransformFlags::None, ETeleportType::TeleportPhysics);
+	LastAppliedSnapshot = Snapshot;
+	++AppliedSnapshotSerial;
 }
 
 void URewindComponent::ApplySnapshot(const FMovementVelocityAndModeSnapshot& Snapshot,
                                      bool bApplyTimeDilationToVelocity)
 {
+	if (bDeferPlaybackApply) return;
+	REWIND_SCOPE_CYCLE_COUNTER(Apply);
 	if (OwnerMovementComponent)
 	{
 		// 目的：让角色的“视觉移动速度”与时间操控的速度相匹配, 比如 2 倍速回溯时，角色也应该以 2 倍速（反向）移动。
-		OwnerMovementComponent->Velocity = bApplyTimeDilationToVelocity ? Snapshot.MovementVelocity * GameMode->GetGlobalRewindSpeed(): Snapshot.MovementVelocity;
+		OwnerMovementComponent->Velocity = bApplyTimeDilationToVelocity ? Snapshot.MovementVelocity * GetClockRewindSpeed(): Snapshot.MovementVelocity;
 		OwnerMovementComponent->SetMovementMode(Snapshot.MovementMode);
 	}
 }
@@ -267,17 +785,19 @@ void URewindComponent::OnGlobalTimeScrubCompleted()
 {
 	if(TryStopTimeManipulation(bIsTimeScrubbing, false, true))
 	{
-		OnFastForwardCompleted.Broadcast();
+		OnTimeScrubCompleted.Broadcast();
 		if (!IsTimeBeingManipulated()) OnTimeManipulationCompleted.Broadcast();
 	}
 }
 
-void URewindComponent::InitializeRingBuffers(float MaxRewindSeconds)
+void URewindComponent::InitializeSnapshotHistory(float MaxRewindSeconds)
 {
-	/* 初始化环形缓冲区 */
+	/* 初始化快照历史 */
 
-	// 确定环形缓冲区的最大snapshot数量
-	MaxSnapshots = FMath::CeilToInt32(MaxRewindSeconds / SnapshotFrequencySeconds);
+	// 确定历史的最大snapshot数量
+	// 自适应采样最密时按最小间隔记录；分段按需分配，预留的数量只占用分段表
+	MaxSnapshots = FMath::CeilToInt32(MaxRewindSeconds / GetRecordTickIntervalSeconds());
+	HistoryHorizonSeconds = MaxRewindSeconds;
 
 	// 根据确定的最大数量来分配对应的内存空间
 	constexpr int OneMB = 1024 * 1024; // 非角色snapshot数据存储最多1MB
@@ -311,57 +831,794 @@ void URewindComponent::InitializeRingBuffers(float MaxRewindSeconds)
 		MaxSnapshots = FMath::Min(static_cast<uint32>(ThreeMB / SnapshotBytes), MaxSnapshots);
 	}
 
-	// 初始化环形缓存区
-	TransformAndVelocitySnapshots.Reserve(MaxSnapshots);
-	if (bSnapshotMovementVelocityAndMode && OwnerMovementComponent) MovementVelocityAndModeSnapshots.Reserve(MaxSnapshots); //角色需要包含运动组件信息缓存的初始化
+	// 初始化快照历史（只分配分段表，分段在写入时才分配，见RecordSnapshot）
+	LLM_SCOPE_BYTAG(Rewind);
+	FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+	TransformAndVelocitySnapshots.Reserve(MaxSnapshots, HistoryLock);
+	if (bSnapshotMovementVelocityAndMode && OwnerMovementComponent) MovementVelocityAndModeSnapshots.Reserve(MaxSnapshots, HistoryLock); //角色需要包含运动组件信息缓存的初始化
 }
 
-void URewindComponent::RecordSnapshot(float DeltaTime)
+void URewindComponent::RecordSnapshot(float DeltaTime, bool bForceRecord)
 {
 	/* 记录snapshot的函数，时间正常流逝时每帧调用 */
 	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::RecordSnapshot);
 	TimeSinceSnapshotsChanged += DeltaTime;
 
 	// 未达到频率，不记录。 但第一帧总是记录
-	if (TimeSinceSnapshotsChanged < SnapshotFrequencySeconds && TransformAndVelocitySnapshots.Num() != 0) return;
+	// 正常记录时Tick间隔就是快照频率，每次Tick都是到期的记录；只有没有设置Tick间隔时才需要在这里判断
+	const bool bScheduledByTickInterval = PrimaryComponentTick.TickInterval > 0.0f;
+	if (!bForceRecord && !bScheduledByTickInterval && TimeSinceSnapshotsChanged < GetRecordTickIntervalSeconds() && TransformAndVelocitySnapshots.Num() != 0)
+	{
+		REWIND_STATS_SAMPLE_SKIPPED();
+		return;
+	}
+
+	// 子组件按自己是否变化记录，与owner的快照是否记录无关
+	if (!ChildTracks.IsEmpty()) RecordChildTransforms();
 
-	// 缓冲区爆满的情况: 丢弃最老的snapshot
-	if (TransformAndVelocitySnapshots.Num() == MaxSnapshots) TransformAndVelocitySnapshots.PopFront();
+	// 检查点模式：从最新检查点重新模拟的结果仍在容差之内且未超过最大间隔时不记录检查点
+	if (!bForceRecord && bUsePhysicsResimulation && TransformAndVelocitySnapshots.Num() != 0
+		&& TimeSinceSnapshotsChanged < PhysicsResimulationSettings.MaxCheckpointIntervalSeconds && IsResimulationPredictionWithinTolerance())
+	{
+		REWIND_STATS_SAMPLE_SKIPPED();
+		return;
+	}
+
+	// 自适应采样：每个最小间隔检查一次，按上一个快照外推仍然准确且未超过最大间隔时不记录
+	if (!bForceRecord && !bUsePhysicsResimulation && SamplingMode == ERewindSamplingMode::Adaptive && TransformAndVelocitySnapshots.Num() != 0
+		&& TimeSinceSnapshotsChanged < MaxSnapshotIntervalSeconds && IsSnapshotPredictionWithinTolerance())
+	{
+		REWIND_STATS_SAMPLE_SKIPPED();
+		return;
+	}
+	REWIND_SCOPE_CYCLE_COUNTER(Record);
+	REWIND_STATS_SAMPLE_RECORDED();
 
-	// snapshot
-	FTransform Transform = GetOwner()->GetActorTransform();
-	FVector LinearVelocity = OwnerRootComponent ? OwnerRootComponent->GetPhysicsLinearVelocity() : FVector::Zero();
-	FVector AngularVelocityInRadians = OwnerRootComponent ? OwnerRootComponent->GetPhysicsAngularVelocityInRadians() : FVector::Zero();
-	// 存储snapshot
-	LatestSnapshotIndex = TransformAndVelocitySnapshots.Emplace(TimeSinceSnapshotsChanged, Transform, LinearVelocity, AngularVelocityInRadians);
+	// 历史的分段在写入时才分配（新分段和写时复制），计入Rewind标签
+	LLM_SCOPE_BYTAG(Rewind);
 
-	if (bSnapshotMovementVelocityAndMode && OwnerMovementComponent) // 角色运动可选项的记录
+	bool bDroppedOldestSnapshot = false;
 	{
-		if (MovementVelocityAndModeSnapshots.Num() == MaxSnapshots) MovementVelocityAndModeSnapshots.PopFront();
-		FVector MovementVelocity = OwnerMovementComponent->Velocity;
-		TEnumAsByte<EMovementMode> MovementMode = OwnerMovementComponent->MovementMode;
-		const int32 LastMovementSnapshotIndex = MovementVelocityAndModeSnapshots.Emplace(TimeSinceSnapshotsChanged, MovementVelocity, MovementMode);
+		// 修改历史期间，其他线程的历史查询会重试
+		FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+
+		// 历史爆满的情况: 丢弃最老的snapshot
+		if (TransformAndVelocitySnapshots.Num() == MaxSnapshots)
+		{
+			DropOldestSnapshot();
+			bDroppedOldestSnapshot = true;
+		}
+
+		// snapshot
+		FTransform Transform = GetOwner()->GetActorTransform();
+		// 不模拟物理的owner（例如角色）使用Actor速度，作为Hermite插值的切线
+		const bool bOwnerSimulatesPhysics = OwnerRootComponent && OwnerRootComponent->IsSimulatingPhysics();
+		FVector LinearVelocity = bOwnerSimulatesPhysics ? OwnerRootComponent->GetPhysicsLinearVelocity() : GetOwner()->GetVelocity();
+		FVector AngularVelocityInRadians = OwnerRootComponent ? OwnerRootComponent->GetPhysicsAngularVelocityInRadians() : FVector::Zero();
+		const bool bIsSleeping = IsOwnerBodySleeping();
+		// 存储snapshot
+		const float RecordedTime = GetWorld()->GetTimeSeconds();
+		LatestSnapshotIndex = TransformAndVelocitySnapshots.Emplace(TimeSinceSnapshotsChanged, RecordedTime, Transform, LinearVelocity, AngularVelocityInRadians, bIsSleeping);
+		if (LatestSnapshotIndex > 0) HistoryDurationSeconds += TimeSinceSnapshotsChanged;
+
+		if (bSnapshotMovementVelocityAndMode && OwnerMovementComponent) // 角色运动可选项的记录
+		{
+			FVector MovementVelocity = OwnerMovementComponent->Velocity;
+			TEnumAsByte<EMovementMode> MovementMode = OwnerMovementComponent->MovementMode;
+			const int32 LastMovementSnapshotIndex = MovementVelocityAndModeSnapshots.Emplace(TimeSinceSnapshotsChanged, MovementVelocity, MovementMode);
 
-		check(LastMovementSnapshotIndex == LatestSnapshotIndex); //检查两组snap的数据是否同步
+			check(LastMovementSnapshotIndex == LatestSnapshotIndex); //检查两组snap的数据是否同步
+		}
+
+		if (DropSnapshotsBeyondHorizon())
+		{
+			bDroppedOldestSnapshot = true;
+			LatestSnapshotIndex = TransformAndVelocitySnapshots.Num() - 1;
+		}
 	}
-	
+	if (Registry) Registry->RecordSweptLocation(this, GetOwner()->GetActorLocation());
+	UpdateHistorySimplification();
+	if (bUsePhysicsResimulation) ResetResimulationPrediction();
+	if (bDroppedOldestSnapshot && !ChildTracks.IsEmpty()) TrimChildTracks(TransformAndVelocitySnapshots[0].RecordedTime);
+
+	// 最老的分段移出当前时间线后，保留的分支与当前时间线共享的分段变少，需要重新检查预算；只丢弃分段中的快照时内存不变
+	if (bReleasedFrontSegment) PruneTimelineBranches();
+
 	TimeSinceSnapshotsChanged = 0.0f; //重置计时器，开始累计下一个snapshot的计时器
 }
 
-void URewindComponent::EraseFutureSnapshots()
+float URewindComponent::GetUndilatedDeltaTime(float DeltaTime) const
+{
+	/*
+	 * 组件收到的DeltaTime乘了owner的CustomTimeDilation（时间泡中的慢动作）；快照的RecordedTime是世界时间，
+	 * 间隔必须使用同一时间基准，否则按时刻查询历史时插值比例和历史时长都会偏差
+	 */
+	const float TimeDilation = GetOwner()->CustomTimeDilation;
+	return TimeDilation > UE_SMALL_NUMBER ? DeltaTime / TimeDilation : GetWorld()->GetDeltaSeconds();
+}
+
+float URewindComponent::GetRecordTickIntervalSeconds() const
+{
+	return SamplingMode == ERewindSamplingMode::Adaptive ? FMath::Min(MinSnapshotIntervalSeconds, MaxSnapshotIntervalSeconds) : SnapshotFrequencySeconds;
+}
+
+bool URewindComponent::IsSnapshotPredictionWithinTolerance() const
+{
+	/* 匀速滑动的物体外推几乎没有误差，很少记录；翻滚、碰撞和转向时误差很快超出容差，按最小间隔记录 */
+	const FTransformAndVelocitySnapshot& LastSnapshot = TransformAndVelocitySnapshots[TransformAndVelocitySnapshots.Num() - 1];
+
+	// 休眠状态和运动模式是离散值，变化时必须记录
+	if (LastSnapshot.bIsSleeping != IsOwnerBodySleeping()) return false;
+	if (bSnapshotMovementVelocityAndMode && OwnerMovementComponent && MovementVelocityAndModeSnapshots.Num() != 0
+		&& MovementVelocityAndModeSnapshots[MovementVelocityAndModeSnapshots.Num() - 1].MovementMode != OwnerMovementComponent->MovementMode)
+	{
+		return false;
+	}
+
+	const FTransform& Transform = GetOwner()->GetActorTransform();
+	const FVector PredictedLocation = LastSnapshot.Transform.GetLocation() + LastSnapshot.LinearVelocity * TimeSinceSnapshotsChanged;
+	if (FVector::DistSquared(PredictedLocation, Transform.GetLocation()) > FMath::Square(AdaptiveSamplingPositionTolerance)) return false;
+
+	const FQuat PredictedRotation = FQuat::MakeFromRotationVector(LastSnapshot.AngularVelocityInRadians * TimeSinceSnapshotsChanged) * LastSnapshot.Transform.GetRotation();
+	return PredictedRotation.AngularDistance(Transform.GetRotation()) <= FMath::DegreesToRadians(AdaptiveSamplingRotationToleranceDegrees);
+}
+
+namespace
 {
-	/* 删除最新index之后的snapshot */
-	while (LatestSnapshotIndex < TransformAndVelocitySnapshots.Num() - 1)
+	FRewindRigidBodyState MakeRigidBodyState(const FTransformAndVelocitySnapshot& Snapshot)
 	{
-		TransformAndVelocitySnapshots.Pop();
+		FRewindRigidBodyState State;
+		State.Transform = Snapshot.Transform;
+		State.LinearVelocity = Snapshot.LinearVelocity;
+		State.AngularVelocityInRadians = Snapshot.AngularVelocityInRadians;
+		return State;
 	}
-	if (bSnapshotMovementVelocityAndMode)
+}
+
+bool URewindComponent::IsResimulationPredictionWithinTolerance()
+{
+	/* 与回放使用相同的重新模拟：预测在容差之内时，回放重建的状态同样在容差之内 */
+	const int64 CheckpointSerial = NumDroppedSnapshots + TransformAndVelocitySnapshots.Num() - 1;
+
+	// 休眠状态变化时写检查点，结束时间操作时才能按检查点恢复休眠
+	if (TransformAndVelocitySnapshots[TransformAndVelocitySnapshots.Num() - 1].bIsSleeping != IsOwnerBodySleeping()) return false;
+
+	const TConstArrayView<FRewindPhysicsInput> Inputs = GetPhysicsInputs(CheckpointSerial);
+	ResimulationPrediction.AdvanceTo(TimeSinceSnapshotsChanged, Inputs, ResimulationModel, PhysicsResimulationSettings.FixedStepSeconds);
+	const FRewindRigidBodyState Predicted = ResimulationPrediction.Extrapolate(TimeSinceSnapshotsChanged, Inputs, ResimulationModel);
+
+	const FTransform& Transform = GetOwner()->GetActorTransform();
+	if (FVector::DistSquared(Predicted.Transform.GetLocation(), Transform.GetLocation()) > FMath::Square(PhysicsResimulationSettings.PositionTolerance)) return false;
+	return Predicted.Transform.GetRotation().AngularDistance(Transform.GetRotation()) <= FMath::DegreesToRadians(PhysicsResimulationSettings.RotationToleranceDegrees);
+}
+
+void URewindComponent::ResetResimulationPrediction()
+{
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (NumSnapshots == 0) return;
+	ResimulationPrediction.Reset(MakeRigidBodyState(TransformAndVelocitySnapshots[NumSnapshots - 1]), ResimulationModel);
+}
+
+TConstArrayView<FRewindPhysicsInput> URewindComponent::GetPhysicsInputs(int64 CheckpointSerial) const
+{
+	const int32 First = Algo::LowerBoundBy(PhysicsInputs, CheckpointSerial, &FRewindPhysicsInput::CheckpointSerial);
+	const int32 Last = Algo::UpperBoundBy(PhysicsInputs, CheckpointSerial, &FRewindPhysicsInput::CheckpointSerial);
+	return TConstArrayView<FRewindPhysicsInput>(PhysicsInputs.GetData() + First, Last - First);
+}
+
+void URewindComponent::TrimPhysicsInputs(int64 FirstSerial, int64 LastSerial)
+{
+	PhysicsInputs.RemoveAll([FirstSerial, LastSerial](const FRewindPhysicsInput& Input)
 	{
-		while (LatestSnapshotIndex < MovementVelocityAndModeSnapshots.Num() - 1)
+		return Input.CheckpointSerial < FirstSerial || Input.CheckpointSerial > LastSerial;
+	});
+}
+
+void URewindComponent::RecordExternalImpulse(FVector Impulse, FVector Location)
+{
+	/* 时间操作期间owner不模拟物理，不会受到冲量 */
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (!bUsePhysicsResimulation || IsTimeBeingManipulated() || NumSnapshots == 0) return;
+
+	const float Mass = OwnerRootComponent->GetMass();
+	if (Mass <= UE_KINDA_SMALL_NUMBER) return;
+
+	// 冲量换算成速度变化；惯量按组件局部坐标轴上的主惯量近似
+	const FTransform& ComponentTransform = OwnerRootComponent->GetComponentTransform();
+	const FVector InertiaTensor = OwnerRootComponent->GetInertiaTensor();
+	const FVector LocalAngularImpulse = ComponentTransform.InverseTransformVectorNoScale((Location - OwnerRootComponent->GetCenterOfMass()) ^ Impulse);
+	const FVector LocalAngularVelocityChange(
+		LocalAngularImpulse.X / FMath::Max(InertiaTensor.X, UE_KINDA_SMALL_NUMBER),
+		LocalAngularImpulse.Y / FMath::Max(InertiaTensor.Y, UE_KINDA_SMALL_NUMBER),
+		LocalAngularImpulse.Z / FMath::Max(InertiaTensor.Z, UE_KINDA_SMALL_NUMBER));
+
+	FRewindPhysicsInput& Input = PhysicsInputs.AddDefaulted_GetRef();
+	Input.CheckpointSerial = NumDroppedSnapshots + NumSnapshots - 1;
+	Input.TimeAfterCheckpoint = GetWorld()->GetTimeSeconds() - TransformAndVelocitySnapshots[NumSnapshots - 1].RecordedTime;
+	Input.LinearVelocityChange = Impulse / Mass;
+	Input.AngularVelocityChange = ComponentTransform.TransformVectorNoScale(LocalAngularVelocityChange);
+}
+
+void URewindComponent::PrefetchResimulatedInterval(int32 FirstIndex)
+{
+	if (FirstIndex < 0 || FirstIndex + 1 >= TransformAndVelocitySnapshots.Num()) return;
+
+	const int64 CheckpointSerial = NumDroppedSnapshots + FirstIndex;
+	const bool bCached = ResimulatedIntervals.ContainsByPredicate([this, CheckpointSerial](const FResimulatedInterval& Cached)
+	{
+		return Cached.CheckpointSerial == CheckpointSerial && Cached.Generation == HistoryGeneration;
+	});
+	if (bCached) return;
+
+	// 工作线程只使用复制的输入，组件在计算期间被销毁或修改历史都不受影响
+	FResimulatedInterval& ResimulatedInterval = ResimulatedIntervals.AddDefaulted_GetRef();
+	ResimulatedInterval.CheckpointSerial = CheckpointSerial;
+	ResimulatedInterval.Generation = HistoryGeneration;
+	ResimulatedInterval.Pending = Async(EAsyncExecution::ThreadPool,
+		[From = MakeRigidBodyState(TransformAndVelocitySnapshots[FirstIndex]),
+		 To = MakeRigidBodyState(TransformAndVelocitySnapshots[FirstIndex + 1]),
+		 Interval = TransformAndVelocitySnapshots[FirstIndex + 1].TimeSinceLastSnapshot,
+		 Inputs = TArray<FRewindPhysicsInput>(GetPhysicsInputs(CheckpointSerial)),
+		 Model = ResimulationModel,
+		 StepSeconds = PhysicsResimulationSettings.FixedStepSeconds]()
+	{
+		TArray<FRewindRigidBodyState> Samples;
+		FRewindPhysicsResimulator::ResimulateInterval(From, To, Interval, Inputs, Model, StepSeconds, Samples);
+		return Samples;
+	});
+}
+
+FTransformAndVelocitySnapshot URewindComponent::GetResimulatedSnapshot(int32 FirstIndex, float Time)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::GetResimulatedSnapshot);
+	REWIND_SCOPE_CYCLE_COUNTER(Blend);
+	const int64 CheckpointSerial = NumDroppedSnapshots + FirstIndex;
+	const FTransformAndVelocitySnapshot& From = TransformAndVelocitySnapshots[FirstIndex];
+	const FTransformAndVelocitySnapshot& To = TransformAndVelocitySnapshots[FirstIndex + 1];
+
+	// 只保留当前区间和前后相邻的区间
+	ResimulatedIntervals.RemoveAll([this, CheckpointSerial](const FResimulatedInterval& Cached)
+	{
+		return Cached.Generation != HistoryGeneration || FMath::Abs(Cached.CheckpointSerial - CheckpointSerial) > 1;
+	});
+
+	FResimulatedInterval* ResimulatedInterval = ResimulatedIntervals.FindByPredicate([CheckpointSerial](const FResimulatedInterval& Cached)
+	{
+		return Cached.CheckpointSerial == CheckpointSerial;
+	});
+	if (!ResimulatedInterval)
+	{
+		// 跳转或回放速度超过了预先计算：在游戏线程中计算当前区间
+		ResimulatedInterval = &ResimulatedIntervals.AddDefaulted_GetRef();
+		ResimulatedInterval->CheckpointSerial = CheckpointSerial;
+		ResimulatedInterval->Generation = HistoryGeneration;
+		FRewindPhysicsResimulator::ResimulateInterval(MakeRigidBodyState(From), MakeRigidBodyState(To), To.TimeSinceLastSnapshot,
+			GetPhysicsInputs(CheckpointSerial), ResimulationModel, PhysicsResimulationSettings.FixedStepSeconds, ResimulatedInterval->Samples);
+	}
+	else if (ResimulatedInterval->Pending.IsValid())
+	{
+		// 还没有算完时等待工作线程
+		ResimulatedInterval->Samples = ResimulatedInterval->Pending.Consume();
+	}
+
+	const FRewindRigidBodyState State = FRewindPhysicsResimulator::SampleInterval(ResimulatedInterval->Samples, To.TimeSinceLastSnapshot,
+		PhysicsResimulationSettings.FixedStepSeconds, Time);
+	FTransformAndVelocitySnapshot Result;
+	Result.Transform = State.Transform;
+	Result.LinearVelocity = State.LinearVelocity;
+	Result.AngularVelocityInRadians = State.AngularVelocityInRadians;
+	Result.bIsSleeping = From.bIsSleeping && To.bIsSleeping;
+	Result.RecordedTime = FMath::Lerp(From.RecordedTime, To.RecordedTime, To.TimeSinceLastSnapshot > UE_KINDA_SMALL_NUMBER ? Time / To.TimeSinceLastSnapshot : 1.0f);
+	return Result;
+}
+
+void URewindComponent::RecordCurrentSnapshot()
+{
+	/*
+	 * 各组件的记录相位不同，最新快照的时间也各不相同；
+	 * 进入时间操作前补记当前时刻的快照，让所有组件的历史都以同一时刻结束，回放时彼此对齐
+	 */
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (bIsNetPlaybackFollower || NumSnapshots == 0) return;
+
+	const float Elapsed = GetWorld()->GetTimeSeconds() - TransformAndVelocitySnapshots[NumSnapshots - 1].RecordedTime;
+	if (Elapsed <= UE_KINDA_SMALL_NUMBER) return; // 本帧已经记录过
+
+	TimeSinceSnapshotsChanged = Elapsed;
+	RecordSnapshot(0.0f, true);
+}
+
+void URewindComponent::ForkTimeline()
+{
+	/*
+	 * 回溯后恢复正常时间时调用：最新index之后的snapshot不再删除，而是连同共享的前缀一起保存为分支，之后可以切换回去（重做）
+	 * 保存分支只复制分段引用；当前时间线截断到最新index，继续记录时只会复制分叉点所在的一个分段
+	 */
+	LLM_SCOPE_BYTAG(Rewind);
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (LatestSnapshotIndex >= NumSnapshots - 1) return; // 没有未来的快照
+
+	if (MaxTimelineBranches > 0)
+	{
+		FRewindTimelineBranch& Branch = TimelineBranches.AddDefaulted_GetRef();
+		Branch.Info.BranchId = NextTimelineBranchId++;
+		Branch.Info.ForkTime = LatestSnapshotIndex >= 0 ? TransformAndVelocitySnapshots[LatestSnapshotIndex].RecordedTime : 0.0f;
+		Branch.Info.EndTime = TransformAndVelocitySnapshots[NumSnapshots - 1].RecordedTime;
+		Branch.TransformAndVelocitySnapshots = TransformAndVelocitySnapshots.CaptureBranch();
+		Branch.MovementVelocityAndModeSnapshots = MovementVelocityAndModeSnapshots.CaptureBranch();
+		Branch.NumSimplifiedSnapshots = NumSimplifiedSnapshots;
+		for (const FRewindChildTrack& ChildTrack : ChildTracks) Branch.ChildTransformSamples.Add(ChildTrack.Samples);
+	}
+	if (!ChildTracks.IsEmpty()) TruncateChildTracks(TransformAndVelocitySnapshots[FMath::Max(LatestSnapshotIndex, 0)].RecordedTime);
+
+	{
+		FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+		TransformAndVelocitySnapshots.Truncate(LatestSnapshotIndex + 1);
+		if (bSnapshotMovementVelocityAndMode && MovementVelocityAndModeSnapshots.Num() > LatestSnapshotIndex + 1)
 		{
-			MovementVelocityAndModeSnapshots.Pop();
+			MovementVelocityAndModeSnapshots.Truncate(LatestSnapshotIndex + 1);
 		}
 	}
+	NumSimplifiedSnapshots = FMath::Min(NumSimplifiedSnapshots, LatestSnapshotIndex + 1);
+	++HistoryGeneration;
+	RecalculateHistoryDuration();
+
+	PruneTimelineBranches();
+}
+
+void URewindComponent::DropOldestSnapshot()
+{
+	// 新的最老快照的间隔不再属于历史时长
+	HistoryDurationSeconds = TransformAndVelocitySnapshots.Num() > 1
+		? FMath::Max(HistoryDurationSeconds - TransformAndVelocitySnapshots[1].TimeSinceLastSnapshot, 0.0f)
+		: 0.0f;
+	// 移出当前时间线的分段如果仍被分支引用，就变成了分支独占的内存
+	if (TransformAndVelocitySnapshots.PopFront()) bReleasedFrontSegment = true;
+	if (MovementVelocityAndModeSnapshots.Num() > 0 && MovementVelocityAndModeSnapshots.PopFront()) bReleasedFrontSegment = true;
+
+	NumSimplifiedSnapshots = FMath::Max(NumSimplifiedSnapshots - 1, 0);
+	++NumDroppedSnapshots;
+
+	// 最老检查点之后的输入随它一起丢弃
+	if (!PhysicsInputs.IsEmpty() && PhysicsInputs[0].CheckpointSerial < NumDroppedSnapshots) TrimPhysicsInputs(NumDroppedSnapshots, MAX_int64);
+}
+
+bool URewindComponent::DropSnapshotsBeyondHorizon()
+{
+	// 化简、自适应采样或检查点模式时同样数量的快照覆盖更长的时间：按时长淘汰超出回溯上限的快照，节省的内存才会释放
+	if (!bSimplifyAgedHistory && SamplingMode != ERewindSamplingMode::Adaptive && !bUsePhysicsResimulation) return false;
+
+	bool bDropped = false;
+	while (TransformAndVelocitySnapshots.Num() > 2 && HistoryDurationSeconds - TransformAndVelocitySnapshots[1].TimeSinceLastSnapshot >= HistoryHorizonSeconds)
+	{
+		DropOldestSnapshot();
+		bDropped = true;
+	}
+	return bDropped;
+}
+
+void URewindComponent::RecalculateHistoryDuration()
+{
+	HistoryDurationSeconds = 0.0f;
+	for (int32 Index = 1; Index < TransformAndVelocitySnapshots.Num(); ++Index)
+	{
+		HistoryDurationSeconds += TransformAndVelocitySnapshots[Index].TimeSinceLastSnapshot;
+	}
+}
+
+void URewindComponent::UpdateHistorySimplification()
+{
+	/* 化简在工作线程中计算，游戏线程只复制输入和删除快照；同一时间最多进行一次化简 */
+	if (PendingSimplification.IsValid())
+	{
+		if (!PendingSimplification.IsReady()) return;
+
+		// 计算期间分叉或切换了分支，下标已经对应不上
+		const TBitArray<> Removable = PendingSimplification.Consume();
+		if (PendingSimplificationGeneration == HistoryGeneration) ApplyHistorySimplification(Removable);
+		return;
+	}
+	// 检查点模式的输入按检查点序号记录，删除检查点会让输入对应不上
+	if (!bSimplifyAgedHistory || bIsNetPlaybackFollower || bUsePhysicsResimulation) return;
+
+	// 从最新快照向前累加间隔，找到最新的一个足够老的快照
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	int32 LastAgedIndex = NumSnapshots - 1;
+	float Age = 0.0f;
+	while (LastAgedIndex > 0 && Age < SimplifyHistoryOlderThanSeconds)
+	{
+		Age += TransformAndVelocitySnapshots[LastAgedIndex].TimeSinceLastSnapshot;
+		--LastAgedIndex;
+	}
+	if (Age < SimplifyHistoryOlderThanSeconds) return;
+
+	// 上一次化简的最后一个快照作为这次的起点；积累满一个分段再化简，摊薄复制输入和重写历史的开销
+	const int32 FirstIndex = FMath::Max(NumSimplifiedSnapshots - 1, 0);
+	if (LastAgedIndex - FirstIndex < TRewindSnapshotHistory<FTransformAndVelocitySnapshot>::SegmentCapacity) return;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::StartHistorySimplification);
+	FRewindHistorySimplificationInput Input;
+	Input.InterpolationMode = InterpolationMode;
+	Input.PositionTolerance = SimplificationPositionTolerance;
+	Input.RotationToleranceRadians = FMath::DegreesToRadians(SimplificationRotationToleranceDegrees);
+	Input.TransformSnapshots.Reserve(LastAgedIndex - FirstIndex + 1);
+	for (int32 Index = FirstIndex; Index <= LastAgedIndex; ++Index) Input.TransformSnapshots.Add(TransformAndVelocitySnapshots[Index]);
+	if (MovementVelocityAndModeSnapshots.Num() == NumSnapshots)
+	{
+		Input.MovementSnapshots.Reserve(LastAgedIndex - FirstIndex + 1);
+		for (int32 Index = FirstIndex; Index <= LastAgedIndex; ++Index) Input.MovementSnapshots.Add(MovementVelocityAndModeSnapshots[Index]);
+	}
+
+	PendingSimplificationFirstIndex = FirstIndex;
+	PendingSimplificationDroppedSnapshots = NumDroppedSnapshots;
+	PendingSimplificationGeneration = HistoryGeneration;
+	PendingSimplification = Async(EAsyncExecution::ThreadPool, [Input = MoveTemp(Input)]()
+	{
+		return FRewindHistorySimplifier::FindRemovableSnapshots(Input);
+	});
+}
+
+void URewindComponent::ApplyHistorySimplification(const TBitArray<>& Removable)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::ApplyHistorySimplification);
+	LLM_SCOPE_BYTAG(Rewind);
+
+	// 计算期间丢弃的最老快照使下标前移，已经被丢弃的部分跳过
+	const int32 FirstIndex = PendingSimplificationFirstIndex - static_cast<int32>(NumDroppedSnapshots - PendingSimplificationDroppedSnapshots);
+	const int32 LastIndex = FirstIndex + Removable.Num() - 1;
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	if (LastIndex < 0 || LastIndex >= NumSnapshots) return;
+
+	const int32 NumSkipped = FMath::Max(-FirstIndex, 0);
+	TBitArray<> CurrentRemovable(false, Removable.Num() - NumSkipped);
+	int32 NumRemoved = 0;
+	for (int32 Index = NumSkipped; Index < Removable.Num(); ++Index)
+	{
+		if (!Removable[Index]) continue;
+		CurrentRemovable[Index - NumSkipped] = true;
+		++NumRemoved;
+	}
+
+	if (NumRemoved > 0)
+	{
+		// 删除的快照的间隔累加到下一个保留的快照，回放经过这一段的时间不变
+		auto MergeRemoved = [](auto& Kept, const auto& Removed) { Kept.TimeSinceLastSnapshot += Removed.TimeSinceLastSnapshot; };
+		{
+			FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+			TransformAndVelocitySnapshots.Compact(FirstIndex + NumSkipped, CurrentRemovable, MergeRemoved);
+			if (MovementVelocityAndModeSnapshots.Num() == NumSnapshots)
+			{
+				MovementVelocityAndModeSnapshots.Compact(FirstIndex + NumSkipped, CurrentRemovable, MergeRemoved);
+			}
+		}
+
+		LatestSnapshotIndex = TransformAndVelocitySnapshots.Num() - 1;
+		RecalculateHistoryDuration();
+
+		// 被重写的分段（第一个删除的快照之后）不再与分支共享，分支独占的内存变多
+		if (!TimelineBranches.IsEmpty()) PruneTimelineBranches();
+	}
+	NumSimplifiedSnapshots = LastIndex - NumRemoved + 1;
+}
+
+void URewindComponent::RecordChildTransforms()
+{
+	/* 只比较相对Transform：静止的子组件不产生样本，随owner移动不算变化 */
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (FRewindChildTrack& ChildTrack : ChildTracks)
+	{
+		const USceneComponent* Child = ChildTrack.Component.Get();
+		if (!Child) continue;
+
+		const FTransform RelativeTransform = Child->GetRelativeTransform();
+		TArray<FRewindChildTransformSample>& Samples = ChildTrack.Samples;
+		if (!Samples.IsEmpty() && Samples.Last().RelativeTransform.Equals(RelativeTransform)) continue;
+
+		// 静止一段时间后开始运动：补记上一次检查时静止的姿势，插值不会把这次运动摊到静止的时间段上
+		if (!Samples.IsEmpty() && Samples.Last().RecordedTime < LastChildCheckTime)
+		{
+			Samples.Add({LastChildCheckTime, Samples.Last().RelativeTransform});
+		}
+
+		// 同一时刻（例如进入时间操作前的补记）只保留最新的样本
+		if (!Samples.IsEmpty() && Samples.Last().RecordedTime >= Now) Samples.Last().RelativeTransform = RelativeTransform;
+		else Samples.Add({Now, RelativeTransform});
+	}
+	LastChildCheckTime = Now;
+}
+
+bool URewindComponent::WriteChildTransforms(float Time)
+{
+	bool bChanged = false;
+	for (const FRewindChildTrack& ChildTrack : ChildTracks)
+	{
+		USceneComponent* Child = ChildTrack.Component.Get();
+		if (!Child || ChildTrack.Samples.IsEmpty()) continue;
+
+		const FTransform RelativeTransform = GetChildTransformAtTime(ChildTrack.Samples, Time);
+		if (Child->GetRelativeTransform().Equals(RelativeTransform)) continue;
+
+		Child->SetRelativeLocation_Direct(RelativeTransform.GetLocation());
+		Child->SetRelativeRotation_Direct(RelativeTransform.Rotator());
+		Child->SetRelativeScale3D_Direct(RelativeTransform.GetScale3D());
+		bChanged = true;
+	}
+	return bChanged;
+}
+
+void URewindComponent::TrimChildTracks(float OldestTime)
+{
+	for (FRewindChildTrack& ChildTrack : ChildTracks)
+	{
+		const int32 FirstLater = Algo::UpperBoundBy(ChildTrack.Samples, OldestTime, &FRewindChildTransformSample::RecordedTime);
+		if (FirstLater > 1) ChildTrack.Samples.RemoveAt(0, FirstLater - 1, EAllowShrinking::No);
+	}
+}
+
+void URewindComponent::TruncateChildTracks(float Time)
+{
+	for (FRewindChildTrack& ChildTrack : ChildTracks)
+	{
+		TArray<FRewindChildTransformSample>& Samples = ChildTrack.Samples;
+		const int32 FirstLater = Algo::UpperBoundBy(Samples, Time, &FRewindChildTransformSample::RecordedTime);
+		if (FirstLater >= Samples.Num()) continue;
+
+		// 分叉点可能在两个样本之间，先保存分叉点的插值姿势
+		const FTransform TransformAtTime = GetChildTransformAtTime(Samples, Time);
+		Samples.SetNum(FirstLater, EAllowShrinking::No);
+		if (Samples.IsEmpty() || !Samples.Last().RelativeTransform.Equals(TransformAtTime)) Samples.Add({Time, TransformAtTime});
+	}
+}
+
+FTransform URewindComponent::GetChildTransformAtTime(const TArray<FRewindChildTransformSample>& Samples, float Time)
+{
+	check(!Samples.IsEmpty());
+	const int32 Next = Algo::UpperBoundBy(Samples, Time, &FRewindChildTransformSample::RecordedTime);
+	if (Next == 0) return Samples[0].RelativeTransform;
+	if (Next >= Samples.Num()) return Samples.Last().RelativeTransform;
+
+	const FRewindChildTransformSample& Previous = Samples[Next - 1];
+	const FRewindChildTransformSample& Later = Samples[Next];
+	const float Interval = Later.RecordedTime - Previous.RecordedTime;
+	FTransform Result;
+	Result.Blend(Previous.RelativeTransform, Later.RelativeTransform, Interval > UE_KINDA_SMALL_NUMBER ? (Time - Previous.RecordedTime) / Interval : 1.0f);
+	return Result;
+}
+
+void URewindComponent::StoreColdHistory()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::StoreColdHistory);
+	if (bIsNetPlaybackFollower || ColdHistoryKey.IsEmpty()) return;
+	URewindHistoryColdStorage* ColdStorage = GetWorld()->GetSubsystem<URewindHistoryColdStorage>();
+	if (!ColdStorage) return;
+
+	// 没有接回过的冷历史先接回，存入的是完整的历史；保留的分支不会跨越流送
+	ReattachColdHistory();
+	if (TransformAndVelocitySnapshots.Num() == 0) return;
+
+	FRewindColdHistory ColdHistory;
+	ColdHistory.NumSimplifiedSnapshots = NumSimplifiedSnapshots;
+	ColdHistory.TransformSnapshots.Reserve(TransformAndVelocitySnapshots.Num());
+	for (int32 Index = 0; Index < TransformAndVelocitySnapshots.Num(); ++Index) ColdHistory.TransformSnapshots.Add(TransformAndVelocitySnapshots[Index]);
+	if (MovementVelocityAndModeSnapshots.Num() == TransformAndVelocitySnapshots.Num())
+	{
+		ColdHistory.MovementSnapshots.Reserve(MovementVelocityAndModeSnapshots.Num());
+		for (int32 Index = 0; Index < MovementVelocityAndModeSnapshots.Num(); ++Index) ColdHistory.MovementSnapshots.Add(MovementVelocityAndModeSnapshots[Index]);
+	}
+	ColdStorage->Store(ColdHistoryKey, MoveTemp(ColdHistory), HistoryHorizonSeconds);
+}
+
+void URewindComponent::ReattachColdHistory()
+{
+	if (!bHasColdHistory) return;
+	bHasColdHistory = false;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::ReattachColdHistory);
+	LLM_SCOPE_BYTAG(Rewind);
+	URewindHistoryColdStorage* ColdStorage = GetWorld()->GetSubsystem<URewindHistoryColdStorage>();
+	FRewindColdHistory ColdHistory;
+	if (!ColdStorage || !ColdStorage->Retrieve(ColdHistoryKey, ColdHistory) || ColdHistory.TransformSnapshots.IsEmpty()) return;
+
+	// 运动组件数据的设置不一致时两条历史无法对齐，放弃冷历史
+	const bool bHasMovementHistory = bSnapshotMovementVelocityAndMode && OwnerMovementComponent;
+	if (bHasMovementHistory != (ColdHistory.MovementSnapshots.Num() == ColdHistory.TransformSnapshots.Num())) return;
+
+	// 冷历史在前，重新加载后记录的历史在后；超出容量时丢弃最老的
+	TArray<FTransformAndVelocitySnapshot> TransformSnapshots = MoveTemp(ColdHistory.TransformSnapshots);
+	TArray<FMovementVelocityAndModeSnapshot> MovementSnapshots = MoveTemp(ColdHistory.MovementSnapshots);
+	const int32 NumColdSnapshots = TransformSnapshots.Num();
+	for (int32 Index = 0; Index < TransformAndVelocitySnapshots.Num(); ++Index) TransformSnapshots.Add(TransformAndVelocitySnapshots[Index]);
+	if (bHasMovementHistory)
+	{
+		for (int32 Index = 0; Index < MovementVelocityAndModeSnapshots.Num(); ++Index) MovementSnapshots.Add(MovementVelocityAndModeSnapshots[Index]);
+		if (MovementSnapshots.Num() != TransformSnapshots.Num()) return;
+	}
+
+	/*
+	 * 卸载期间owner不存在，卸载前后的两个快照之间不能插值（重新加载后的位置可能完全不同）：
+	 * 在间隙中插入卸载前姿势的两个静止副本，一个在卸载时刻、一个在重新加载时刻，重新加载后的第一个快照间隔为0；
+	 * 回放时在间隙中停在卸载前的姿势，到达重新加载的时刻直接跳到新的姿势，历史时长仍与世界时间一致
+	 */
+	if (TransformSnapshots.Num() > NumColdSnapshots)
+	{
+		const FTransformAndVelocitySnapshot& LastCold = TransformSnapshots[NumColdSnapshots - 1];
+		const float ReloadedTime = TransformSnapshots[NumColdSnapshots].RecordedTime;
+
+		// 速度为零：Hermite插值在静止的区间内不会因为切线偏离
+		FTransformAndVelocitySnapshot UnloadedHold = LastCold;
+		UnloadedHold.TimeSinceLastSnapshot = 0.0f;
+		UnloadedHold.LinearVelocity = FVector::ZeroVector;
+		UnloadedHold.AngularVelocityInRadians = FVector::ZeroVector;
+		FTransformAndVelocitySnapshot ReloadedHold = UnloadedHold;
+		ReloadedHold.TimeSinceLastSnapshot = FMath::Max(ReloadedTime - LastCold.RecordedTime, 0.0f);
+		ReloadedHold.RecordedTime = FMath::Max(ReloadedTime, LastCold.RecordedTime);
+		TransformSnapshots[NumColdSnapshots].TimeSinceLastSnapshot = 0.0f;
+		TransformSnapshots.Insert({ UnloadedHold, ReloadedHold }, NumColdSnapshots);
+
+		if (bHasMovementHistory)
+		{
+			FMovementVelocityAndModeSnapshot MovementHold = MovementSnapshots[NumColdSnapshots - 1];
+			MovementHold.TimeSinceLastSnapshot = 0.0f;
+			MovementHold.MovementVelocity = FVector::ZeroVector;
+			FMovementVelocityAndModeSnapshot ReloadedMovementHold = MovementHold;
+			ReloadedMovementHold.TimeSinceLastSnapshot = ReloadedHold.TimeSinceLastSnapshot;
+			MovementSnapshots[NumColdSnapshots].TimeSinceLastSnapshot = 0.0f;
+			MovementSnapshots.Insert({ MovementHold, ReloadedMovementHold }, NumColdSnapshots);
+		}
+	}
+
+	const int32 FirstKept = FMath::Max(TransformSnapshots.Num() - static_cast<int32>(MaxSnapshots), 0);
+	NumSimplifiedSnapshots = FMath::Max(ColdHistory.NumSimplifiedSnapshots - FirstKept, 0);
+	{
+		FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+		TransformAndVelocitySnapshots.Reset();
+		MovementVelocityAndModeSnapshots.Reset();
+		for (int32 Index = FirstKept; Index < TransformSnapshots.Num(); ++Index)
+		{
+			TransformAndVelocitySnapshots.Emplace(TransformSnapshots[Index]);
+			if (bHasMovementHistory) MovementVelocityAndModeSnapshots.Emplace(MovementSnapshots[Index]);
+		}
+		RecalculateHistoryDuration();
+		DropSnapshotsBeyondHorizon();
+	}
+
+	NumSimplifiedSnapshots = FMath::Min(NumSimplifiedSnapshots, TransformAndVelocitySnapshots.Num());
+	LatestSnapshotIndex = TransformAndVelocitySnapshots.Num() - 1;
+	++HistoryGeneration;
+
+	// 冷历史不保存输入，接回后检查点的序号也变了；这些区间只按检查点修正重新模拟
+	PhysicsInputs.Reset();
+	if (bUsePhysicsResimulation) ResetResimulationPrediction();
+}
+
+void URewindComponent::GetTimelineBranches(TArray<FRewindTimelineBranchInfo>& OutBranches) const
+{
+	OutBranches.Reset(TimelineBranches.Num());
+	for (const FRewindTimelineBranch& Branch : TimelineBranches) OutBranches.Add(Branch.Info);
+}
+
+bool URewindComponent::SwitchToTimelineBranch(int32 BranchId)
+{
+	/* 只在时停期间切换：此时不记录也不回放，切换后停在目标时间线上对应的位置 */
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::SwitchToTimelineBranch);
+	LLM_SCOPE_BYTAG(Rewind);
+	if (!bIsTimeScrubbing || bIsRewinding || bIsFastForwarding) return false;
+
+	const int32 BranchIndex = TimelineBranches.IndexOfByPredicate([BranchId](const FRewindTimelineBranch& Branch) { return Branch.Info.BranchId == BranchId; });
+	if (BranchIndex == INDEX_NONE) return false;
+	FRewindTimelineBranch Target = MoveTemp(TimelineBranches[BranchIndex]);
+	TimelineBranches.RemoveAt(BranchIndex);
+
+	// 当前播放位置：在共享的前缀中时两条时间线的快照相同，否则退回到分叉点
+	const int32 NumSnapshots = TransformAndVelocitySnapshots.Num();
+	const float CurrentTime = LatestSnapshotIndex >= 0 && LatestSnapshotIndex < NumSnapshots
+		? TransformAndVelocitySnapshots[LatestSnapshotIndex].RecordedTime
+		: Target.Info.ForkTime;
+	const float TargetTime = FMath::Min(CurrentTime, Target.Info.ForkTime);
+
+	// 当前时间线保留为分支，与目标在同一点分叉
+	if (NumSnapshots > 0)
+	{
+		FRewindTimelineBranch& Current = TimelineBranches.AddDefaulted_GetRef();
+		Current.Info.BranchId = NextTimelineBranchId++;
+		Current.Info.ForkTime = Target.Info.ForkTime;
+		Current.Info.EndTime = TransformAndVelocitySnapshots[NumSnapshots - 1].RecordedTime;
+		Current.TransformAndVelocitySnapshots = TransformAndVelocitySnapshots.CaptureBranch();
+		Current.MovementVelocityAndModeSnapshots = MovementVelocityAndModeSnapshots.CaptureBranch();
+		Current.NumSimplifiedSnapshots = NumSimplifiedSnapshots;
+		for (const FRewindChildTrack& ChildTrack : ChildTracks) Current.ChildTransformSamples.Add(ChildTrack.Samples);
+	}
+
+	// 子组件的样本随目标时间线恢复；目标是在子组件设置生效前分出的，缺少的子组件保留当前的样本
+	for (int32 ChildIndex = 0; ChildIndex < FMath::Min(ChildTracks.Num(), Target.ChildTransformSamples.Num()); ++ChildIndex)
+	{
+		ChildTracks[ChildIndex].Samples = MoveTemp(Target.ChildTransformSamples[ChildIndex]);
+	}
+
+	{
+		FRewindHistorySequenceLock::FWriteScope WriteScope(HistoryLock);
+		TransformAndVelocitySnapshots.RestoreBranch(Target.TransformAndVelocitySnapshots);
+		MovementVelocityAndModeSnapshots.RestoreBranch(Target.MovementVelocityAndModeSnapshots);
+	}
+	NumSimplifiedSnapshots = Target.NumSimplifiedSnapshots;
+	++HistoryGeneration;
+	RecalculateHistoryDuration();
+
+	// 分支不保存输入：切换后的区间只按检查点修正重新模拟
+	PhysicsInputs.Reset();
+
+	// 同一时间线中RecordedTime递增：二分查找最后一个不晚于目标时间的快照
+	int32 Low = 0;
+	int32 High = TransformAndVelocitySnapshots.Num();
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (TransformAndVelocitySnapshots[Middle].RecordedTime <= TargetTime) Low = Middle + 1;
+		else High = Middle;
+	}
+	LatestSnapshotIndex = FMath::Max(Low - 1, 0);
+	if (TransformAndVelocitySnapshots.Num() == 0) LatestSnapshotIndex = -1;
+
+	// 停在该快照上：按回溯方向插值且进度已满，PauseTime会直接应用该快照
+	bLastTimeManipulationWasRewind = true;
+	TimeSinceSnapshotsChanged = LatestSnapshotIndex >= 0 ? TransformAndVelocitySnapshots[LatestSnapshotIndex].TimeSinceLastSnapshot : 0.0f;
+	bIsPauseSettled = false;
+	UpdateTickSchedule();
+
+	PruneTimelineBranches();
+	return true;
+}
+
+bool URewindComponent::SwitchToLatestTimelineBranch()
+{
+	return !TimelineBranches.IsEmpty() && SwitchToTimelineBranch(TimelineBranches.Last().Info.BranchId);
+}
+
+SIZE_T URewindComponent::GetTimelineBranchesAllocatedSize(TArray<SIZE_T>* OutBranchSizes) const
+{
+	/*
+	 * 与当前时间线共享的分段已经计入当前时间线，分支之间共享的分段只计算一次；
+	 * 从最新的分支往前计算，共享的分段计入较新的分支，删除最老的分支时释放的正好是它名下的内存
+	 */
+	TSet<const void*> CountedSegments;
+	TransformAndVelocitySnapshots.GatherActiveSegments(CountedSegments);
+	MovementVelocityAndModeSnapshots.GatherActiveSegments(CountedSegments);
+
+	if (OutBranchSizes) OutBranchSizes->SetNumZeroed(TimelineBranches.Num());
+	SIZE_T Size = 0;
+	for (int32 BranchIndex = TimelineBranches.Num() - 1; BranchIndex >= 0; --BranchIndex)
+	{
+		const FRewindTimelineBranch& Branch = TimelineBranches[BranchIndex];
+		SIZE_T BranchSize = 0;
+		for (const TArray<FRewindChildTransformSample>& ChildSamples : Branch.ChildTransformSamples) BranchSize += ChildSamples.GetAllocatedSize();
+		BranchSize += TRewindSnapshotHistory<FTransformAndVelocitySnapshot>::GetUniqueAllocatedSize(Branch.TransformAndVelocitySnapshots, CountedSegments);
+		BranchSize += TRewindSnapshotHistory<FMovementVelocityAndModeSnapshot>::GetUniqueAllocatedSize(Branch.MovementVelocityAndModeSnapshots, CountedSegments);
+		if (OutBranchSizes) (*OutBranchSizes)[BranchIndex] = BranchSize;
+		Size += BranchSize;
+	}
+	return Size;
+}
+
+void URewindComponent::PruneTimelineBranches()
+{
+	/* 分支不在当前时间线中，没有其他线程读取，删除后独占的分段立即释放 */
+	bReleasedFrontSegment = false;
+	if (TimelineBranches.Num() > MaxTimelineBranches)
+	{
+		TimelineBranches.RemoveAt(0, TimelineBranches.Num() - MaxTimelineBranches);
+	}
+	if (TimelineBranches.IsEmpty()) return;
+
+	// 只计算一次，按最老的分支依次扣除它名下的内存
+	TArray<SIZE_T> BranchSizes;
+	SIZE_T Size = GetTimelineBranchesAllocatedSize(&BranchSizes);
+	const SIZE_T BudgetBytes = static_cast<SIZE_T>(TimelineBranchMemoryBudgetKB) * 1024;
+	int32 NumRemoved = 0;
+	while (NumRemoved < BranchSizes.Num() && Size > BudgetBytes)
+	{
+		Size -= BranchSizes[NumRemoved++];
+	}
+	if (NumRemoved > 0) TimelineBranches.RemoveAt(0, NumRemoved);
 }
 
 void URewindComponent::PlaySnapshots(float DeltaTime, bool bRewinding)
@@ -377,7 +1634,7 @@ void URewindComponent::PlaySnapshots(float DeltaTime, bool bRewinding)
 
 	if (HandleInsufficientSnapshots()) { return; }
 
-	DeltaTime *= GameMode->GetGlobalRewindSpeed(); // 匹配设置的速度
+	DeltaTime *= GetClockRewindSpeed(); // 匹配所在时钟设置的速度
 	TimeSinceSnapshotsChanged += DeltaTime; // 累加上对应速度的时间差
 
 	bool bReachedEndOfTrack = false;
@@ -385,16 +1642,19 @@ void URewindComponent::PlaySnapshots(float DeltaTime, bool bRewinding)
 	if (bRewinding) // 回溯方向
 	{
 		// 跳过小间隔粒度的snapshot
-		while (LatestSnapshotIndex > 0 && TimeSinceSnapshotsChanged > LastSnapshotTime)
 		{
-			TimeSinceSnapshotsChanged -= LastSnapshotTime;
-			LastSnapshotTime = TransformAndVelocitySnapshots[LatestSnapshotIndex].TimeSinceLastSnapshot;
-			--LatestSnapshotIndex;
+			REWIND_SCOPE_CYCLE_COUNTER(Seek);
+			while (LatestSnapshotIndex > 0 && TimeSinceSnapshotsChanged > LastSnapshotTime)
+			{
+				TimeSinceSnapshotsChanged -= LastSnapshotTime;
+				LastSnapshotTime = TransformAndVelocitySnapshots[LatestSnapshotIndex].TimeSinceLastSnapshot;
+				--LatestSnapshotIndex;
+			}
 		}
 
 		if (LatestSnapshotIndex == TransformAndVelocitySnapshots.Num() - 1) // 只剩一个snapshot,直接使用这个snapshot
 		{
-			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex], false);
+			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex]);
 			if (bSnapshotMovementVelocityAndMode)
 			{
 				ApplySnapshot(MovementVelocityAndModeSnapshots[LatestSnapshotIndex], true);
@@ -405,6 +1665,7 @@ void URewindComponent::PlaySnapshots(float DeltaTime, bool bRewinding)
 	}
 	else // 快进方向
 	{
+		REWIND_SCOPE_CYCLE_COUNTER(Seek);
 		while (LatestSnapshotIndex < TransformAndVelocitySnapshots.Num() - 1 && TimeSinceSnapshotsChanged > LastSnapshotTime)
 		{
 			TimeSinceSnapshotsChanged -= LastSnapshotTime;
@@ -429,18 +1690,23 @@ void URewindComponent::PauseTime(float DeltaTime, bool bRewinding)
 	/* 核心逻辑不是“立即暂停”，而是平滑地完成当前的插值，然后才真正暂停。这确保了 Actor 总是“冻结”在两个快照之间的插值终点，而不是尴尬的中间位置。 */
 	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponent::PauseTime);
 
-	if (HandleInsufficientSnapshots()) return;  // 不够snapshot插值，不进行下面的插值流程
+	if (HandleInsufficientSnapshots())  // 不够snapshot插值，不进行下面的插值流程
+	{
+		SettlePause();
+		return;
+	}
 
 	if (bRewinding) // 上一次操作的方向是rewind
 	{
 		if (LatestSnapshotIndex == TransformAndVelocitySnapshots.Num() - 1) // 只剩一个snapshot,就使用唯一的这个
 		{
-			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex], false);
+			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex]);
 			if (bSnapshotMovementVelocityAndMode)
 			{
 				ApplySnapshot(MovementVelocityAndModeSnapshots[LatestSnapshotIndex], true);
 			}
 			PauseAnimation();
+			SettlePause();
 			return;
 		}
 	}
@@ -449,7 +1715,7 @@ void URewindComponent::PauseTime(float DeltaTime, bool bRewinding)
 	// 检查插值进度 (TimeSinceSnapshotsChanged) 是否还未完成, 这一步更新【TimeSinceSnapshotsChanged】
 	if (TimeSinceSnapshotsChanged < LastedSnapshotTime)
 	{
-		DeltaTime *= GameMode->GetGlobalRewindSpeed(); // 获取本帧的时间，并乘以“回溯速度”。
+		DeltaTime *= GetClockRewindSpeed(); // 获取本帧的时间，并乘以所在时钟的“回溯速度”。
 		TimeSinceSnapshotsChanged = FMath::Min(TimeSinceSnapshotsChanged + DeltaTime, LastedSnapshotTime); //推进进度，并使用 FMath::Min 确保进度“不会超过”总时长。
 	}
 
@@ -461,6 +1727,7 @@ void URewindComponent::PauseTime(float DeltaTime, bool bRewinding)
 	{
 		// / 只有当插值 100% 完成时，才调用 PauseAnimation() 来冻结动画。
 		PauseAnimation();
+		SettlePause();
 	}
 }
 
@@ -471,9 +1738,15 @@ bool URewindComponent::TryStartTimeManipulation(bool& bStateToSet, bool bResetTi
 	 * 返回参数： 表示是否成功启用时间操作
 	 */
 
-	// 没有开启时间回溯操作权限 或 已经是目标状态了，直接返回false
-	if (!bIsRewindingEnabled || bStateToSet) return false;
+	// 没有开启时间回溯操作权限、外部回放接管中 或 已经是目标状态了，直接返回false
+	if (!bIsRewindingEnabled || bIsExternalPlayback || bStateToSet) return false;
 
+	const bool bAlreadyManipulatingTime = IsTimeBeingManipulated();
+	if (!bAlreadyManipulatingTime)
+	{
+		ReattachColdHistory();
+		RecordCurrentSnapshot();
+	}
 	bStateToSet = true; //设置成对应的目标状态
 	if (bResetTimeSinceSnapshotsChanged) TimeSinceSnapshotsChanged = 0.0f;
 
@@ -483,6 +1756,12 @@ bool URewindComponent::TryStartTimeManipulation(bool& bStateToSet, bool bResetTi
 	// 在开始时间操控时记录“动画原本是否暂停”
 	bAnimationsPausedAtStartOfTimeManipulation = bPausedAnimation;
 
+	// 从正常时间进入时间操作：服务器接管owner的网络同步
+	if (!bAlreadyManipulatingTime) BeginNetPlayback();
+
+	bIsPauseSettled = false;
+	UpdateTickSchedule();
+	ApplyClockTimeDilation();
 	return true;
 }
 
@@ -496,44 +1775,114 @@ bool URewindComponent::TryStopTimeManipulation(bool& bStateToSet, bool bResetTim
 	{
 		if (bResetTimeSinceSnapshotsChanged) TimeSinceSnapshotsChanged = 0.0f;
 
-		// 恢复物理模拟和动画播放
-		UnpausePhysics();
+		// 恢复动画播放
 		UnpauseAnimation();
 
-		// 应用最终快照状态
+		// 应用最终快照状态：先在运动学状态下摆好姿势，再恢复物理模拟和速度
 		if (LatestSnapshotIndex >= 0)
 		{
-			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex], true);
+			ApplySnapshot(TransformAndVelocitySnapshots[LatestSnapshotIndex]);
 			if (bSnapshotMovementVelocityAndMode)
 			{
 				// 速度清零，防止倒带后残留速度
 				ApplySnapshot(MovementVelocityAndModeSnapshots[LatestSnapshotIndex], false);
 			}
 		}
-		// 删除未来的快照，防止与新操作冲突
-		EraseFutureSnapshots();
+		UnpausePhysics(LatestSnapshotIndex >= 0 ? &TransformAndVelocitySnapshots[LatestSnapshotIndex] : nullptr);
+		// 未来的快照保存为分支，当前时间线从最新快照处继续记录
+		ForkTimeline();
+
+		// 子组件停在最新快照时刻的姿势上，之后的变化相对这一时刻记录
+		if (LatestSnapshotIndex >= 0) LastChildCheckTime = TransformAndVelocitySnapshots[LatestSnapshotIndex].RecordedTime;
+
+		// 检查点模式：被放弃的未来的输入一起删除，从恢复的检查点重新开始预测；重新模拟的缓存不再需要
+		if (bUsePhysicsResimulation)
+		{
+			TrimPhysicsInputs(NumDroppedSnapshots, NumDroppedSnapshots + LatestSnapshotIndex - 1);
+			ResimulatedIntervals.Reset();
+			ResetResimulationPrediction();
+		}
 	}
 
+	// 回到正常时间：恢复owner默认的移动复制
+	if (!IsTimeBeingManipulated()) EndNetPlayback();
+
+	bIsPauseSettled = false;
+	UpdateTickSchedule();
+	ApplyClockTimeDilation();
 	return true;
 }
 
+void URewindComponent::UpdateTickSchedule()
+{
+	/* 不到期也不活跃的组件每帧没有任何开销：间隔Tick在冷却期间不会被Tick管理器遍历 */
+	if (bIsNetPlaybackFollower || bIsPauseSettled || bIsExternalPlayback)
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+
+	if (IsTimeBeingManipulated())
+	{
+		bAwaitingSnapshotPhase = false;
+		SetComponentTickInterval(0.0f);
+	}
+	else
+	{
+		// 错开各组件的记录时刻：先等到自己的相位再开始按快照频率记录，同一帧开始记录的组件不会在同一帧集中记录
+		bAwaitingSnapshotPhase = true;
+		SetComponentTickInterval(FMath::Max(SnapshotPhase * GetRecordTickIntervalSeconds(), UE_KINDA_SMALL_NUMBER));
+	}
+	SetComponentTickEnabled(true);
+}
+
+void URewindComponent::SettlePause()
+{
+	// 最终姿势还没有应用，等轮到自己时再停止
+	if (bIsPauseSettled || bDeferPlaybackApply) return;
+	bIsPauseSettled = true;
+	UpdateTickSchedule();
+}
+
 void URewindComponent::PausePhysics()
 {
 	if (OwnerRootComponent && OwnerRootComponent->BodyInstance.bSimulatePhysics)
 	{
+		REWIND_SCOPE_CYCLE_COUNTER(PhysicsTransition);
 		bPausedPhysics = true;
 		OwnerRootComponent->SetSimulatePhysics(false);
 	}
 }
 
-void URewindComponent::UnpausePhysics()
+void URewindComponent::UnpausePhysics(const FTransformAndVelocitySnapshot* FinalSnapshot)
 {
+	/*
+	 * 不重建物理状态：重建会让所有刚体同时醒来，求解器在结束回溯的那一帧出现尖峰，静止的堆叠也会抖动几帧；
+	 * 暂停期间刚体是运动学的，只需瞬移到最终姿势再切回动态，记录时休眠的刚体直接恢复休眠，不参与求解
+	 */
 	if (!bPausedPhysics) return;
 
+	REWIND_SCOPE_CYCLE_COUNTER(PhysicsTransition);
 	check(OwnerRootComponent);
-	bPausedPhysics = true;
+	bPausedPhysics = false;
+	OwnerRootComponent->BodyInstance.SetBodyTransform(OwnerRootComponent->GetComponentTransform(), ETeleportType::TeleportPhysics);
 	OwnerRootComponent->SetSimulatePhysics(true);
-	OwnerRootComponent->RecreatePhysicsState(); // 强制物理引擎重新生成组件的最新运动状态
+	if (!FinalSnapshot) return;
+
+	if (FinalSnapshot->bIsSleeping)
+	{
+		OwnerRootComponent->PutRigidBodyToSleep();
+	}
+	else
+	{
+		OwnerRootComponent->SetPhysicsLinearVelocity(FinalSnapshot->LinearVelocity);
+		OwnerRootComponent->SetPhysicsAngularVelocityInRadians(FinalSnapshot->AngularVelocityInRadians);
+	}
+}
+
+bool URewindComponent::IsOwnerBodySleeping() const
+{
+	return OwnerRootComponent && OwnerRootComponent->IsSimulatingPhysics() && !OwnerRootComponent->RigidBodyIsAwake();
 }
 
 void URewindComponent::PauseAnimation()
@@ -555,3 +1904,72 @@ void URewindComponent::UnpauseAnimation()
 	OwnerSkeletalMesh->bPauseAnims = false; // 骨骼网格体恢复动画
 }
 
+void FRewindNetPlaybackState::Quantize()
+{
+	// 与NetSerialize的精度保持一致：位置0.1cm，旋转16位
+	LocationOffset.X = FMath::RoundToDouble(LocationOffset.X * 10.0) / 10.0;
+	LocationOffset.Y = FMath::RoundToDouble(LocationOffset.Y * 10.0) / 10.0;
+	LocationOffset.Z = FMath::RoundToDouble(LocationOffset.Z * 10.0) / 10.0;
+
+	Rotation.Pitch = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Pitch));
+	Rotation.Yaw = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Yaw));
+	Rotation.Roll = FRotator::DecompressAxisFromShort(FRotator::CompressAxisToShort(Rotation.Roll));
+}
+
+bool FRewindNetPlaybackState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// 偏移不超过MaxLocationOffset，乘以10后18位（含符号）足够表示
+	bOutSuccess = SerializePackedVector<10, 18>(LocationOffset, Ar);
+	Rotation.SerializeCompressedShort(Ar);
+	return true;
+}
+
+void URewindComponent::BeginNetPlayback()
+{
+	if (!bIsNetPlaybackAuthority) return;
+
+	// 回放期间关闭owner默认的移动复制，改为发送压缩后的回放结果
+	AActor* Owner = GetOwner();
+	bOwnerReplicatedMovementBeforeManipulation = Owner->IsReplicatingMovement();
+	Owner->SetReplicateMovement(false);
+
+	NetPlaybackAnchor = FVector::ZeroVector;
+	UpdateNetPlaybackState();
+	Owner->ForceNetUpdate();
+}
+
+void URewindComponent::EndNetPlayback()
+{
+	if (!bIsNetPlaybackAuthority) return;
+
+	AActor* Owner = GetOwner();
+	Owner->SetReplicateMovement(bOwnerReplicatedMovementBeforeManipulation);
+	Owner->ForceNetUpdate();
+}
+
+void URewindComponent::UpdateNetPlaybackState()
+{
+	/* 服务器每帧调用：未变化的量化结果与上次复制的值相同，不会产生网络流量 */
+	const FTransform& OwnerTransform = GetOwner()->GetActorTransform();
+	const FVector Location = OwnerTransform.GetLocation();
+
+	// 偏移超出可表示范围时重新设置锚点（锚点以整数精度复制，这里先取整保证两端一致）
+	if ((Location - NetPlaybackAnchor).GetAbsMax() > FRewindNetPlaybackState::MaxLocationOffset)
+	{
+		NetPlaybackAnchor = FVector(FMath::RoundToDouble(Location.X), FMath::RoundToDouble(Location.Y), FMath::RoundToDouble(Location.Z));
+	}
+
+	FRewindNetPlaybackState NewState;
+	NewState.LocationOffset = Location - NetPlaybackAnchor;
+	NewState.Rotation = OwnerTransform.Rotator();
+	NewState.Quantize();
+	NetPlaybackState = NewState;
+}
+
+void URewindComponent::OnRep_NetPlaybackState()
+{
+	if (!bIsNetPlaybackFollower) return;
+
+	const FVector Location = NetPlaybackAnchor + NetPlaybackState.LocationOffset;
+	GetOwner()->SetActorLocationAndRotation(Location, NetPlaybackState.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+}
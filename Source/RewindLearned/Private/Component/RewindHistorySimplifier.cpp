@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Component/RewindHistorySimplifier.h"
+
+TBitArray<> FRewindHistorySimplifier::FindRemovableSnapshots(const FRewindHistorySimplificationInput& Input)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindHistorySimplifier::FindRemovableSnapshots);
+	const int32 NumSnapshots = Input.TransformSnapshots.Num();
+	check(Input.MovementSnapshots.IsEmpty() || Input.MovementSnapshots.Num() == NumSnapshots);
+
+	TBitArray<> Removable(false, NumSnapshots);
+	if (NumSnapshots < 3) return Removable;
+
+	// 回放按快照间隔推进，时间轴使用间隔的累加值（分叉点前后的世界时间不连续）
+	TArray<float> Timeline;
+	Timeline.SetNumUninitialized(NumSnapshots);
+	Timeline[0] = 0.0f;
+	for (int32 Index = 1; Index < NumSnapshots; ++Index)
+	{
+		Timeline[Index] = Timeline[Index - 1] + Input.TransformSnapshots[Index].TimeSinceLastSnapshot;
+	}
+
+	// 用栈代替递归，避免长历史的递归深度
+	TArray<TPair<int32, int32>, TInlineAllocator<32>> Ranges;
+	Ranges.Emplace(0, NumSnapshots - 1);
+	while (!Ranges.IsEmpty())
+	{
+		const TPair<int32, int32> Range = Ranges.Pop(EAllowShrinking::No);
+		const int32 First = Range.Key;
+		const int32 Last = Range.Value;
+		if (Last - First < 2) continue;
+
+		int32 WorstIndex = INDEX_NONE;
+		float WorstError = 1.0f;
+		for (int32 Index = First + 1; Index < Last; ++Index)
+		{
+			const float Error = GetReconstructionError(Input, Timeline, First, Last, Index);
+			if (Error > WorstError)
+			{
+				WorstError = Error;
+				WorstIndex = Index;
+			}
+		}
+
+		if (WorstIndex == INDEX_NONE)
+		{
+			// 整个区间都可以由首尾重建
+			for (int32 Index = First + 1; Index < Last; ++Index) Removable[Index] = true;
+			continue;
+		}
+
+		Ranges.Emplace(First, WorstIndex);
+		Ranges.Emplace(WorstIndex, Last);
+	}
+	return Removable;
+}
+
+float FRewindHistorySimplifier::GetReconstructionError(const FRewindHistorySimplificationInput& Input, const TArray<float>& Timeline, int32 First, int32 Last, int32 Index)
+{
+	// 间隔为0的快照是不连续点（冷历史的间隙、外部回放结束），删除它会让前后两段历史互相插值
+	if (Input.TransformSnapshots[Index].TimeSinceLastSnapshot <= UE_SMALL_NUMBER) return MAX_flt;
+
+	// 休眠状态变化的快照必须保留，结束时间操作时按它恢复休眠
+	const bool bIsSleeping = Input.TransformSnapshots[Index].bIsSleeping;
+	if (bIsSleeping != Input.TransformSnapshots[First].bIsSleeping || bIsSleeping != Input.TransformSnapshots[Last].bIsSleeping) return MAX_flt;
+
+	// 运动模式是离散值，区间内发生变化时必须保留
+	if (!Input.MovementSnapshots.IsEmpty())
+	{
+		const TEnumAsByte<EMovementMode> Mode = Input.MovementSnapshots[Index].MovementMode;
+		if (Mode != Input.MovementSnapshots[First].MovementMode || Mode != Input.MovementSnapshots[Last].MovementMode) return MAX_flt;
+	}
+
+	const float Interval = Timeline[Last] - Timeline[First];
+	if (Interval <= UE_SMALL_NUMBER) return 0.0f;
+
+	// 删除中间的快照后，Last的间隔就是整个区间
+	FTransformAndVelocitySnapshot LastSnapshot = Input.TransformSnapshots[Last];
+	LastSnapshot.TimeSinceLastSnapshot = Interval;
+	const float Alpha = (Timeline[Index] - Timeline[First]) / Interval;
+	const FTransformAndVelocitySnapshot Reconstructed = URewindComponent::BlendSnapshots(Input.TransformSnapshots[First], LastSnapshot, Alpha, Input.InterpolationMode);
+
+	const FTransform& Original = Input.TransformSnapshots[Index].Transform;
+	const float PositionError = FVector::Dist(Reconstructed.Transform.GetLocation(), Original.GetLocation()) / FMath::Max(Input.PositionTolerance, UE_KINDA_SMALL_NUMBER);
+	const float RotationError = Reconstructed.Transform.GetRotation().AngularDistance(Original.GetRotation()) / FMath::Max(Input.RotationToleranceRadians, UE_KINDA_SMALL_NUMBER);
+	return FMath::Max(PositionError, RotationError);
+}
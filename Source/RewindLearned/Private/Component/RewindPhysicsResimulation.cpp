@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Component/RewindPhysicsResimulation.h"
+
+void FRewindResimulationCursor::Reset(const FRewindRigidBodyState& Checkpoint, const FRewindRigidBodyModel& Model)
+{
+	State = Checkpoint;
+	Time = 0.0f;
+	NextInput = 0;
+
+	const FVector GravityDirection = Model.Gravity.GetSafeNormal();
+	bSupported = GravityDirection.IsZero() || FMath::Abs(Checkpoint.LinearVelocity | GravityDirection) < FRewindPhysicsResimulator::SupportedSpeedThreshold;
+}
+
+void FRewindResimulationCursor::AdvanceTo(float TargetTime, TConstArrayView<FRewindPhysicsInput> Inputs,
+	const FRewindRigidBodyModel& Model, float StepSeconds)
+{
+	// 步长的累加误差不能让最后一个完整的步被跳过
+	constexpr float StepTolerance = 1.0e-4f;
+	while (Time + StepSeconds <= TargetTime + StepTolerance)
+	{
+		// 本步之内发生的输入在本步开始时施加
+		FRewindPhysicsResimulator::ApplyInputs(State, NextInput, Time + StepSeconds, Inputs);
+		FRewindPhysicsResimulator::Integrate(State, bSupported, Model, StepSeconds);
+		Time += StepSeconds;
+	}
+}
+
+FRewindRigidBodyState FRewindResimulationCursor::Extrapolate(float TargetTime, TConstArrayView<FRewindPhysicsInput> Inputs,
+	const FRewindRigidBodyModel& Model) const
+{
+	FRewindRigidBodyState Result = State;
+	const float Remaining = TargetTime - Time;
+	if (Remaining <= UE_KINDA_SMALL_NUMBER) return Result;
+
+	int32 InputIndex = NextInput;
+	FRewindPhysicsResimulator::ApplyInputs(Result, InputIndex, TargetTime, Inputs);
+	FRewindPhysicsResimulator::Integrate(Result, bSupported, Model, Remaining);
+	return Result;
+}
+
+void FRewindPhysicsResimulator::ResimulateInterval(const FRewindRigidBodyState& From, const FRewindRigidBodyState& To,
+	float Interval, TConstArrayView<FRewindPhysicsInput> Inputs, const FRewindRigidBodyModel& Model, float StepSeconds,
+	TArray<FRewindRigidBodyState>& OutSamples)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindPhysicsResimulator::ResimulateInterval);
+	check(StepSeconds > 0.0f);
+	OutSamples.Reset();
+
+	// 间隔为零（例如本帧补记的检查点）时没有中间状态
+	if (Interval <= UE_KINDA_SMALL_NUMBER)
+	{
+		OutSamples.Add(From);
+		OutSamples.Add(To);
+		return;
+	}
+
+	const int32 NumSteps = FMath::Max(FMath::CeilToInt32(Interval / StepSeconds - 1.0e-4f), 1);
+	OutSamples.SetNum(NumSteps + 1);
+	OutSamples[0] = From;
+
+	FRewindResimulationCursor Cursor;
+	Cursor.Reset(From, Model);
+	for (int32 Step = 1; Step < NumSteps; ++Step)
+	{
+		Cursor.AdvanceTo(Step * StepSeconds, Inputs, Model, StepSeconds);
+		OutSamples[Step] = Cursor.State;
+	}
+	Cursor.AdvanceTo(Interval, Inputs, Model, StepSeconds);
+	const FRewindRigidBodyState End = Cursor.Extrapolate(Interval, Inputs, Model);
+
+	// 记录时误差不超过容差才不会产生新检查点，这里的修正量很小；超出最大间隔或输入缺失（切换分支后）时修正量较大，但仍然连续
+	const FVector LocationError = To.Transform.GetLocation() - End.Transform.GetLocation();
+	FQuat RotationError = To.Transform.GetRotation() * End.Transform.GetRotation().Inverse();
+	if (RotationError.W < 0.0f) RotationError = -RotationError; // 走最短路径
+	const FVector LinearVelocityError = To.LinearVelocity - End.LinearVelocity;
+	const FVector AngularVelocityError = To.AngularVelocityInRadians - End.AngularVelocityInRadians;
+
+	for (int32 Step = 1; Step < NumSteps; ++Step)
+	{
+		const float Alpha = Step * StepSeconds / Interval;
+		FRewindRigidBodyState& Sample = OutSamples[Step];
+		Sample.Transform.AddToTranslation(LocationError * Alpha);
+		Sample.Transform.SetRotation((FQuat::Slerp(FQuat::Identity, RotationError, Alpha) * Sample.Transform.GetRotation()).GetNormalized());
+		Sample.LinearVelocity += LinearVelocityError * Alpha;
+		Sample.AngularVelocityInRadians += AngularVelocityError * Alpha;
+	}
+	OutSamples[NumSteps] = To;
+}
+
+FRewindRigidBodyState FRewindPhysicsResimulator::SampleInterval(TConstArrayView<FRewindRigidBodyState> Samples, float Interval,
+	float StepSeconds, float Time)
+{
+	check(Samples.Num() >= 2);
+	Time = FMath::Clamp(Time, 0.0f, Interval);
+
+	const int32 Index = FMath::Clamp(FMath::FloorToInt32(Time / StepSeconds), 0, Samples.Num() - 2);
+	const float SampleTime = Index * StepSeconds;
+	const float NextSampleTime = FMath::Min((Index + 1) * StepSeconds, Interval);
+	const float Alpha = NextSampleTime - SampleTime > UE_KINDA_SMALL_NUMBER
+		? FMath::Clamp((Time - SampleTime) / (NextSampleTime - SampleTime), 0.0f, 1.0f)
+		: 1.0f;
+
+	const FRewindRigidBodyState& A = Samples[Index];
+	const FRewindRigidBodyState& B = Samples[Index + 1];
+	FRewindRigidBodyState Result;
+	Result.Transform.Blend(A.Transform, B.Transform, Alpha);
+	Result.LinearVelocity = FMath::Lerp(A.LinearVelocity, B.LinearVelocity, Alpha);
+	Result.AngularVelocityInRadians = FMath::Lerp(A.AngularVelocityInRadians, B.AngularVelocityInRadians, Alpha);
+	return Result;
+}
+
+void FRewindPhysicsResimulator::Integrate(FRewindRigidBodyState& State, bool bSupported, const FRewindRigidBodyModel& Model, float DeltaSeconds)
+{
+	// 先更新速度再用新速度更新位置（半隐式欧拉），阻尼与物理引擎一样按一阶近似
+	if (!bSupported) State.LinearVelocity += Model.Gravity * DeltaSeconds;
+	State.LinearVelocity *= FMath::Max(1.0f - Model.LinearDamping * DeltaSeconds, 0.0f);
+	State.AngularVelocityInRadians *= FMath::Max(1.0f - Model.AngularDamping * DeltaSeconds, 0.0f);
+
+	State.Transform.AddToTranslation(State.LinearVelocity * DeltaSeconds);
+	const FQuat DeltaRotation = FQuat::MakeFromRotationVector(State.AngularVelocityInRadians * DeltaSeconds);
+	State.Transform.SetRotation((DeltaRotation * State.Transform.GetRotation()).GetNormalized());
+}
+
+void FRewindPhysicsResimulator::ApplyInputs(FRewindRigidBodyState& State, int32& NextInput, float Time,
+	TConstArrayView<FRewindPhysicsInput> Inputs)
+{
+	while (NextInput < Inputs.Num() && Inputs[NextInput].TimeAfterCheckpoint <= Time)
+	{
+		State.LinearVelocity += Inputs[NextInput].LinearVelocityChange;
+		State.AngularVelocityInRadians += Inputs[NextInput].AngularVelocityChange;
+		++NextInput;
+	}
+}
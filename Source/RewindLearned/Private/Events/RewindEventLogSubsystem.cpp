@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Events/RewindEventLogSubsystem.h"
+
+#include "RewindLearned.h"
+#include "Algo/BinarySearch.h"
+#include "Component/RewindComponent.h"
+#include "GameMode/RewindGameState.h"
+#include "Registry/RewindComponentRegistry.h"
+#include "Stats/RewindStats.h"
+
+namespace RewindEventLog
+{
+	static FAutoConsoleCommandWithWorldAndArgs DumpCommand(
+		TEXT("Rewind.Events.Dump"),
+		TEXT("Rewind.Events.Dump [MaxEntries] - Log the most recent gameplay events on the rewind timeline"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const URewindEventLogSubsystem* Subsystem = World ? World->GetSubsystem<URewindEventLogSubsystem>() : nullptr;
+			if (Subsystem) Subsystem->DumpEvents(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 20);
+		}));
+}
+
+bool URewindEventLogSubsystem::RecordEvent(FName Type, UObject* Subject, TFunction<void()> Undo, TFunction<void(float)> Redo)
+{
+	if (bIsApplying || IsTimelineManipulated()) return false;
+
+	FRewindGameplayEvent& Event = Events.AddDefaulted_GetRef();
+	// 本帧的Tick还没有执行，直接用世界时间，不早于最后一个事件以保证数组有序；刚刚恢复、间隙还没有记录时记在恢复点
+	Event.Time = bWasManipulating ? AppliedTime : FMath::Max(GetWorld()->GetTimeSeconds(), AppliedTime);
+	Event.Sequence = NextSequence++;
+	Event.Type = Type;
+	Event.Subject = Subject;
+	Event.Undo = MoveTemp(Undo);
+	Event.Redo = MoveTemp(Redo);
+	return true;
+}
+
+bool URewindEventLogSubsystem::IsTimelineManipulated() const
+{
+	const ARewindGameState* GameState = GetGameState();
+	return GameState && (GameState->IsGlobalRewinding() || GameState->IsGlobalFastForwarding() || GameState->IsGlobalTimeScrubbing());
+}
+
+float URewindEventLogSubsystem::GetTimelineSeconds(float From, float To) const
+{
+	float Seconds = To - From;
+	for (const FTimelineGap& Gap : Gaps)
+	{
+		if (Gap.Start >= To) break;
+		Seconds -= FMath::Max(FMath::Min(Gap.End, To) - FMath::Max(Gap.Start, From), 0.0f);
+	}
+	return FMath::Max(Seconds, 0.0f);
+}
+
+float URewindEventLogSubsystem::GetTimeBefore(float To, float TimelineSeconds) const
+{
+	// 从后往前，每经过一个间隙就再往前移动间隙的长度
+	float Time = To - TimelineSeconds;
+	for (int32 Index = Gaps.Num() - 1; Index >= 0; --Index)
+	{
+		const FTimelineGap& Gap = Gaps[Index];
+		if (Gap.End <= Time) break;
+		if (Gap.Start < To) Time -= FMath::Min(Gap.End, To) - Gap.Start;
+	}
+	return Time;
+}
+
+void URewindEventLogSubsystem::SelectTimeReference()
+{
+	TimeReference.Reset();
+	const URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	if (!Registry) return;
+
+	float ReferenceOldestTime = TNumericLimits<float>::Max();
+	for (const URewindComponent* Member : Registry->GetClock(URewindComponentRegistry::GlobalClockIndex).Members)
+	{
+		float OldestTime = 0.0f;
+		float NewestTime = 0.0f;
+		if (!Member || !Member->IsTimeBeingManipulated() || !Member->GetHistoryTimeRange(OldestTime, NewestTime)) continue;
+		if (OldestTime < ReferenceOldestTime)
+		{
+			ReferenceOldestTime = OldestTime;
+			TimeReference = Member;
+		}
+	}
+}
+
+float URewindEventLogSubsystem::GetManipulatedPlaybackTime() const
+{
+	const URewindComponent* Reference = TimeReference.Get();
+	if (Reference && Reference->IsTimeBeingManipulated()) return Reference->GetPlaybackTime();
+
+	// 参考组件不可用时退回到GameState的游标
+	const ARewindGameState* GameState = GetGameState();
+	return GameState ? FMath::Max(ManipulationLiveTime - GameState->GetTimelineCursorSeconds(), 0.0f) : AppliedTime;
+}
+
+const ARewindGameState* URewindEventLogSubsystem::GetGameState() const
+{
+	return GetWorld()->GetGameState<ARewindGameState>();
+}
+
+void URewindEventLogSubsystem::DumpEvents(int32 MaxEntries) const
+{
+	UE_LOG(LogRewind, Display, TEXT("Rewind events: %d logged, playback at %.3f s%s"),
+		Events.Num(), AppliedTime, bWasManipulating ? TEXT(" (manipulating)") : TEXT(""));
+
+	for (int32 Index = FMath::Max(Events.Num() - FMath::Max(MaxEntries, 0), 0); Index < Events.Num(); ++Index)
+	{
+		const FRewindGameplayEvent& Event = Events[Index];
+		const UObject* Subject = Event.Subject.Get();
+		UE_LOG(LogRewind, Display, TEXT("  #%-6u %9.3f s  %-20s %s%s"), Event.Sequence, Event.Time, *Event.Type.ToString(),
+			Subject ? *Subject->GetName() : TEXT("<none>"), Event.Time > AppliedTime ? TEXT("  (undone)") : TEXT(""));
+	}
+}
+
+void URewindEventLogSubsystem::Deinitialize()
+{
+	Events.Empty();
+	Gaps.Empty();
+	OnTimelinePlayback.Clear();
+	Super::Deinitialize();
+}
+
+TStatId URewindEventLogSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URewindEventLogSubsystem, STATGROUP_Tickables);
+}
+
+void URewindEventLogSubsystem::Tick(float DeltaTime)
+{
+	/* 可Tick对象在所有Tick组之后更新：GameMode已经推进了游标，组件也已经应用了本帧的快照 */
+	Super::Tick(DeltaTime);
+
+	const ARewindGameState* GameState = GetGameState();
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+
+	if (IsTimelineManipulated())
+	{
+		if (!bWasManipulating)
+		{
+			// 组件在上一帧之后停止记录，没有参考组件时游标从上一帧的时刻往回计算
+			bWasManipulating = true;
+			ManipulationLiveTime = AppliedTime;
+			SelectTimeReference();
+		}
+		SeekTo(GetManipulatedPlaybackTime());
+		OnTimelinePlayback.Broadcast(true, AppliedTime);
+		return;
+	}
+
+	if (bWasManipulating)
+	{
+		/* 从播放位置恢复：之后的事件和间隙属于被放弃的未来，时间线从恢复点跳到当前世界时间继续 */
+		bWasManipulating = false;
+		TimeReference.Reset();
+		const int32 FirstDiscarded = UpperBound(AppliedTime);
+		if (FirstDiscarded < Events.Num())
+		{
+			UE_LOG(LogRewind, Verbose, TEXT("Discarding %d gameplay events after %.3f s"), Events.Num() - FirstDiscarded, AppliedTime);
+			Events.RemoveAt(FirstDiscarded, Events.Num() - FirstDiscarded);
+		}
+
+		Gaps.RemoveAll([this](const FTimelineGap& Gap) { return Gap.Start >= AppliedTime; });
+		if (Gaps.Num() > 0) Gaps.Last().End = FMath::Min(Gaps.Last().End, AppliedTime);
+		if (WorldTime > AppliedTime) Gaps.Add({AppliedTime, WorldTime});
+
+		OnTimelinePlayback.Broadcast(false, AppliedTime);
+	}
+
+	AppliedTime = WorldTime;
+
+	// 超出最大回溯时长的事件不会再被回溯到，更早的间隙也不再参与换算
+	if (GameState)
+	{
+		const float OldestTime = GetTimeBefore(WorldTime, GameState->GetMaxRewindSeconds());
+		if (Events.Num() > 0 && Events[0].Time < OldestTime) Events.RemoveAt(0, Algo::LowerBoundBy(Events, OldestTime, &FRewindGameplayEvent::Time));
+		if (Gaps.Num() > 0 && Gaps[0].End < OldestTime) Gaps.RemoveAt(0, Algo::LowerBoundBy(Gaps, OldestTime, [](const FTimelineGap& Gap) { return Gap.End; }));
+	}
+}
+
+void URewindEventLogSubsystem::SeekTo(float TargetTime)
+{
+	if (TargetTime == AppliedTime) return;
+	REWIND_SCOPE_CYCLE_COUNTER(EventSeek);
+
+	TGuardValue<bool> ApplyingGuard(bIsApplying, true);
+	const int32 AppliedEnd = UpperBound(AppliedTime);
+	const int32 TargetEnd = UpperBound(TargetTime);
+
+	if (TargetTime < AppliedTime)
+	{
+		// (TargetTime, AppliedTime]中的事件，从后往前撤销
+		for (int32 Index = AppliedEnd - 1; Index >= TargetEnd; --Index)
+		{
+			if (Events[Index].Undo) Events[Index].Undo();
+		}
+	}
+	else
+	{
+		// (AppliedTime, TargetTime]中的事件，从前往后重做
+		for (int32 Index = AppliedEnd; Index < TargetEnd; ++Index)
+		{
+			if (Events[Index].Redo) Events[Index].Redo(GetTimelineSeconds(Events[Index].Time, TargetTime));
+		}
+	}
+
+	AppliedTime = TargetTime;
+}
+
+int32 URewindEventLogSubsystem::UpperBound(float Time) const
+{
+	return Algo::UpperBoundBy(Events, Time, &FRewindGameplayEvent::Time);
+}
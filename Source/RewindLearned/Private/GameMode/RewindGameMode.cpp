@@ -3,37 +3,113 @@
 
 #include "RewindLearned/Public/GameMode/RewindGameMode.h"
 
+#include "Component/RewindComponent.h"
+#include "GameMode/RewindGameState.h"
+#include "Registry/RewindComponentRegistry.h"
+
 ARewindGameMode::ARewindGameMode()
 {
 	// 设置默认pawn
 	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/RewindLearned/Content/BP/BP_RewindCharacter"));
 	if (PlayerPawnBPClass.Class != nullptr) {DefaultPawnClass = PlayerPawnBPClass.Class;}
+
+	// 全局时间状态通过GameState复制给客户端
+	GameStateClass = ARewindGameState::StaticClass();
+
+	// 需要Tick来推进时间轴游标
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void ARewindGameMode::InitGameState()
+{
+	Super::InitGameState();
+
+	if (ARewindGameState* RewindGameState = GetGameState<ARewindGameState>())
+	{
+		RewindGameState->SetMaxRewindSeconds(MaxRewindSeconds);
+		RewindGameState->SetPhysicsResimulationSettings(PhysicsResimulation);
+	}
+	PushTimeStateToGameState();
+}
+
+void ARewindGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	/* 游标由上一次状态变化按速度外推（与客户端相同的计算），这里只取回本地值，下一次状态变化时从它继续；不逐帧写入复制的状态 */
+	if (const ARewindGameState* RewindGameState = GetGameState<ARewindGameState>())
+	{
+		TimelineCursorSeconds = RewindGameState->GetTimelineCursorSeconds();
+	}
+}
+
+void ARewindGameMode::PushTimeStateToGameState()
+{
+	ARewindGameState* RewindGameState = GetGameState<ARewindGameState>();
+	if (!RewindGameState) return;
+
+	// 只在离散的状态变化时调用：先按旧状态把游标推进到此刻，再以此刻为起点记录新的方向和速度；回到正常时间流逝时游标回到实时
+	if (!bIsGlobalTimeScrubbing && !bIsGlobalRewinding && !bIsGlobalFastForwarding) TimelineCursorSeconds = 0.0f;
+	else TimelineCursorSeconds = RewindGameState->GetTimelineCursorSeconds();
+
+	FRewindGlobalTimeState TimeState;
+	TimeState.bIsRewinding = bIsGlobalRewinding;
+	TimeState.bIsFastForwarding = bIsGlobalFastForwarding;
+	TimeState.bIsTimeScrubbing = bIsGlobalTimeScrubbing;
+	TimeState.GlobalRewindSpeed = GlobalRewindSpeed;
+	TimeState.TimelineCursorSeconds = TimelineCursorSeconds;
+	TimeState.CursorServerTime = RewindGameState->GetServerWorldTimeSeconds();
+	RewindGameState->SetTimeState(TimeState);
+}
+
+void ARewindGameMode::ExecuteTimeCommand(ERewindTimeCommand Command)
+{
+	switch (Command)
+	{
+	case ERewindTimeCommand::StartRewind: StartGlobalRewind(); break;
+	case ERewindTimeCommand::StopRewind: StopGlobalRewind(); break;
+	case ERewindTimeCommand::StartFastForward: StartGlobalFastForward(); break;
+	case ERewindTimeCommand::StopFastForward: StopGlobalFastForward(); break;
+	case ERewindTimeCommand::ToggleTimeScrub: ToggleTimeScrub(); break;
+	case ERewindTimeCommand::SetSpeedSlowest: SetRewindSpeedSlowest(); break;
+	case ERewindTimeCommand::SetSpeedSlower: SetRewindSpeedSlower(); break;
+	case ERewindTimeCommand::SetSpeedNormal: SetRewindSpeedNormal(); break;
+	case ERewindTimeCommand::SetSpeedFaster: SetRewindSpeedFaster(); break;
+	case ERewindTimeCommand::SetSpeedFastest: SetRewindSpeedFastest(); break;
+	case ERewindTimeCommand::RestoreAbandonedTimeline: RestoreAbandonedTimeline(); break;
+	default: checkNoEntry();
+	}
 }
 
 /* ---------------------调整时间操纵速度相关函数--------------------- */
 void ARewindGameMode::SetRewindSpeedSlowest()
 {
 	GlobalRewindSpeed = SlowestRewindSpeed;
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::SetRewindSpeedSlower()
 {
 	GlobalRewindSpeed = SlowerRewindSpeed;
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::SetRewindSpeedNormal()
 {
 	GlobalRewindSpeed = NormalRewindSpeed;
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::SetRewindSpeedFaster()
 {
 	GlobalRewindSpeed = FasterRewindSpeed;
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::SetRewindSpeedFastest()
 {
 	GlobalRewindSpeed = FastestRewindSpeed;
+	PushTimeStateToGameState();
 }
 
 /* ---------------------时间操纵相关函数--------------------- */
@@ -41,43 +117,57 @@ void ARewindGameMode::StartGlobalRewind()
 {
 	TRACE_BOOKMARK(TEXT("ARewindGameMode::StartGlobalRewind")); // 性能检测
 	bIsGlobalRewinding = true;
+	PushTimeStateToGameState();
 	//GEngine->AddOnScreenDebugMessage(-1, 10, FColor::Blue, FString::Printf(TEXT("ARewindGameMode::StartGlobalRewind()")));
-	OnGlobalRewindStarted.Broadcast(); // 广播该事件，通知rewind component工作
 }
 
 void ARewindGameMode::StopGlobalRewind()
 {
 	TRACE_BOOKMARK(TEXT("ARewindGameMode::StartGlobalStop"));
 	bIsGlobalRewinding = false;
-	OnGlobalRewindCompleted.Broadcast();
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::StartGlobalFastForward()
 {
 	TRACE_BOOKMARK(TEXT("ARewindGameMode::StartGlobalFastForward"));
 	bIsGlobalFastForwarding = true;
-	OnGlobalFastForwardStarted.Broadcast();
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::StopGlobalFastForward()
 {
 	TRACE_BOOKMARK(TEXT("ARewindGameMode::StopGlobalFastForward"));
 	bIsGlobalFastForwarding = false;
-	OnGlobalFastForwardCompleted.Broadcast();
+	PushTimeStateToGameState();
 }
 
 void ARewindGameMode::ToggleTimeScrub()
 {
 	/* 时间暂停开关函数 */
 	bIsGlobalTimeScrubbing = !bIsGlobalTimeScrubbing;
+	PushTimeStateToGameState();
 	if (bIsGlobalTimeScrubbing)
 	{
 		TRACE_BOOKMARK(TEXT("ARewindGameMode::ToggleTimeScrub - Start Time Scrubbing"));
-		OnGlobalTimeScrubStarted.Broadcast();
 	}
 	else
 	{
 		TRACE_BOOKMARK(TEXT("ARewindGameMode::ToggleTimeScrub - Stop Time Scrubbing"));
-		OnGlobalTimeScrubCompleted.Broadcast();
+	}
+}
+
+void ARewindGameMode::RestoreAbandonedTimeline()
+{
+	/* 所有组件都在同一时刻分叉，因此各自最近放弃的分支属于同一条全局时间线；客户端跟随服务器发送的回放结果 */
+	if (!bIsGlobalTimeScrubbing || bIsGlobalRewinding || bIsGlobalFastForwarding) return;
+
+	const URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	if (!Registry) return;
+
+	TRACE_BOOKMARK(TEXT("ARewindGameMode::RestoreAbandonedTimeline"));
+	for (URewindComponent* Component : Registry->GetComponents())
+	{
+		if (Component) Component->SwitchToLatestTimelineBranch();
 	}
 }
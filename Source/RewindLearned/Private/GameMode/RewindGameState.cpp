@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameMode/RewindGameState.h"
+
+#include "Net/UnrealNetwork.h"
+#include "Registry/RewindComponentRegistry.h"
+
+float FRewindGlobalTimeState::GetCursorSecondsAt(double ServerTime, float MaxRewindSeconds) const
+{
+	const float Direction = bIsRewinding ? 1.0f : bIsFastForwarding ? -1.0f : 0.0f;
+	const float Elapsed = FMath::Max(static_cast<float>(ServerTime - CursorServerTime), 0.0f);
+	return FMath::Clamp(TimelineCursorSeconds + Direction * GlobalRewindSpeed * Elapsed, 0.0f, MaxRewindSeconds);
+}
+
+ARewindGameState::ARewindGameState()
+{
+	// 时间状态变化需要尽快同步到客户端，避免客户端与服务器的回溯进度不一致；游标在两次变化之间由客户端外推，不会逐帧复制
+	NetUpdateFrequency = 30.0f;
+}
+
+void ARewindGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ARewindGameState, TimeState);
+	DOREPLIFETIME_CONDITION(ARewindGameState, MaxRewindSeconds, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(ARewindGameState, PhysicsResimulationSettings, COND_InitialOnly);
+}
+
+void ARewindGameState::SetTimeState(const FRewindGlobalTimeState& NewTimeState)
+{
+	check(HasAuthority());
+	const FRewindGlobalTimeState OldTimeState = TimeState;
+	TimeState = NewTimeState;
+
+	// 服务器不会调用OnRep，需要手动广播
+	BroadcastTimeStateChanges(OldTimeState);
+}
+
+float ARewindGameState::GetTimelineCursorSeconds() const
+{
+	return TimeState.GetCursorSecondsAt(GetServerWorldTimeSeconds(), MaxRewindSeconds);
+}
+
+void ARewindGameState::OnRep_TimeState(const FRewindGlobalTimeState& OldTimeState)
+{
+	BroadcastTimeStateChanges(OldTimeState);
+}
+
+void ARewindGameState::BroadcastTimeStateChanges(const FRewindGlobalTimeState& OldTimeState)
+{
+	/*
+	 * 客户端可能在一次复制中同时收到多个状态变化（例如时停和快进同时开始），
+	 * 组件的状态机要求快进必须在时停之后开始，所以按注册表给出的固定顺序广播；
+	 * 回溯组件通过注册表分发给全局时钟的成员（时间泡中的组件不受全局状态影响），动态委托只留给蓝图和其他Actor（GameMode不再重复广播）
+	 */
+	if (URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>())
+	{
+		Registry->SetClockState(URewindComponentRegistry::GlobalClockIndex, TimeState);
+	}
+
+	TArray<ERewindGlobalTransition, TInlineAllocator<6>> Transitions;
+	URewindComponentRegistry::GetTransitions(OldTimeState, TimeState, Transitions);
+	for (const ERewindGlobalTransition Transition : Transitions)
+	{
+		switch (Transition)
+		{
+		case ERewindGlobalTransition::TimeScrubStarted: OnGlobalTimeScrubStarted.Broadcast(); break;
+		case ERewindGlobalTransition::RewindStarted: OnGlobalRewindStarted.Broadcast(); break;
+		case ERewindGlobalTransition::FastForwardStarted: OnGlobalFastForwardStarted.Broadcast(); break;
+		case ERewindGlobalTransition::RewindCompleted: OnGlobalRewindCompleted.Broadcast(); break;
+		case ERewindGlobalTransition::FastForwardCompleted: OnGlobalFastForwardCompleted.Broadcast(); break;
+		case ERewindGlobalTransition::TimeScrubCompleted: OnGlobalTimeScrubCompleted.Broadcast(); break;
+		default: checkNoEntry();
+		}
+	}
+}
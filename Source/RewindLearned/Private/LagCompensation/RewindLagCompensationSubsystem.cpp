@@ -0,0 +1,359 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LagCompensation/RewindLagCompensationSubsystem.h"
+
+#include "RewindLearned.h"
+#include "Component/RewindComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkinnedMeshComponent.h"
+#include "Components/SphereComponent.h"
+#include "Engine/World.h"
+#include "Registry/RewindComponentRegistry.h"
+
+namespace RewindLagCompensation
+{
+	/* 射线与球体求交，Direction为单位向量 */
+	bool IntersectRaySphere(const FVector& Start, const FVector& Direction, float Length, const FVector& Center, float Radius, float& OutDistance, FVector& OutNormal)
+	{
+		const FVector ToStart = Start - Center;
+		const double B = FVector::DotProduct(ToStart, Direction);
+		const double C = ToStart.SizeSquared() - FMath::Square(Radius);
+		if (C <= 0.0) // 起点在球内
+		{
+			OutDistance = 0.0f;
+			OutNormal = -Direction;
+			return true;
+		}
+		if (B > 0.0) return false; // 远离球体
+
+		const double Discriminant = B * B - C;
+		if (Discriminant < 0.0) return false;
+
+		const double Distance = -B - FMath::Sqrt(Discriminant);
+		if (Distance > Length) return false;
+
+		OutDistance = Distance;
+		OutNormal = (Start + Direction * Distance - Center).GetSafeNormal();
+		return true;
+	}
+
+	/* 射线与胶囊体求交：先检测圆柱部分，再检测两端的半球 */
+	bool IntersectRayCapsule(const FVector& Start, const FVector& Direction, float Length, const FVector& A, const FVector& B, float Radius, float& OutDistance, FVector& OutNormal)
+	{
+		if (FMath::PointDistToSegmentSquared(Start, A, B) <= FMath::Square(Radius)) // 起点在胶囊体内
+		{
+			OutDistance = 0.0f;
+			OutNormal = -Direction;
+			return true;
+		}
+
+		bool bHit = false;
+		OutDistance = Length;
+
+		const FVector Axis = B - A;
+		const double AxisLength = Axis.Size();
+		if (AxisLength > UE_KINDA_SMALL_NUMBER)
+		{
+			const FVector AxisDirection = Axis / AxisLength;
+			const FVector RelativeStart = Start - A;
+			// 去掉轴向分量，在垂直于轴的平面中求解
+			const FVector PlanarDirection = Direction - AxisDirection * FVector::DotProduct(Direction, AxisDirection);
+			const FVector PlanarStart = RelativeStart - AxisDirection * FVector::DotProduct(RelativeStart, AxisDirection);
+			const double QuadA = PlanarDirection.SizeSquared();
+			if (QuadA > UE_KINDA_SMALL_NUMBER)
+			{
+				const double QuadB = FVector::DotProduct(PlanarDirection, PlanarStart);
+				const double QuadC = PlanarStart.SizeSquared() - FMath::Square(Radius);
+				const double Discriminant = QuadB * QuadB - QuadA * QuadC;
+				if (Discriminant >= 0.0)
+				{
+					const double Distance = (-QuadB - FMath::Sqrt(Discriminant)) / QuadA;
+					const FVector HitLocation = Start + Direction * Distance;
+					const double AxisPosition = FVector::DotProduct(HitLocation - A, AxisDirection);
+					if (Distance >= 0.0 && Distance <= OutDistance && AxisPosition >= 0.0 && AxisPosition <= AxisLength)
+					{
+						bHit = true;
+						OutDistance = Distance;
+						OutNormal = (HitLocation - (A + AxisDirection * AxisPosition)).GetSafeNormal();
+					}
+				}
+			}
+		}
+
+		float CapDistance;
+		FVector CapNormal;
+		if (IntersectRaySphere(Start, Direction, OutDistance, A, Radius, CapDistance, CapNormal) && (!bHit || CapDistance < OutDistance))
+		{
+			bHit = true;
+			OutDistance = CapDistance;
+			OutNormal = CapNormal;
+		}
+		if (IntersectRaySphere(Start, Direction, OutDistance, B, Radius, CapDistance, CapNormal) && (!bHit || CapDistance < OutDistance))
+		{
+			bHit = true;
+			OutDistance = CapDistance;
+			OutNormal = CapNormal;
+		}
+		return bHit;
+	}
+
+	/* 射线与轴对齐包围盒求交（slab方法），输入都在盒子的局部空间 */
+	bool IntersectRayBox(const FVector& Start, const FVector& Direction, float Length, const FVector& Center, const FVector& Extent, float& OutDistance, FVector& OutNormal)
+	{
+		double MinDistance = 0.0;
+		double MaxDistance = Length;
+		int32 HitAxis = INDEX_NONE;
+		double HitSign = 0.0;
+
+		for (int32 Axis = 0; Axis < 3; ++Axis)
+		{
+			const double BoxMin = Center[Axis] - Extent[Axis];
+			const double BoxMax = Center[Axis] + Extent[Axis];
+			if (FMath::Abs(Direction[Axis]) < UE_SMALL_NUMBER)
+			{
+				// 与该轴平行：起点必须在slab内
+				if (Start[Axis] < BoxMin || Start[Axis] > BoxMax) return false;
+				continue;
+			}
+
+			double Near = (BoxMin - Start[Axis]) / Direction[Axis];
+			double Far = (BoxMax - Start[Axis]) / Direction[Axis];
+			if (Near > Far) Swap(Near, Far);
+
+			if (Near > MinDistance)
+			{
+				MinDistance = Near;
+				HitAxis = Axis;
+				HitSign = Direction[Axis] > 0.0 ? -1.0 : 1.0;
+			}
+			MaxDistance = FMath::Min(MaxDistance, Far);
+			if (MinDistance > MaxDistance) return false;
+		}
+
+		OutDistance = MinDistance;
+		if (HitAxis == INDEX_NONE) // 起点在盒子内
+		{
+			OutNormal = -Direction;
+		}
+		else
+		{
+			OutNormal = FVector::ZeroVector;
+			OutNormal[HitAxis] = HitSign;
+		}
+		return true;
+	}
+}
+
+bool URewindLagCompensationSubsystem::LineTraceAtTime(float Time, const FVector& Start, const FVector& End, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore)
+{
+	return SweepAtTime(Time, Start, End, 0.0f, OutHit, ActorsToIgnore);
+}
+
+bool URewindLagCompensationSubsystem::SphereSweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore)
+{
+	return SweepAtTime(Time, Start, End, FMath::Max(SweepRadius, 0.0f), OutHit, ActorsToIgnore);
+}
+
+bool URewindLagCompensationSubsystem::SweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindLagCompensationSubsystem::SweepAtTime);
+	OutHit = FHitResult(Start, End);
+
+	const FVector Delta = End - Start;
+	const float Length = Delta.Size();
+	if (Length < UE_KINDA_SMALL_NUMBER) return false;
+	const FVector Direction = Delta / Length;
+
+	// 粗检测：只有扫掠路径附近的Actor才需要重建历史碰撞体
+	FBox QueryBounds(ForceInit);
+	QueryBounds += Start;
+	QueryBounds += End;
+	QueryBounds = QueryBounds.ExpandBy(BroadphaseMargin + SweepRadius);
+
+	TArray<AActor*> Candidates;
+	GatherCandidateActors(Time, QueryBounds, Candidates);
+	Candidates.RemoveAll([&ActorsToIgnore](const AActor* Actor) { return ActorsToIgnore.Contains(Actor); });
+	if (Candidates.Num() == 0) return false;
+
+	TArray<FRewindGhost> Ghosts;
+	BuildGhostsAtTime(Time, Candidates, Ghosts);
+
+	// 精确检测：对每个幽灵求交，保留最近的命中
+	const FRewindGhost* ClosestGhost = nullptr;
+	float ClosestDistance = Length;
+	FVector ClosestNormal = FVector::ZeroVector;
+	for (const FRewindGhost& Ghost : Ghosts)
+	{
+		float Distance;
+		FVector Normal;
+		if (SweepGhost(Ghost, Start, Direction, ClosestDistance, SweepRadius, Distance, Normal) && (!ClosestGhost || Distance < ClosestDistance))
+		{
+			ClosestGhost = &Ghost;
+			ClosestDistance = Distance;
+			ClosestNormal = Normal;
+		}
+	}
+	if (!ClosestGhost) return false;
+
+	OutHit.bBlockingHit = true;
+	OutHit.bStartPenetrating = ClosestDistance <= 0.0f;
+	OutHit.Time = ClosestDistance / Length;
+	OutHit.Distance = ClosestDistance;
+	OutHit.Location = Start + Direction * ClosestDistance;
+	OutHit.ImpactPoint = OutHit.Location - ClosestNormal * SweepRadius;
+	OutHit.Normal = ClosestNormal;
+	OutHit.ImpactNormal = ClosestNormal;
+	OutHit.HitObjectHandle = FActorInstanceHandle(ClosestGhost->Actor.Get());
+	OutHit.Component = ClosestGhost->Component;
+	return true;
+}
+
+void URewindLagCompensationSubsystem::GatherCandidateActors(float Time, const FBox& QueryBounds, TArray<AActor*>& OutActors) const
+{
+	/*
+	 * 物理场景只知道物体现在的位置，延迟期间移动很远的物体会被漏掉；
+	 * 因此先从注册表的网格中取出[Time, 现在]内经过查询范围附近的组件，再用各自历史经过的包围盒加上现在的位置做判断，
+	 * 开销与附近的组件数量成正比；查询时刻早于网格的窗口时才遍历所有回溯组件
+	 */
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindLagCompensationSubsystem::GatherCandidateActors);
+	const UWorld* World = GetWorld();
+	const URewindComponentRegistry* Registry = World ? World->GetSubsystem<URewindComponentRegistry>() : nullptr;
+	if (!Registry) return;
+
+	const float Now = World->GetTimeSeconds();
+	TSet<AActor*> Candidates;
+	auto TestComponent = [this, Time, Now, &QueryBounds, &Candidates](const URewindComponent* Component)
+	{
+		AActor* Actor = Component ? Component->GetOwner() : nullptr;
+		const UPrimitiveComponent* RootComponent = Component ? Component->GetOwnerRootComponent() : nullptr;
+		if (!Actor || !RootComponent) return;
+
+		FBox SweptBounds(ForceInit);
+		if (!Component->GetLocationBoundsInTimeRange(Time, Now, SweptBounds)) return;
+		SweptBounds += Actor->GetActorLocation();
+
+		// 位置只是根组件的原点，扩展整个Actor碰撞体的半径
+		const FBox ActorBounds = Actor->GetComponentsBoundingBox();
+		const float ShapeRadius = (ActorBounds.GetCenter() - Actor->GetActorLocation()).Size() + ActorBounds.GetExtent().Size();
+		if (SweptBounds.ExpandBy(ShapeRadius + BroadphaseMargin).Intersect(QueryBounds)) Candidates.Add(Actor);
+	};
+
+	// 网格在格子粒度上是保守的，扩展与精确判断相同的余量
+	TArray<URewindComponent*> NearbyComponents;
+	if (Registry->GatherSweptBoundsCandidates(Time, QueryBounds.ExpandBy(BroadphaseMargin), NearbyComponents))
+	{
+		for (const URewindComponent* Component : NearbyComponents) TestComponent(Component);
+	}
+	else
+	{
+		UE_LOG(LogRewind, Verbose, TEXT("Lag compensation query at %.3f s is older than the broadphase grid, scanning all rewind components"), Time);
+		for (const URewindComponent* Component : Registry->GetComponents()) TestComponent(Component);
+	}
+	OutActors.Append(Candidates.Array());
+}
+
+void URewindLagCompensationSubsystem::BuildGhostsAtTime(float Time, TConstArrayView<AActor*> Actors, TArray<FRewindGhost>& OutGhosts) const
+{
+	TArray<UPrimitiveComponent*> GhostComponents;
+	OutGhosts.Reserve(OutGhosts.Num() + Actors.Num());
+	for (AActor* Actor : Actors)
+	{
+		const URewindComponent* RewindComponent = Actor ? Actor->FindComponentByClass<URewindComponent>() : nullptr;
+		UPrimitiveComponent* RootComponent = RewindComponent ? RewindComponent->GetOwnerRootComponent() : nullptr;
+		if (!RootComponent) continue;
+
+		// 从历史中插值出过去时刻的Transform，不移动Actor
+		FTransformAndVelocitySnapshot Snapshot;
+		if (!RewindComponent->GetSnapshotAtTime(Time, Snapshot)) continue;
+
+		// 子组件保持现在相对根组件的姿势，跟随根组件回到过去
+		const FTransform& RootTransform = RootComponent->GetComponentTransform();
+		GetGhostComponents(Actor, RootComponent, GhostComponents);
+		for (UPrimitiveComponent* GhostComponent : GhostComponents)
+		{
+			FRewindGhost Ghost;
+			if (!InitializeGhostShape(GhostComponent, Ghost)) continue;
+			Ghost.Actor = Actor;
+			Ghost.Component = GhostComponent;
+			Ghost.Transform = GhostComponent == RootComponent
+				? Snapshot.Transform
+				: GhostComponent->GetComponentTransform().GetRelativeTransform(RootTransform) * Snapshot.Transform;
+			OutGhosts.Add(MoveTemp(Ghost));
+		}
+	}
+}
+
+void URewindLagCompensationSubsystem::GetGhostComponents(const AActor* Actor, const UPrimitiveComponent* RootComponent, TArray<UPrimitiveComponent*>& OutComponents)
+{
+	OutComponents.Reset();
+	Actor->ForEachComponent<UPrimitiveComponent>(false, [RootComponent, &OutComponents](UPrimitiveComponent* Component)
+	{
+		// 骨骼网格的碰撞来自物理资产，按包围盒重建会比实际形状大得多
+		const bool bIsChildCollision = Component != RootComponent && Component->IsQueryCollisionEnabled() &&
+			Component->IsAttachedTo(RootComponent) && !Component->IsA<USkinnedMeshComponent>();
+		if (Component == RootComponent || bIsChildCollision) OutComponents.Add(Component);
+	});
+}
+
+bool URewindLagCompensationSubsystem::InitializeGhostShape(const UPrimitiveComponent* Component, FRewindGhost& OutGhost)
+{
+	/* 角色使用胶囊体，球形碰撞使用球体，其余使用局部包围盒 */
+	if (const UCapsuleComponent* Capsule = Cast<UCapsuleComponent>(Component))
+	{
+		OutGhost.ShapeType = ERewindGhostShapeType::Capsule;
+		OutGhost.Radius = Capsule->GetUnscaledCapsuleRadius();
+		OutGhost.HalfHeight = Capsule->GetUnscaledCapsuleHalfHeight();
+		return true;
+	}
+	if (const USphereComponent* Sphere = Cast<USphereComponent>(Component))
+	{
+		OutGhost.ShapeType = ERewindGhostShapeType::Sphere;
+		OutGhost.Radius = Sphere->GetUnscaledSphereRadius();
+		return true;
+	}
+
+	const FBoxSphereBounds LocalBounds = Component->CalcBounds(FTransform::Identity);
+	if (LocalBounds.BoxExtent.IsNearlyZero()) return false;
+	OutGhost.ShapeType = ERewindGhostShapeType::Box;
+	OutGhost.LocalCenter = LocalBounds.Origin;
+	OutGhost.BoxExtent = LocalBounds.BoxExtent;
+	return true;
+}
+
+bool URewindLagCompensationSubsystem::SweepGhost(const FRewindGhost& Ghost, const FVector& Start, const FVector& Direction, float Length, float SweepRadius, float& OutDistance, FVector& OutNormal)
+{
+	/* 球形扫掠等价于：把形状膨胀SweepRadius后做射线检测（盒子的棱角处为近似） */
+	const FVector Scale = Ghost.Transform.GetScale3D().GetAbs();
+	switch (Ghost.ShapeType)
+	{
+	case ERewindGhostShapeType::Sphere:
+	{
+		const FVector Center = Ghost.Transform.TransformPosition(Ghost.LocalCenter);
+		const float Radius = Ghost.Radius * Scale.GetMax() + SweepRadius;
+		return RewindLagCompensation::IntersectRaySphere(Start, Direction, Length, Center, Radius, OutDistance, OutNormal);
+	}
+	case ERewindGhostShapeType::Capsule:
+	{
+		const float ScaledRadius = Ghost.Radius * FMath::Max(Scale.X, Scale.Y);
+		const float SegmentHalfLength = FMath::Max(Ghost.HalfHeight * Scale.Z - ScaledRadius, 0.0f);
+		const FVector Center = Ghost.Transform.TransformPosition(Ghost.LocalCenter);
+		const FVector Up = Ghost.Transform.GetRotation().GetUpVector();
+		return RewindLagCompensation::IntersectRayCapsule(
+			Start, Direction, Length, Center - Up * SegmentHalfLength, Center + Up * SegmentHalfLength, ScaledRadius + SweepRadius, OutDistance, OutNormal);
+	}
+	case ERewindGhostShapeType::Box:
+	default:
+	{
+		// 在不含缩放的局部空间中计算，保证扫掠半径不被缩放扭曲
+		const FTransform RigidTransform(Ghost.Transform.GetRotation(), Ghost.Transform.GetLocation());
+		const FVector LocalStart = RigidTransform.InverseTransformPositionNoScale(Start);
+		const FVector LocalDirection = RigidTransform.InverseTransformVectorNoScale(Direction);
+		const FVector Extent = Ghost.BoxExtent * Scale + FVector(SweepRadius);
+		FVector LocalNormal;
+		if (!RewindLagCompensation::IntersectRayBox(LocalStart, LocalDirection, Length, Ghost.LocalCenter * Scale, Extent, OutDistance, LocalNormal)) return false;
+		OutNormal = RigidTransform.TransformVectorNoScale(LocalNormal);
+		return true;
+	}
+	}
+}
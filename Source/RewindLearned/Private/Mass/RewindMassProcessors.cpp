@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/RewindMassProcessors.h"
+
+#include "MassCommonFragments.h"
+#include "MassCommonTypes.h"
+#include "MassExecutionContext.h"
+#include "MassMovementFragments.h"
+#include "Mass/RewindMassSubsystem.h"
+
+/* ----------------------------- 时间线 ----------------------------- */
+URewindMassTimelineProcessor::URewindMassTimelineProcessor()
+{
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::All);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	ExecutionOrder.ExecuteBefore.Add(UE::Mass::ProcessorGroupNames::Movement);
+	bRequiresGameThreadExecution = true;
+}
+
+void URewindMassTimelineProcessor::Initialize(UObject& Owner)
+{
+	Super::Initialize(Owner);
+	RewindMassSubsystem = UWorld::GetSubsystem<URewindMassSubsystem>(Owner.GetWorld());
+}
+
+void URewindMassTimelineProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	if (RewindMassSubsystem) RewindMassSubsystem->AdvanceTimeline(Context.GetDeltaTimeSeconds());
+}
+
+/* ----------------------------- 记录 ----------------------------- */
+URewindMassRecordProcessor::URewindMassRecordProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::All);
+	ProcessingPhase = EMassProcessingPhase::PostPhysics;
+}
+
+void URewindMassRecordProcessor::Initialize(UObject& Owner)
+{
+	Super::Initialize(Owner);
+	RewindMassSubsystem = UWorld::GetSubsystem<URewindMassSubsystem>(Owner.GetWorld());
+}
+
+void URewindMassRecordProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddRequirement<FMassVelocityFragment>(EMassFragmentAccess::ReadOnly, EMassFragmentPresence::Optional);
+	EntityQuery.AddRequirement<FRewindMassHistoryFragment>(EMassFragmentAccess::ReadOnly);
+}
+
+void URewindMassRecordProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	if (!RewindMassSubsystem || !RewindMassSubsystem->ShouldRecord()) return;
+
+	// 每个实体只写自己的槽位，块之间没有共享的写入
+	const TArrayView<FRewindMassSample> Samples = RewindMassSubsystem->GetRecordSamples();
+	EntityQuery.ParallelForEachEntityChunk(EntityManager, Context, [Samples](FMassExecutionContext& ChunkContext)
+	{
+		const TConstArrayView<FTransformFragment> Transforms = ChunkContext.GetFragmentView<FTransformFragment>();
+		const TConstArrayView<FMassVelocityFragment> Velocities = ChunkContext.GetFragmentView<FMassVelocityFragment>();
+		const TConstArrayView<FRewindMassHistoryFragment> Histories = ChunkContext.GetFragmentView<FRewindMassHistoryFragment>();
+		const bool bHasVelocity = Velocities.Num() > 0;
+
+		for (int32 EntityIndex = 0; EntityIndex < ChunkContext.GetNumEntities(); ++EntityIndex)
+		{
+			const int32 Slot = Histories[EntityIndex].Slot;
+			if (!Samples.IsValidIndex(Slot)) continue;
+			Samples[Slot].Encode(Transforms[EntityIndex].GetTransform(), bHasVelocity ? Velocities[EntityIndex].Value : FVector::ZeroVector);
+		}
+	});
+}
+
+/* ----------------------------- 回放 ----------------------------- */
+URewindMassPlaybackProcessor::URewindMassPlaybackProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = static_cast<int32>(EProcessorExecutionFlags::All);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+	ExecutionOrder.ExecuteAfter.Add(UE::Mass::ProcessorGroupNames::Movement);
+	ExecutionOrder.ExecuteAfter.Add(URewindMassTimelineProcessor::StaticClass()->GetFName());
+}
+
+void URewindMassPlaybackProcessor::Initialize(UObject& Owner)
+{
+	Super::Initialize(Owner);
+	RewindMassSubsystem = UWorld::GetSubsystem<URewindMassSubsystem>(Owner.GetWorld());
+}
+
+void URewindMassPlaybackProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTransformFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FMassVelocityFragment>(EMassFragmentAccess::ReadWrite, EMassFragmentPresence::Optional);
+	EntityQuery.AddRequirement<FRewindMassHistoryFragment>(EMassFragmentAccess::ReadOnly);
+}
+
+void URewindMassPlaybackProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	if (!RewindMassSubsystem || !RewindMassSubsystem->ShouldApplyPlayback()) return;
+
+	const TConstArrayView<FRewindMassSample> FromSamples = RewindMassSubsystem->GetPlaybackSamplesFrom();
+	const TConstArrayView<FRewindMassSample> ToSamples = RewindMassSubsystem->GetPlaybackSamplesTo();
+	const int64 FromSerial = RewindMassSubsystem->GetPlaybackSerialFrom();
+	const int64 ToSerial = RewindMassSubsystem->GetPlaybackSerialTo();
+	const float Alpha = RewindMassSubsystem->GetPlaybackAlpha();
+
+	EntityQuery.ParallelForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+	{
+		const TArrayView<FTransformFragment> Transforms = ChunkContext.GetMutableFragmentView<FTransformFragment>();
+		const TArrayView<FMassVelocityFragment> Velocities = ChunkContext.GetMutableFragmentView<FMassVelocityFragment>();
+		const TConstArrayView<FRewindMassHistoryFragment> Histories = ChunkContext.GetFragmentView<FRewindMassHistoryFragment>();
+		const bool bHasVelocity = Velocities.Num() > 0;
+
+		for (int32 EntityIndex = 0; EntityIndex < ChunkContext.GetNumEntities(); ++EntityIndex)
+		{
+			const FRewindMassHistoryFragment& History = Histories[EntityIndex];
+			if (!FromSamples.IsValidIndex(History.Slot) || !ToSamples.IsValidIndex(History.Slot)) continue;
+
+			// 槽位在实体创建之前属于其他实体：回放位置早于实体的第一帧时停在第一帧
+			const bool bFromValid = FromSerial >= History.FirstFrameSerial;
+			const bool bToValid = ToSerial >= History.FirstFrameSerial;
+			if (!bToValid) continue;
+			const FRewindMassSample& From = bFromValid ? FromSamples[History.Slot] : ToSamples[History.Slot];
+			const FRewindMassSample& To = ToSamples[History.Slot];
+
+			FTransform& Transform = Transforms[EntityIndex].GetMutableTransform();
+			Transform.SetLocation(FMath::Lerp(From.GetLocation(), To.GetLocation(), Alpha));
+			Transform.SetRotation(FQuat::Slerp(From.GetRotation(), To.GetRotation(), Alpha));
+			if (bHasVelocity) Velocities[EntityIndex].Value = FMath::Lerp(From.GetVelocity(), To.GetVelocity(), Alpha);
+		}
+	});
+}
+
+/* ----------------------------- 槽位 ----------------------------- */
+URewindMassSlotInitializer::URewindMassSlotInitializer()
+	: EntityQuery(*this)
+{
+	ObservedType = FRewindMassHistoryFragment::StaticStruct();
+	Operation = EMassObservedOperation::Add;
+	bRequiresGameThreadExecution = true;
+}
+
+void URewindMassSlotInitializer::Initialize(UObject& Owner)
+{
+	Super::Initialize(Owner);
+	RewindMassSubsystem = UWorld::GetSubsystem<URewindMassSubsystem>(Owner.GetWorld());
+}
+
+void URewindMassSlotInitializer::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FRewindMassHistoryFragment>(EMassFragmentAccess::ReadWrite);
+}
+
+void URewindMassSlotInitializer::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	if (!RewindMassSubsystem) return;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [this](FMassExecutionContext& ChunkContext)
+	{
+		const TArrayView<FRewindMassHistoryFragment> Histories = ChunkContext.GetMutableFragmentView<FRewindMassHistoryFragment>();
+		for (FRewindMassHistoryFragment& History : Histories)
+		{
+			History.Slot = RewindMassSubsystem->AllocateSlot();
+			History.FirstFrameSerial = RewindMassSubsystem->GetNextFrameSerial();
+		}
+	});
+}
+
+URewindMassSlotDeinitializer::URewindMassSlotDeinitializer()
+	: EntityQuery(*this)
+{
+	ObservedType = FRewindMassHistoryFragment::StaticStruct();
+	Operation = EMassObservedOperation::Remove;
+	bRequiresGameThreadExecution = true;
+}
+
+void URewindMassSlotDeinitializer::Initialize(UObject& Owner)
+{
+	Super::Initialize(Owner);
+	RewindMassSubsystem = UWorld::GetSubsystem<URewindMassSubsystem>(Owner.GetWorld());
+}
+
+void URewindMassSlotDeinitializer::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FRewindMassHistoryFragment>(EMassFragmentAccess::ReadOnly);
+}
+
+void URewindMassSlotDeinitializer::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	if (!RewindMassSubsystem) return;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [this](FMassExecutionContext& ChunkContext)
+	{
+		for (const FRewindMassHistoryFragment& History : ChunkContext.GetFragmentView<FRewindMassHistoryFragment>())
+		{
+			RewindMassSubsystem->ReleaseSlot(History.Slot);
+		}
+	});
+}
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/RewindMassSubsystem.h"
+
+#include "GameMode/RewindGameState.h"
+#include "Stats/RewindStats.h"
+
+void URewindMassSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// 多保留一帧：回放到最老的记录点时仍然有两侧的帧
+	Frames.SetNum(FMath::Max(FMath::CeilToInt32(MaxRewindSeconds / FMath::Max(FrameFrequencySeconds, UE_KINDA_SMALL_NUMBER)) + 1, 2));
+}
+
+void URewindMassSubsystem::Deinitialize()
+{
+	Frames.Empty();
+	FreeSlots.Empty();
+	GameState = nullptr;
+
+	Super::Deinitialize();
+}
+
+int32 URewindMassSubsystem::AllocateSlot()
+{
+	if (FreeSlots.IsEmpty()) GrowSlotCapacity(FMath::Max(SlotCapacity * 2, 1024));
+	return FreeSlots.Pop(EAllowShrinking::No);
+}
+
+void URewindMassSubsystem::ReleaseSlot(int32 Slot)
+{
+	if (Slot >= 0 && Slot < SlotCapacity) FreeSlots.Add(Slot);
+}
+
+void URewindMassSubsystem::GrowSlotCapacity(int32 NewCapacity)
+{
+	/* 只在游戏线程的观察者处理器中调用，此时记录和回放处理器不在运行 */
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindMassSubsystem::GrowSlotCapacity);
+	LLM_SCOPE_BYTAG(Rewind);
+
+	// 新槽位倒序放入空闲列表，Pop时先分配小的槽位
+	FreeSlots.Reserve(FreeSlots.Num() + NewCapacity - SlotCapacity);
+	for (int32 Slot = NewCapacity - 1; Slot >= SlotCapacity; --Slot) FreeSlots.Add(Slot);
+	SlotCapacity = NewCapacity;
+
+	for (int32 Index = 0; Index < NumFrames; ++Index) Frames[GetFrameIndex(Index)].Samples.SetNumZeroed(SlotCapacity);
+}
+
+SIZE_T URewindMassSubsystem::GetAllocatedSize() const
+{
+	SIZE_T Size = Frames.GetAllocatedSize() + FreeSlots.GetAllocatedSize();
+	for (const FFrame& Frame : Frames) Size += Frame.Samples.GetAllocatedSize();
+	return Size;
+}
+
+void URewindMassSubsystem::AdvanceTimeline(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindMassSubsystem::AdvanceTimeline);
+	RecordFrame = INDEX_NONE;
+	bApplyPlayback = false;
+
+	if (!GameState) GameState = GetWorld()->GetGameState<ARewindGameState>();
+	if (!GameState) return;
+
+	// 与组件一样跟随全局状态；时间泡的局部时钟不作用于人群
+	const FRewindGlobalTimeState TimeState = GameState->GetTimeState();
+	const bool bIsManipulatingTime = TimeState.bIsRewinding || TimeState.bIsFastForwarding || TimeState.bIsTimeScrubbing;
+	if (!bIsManipulatingTime)
+	{
+		// 回到正常时间：从回放位置继续记录，之后的帧被丢弃
+		if (bWasManipulatingTime) ForkAtPlaybackTime();
+		bWasManipulatingTime = false;
+
+		TimelineTime += DeltaTime;
+		TimeSinceLastFrame += DeltaTime;
+		if (NumFrames == 0 || TimeSinceLastFrame >= FrameFrequencySeconds) BeginRecordFrame();
+		return;
+	}
+
+	if (!bWasManipulatingTime)
+	{
+		// 全局时间轴游标从0开始，以最新的记录点为实时
+		ManipulationStartTime = NumFrames > 0 ? GetFrame(NumFrames - 1).TimelineTime : TimelineTime;
+		bWasManipulatingTime = true;
+	}
+	if (NumFrames == 0) return;
+
+	// 移动实体在时间操作期间仍会被移动处理器推进，每帧都覆盖回放结果（包括时停）
+	PlaybackTime = FMath::Clamp(ManipulationStartTime - GameState->GetTimelineCursorSeconds(), GetFrame(0).TimelineTime, GetFrame(NumFrames - 1).TimelineTime);
+	UpdatePlaybackFrames();
+	bApplyPlayback = true;
+}
+
+void URewindMassSubsystem::BeginRecordFrame()
+{
+	LLM_SCOPE_BYTAG(Rewind);
+	if (NumFrames == Frames.Num())
+	{
+		OldestFrame = (OldestFrame + 1) % Frames.Num();
+		--NumFrames;
+	}
+
+	RecordFrame = GetFrameIndex(NumFrames);
+	FFrame& Frame = Frames[RecordFrame];
+	Frame.TimelineTime = TimelineTime;
+	Frame.Serial = NextFrameSerial++;
+	Frame.Samples.SetNumZeroed(SlotCapacity, EAllowShrinking::No); // 复用被覆盖的帧的内存
+	++NumFrames;
+	TimeSinceLastFrame = 0.0f;
+}
+
+void URewindMassSubsystem::ForkAtPlaybackTime()
+{
+	while (NumFrames > 1 && GetFrame(NumFrames - 1).TimelineTime > PlaybackTime + UE_KINDA_SMALL_NUMBER) --NumFrames;
+	TimelineTime = FMath::Max(PlaybackTime, NumFrames > 0 ? GetFrame(NumFrames - 1).TimelineTime : 0.0);
+	TimeSinceLastFrame = static_cast<float>(TimelineTime - (NumFrames > 0 ? GetFrame(NumFrames - 1).TimelineTime : TimelineTime));
+}
+
+void URewindMassSubsystem::UpdatePlaybackFrames()
+{
+	// 时间线时间递增：二分查找最后一个不晚于回放位置的帧
+	int32 Low = 0;
+	int32 High = NumFrames;
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (GetFrame(Middle).TimelineTime <= PlaybackTime) Low = Middle + 1;
+		else High = Middle;
+	}
+	const int32 From = FMath::Clamp(Low - 1, 0, NumFrames - 1);
+	const int32 To = FMath::Min(From + 1, NumFrames - 1);
+
+	PlaybackFrameFrom = GetFrameIndex(From);
+	PlaybackFrameTo = GetFrameIndex(To);
+	const double Interval = GetFrame(To).TimelineTime - GetFrame(From).TimelineTime;
+	PlaybackAlpha = Interval > UE_KINDA_SMALL_NUMBER ? FMath::Clamp(static_cast<float>((PlaybackTime - GetFrame(From).TimelineTime) / Interval), 0.0f, 1.0f) : 0.0f;
+}
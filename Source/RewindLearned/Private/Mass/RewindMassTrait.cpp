@@ -0,0 +1,14 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Mass/RewindMassTrait.h"
+
+#include "MassCommonFragments.h"
+#include "MassEntityTemplateRegistry.h"
+#include "Mass/RewindMassFragments.h"
+
+void URewindMassTrait::BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const
+{
+	BuildContext.RequireFragment<FTransformFragment>();
+	BuildContext.AddFragment<FRewindMassHistoryFragment>();
+}
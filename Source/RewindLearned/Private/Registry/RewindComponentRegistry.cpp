@@ -0,0 +1,465 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Registry/RewindComponentRegistry.h"
+
+#include "Component/RewindComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "GameMode/RewindGameState.h"
+#include "TimeBubble/RewindTimeBubbleVolume.h"
+
+namespace RewindComponentRegistry
+{
+	static float PlaybackBudgetMs = 2.0f;
+	static FAutoConsoleVariableRef CVarPlaybackBudgetMs(
+		TEXT("Rewind.PlaybackBudgetMs"),
+		PlaybackBudgetMs,
+		TEXT("Per-frame budget in milliseconds for applying rewind playback. High priority actors always update; others share the rest round-robin. 0 disables budgeting."));
+
+	static float PlaybackFullRateDistance = 3000.0f;
+	static FAutoConsoleVariableRef CVarPlaybackFullRateDistance(
+		TEXT("Rewind.PlaybackFullRateDistance"),
+		PlaybackFullRateDistance,
+		TEXT("Visible actors closer than this to a player view update their rewind playback every frame."));
+
+	// 耗时估计的平滑系数
+	constexpr double CostSmoothing = 0.1;
+}
+
+void URewindComponentRegistry::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// 0号时钟是全局时钟
+	FRewindClock& GlobalClock = Clocks.AddDefaulted_GetRef();
+	GlobalClock.bInUse = true;
+}
+
+void URewindComponentRegistry::Register(URewindComponent* Component)
+{
+	check(Component);
+	if (Component->RegistryIndex != INDEX_NONE) return;
+
+	Component->RegistryIndex = Components.Add(Component);
+	++MembershipSerial;
+	Component->SnapshotPhase = ComputeSnapshotPhase(NumRegistrations++);
+
+	// 时间泡的重叠事件可能早于组件的BeginPlay，注册时直接加入所在时间泡的时钟
+	const int32 ClockIndex = FindClockForActor(Component->GetOwner(), GlobalClockIndex);
+	Component->ClockIndex = ClockIndex;
+	Component->ClockMemberIndex = Clocks[ClockIndex].Members.Add(Component);
+}
+
+float URewindComponentRegistry::ComputeSnapshotPhase(uint32 RegistrationIndex)
+{
+	/*
+	 * Van der Corput序列（二进制位反转）：0, 1/2, 1/4, 3/4, 1/8, 5/8...
+	 * 不需要知道组件总数，任意前N个相位都近似均匀地分布在[0, 1)中，组件陆续注册/注销时也保持均匀
+	 */
+	return static_cast<float>(ReverseBits(RegistrationIndex) * (1.0 / 4294967296.0));
+}
+
+void URewindComponentRegistry::Unregister(URewindComponent* Component)
+{
+	check(Component);
+	const int32 Index = Component->RegistryIndex;
+	if (Index == INDEX_NONE) return;
+
+	check(Components[Index] == Component);
+	Component->RegistryIndex = INDEX_NONE;
+	++MembershipSerial;
+	RemoveFromClock(Component);
+	SweptBoundsGrid.Remove(Component);
+
+	if (bIsDispatching)
+	{
+		Components[Index] = nullptr;
+		++NumPendingRemovals;
+		return;
+	}
+
+	// 与末尾交换删除，并修正被移动组件的下标
+	Components.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	if (Index < Components.Num()) Components[Index]->RegistryIndex = Index;
+}
+
+void URewindComponentRegistry::DispatchTransition(ERewindGlobalTransition Transition, int32 ClockIndex)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponentRegistry::DispatchTransition);
+	check(!bIsDispatching);
+	bIsDispatching = true;
+
+	// 只遍历分发开始时已加入该时钟的组件
+	const int32 NumMembers = Clocks[ClockIndex].Members.Num();
+	for (int32 Index = 0; Index < NumMembers; ++Index)
+	{
+		if (URewindComponent* Component = Clocks[ClockIndex].Members[Index]) Component->HandleGlobalTransition(Transition);
+	}
+
+	bIsDispatching = false;
+	FinishDispatch();
+
+	// 开始时间操作的这一帧就需要时间片
+	PlanPlayback();
+}
+
+void URewindComponentRegistry::FinishDispatch()
+{
+	if (NumPendingRemovals > 0) CompactComponents();
+	for (FRewindClock& Clock : Clocks)
+	{
+		if (Clock.bHasPendingRemovals) CompactClock(Clock);
+	}
+
+	// 分发期间移除的时钟和分组变化（例如回放移动Actor引起的重叠事件）
+	for (const int32 ClockIndex : TArray<int32>(MoveTemp(PendingClockRemovals))) RemoveClock(ClockIndex);
+
+	const TArray<TPair<TWeakObjectPtr<URewindComponent>, int32>> ClockMoves = MoveTemp(PendingClockMoves);
+	for (const TPair<TWeakObjectPtr<URewindComponent>, int32>& Move : ClockMoves)
+	{
+		URewindComponent* Component = Move.Key.Get();
+		if (!Component || Component->RegistryIndex == INDEX_NONE) continue;
+		MoveToClock(Component, Clocks[Move.Value].bInUse ? Move.Value : GlobalClockIndex);
+	}
+}
+
+void URewindComponentRegistry::GetTransitions(const FRewindGlobalTimeState& OldState, const FRewindGlobalTimeState& NewState,
+	TArray<ERewindGlobalTransition, TInlineAllocator<6>>& OutTransitions)
+{
+	/* 组件的状态机要求快进必须在时停之后开始，一次同时发生多个变化时按固定顺序列出 */
+	OutTransitions.Reset();
+	if (!OldState.bIsTimeScrubbing && NewState.bIsTimeScrubbing) OutTransitions.Add(ERewindGlobalTransition::TimeScrubStarted);
+	if (!OldState.bIsRewinding && NewState.bIsRewinding) OutTransitions.Add(ERewindGlobalTransition::RewindStarted);
+	if (!OldState.bIsFastForwarding && NewState.bIsFastForwarding) OutTransitions.Add(ERewindGlobalTransition::FastForwardStarted);
+
+	if (OldState.bIsRewinding && !NewState.bIsRewinding) OutTransitions.Add(ERewindGlobalTransition::RewindCompleted);
+	if (OldState.bIsFastForwarding && !NewState.bIsFastForwarding) OutTransitions.Add(ERewindGlobalTransition::FastForwardCompleted);
+	if (OldState.bIsTimeScrubbing && !NewState.bIsTimeScrubbing) OutTransitions.Add(ERewindGlobalTransition::TimeScrubCompleted);
+}
+
+int32 URewindComponentRegistry::AddClock(ARewindTimeBubbleVolume* Bubble)
+{
+	const int32 ClockIndex = FreeClockIndices.IsEmpty() ? Clocks.AddDefaulted() : FreeClockIndices.Pop(EAllowShrinking::No);
+	FRewindClock& Clock = Clocks[ClockIndex];
+	Clock = FRewindClock();
+	Clock.Bubble = Bubble;
+	Clock.bInUse = true;
+	return ClockIndex;
+}
+
+void URewindComponentRegistry::RemoveClock(int32 ClockIndex)
+{
+	check(ClockIndex != GlobalClockIndex && Clocks[ClockIndex].bInUse);
+	if (bIsDispatching)
+	{
+		PendingClockRemovals.AddUnique(ClockIndex);
+		return;
+	}
+
+	// 成员回到其他重叠的时间泡或全局时钟，并离开该时钟的时间状态
+	const TArray<URewindComponent*> Members = Clocks[ClockIndex].Members;
+	for (URewindComponent* Component : Members)
+	{
+		if (Component) MoveToClock(Component, FindClockForActor(Component->GetOwner(), GlobalClockIndex, ClockIndex));
+	}
+
+	Clocks[ClockIndex] = FRewindClock();
+	FreeClockIndices.Add(ClockIndex);
+}
+
+void URewindComponentRegistry::SetClockState(int32 ClockIndex, const FRewindGlobalTimeState& NewState, float TimeDilation)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponentRegistry::SetClockState);
+	check(Clocks[ClockIndex].bInUse);
+	const FRewindGlobalTimeState OldState = Clocks[ClockIndex].State;
+	const bool bTimeDilationChanged = Clocks[ClockIndex].TimeDilation != TimeDilation;
+	Clocks[ClockIndex].State = NewState;
+	Clocks[ClockIndex].TimeDilation = TimeDilation;
+
+	// 一组成员共用一次状态比较，速度变化不需要分发（组件每帧从时钟读取）
+	TArray<ERewindGlobalTransition, TInlineAllocator<6>> Transitions;
+	GetTransitions(OldState, NewState, Transitions);
+	for (const ERewindGlobalTransition Transition : Transitions) DispatchTransition(Transition, ClockIndex);
+
+	if (bTimeDilationChanged)
+	{
+		for (URewindComponent* Component : Clocks[ClockIndex].Members)
+		{
+			if (Component) Component->ApplyClockTimeDilation();
+		}
+	}
+
+	// 时间操作期间忽略了回放引起的进出，回到正常时间后统一检查一次
+	const bool bWasManipulating = OldState.bIsRewinding || OldState.bIsFastForwarding || OldState.bIsTimeScrubbing;
+	if (bWasManipulating && !Clocks[ClockIndex].IsTimeBeingManipulated()) ReevaluateClockMembers(ClockIndex);
+}
+
+void URewindComponentRegistry::NotifyActorEnteredBubble(AActor* Actor, int32 ClockIndex)
+{
+	URewindComponent* Component = Actor ? Actor->FindComponentByClass<URewindComponent>() : nullptr;
+	if (!Component || Component->RegistryIndex == INDEX_NONE || Component->ClockIndex == ClockIndex) return;
+
+	// 当前时钟正在操作时间：Actor是被回放移动进来的，不改变分组
+	if (Clocks[Component->ClockIndex].IsTimeBeingManipulated()) return;
+	MoveToClock(Component, ClockIndex);
+}
+
+void URewindComponentRegistry::NotifyActorLeftBubble(AActor* Actor, int32 ClockIndex)
+{
+	URewindComponent* Component = Actor ? Actor->FindComponentByClass<URewindComponent>() : nullptr;
+	if (!Component || Component->RegistryIndex == INDEX_NONE || Component->ClockIndex != ClockIndex) return;
+
+	if (Clocks[ClockIndex].IsTimeBeingManipulated()) return;
+	MoveToClock(Component, FindClockForActor(Actor, GlobalClockIndex, ClockIndex));
+}
+
+void URewindComponentRegistry::MoveToClock(URewindComponent* Component, int32 ClockIndex)
+{
+	if (bIsDispatching)
+	{
+		PendingClockMoves.Emplace(Component, ClockIndex);
+		return;
+	}
+
+	const int32 OldClockIndex = Component->ClockIndex;
+	if (OldClockIndex == ClockIndex) return;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponentRegistry::MoveToClock);
+	const FRewindGlobalTimeState OldState = Clocks[OldClockIndex].State;
+	RemoveFromClock(Component);
+	Component->ClockIndex = ClockIndex;
+	Component->ClockMemberIndex = Clocks[ClockIndex].Members.Add(Component);
+
+	// 与新时钟的状态同步：同步期间Actor被移动引起的分组变化推迟到同步结束后
+	bIsDispatching = true;
+	Component->SyncToClockState(OldState, Clocks[ClockIndex].State);
+	bIsDispatching = false;
+	FinishDispatch();
+}
+
+void URewindComponentRegistry::RemoveFromClock(URewindComponent* Component)
+{
+	const int32 MemberIndex = Component->ClockMemberIndex;
+	if (MemberIndex == INDEX_NONE) return;
+
+	FRewindClock& Clock = Clocks[Component->ClockIndex];
+	check(Clock.Members[MemberIndex] == Component);
+	Component->ClockMemberIndex = INDEX_NONE;
+
+	if (bIsDispatching)
+	{
+		Clock.Members[MemberIndex] = nullptr;
+		Clock.bHasPendingRemovals = true;
+		return;
+	}
+
+	Clock.Members.RemoveAtSwap(MemberIndex, 1, EAllowShrinking::No);
+	if (MemberIndex < Clock.Members.Num()) Clock.Members[MemberIndex]->ClockMemberIndex = MemberIndex;
+}
+
+void URewindComponentRegistry::CompactClock(FRewindClock& Clock)
+{
+	Clock.Members.RemoveAll([](const URewindComponent* Component) { return Component == nullptr; });
+	for (int32 Index = 0; Index < Clock.Members.Num(); ++Index) Clock.Members[Index]->ClockMemberIndex = Index;
+	Clock.bHasPendingRemovals = false;
+}
+
+int32 URewindComponentRegistry::FindClockForActor(const AActor* Actor, int32 PreferredClockIndex, int32 ExcludedClockIndex) const
+{
+	auto IsInBubble = [this, Actor, ExcludedClockIndex](int32 ClockIndex)
+	{
+		const FRewindClock& Clock = Clocks[ClockIndex];
+		const ARewindTimeBubbleVolume* Bubble = Clock.Bubble.Get();
+		return ClockIndex != ExcludedClockIndex && Clock.bInUse && Bubble && Bubble->IsOverlappingActor(Actor);
+	};
+
+	if (!Actor || Clocks.Num() <= 1) return GlobalClockIndex;
+	if (PreferredClockIndex != GlobalClockIndex && IsInBubble(PreferredClockIndex)) return PreferredClockIndex;
+	for (int32 ClockIndex = GlobalClockIndex + 1; ClockIndex < Clocks.Num(); ++ClockIndex)
+	{
+		if (IsInBubble(ClockIndex)) return ClockIndex;
+	}
+	return GlobalClockIndex;
+}
+
+void URewindComponentRegistry::ReevaluateClockMembers(int32 ClockIndex)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponentRegistry::ReevaluateClockMembers);
+	if (ClockIndex == GlobalClockIndex)
+	{
+		// 全局时钟的成员可能很多，从各个时间泡的重叠Actor出发查找进入了时间泡的成员
+		TArray<AActor*> OverlappingActors;
+		for (int32 BubbleClockIndex = GlobalClockIndex + 1; BubbleClockIndex < Clocks.Num(); ++BubbleClockIndex)
+		{
+			const ARewindTimeBubbleVolume* Bubble = Clocks[BubbleClockIndex].Bubble.Get();
+			if (!Clocks[BubbleClockIndex].bInUse || !Bubble) continue;
+
+			Bubble->GetOverlappingActors(OverlappingActors);
+			for (AActor* Actor : OverlappingActors)
+			{
+				URewindComponent* Component = Actor->FindComponentByClass<URewindComponent>();
+				if (Component && Component->RegistryIndex != INDEX_NONE && Component->ClockIndex == GlobalClockIndex) MoveToClock(Component, BubbleClockIndex);
+			}
+		}
+		return;
+	}
+
+	// 时间泡：把已经不在泡内的成员移出
+	const ARewindTimeBubbleVolume* Bubble = Clocks[ClockIndex].Bubble.Get();
+	TArray<URewindComponent*> LeavingComponents;
+	for (URewindComponent* Component : Clocks[ClockIndex].Members)
+	{
+		if (Component && !(Bubble && Bubble->IsOverlappingActor(Component->GetOwner()))) LeavingComponents.Add(Component);
+	}
+	for (URewindComponent* Component : LeavingComponents)
+	{
+		MoveToClock(Component, FindClockForActor(Component->GetOwner(), GlobalClockIndex, ClockIndex));
+	}
+}
+
+bool URewindComponentRegistry::IsAnyClockManipulatingTime() const
+{
+	for (const FRewindClock& Clock : Clocks)
+	{
+		if (Clock.bInUse && Clock.IsTimeBeingManipulated()) return true;
+	}
+	return false;
+}
+
+bool URewindComponentRegistry::ShouldMaintainSweptBounds() const
+{
+	// 延迟补偿只在服务器上查询
+	return GetWorld()->GetNetMode() != NM_Client;
+}
+
+void URewindComponentRegistry::RecordSweptLocation(URewindComponent* Component, const FVector& Location)
+{
+	if (ShouldMaintainSweptBounds()) SweptBoundsGrid.Add(Component, Location);
+}
+
+bool URewindComponentRegistry::GatherSweptBoundsCandidates(float Time, const FBox& QueryBounds, TArray<URewindComponent*>& OutComponents) const
+{
+	return ShouldMaintainSweptBounds() && SweptBoundsGrid.Query(Time, QueryBounds, OutComponents);
+}
+
+TStatId URewindComponentRegistry::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URewindComponentRegistry, STATGROUP_Tickables);
+}
+
+void URewindComponentRegistry::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (ShouldMaintainSweptBounds()) SweptBoundsGrid.Tick(GetWorld()->GetTimeSeconds());
+
+	if (!IsAnyClockManipulatingTime())
+	{
+		bPlaybackBudgetEnabled = false;
+		return;
+	}
+
+	// 用本帧的实际耗时更新估计，再为下一帧分配时间片
+	using namespace RewindComponentRegistry;
+	AverageHighPriorityMilliseconds = FMath::Lerp(AverageHighPriorityMilliseconds, FrameHighPriorityMilliseconds, CostSmoothing);
+	if (FrameNumLowPriorityApplied > 0)
+	{
+		AverageLowPriorityMillisecondsPerComponent = FMath::Lerp(AverageLowPriorityMillisecondsPerComponent,
+			FrameLowPriorityMilliseconds / FrameNumLowPriorityApplied, CostSmoothing);
+	}
+	FrameHighPriorityMilliseconds = 0.0;
+	FrameLowPriorityMilliseconds = 0.0;
+	FrameNumLowPriorityApplied = 0;
+
+	PlanPlayback();
+}
+
+bool URewindComponentRegistry::ShouldApplyPlayback(const URewindComponent* Component) const
+{
+	return !bPlaybackBudgetEnabled || Component->bHighPlaybackPriority || Component->PlaybackTurnSerial == PlanSerial;
+}
+
+void URewindComponentRegistry::ReportPlaybackCost(const URewindComponent* Component, double Seconds)
+{
+	if (Component->bHighPlaybackPriority)
+	{
+		FrameHighPriorityMilliseconds += Seconds * 1000.0;
+	}
+	else
+	{
+		FrameLowPriorityMilliseconds += Seconds * 1000.0;
+		++FrameNumLowPriorityApplied;
+	}
+}
+
+void URewindComponentRegistry::PlanPlayback()
+{
+	using namespace RewindComponentRegistry;
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindComponentRegistry::PlanPlayback);
+	++PlanSerial;
+	bPlaybackBudgetEnabled = PlaybackBudgetMs > 0.0f;
+	if (!bPlaybackBudgetEnabled) return;
+
+	// 所有本地玩家（服务器上是所有玩家）的视点
+	TArray<FVector, TInlineAllocator<4>> ViewLocations;
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		if (const APlayerController* PlayerController = It->Get())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			ViewLocations.Add(ViewLocation);
+		}
+	}
+
+	LowPriorityComponents.Reset();
+	for (URewindComponent* Component : Components)
+	{
+		if (!Component || !Component->IsTimeBeingManipulated()) continue;
+
+		Component->bHighPlaybackPriority = IsHighPlaybackPriority(Component, ViewLocations);
+		if (!Component->bHighPlaybackPriority) LowPriorityComponents.Add(Component);
+	}
+
+	const int32 NumLowPriority = LowPriorityComponents.Num();
+	if (NumLowPriority == 0) return;
+
+	// 剩余预算能覆盖的低优先级组件数量，至少一个，保证所有组件最终都会轮到
+	const double RemainingMilliseconds = PlaybackBudgetMs - AverageHighPriorityMilliseconds;
+	const int32 NumTurns = FMath::Clamp(FMath::FloorToInt32(RemainingMilliseconds / FMath::Max(AverageLowPriorityMillisecondsPerComponent, UE_DOUBLE_SMALL_NUMBER)), 1, NumLowPriority);
+	RoundRobinCursor %= NumLowPriority;
+	for (int32 Turn = 0; Turn < NumTurns; ++Turn)
+	{
+		LowPriorityComponents[(RoundRobinCursor + Turn) % NumLowPriority]->PlaybackTurnSerial = PlanSerial;
+	}
+	RoundRobinCursor = (RoundRobinCursor + NumTurns) % NumLowPriority;
+}
+
+bool URewindComponentRegistry::IsHighPlaybackPriority(const URewindComponent* Component, TConstArrayView<FVector> ViewLocations)
+{
+	const AActor* Owner = Component->GetOwner();
+	if (!Owner) return false;
+
+	const APawn* Pawn = Cast<APawn>(Owner);
+	if (Pawn && Pawn->IsPlayerControlled()) return true;
+
+	const bool bVisible = IsRunningDedicatedServer() || Owner->WasRecentlyRendered(0.2f);
+	if (!bVisible) return false;
+
+	const double FullRateDistanceSquared = FMath::Square(RewindComponentRegistry::PlaybackFullRateDistance);
+	const FVector Location = Owner->GetActorLocation();
+	for (const FVector& ViewLocation : ViewLocations)
+	{
+		if (FVector::DistSquared(Location, ViewLocation) < FullRateDistanceSquared) return true;
+	}
+	return false;
+}
+
+void URewindComponentRegistry::CompactComponents()
+{
+	Components.RemoveAll([](const TObjectPtr<URewindComponent>& Component) { return Component == nullptr; });
+	for (int32 Index = 0; Index < Components.Num(); ++Index) Components[Index]->RegistryIndex = Index;
+	NumPendingRemovals = 0;
+}
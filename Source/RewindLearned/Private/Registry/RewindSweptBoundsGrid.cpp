@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Registry/RewindSweptBoundsGrid.h"
+
+#include "Algo/BinarySearch.h"
+#include "Component/RewindComponent.h"
+
+namespace RewindSweptBoundsGrid
+{
+	static float MaxLagCompensationSeconds = 1.0f;
+	static FAutoConsoleVariableRef CVarMaxLagCompensationSeconds(
+		TEXT("Rewind.LagCompensation.MaxSeconds"),
+		MaxLagCompensationSeconds,
+		TEXT("How far back the lag compensation broadphase grid reaches. Older queries fall back to scanning every rewind component."));
+
+	// 格子边长（cm）和桶的时长（秒）
+	constexpr float CellSize = 1000.0f;
+	constexpr float BucketSeconds = 0.25f;
+
+	// 一条线段最多写入的格子数，超过时（瞬移）只写入两端
+	constexpr int64 MaxCellsPerSegment = 64;
+
+	// 位置只是根组件的原点，扩展整个Actor碰撞体的半径
+	static float GetShapeRadius(const AActor& Actor)
+	{
+		const FBox ActorBounds = Actor.GetComponentsBoundingBox();
+		return ActorBounds.IsValid ? (ActorBounds.GetCenter() - Actor.GetActorLocation()).Size() + ActorBounds.GetExtent().Size() : 0.0f;
+	}
+
+	static int64 CountCells(const FIntVector& MinCell, const FIntVector& MaxCell)
+	{
+		return int64(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1) * (MaxCell.Z - MinCell.Z + 1);
+	}
+}
+
+FIntVector FRewindSweptBoundsGrid::GetCell(const FVector& Location)
+{
+	using namespace RewindSweptBoundsGrid;
+	return FIntVector(FMath::FloorToInt32(Location.X / CellSize), FMath::FloorToInt32(Location.Y / CellSize), FMath::FloorToInt32(Location.Z / CellSize));
+}
+
+void FRewindSweptBoundsGrid::Add(URewindComponent* Component, const FVector& Location)
+{
+	FTrackedComponent& Tracked = TrackedComponents.FindOrAdd(Component);
+	if (!Tracked.Component.IsValid())
+	{
+		Tracked.Component = Component;
+		Tracked.Location = Location;
+		Tracked.Radius = RewindSweptBoundsGrid::GetShapeRadius(*Component->GetOwner());
+	}
+
+	const FVector From = Tracked.Location;
+	Tracked.Location = Location;
+	if (!Buckets.IsEmpty()) Insert(Tracked, From, Location);
+}
+
+void FRewindSweptBoundsGrid::Remove(const URewindComponent* Component)
+{
+	// 已经写入桶中的弱引用在查询时失效，随桶一起过期
+	TrackedComponents.Remove(Component);
+}
+
+void FRewindSweptBoundsGrid::Reset()
+{
+	Buckets.Empty();
+	TrackedComponents.Empty();
+}
+
+void FRewindSweptBoundsGrid::Insert(FTrackedComponent& Tracked, const FVector& From, const FVector& To)
+{
+	using namespace RewindSweptBoundsGrid;
+	FBox Segment(ForceInit);
+	Segment += From;
+	Segment += To;
+	Segment = Segment.ExpandBy(Tracked.Radius);
+
+	const FIntVector MinCell = GetCell(Segment.Min);
+	const FIntVector MaxCell = GetCell(Segment.Max);
+	const bool bInsideWrittenRange = Tracked.BucketSerial == BucketSerial
+		&& MinCell.X >= Tracked.MinCell.X && MinCell.Y >= Tracked.MinCell.Y && MinCell.Z >= Tracked.MinCell.Z
+		&& MaxCell.X <= Tracked.MaxCell.X && MaxCell.Y <= Tracked.MaxCell.Y && MaxCell.Z <= Tracked.MaxCell.Z;
+	if (bInsideWrittenRange) return;
+
+	if (From != To && CountCells(MinCell, MaxCell) > MaxCellsPerSegment)
+	{
+		Insert(Tracked, From, From);
+		Insert(Tracked, To, To);
+		return;
+	}
+
+	FBucket& Bucket = Buckets.Last();
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+			{
+				Bucket.Cells.FindOrAdd(FIntVector(X, Y, Z)).AddUnique(Tracked.Component);
+			}
+		}
+	}
+	Tracked.BucketSerial = BucketSerial;
+	Tracked.MinCell = MinCell;
+	Tracked.MaxCell = MaxCell;
+}
+
+void FRewindSweptBoundsGrid::Tick(float Now)
+{
+	using namespace RewindSweptBoundsGrid;
+	const float BucketStartTime = FMath::FloorToFloat(Now / BucketSeconds) * BucketSeconds;
+	if (!Buckets.IsEmpty() && Buckets.Last().StartTime >= BucketStartTime) return;
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindSweptBoundsGrid::Tick);
+
+	// 整个桶都早于窗口的起点时丢弃
+	int32 NumExpired = 0;
+	while (NumExpired < Buckets.Num() && Buckets[NumExpired].StartTime + BucketSeconds < Now - MaxLagCompensationSeconds) ++NumExpired;
+	Buckets.RemoveAt(0, NumExpired, EAllowShrinking::No);
+
+	Buckets.AddDefaulted_GetRef().StartTime = BucketStartTime;
+	++BucketSerial;
+
+	// 新桶从所有组件现在的位置开始，包括很久没有记录快照的组件
+	for (TMap<TObjectKey<URewindComponent>, FTrackedComponent>::TIterator It = TrackedComponents.CreateIterator(); It; ++It)
+	{
+		FTrackedComponent& Tracked = It.Value();
+		const URewindComponent* Component = Tracked.Component.Get();
+		const AActor* Owner = Component ? Component->GetOwner() : nullptr;
+		if (!Owner)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		Tracked.Radius = GetShapeRadius(*Owner);
+		const FVector From = Tracked.Location;
+		Tracked.Location = Owner->GetActorLocation();
+		Insert(Tracked, From, Tracked.Location);
+	}
+}
+
+bool FRewindSweptBoundsGrid::Query(float Time, const FBox& QueryBounds, TArray<URewindComponent*>& OutComponents) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindSweptBoundsGrid::Query);
+	if (Buckets.IsEmpty() || Time < Buckets[0].StartTime) return false;
+
+	const FIntVector MinCell = GetCell(QueryBounds.Min);
+	const FIntVector MaxCell = GetCell(QueryBounds.Max);
+	const int64 NumQueryCells = RewindSweptBoundsGrid::CountCells(MinCell, MaxCell);
+
+	TSet<URewindComponent*> Found;
+	auto Collect = [&Found](const TArray<TWeakObjectPtr<URewindComponent>, TInlineAllocator<4>>& Entries)
+	{
+		for (const TWeakObjectPtr<URewindComponent>& Entry : Entries)
+		{
+			if (URewindComponent* Component = Entry.Get()) Found.Add(Component);
+		}
+	};
+
+	// 包含Time的桶以及之后的所有桶
+	const int32 FirstBucket = FMath::Max(Algo::UpperBoundBy(Buckets, Time, &FBucket::StartTime) - 1, 0);
+	for (int32 BucketIndex = FirstBucket; BucketIndex < Buckets.Num(); ++BucketIndex)
+	{
+		const FBucket& Bucket = Buckets[BucketIndex];
+		if (NumQueryCells <= Bucket.Cells.Num())
+		{
+			// 查询范围较小：逐个查找覆盖的格子
+			for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+			{
+				for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+				{
+					for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+					{
+						if (const auto* Entries = Bucket.Cells.Find(FIntVector(X, Y, Z))) Collect(*Entries);
+					}
+				}
+			}
+			continue;
+		}
+
+		// 查询范围比桶中有内容的格子还多（例如很长的斜向射线）：遍历有内容的格子
+		for (const auto& Pair : Bucket.Cells)
+		{
+			const FIntVector& Cell = Pair.Key;
+			if (Cell.X >= MinCell.X && Cell.X <= MaxCell.X && Cell.Y >= MinCell.Y && Cell.Y <= MaxCell.Y && Cell.Z >= MinCell.Z && Cell.Z <= MaxCell.Z) Collect(Pair.Value);
+		}
+	}
+
+	OutComponents.Append(Found.Array());
+	return true;
+}
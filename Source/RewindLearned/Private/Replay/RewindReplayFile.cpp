@@ -0,0 +1,478 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/RewindReplayFile.h"
+
+#include "RewindLearned.h"
+#include "Component/RewindComponent.h"
+#include "HAL/FileManager.h"
+#include "Stats/RewindStats.h"
+
+namespace RewindReplay
+{
+	// 写入一个块：先写入占位的块大小，写完数据后回填
+	void WriteChunk(FArchive& Ar, uint32 ChunkId, TFunctionRef<void(FArchive&)> WritePayload)
+	{
+		Ar << ChunkId;
+		const int64 SizeOffset = Ar.Tell();
+		int64 ChunkSize = 0;
+		Ar << ChunkSize;
+
+		const int64 PayloadOffset = Ar.Tell();
+		WritePayload(Ar);
+		const int64 EndOffset = Ar.Tell();
+
+		ChunkSize = EndOffset - PayloadOffset;
+		Ar.Seek(SizeOffset);
+		Ar << ChunkSize;
+		Ar.Seek(EndOffset);
+	}
+}
+
+/* ----------------------------- 基础数据的序列化 ----------------------------- */
+FArchive& operator<<(FArchive& Ar, FRewindReplayHeader& Header)
+{
+	Ar << Header.FormatVersion;
+	Ar << Header.StartTime;
+	Ar << Header.EndTime;
+	Ar << Header.SegmentDurationSeconds;
+	Ar << Header.NumTracks;
+	Ar << Header.NumSegments;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FRewindReplayTrackInfo& TrackInfo)
+{
+	Ar << TrackInfo.ActorPath;
+	Ar << TrackInfo.ActorClassPath;
+	Ar << TrackInfo.bHasMovement;
+	Ar << TrackInfo.NumSamples;
+	Ar << TrackInfo.FirstTime;
+	Ar << TrackInfo.LastTime;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FRewindReplaySegmentIndexEntry& Entry)
+{
+	Ar << Entry.StartTime;
+	Ar << Entry.EndTime;
+	Ar << Entry.FileOffset;
+	return Ar;
+}
+
+void FRewindReplaySample::Serialize(FArchive& Ar, bool bHasMovement)
+{
+	Ar << Time;
+	Ar << Location;
+	Ar << Rotation;
+	Ar << Scale;
+	Ar << LinearVelocity;
+	Ar << AngularVelocityInRadians;
+	if (bHasMovement)
+	{
+		Ar << MovementVelocity;
+		Ar << MovementMode;
+	}
+}
+
+FTransform FRewindReplaySample::GetTransform() const
+{
+	return FTransform(FQuat(Rotation), FVector(Location), FVector(Scale));
+}
+
+FRewindReplaySample FRewindReplaySample::Blend(const FRewindReplaySample& A, const FRewindReplaySample& B, float Alpha)
+{
+	Alpha = FMath::Clamp(Alpha, 0.0f, 1.0f);
+	FRewindReplaySample Result;
+	Result.Time = FMath::Lerp(A.Time, B.Time, Alpha);
+	Result.Location = FMath::Lerp(A.Location, B.Location, Alpha);
+	Result.Rotation = FQuat4f::Slerp(A.Rotation, B.Rotation, Alpha);
+	Result.Scale = FMath::Lerp(A.Scale, B.Scale, Alpha);
+	Result.LinearVelocity = FMath::Lerp(A.LinearVelocity, B.LinearVelocity, Alpha);
+	Result.AngularVelocityInRadians = FMath::Lerp(A.AngularVelocityInRadians, B.AngularVelocityInRadians, Alpha);
+	Result.MovementVelocity = FMath::Lerp(A.MovementVelocity, B.MovementVelocity, Alpha);
+	Result.MovementMode = Alpha < 0.5f ? A.MovementMode : B.MovementMode; // 离散值与BlendSnapshots保持一致
+	return Result;
+}
+
+void FRewindReplayCapture::AddTrack(const AActor* Actor, TConstArrayView<FTransformAndVelocitySnapshot> TransformSnapshots,
+	TConstArrayView<FMovementVelocityAndModeSnapshot> MovementSnapshots)
+{
+	if (!Actor || TransformSnapshots.Num() == 0) return;
+
+	// 运动快照与Transform快照按下标一一对应
+	const bool bHasMovement = MovementSnapshots.Num() == TransformSnapshots.Num();
+
+	FTrack& Track = Tracks.AddDefaulted_GetRef();
+	Track.Info.ActorPath = Actor->GetPathName();
+	Track.Info.ActorClassPath = Actor->GetClass()->GetPathName();
+	Track.Info.bHasMovement = bHasMovement;
+	Track.Info.NumSamples = TransformSnapshots.Num();
+	Track.Info.FirstTime = TransformSnapshots[0].RecordedTime;
+	Track.Info.LastTime = TransformSnapshots.Last().RecordedTime;
+
+	Track.Samples.SetNum(TransformSnapshots.Num());
+	for (int32 Index = 0; Index < TransformSnapshots.Num(); ++Index)
+	{
+		const FTransformAndVelocitySnapshot& Snapshot = TransformSnapshots[Index];
+		FRewindReplaySample& Sample = Track.Samples[Index];
+		Sample.Time = Snapshot.RecordedTime;
+		Sample.Location = FVector3f(Snapshot.Transform.GetLocation());
+		Sample.Rotation = FQuat4f(Snapshot.Transform.GetRotation());
+		Sample.Scale = FVector3f(Snapshot.Transform.GetScale3D());
+		Sample.LinearVelocity = FVector3f(Snapshot.LinearVelocity);
+		Sample.AngularVelocityInRadians = FVector3f(Snapshot.AngularVelocityInRadians);
+		if (bHasMovement)
+		{
+			Sample.MovementVelocity = FVector3f(MovementSnapshots[Index].MovementVelocity);
+			Sample.MovementMode = MovementSnapshots[Index].MovementMode;
+		}
+	}
+}
+
+/* ----------------------------- 写入 ----------------------------- */
+bool FRewindReplayWriter::WriteToFile(const FRewindReplayCapture& Capture, const FString& FilePath, float SegmentDurationSeconds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindReplayWriter::WriteToFile);
+	check(SegmentDurationSeconds > 0.0f);
+
+	const FString TempFilePath = FilePath + TEXT(".tmp");
+	TUniquePtr<FArchive> Ar(IFileManager::Get().CreateFileWriter(*TempFilePath));
+	if (!Ar)
+	{
+		UE_LOG(LogRewind, Warning, TEXT("Failed to create replay file %s"), *TempFilePath);
+		return false;
+	}
+
+	uint32 Magic = RewindReplay::FileMagic;
+	uint32 Version = RewindReplay::FormatVersion;
+	*Ar << Magic;
+	*Ar << Version;
+
+	// 文件头
+	FRewindReplayHeader Header;
+	Header.SegmentDurationSeconds = SegmentDurationSeconds;
+	Header.NumTracks = Capture.Tracks.Num();
+	Header.StartTime = TNumericLimits<float>::Max();
+	Header.EndTime = TNumericLimits<float>::Lowest();
+	for (const FRewindReplayCapture::FTrack& Track : Capture.Tracks)
+	{
+		Header.StartTime = FMath::Min(Header.StartTime, Track.Info.FirstTime);
+		Header.EndTime = FMath::Max(Header.EndTime, Track.Info.LastTime);
+	}
+	if (Capture.Tracks.Num() == 0) Header.StartTime = Header.EndTime = 0.0f;
+	Header.NumSegments = FMath::Max(1, FMath::CeilToInt32((Header.EndTime - Header.StartTime) / SegmentDurationSeconds));
+	RewindReplay::WriteChunk(*Ar, RewindReplay::HeaderChunkId, [&Header](FArchive& ChunkAr) { ChunkAr << Header; });
+
+	// 轨道表
+	RewindReplay::WriteChunk(*Ar, RewindReplay::TrackTableChunkId, [&Capture](FArchive& ChunkAr)
+	{
+		int32 NumTracks = Capture.Tracks.Num();
+		ChunkAr << NumTracks;
+		for (const FRewindReplayCapture::FTrack& Track : Capture.Tracks)
+		{
+			FRewindReplayTrackInfo TrackInfo = Track.Info;
+			ChunkAr << TrackInfo;
+		}
+	});
+
+	// 分段的采样数据：每段包含窗口内的采样，以及窗口前后各一个采样，保证段内可以独立插值
+	TArray<FRewindReplaySegmentIndexEntry> SeekIndex;
+	SeekIndex.Reserve(Header.NumSegments);
+	TArray<int32> TrackCursors;
+	TrackCursors.SetNumZeroed(Capture.Tracks.Num());
+	for (int32 SegmentIndex = 0; SegmentIndex < Header.NumSegments; ++SegmentIndex)
+	{
+		const bool bLastSegment = SegmentIndex == Header.NumSegments - 1;
+		FRewindReplaySegmentIndexEntry& Entry = SeekIndex.AddDefaulted_GetRef();
+		Entry.StartTime = Header.StartTime + SegmentIndex * SegmentDurationSeconds;
+		Entry.EndTime = bLastSegment ? Header.EndTime : Entry.StartTime + SegmentDurationSeconds;
+		Entry.FileOffset = Ar->Tell();
+
+		RewindReplay::WriteChunk(*Ar, RewindReplay::SegmentChunkId, [&](FArchive& ChunkAr)
+		{
+			ChunkAr << Entry.StartTime;
+			ChunkAr << Entry.EndTime;
+
+			// 先统计每条轨道在该段中的采样范围[First, End)
+			TArray<TTuple<int32, int32, int32>> Blocks;
+			for (int32 TrackIndex = 0; TrackIndex < Capture.Tracks.Num(); ++TrackIndex)
+			{
+				const TArray<FRewindReplaySample>& Samples = Capture.Tracks[TrackIndex].Samples;
+				if (Samples.Num() == 0 || Samples.Last().Time < Entry.StartTime || Samples[0].Time > Entry.EndTime) continue;
+
+				int32& Cursor = TrackCursors[TrackIndex];
+				while (Cursor < Samples.Num() && Samples[Cursor].Time < Entry.StartTime) ++Cursor;
+				int32 WindowEnd = Cursor;
+				while (WindowEnd < Samples.Num() && (Samples[WindowEnd].Time < Entry.EndTime || (bLastSegment && Samples[WindowEnd].Time <= Entry.EndTime))) ++WindowEnd;
+
+				const int32 First = FMath::Max(Cursor - 1, 0);
+				const int32 End = FMath::Min(WindowEnd + 1, Samples.Num());
+				if (End > First) Blocks.Emplace(TrackIndex, First, End);
+			}
+
+			int32 NumBlocks = Blocks.Num();
+			ChunkAr << NumBlocks;
+			for (const TTuple<int32, int32, int32>& Block : Blocks)
+			{
+				int32 TrackIndex = Block.Get<0>();
+				int32 NumSamples = Block.Get<2>() - Block.Get<1>();
+				ChunkAr << TrackIndex;
+				ChunkAr << NumSamples;
+
+				const FRewindReplayCapture::FTrack& Track = Capture.Tracks[TrackIndex];
+				for (int32 SampleIndex = Block.Get<1>(); SampleIndex < Block.Get<2>(); ++SampleIndex)
+				{
+					FRewindReplaySample Sample = Track.Samples[SampleIndex];
+					Sample.Serialize(ChunkAr, Track.Info.bHasMovement);
+				}
+			}
+		});
+	}
+
+	// 定位索引和文件尾
+	int64 SeekIndexOffset = Ar->Tell();
+	RewindReplay::WriteChunk(*Ar, RewindReplay::SeekIndexChunkId, [&SeekIndex](FArchive& ChunkAr)
+	{
+		int32 NumEntries = SeekIndex.Num();
+		ChunkAr << NumEntries;
+		for (FRewindReplaySegmentIndexEntry& Entry : SeekIndex) ChunkAr << Entry;
+	});
+	uint32 TrailingMagic = RewindReplay::FooterMagic;
+	*Ar << SeekIndexOffset;
+	*Ar << TrailingMagic;
+
+	const bool bSucceeded = !Ar->IsError() && Ar->Close();
+	Ar.Reset();
+	if (!bSucceeded)
+	{
+		UE_LOG(LogRewind, Warning, TEXT("Failed to write replay file %s"), *TempFilePath);
+		IFileManager::Get().Delete(*TempFilePath);
+		return false;
+	}
+	return IFileManager::Get().Move(*FilePath, *TempFilePath, true);
+}
+
+/* ----------------------------- 读取 ----------------------------- */
+FRewindReplayReader::~FRewindReplayReader()
+{
+	Close();
+}
+
+bool FRewindReplayReader::Open(const FString& FilePath)
+{
+	Close();
+	FileReader.Reset(IFileManager::Get().CreateFileReader(*FilePath));
+	if (!FileReader) return false;
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*FileReader << Magic;
+	*FileReader << Version;
+	if (Magic != RewindReplay::FileMagic || Version > RewindReplay::FormatVersion)
+	{
+		UE_LOG(LogRewind, Warning, TEXT("%s is not a supported replay file (version %u)"), *FilePath, Version);
+		Close();
+		return false;
+	}
+
+	// 读取文件头和轨道表，跳过不认识的块
+	bool bReadHeader = false;
+	bool bReadTracks = false;
+	while (!bReadHeader || !bReadTracks)
+	{
+		uint32 ChunkId;
+		int64 ChunkSize;
+		if (!ReadChunkHeader(ChunkId, ChunkSize))
+		{
+			Close();
+			return false;
+		}
+
+		const int64 PayloadOffset = FileReader->Tell();
+		if (ChunkId == RewindReplay::HeaderChunkId)
+		{
+			*FileReader << Header;
+			bReadHeader = true;
+		}
+		else if (ChunkId == RewindReplay::TrackTableChunkId)
+		{
+			int32 NumTracks = 0;
+			*FileReader << NumTracks;
+			if (NumTracks < 0 || NumTracks > ChunkSize)
+			{
+				Close();
+				return false;
+			}
+			Tracks.SetNum(NumTracks);
+			for (FRewindReplayTrackInfo& TrackInfo : Tracks) *FileReader << TrackInfo;
+			bReadTracks = true;
+		}
+		FileReader->Seek(PayloadOffset + ChunkSize);
+	}
+
+	// 通过文件尾直接定位索引
+	const int64 FooterSize = sizeof(int64) + sizeof(uint32);
+	const int64 TotalSize = FileReader->TotalSize();
+	if (TotalSize < FooterSize)
+	{
+		Close();
+		return false;
+	}
+	FileReader->Seek(TotalSize - FooterSize);
+	int64 SeekIndexOffset = 0;
+	uint32 TrailingMagic = 0;
+	*FileReader << SeekIndexOffset;
+	*FileReader << TrailingMagic;
+
+	uint32 ChunkId;
+	int64 ChunkSize;
+	if (TrailingMagic != RewindReplay::FooterMagic || SeekIndexOffset < 0 || SeekIndexOffset >= TotalSize)
+	{
+		Close();
+		return false;
+	}
+	FileReader->Seek(SeekIndexOffset);
+	if (!ReadChunkHeader(ChunkId, ChunkSize) || ChunkId != RewindReplay::SeekIndexChunkId)
+	{
+		Close();
+		return false;
+	}
+	int32 NumEntries = 0;
+	*FileReader << NumEntries;
+	if (NumEntries < 0 || NumEntries > ChunkSize)
+	{
+		Close();
+		return false;
+	}
+	SeekIndex.SetNum(NumEntries);
+	for (FRewindReplaySegmentIndexEntry& Entry : SeekIndex) *FileReader << Entry;
+
+	if (FileReader->IsError())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FRewindReplayReader::Close()
+{
+	FileReader.Reset();
+	Header = FRewindReplayHeader();
+	Tracks.Reset();
+	SeekIndex.Reset();
+	CachedSegments.Reset();
+}
+
+bool FRewindReplayReader::ReadChunkHeader(uint32& OutChunkId, int64& OutChunkSize)
+{
+	const int64 TotalSize = FileReader->TotalSize();
+	if (FileReader->Tell() + static_cast<int64>(sizeof(uint32) + sizeof(int64)) > TotalSize) return false;
+
+	*FileReader << OutChunkId;
+	*FileReader << OutChunkSize;
+	return !FileReader->IsError() && OutChunkSize >= 0 && FileReader->Tell() + OutChunkSize <= TotalSize;
+}
+
+int32 FRewindReplayReader::FindSegmentIndex(float Time) const
+{
+	// 最后一个StartTime <= Time的分段
+	int32 Low = 0;
+	int32 High = SeekIndex.Num();
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (SeekIndex[Middle].StartTime <= Time) Low = Middle + 1;
+		else High = Middle;
+	}
+	return FMath::Max(Low - 1, 0);
+}
+
+const FRewindReplayReader::FLoadedSegment* FRewindReplayReader::LoadSegment(int32 SegmentIndex)
+{
+	for (const TUniquePtr<FLoadedSegment>& CachedSegment : CachedSegments)
+	{
+		if (CachedSegment->SegmentIndex == SegmentIndex)
+		{
+			CachedSegment->LastUsedCounter = ++UseCounter;
+			return CachedSegment.Get();
+		}
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRewindReplayReader::LoadSegment);
+	LLM_SCOPE_BYTAG(Rewind);
+	FileReader->Seek(SeekIndex[SegmentIndex].FileOffset);
+	uint32 ChunkId;
+	int64 ChunkSize;
+	if (!ReadChunkHeader(ChunkId, ChunkSize) || ChunkId != RewindReplay::SegmentChunkId) return nullptr;
+
+	TUniquePtr<FLoadedSegment> Segment = MakeUnique<FLoadedSegment>();
+	Segment->SegmentIndex = SegmentIndex;
+	Segment->LastUsedCounter = ++UseCounter;
+
+	float StartTime, EndTime;
+	int32 NumBlocks = 0;
+	*FileReader << StartTime;
+	*FileReader << EndTime;
+	*FileReader << NumBlocks;
+	for (int32 BlockIndex = 0; BlockIndex < NumBlocks && !FileReader->IsError(); ++BlockIndex)
+	{
+		int32 TrackIndex = INDEX_NONE;
+		int32 NumSamples = 0;
+		*FileReader << TrackIndex;
+		*FileReader << NumSamples;
+		if (!Tracks.IsValidIndex(TrackIndex) || NumSamples < 0 || NumSamples > ChunkSize) return nullptr;
+
+		TArray<FRewindReplaySample>& Samples = Segment->TrackSamples.Add(TrackIndex);
+		Samples.SetNum(NumSamples);
+		for (FRewindReplaySample& Sample : Samples) Sample.Serialize(*FileReader, Tracks[TrackIndex].bHasMovement);
+	}
+	if (FileReader->IsError()) return nullptr;
+
+	// 缓存已满时淘汰最久未使用的分段
+	if (CachedSegments.Num() >= MaxCachedSegments)
+	{
+		int32 OldestIndex = 0;
+		for (int32 Index = 1; Index < CachedSegments.Num(); ++Index)
+		{
+			if (CachedSegments[Index]->LastUsedCounter < CachedSegments[OldestIndex]->LastUsedCounter) OldestIndex = Index;
+		}
+		CachedSegments.RemoveAtSwap(OldestIndex);
+	}
+	return CachedSegments.Add_GetRef(MoveTemp(Segment)).Get();
+}
+
+bool FRewindReplayReader::SampleTrack(int32 TrackIndex, float Time, FRewindReplaySample& OutSample)
+{
+	if (!IsOpen() || !Tracks.IsValidIndex(TrackIndex) || SeekIndex.Num() == 0) return false;
+	const FRewindReplayTrackInfo& TrackInfo = Tracks[TrackIndex];
+	if (Time < TrackInfo.FirstTime || Time > TrackInfo.LastTime) return false;
+
+	const FLoadedSegment* Segment = LoadSegment(FindSegmentIndex(Time));
+	const TArray<FRewindReplaySample>* Samples = Segment ? Segment->TrackSamples.Find(TrackIndex) : nullptr;
+	if (!Samples || Samples->Num() == 0) return false;
+
+	// 段内二分查找第一个时间大于Time的采样
+	int32 Low = 0;
+	int32 High = Samples->Num();
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if ((*Samples)[Middle].Time <= Time) Low = Middle + 1;
+		else High = Middle;
+	}
+
+	if (Low == 0 || Low >= Samples->Num())
+	{
+		OutSample = (*Samples)[FMath::Clamp(Low - 1, 0, Samples->Num() - 1)];
+		return true;
+	}
+
+	const FRewindReplaySample& PreviousSample = (*Samples)[Low - 1];
+	const FRewindReplaySample& NextSample = (*Samples)[Low];
+	const float Interval = NextSample.Time - PreviousSample.Time;
+	const float Alpha = Interval > UE_KINDA_SMALL_NUMBER ? (Time - PreviousSample.Time) / Interval : 1.0f;
+	OutSample = FRewindReplaySample::Blend(PreviousSample, NextSample, Alpha);
+	return true;
+}
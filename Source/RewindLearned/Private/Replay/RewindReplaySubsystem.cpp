@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Replay/RewindReplaySubsystem.h"
+
+#include "RewindLearned.h"
+#include "Async/Async.h"
+#include "Component/RewindComponent.h"
+#include "Misc/Paths.h"
+#include "Stats/RewindStats.h"
+#include "UObject/UObjectIterator.h"
+
+namespace RewindReplay
+{
+	// 控制台命令，方便在无头模式或命令行中使用
+	static FAutoConsoleCommandWithWorldAndArgs SaveReplayCommand(
+		TEXT("Rewind.SaveReplay"),
+		TEXT("Rewind.SaveReplay <Name> - Save the rewind history of the current world to Saved/Rewind/<Name>.rwnd"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			URewindReplaySubsystem* Subsystem = World ? World->GetSubsystem<URewindReplaySubsystem>() : nullptr;
+			if (Subsystem) Subsystem->SaveReplayAsync(Args.Num() > 0 ? Args[0] : TEXT("LastSession"));
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs PlayReplayCommand(
+		TEXT("Rewind.PlayReplay"),
+		TEXT("Rewind.PlayReplay <Name> - Stream Saved/Rewind/<Name>.rwnd back onto the matching actors"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			URewindReplaySubsystem* Subsystem = World ? World->GetSubsystem<URewindReplaySubsystem>() : nullptr;
+			if (Subsystem) Subsystem->StartReplayPlayback(Args.Num() > 0 ? Args[0] : TEXT("LastSession"));
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs StopReplayCommand(
+		TEXT("Rewind.StopReplay"),
+		TEXT("Rewind.StopReplay - Stop the current replay playback"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			URewindReplaySubsystem* Subsystem = World ? World->GetSubsystem<URewindReplaySubsystem>() : nullptr;
+			if (Subsystem) Subsystem->StopReplayPlayback();
+		}));
+}
+
+void URewindReplaySubsystem::Deinitialize()
+{
+	StopReplayPlayback();
+
+	// 保证写入在世界销毁前完成
+	if (PendingSave.IsValid()) PendingSave.Wait();
+
+	Super::Deinitialize();
+}
+
+TStatId URewindReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URewindReplaySubsystem, STATGROUP_Tickables);
+}
+
+FString URewindReplaySubsystem::GetReplayFilePath(const FString& ReplayName)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Rewind"), ReplayName + RewindReplay::FileExtension);
+}
+
+bool URewindReplaySubsystem::SaveReplayAsync(const FString& ReplayName)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindReplaySubsystem::SaveReplayAsync);
+	if (IsSavingReplay())
+	{
+		UE_LOG(LogRewind, Warning, TEXT("A replay is already being saved, ignoring request for %s"), *ReplayName);
+		return false;
+	}
+
+	// 游戏线程只负责复制数据，编码和磁盘写入在线程池中完成
+	FRewindReplayCapture Capture;
+	CaptureWorldHistory(Capture);
+
+	const FString FilePath = GetReplayFilePath(ReplayName);
+	PendingSave = Async(EAsyncExecution::ThreadPool, [Capture = MoveTemp(Capture), FilePath]()
+	{
+		const bool bSaved = FRewindReplayWriter::WriteToFile(Capture, FilePath);
+		UE_LOG(LogRewind, Log, TEXT("%s replay %s (%d tracks)"), bSaved ? TEXT("Saved") : TEXT("Failed to save"), *FilePath, Capture.Tracks.Num());
+		return bSaved;
+	});
+	return true;
+}
+
+void URewindReplaySubsystem::CaptureWorldHistory(FRewindReplayCapture& OutCapture) const
+{
+	LLM_SCOPE_BYTAG(Rewind);
+	const UWorld* World = GetWorld();
+	TArray<FTransformAndVelocitySnapshot> TransformSnapshots;
+	TArray<FMovementVelocityAndModeSnapshot> MovementSnapshots;
+	for (TObjectIterator<URewindComponent> It; It; ++It)
+	{
+		const URewindComponent* RewindComponent = *It;
+		if (RewindComponent->GetWorld() != World || !RewindComponent->HasBegunPlay()) continue;
+
+		RewindComponent->CopyHistory(TransformSnapshots, MovementSnapshots);
+		OutCapture.AddTrack(RewindComponent->GetOwner(), TransformSnapshots, MovementSnapshots);
+	}
+}
+
+bool URewindReplaySubsystem::StartReplayPlayback(const FString& ReplayName)
+{
+	StopReplayPlayback();
+
+	ReplayReader = MakeUnique<FRewindReplayReader>();
+	if (!ReplayReader->Open(GetReplayFilePath(ReplayName)))
+	{
+		UE_LOG(LogRewind, Warning, TEXT("Failed to open replay %s"), *ReplayName);
+		ReplayReader.Reset();
+		return false;
+	}
+
+	// 通过路径名找到对应的Actor，回放期间由回溯组件暂停它们的记录、角色移动和物理模拟
+	const TArray<FRewindReplayTrackInfo>& Tracks = ReplayReader->GetTracks();
+	PlaybackActors.SetNum(Tracks.Num());
+	for (int32 TrackIndex = 0; TrackIndex < Tracks.Num(); ++TrackIndex)
+	{
+		AActor* Actor = Cast<AActor>(FSoftObjectPath(Tracks[TrackIndex].ActorPath).ResolveObject());
+		if (!Actor || Actor->GetWorld() != GetWorld()) continue;
+
+		PlaybackActors[TrackIndex] = Actor;
+		if (URewindComponent* Component = Actor->FindComponentByClass<URewindComponent>())
+		{
+			Component->BeginExternalPlayback();
+			SuspendedComponents.Add(Component);
+		}
+	}
+
+	PlaybackTime = ReplayReader->GetHeader().StartTime;
+	bIsPlayingReplay = true;
+	return true;
+}
+
+void URewindReplaySubsystem::StopReplayPlayback()
+{
+	if (!bIsPlayingReplay) return;
+	bIsPlayingReplay = false;
+
+	for (const TWeakObjectPtr<URewindComponent>& SuspendedComponent : SuspendedComponents)
+	{
+		if (URewindComponent* Component = SuspendedComponent.Get()) Component->EndExternalPlayback();
+	}
+	SuspendedComponents.Reset();
+	PlaybackActors.Reset();
+	ReplayReader.Reset();
+}
+
+void URewindReplaySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	if (!bIsPlayingReplay) return;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindReplaySubsystem::Tick);
+	PlaybackTime += DeltaTime;
+	if (PlaybackTime > ReplayReader->GetHeader().EndTime)
+	{
+		StopReplayPlayback();
+		return;
+	}
+
+	FRewindReplaySample Sample;
+	for (int32 TrackIndex = 0; TrackIndex < PlaybackActors.Num(); ++TrackIndex)
+	{
+		AActor* Actor = PlaybackActors[TrackIndex].Get();
+		if (Actor && ReplayReader->SampleTrack(TrackIndex, PlaybackTime, Sample))
+		{
+			Actor->SetActorTransform(Sample.GetTransform(), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+}
@@ -12,8 +12,16 @@ ARewindableStaticMeshActor::ARewindableStaticMeshActor()
 	// 网格体物理设置
 	GetStaticMeshComponent()->Mobility = EComponentMobility::Movable;
 	GetStaticMeshComponent()->SetSimulatePhysics(true);
+	GetStaticMeshComponent()->SetGenerateOverlapEvents(true); // 进出时间泡时需要重叠事件
+
+	// 网络同步：平时使用默认的物理移动复制，时间操作期间由回溯组件发送回放结果
+	bReplicates = true;
+	bStaticMeshReplicateMovement = true;
+	SetReplicatingMovement(true);
 
 	// 回溯组件初始化和设置频率
 	RewindComponent = CreateDefaultSubobject<URewindComponent>(TEXT("RewindComponent"));
-	RewindComponent->SnapshotFrequencySeconds = 1.0f / 30.0f;
+	// 物理模拟记录了可靠的线速度和角速度，以速度为切线插值时15Hz即可保持平滑，内存和记录开销减半
+	RewindComponent->SnapshotFrequencySeconds = 1.0f / 15.0f;
+	RewindComponent->InterpolationMode = ERewindInterpolationMode::Hermite;
 }
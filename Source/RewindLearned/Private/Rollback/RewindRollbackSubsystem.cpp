@@ -0,0 +1,414 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Rollback/RewindRollbackSubsystem.h"
+
+#include "RewindLearned.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "Component/RewindComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Registry/RewindComponentRegistry.h"
+#include "Stats/RewindStats.h"
+
+namespace RewindRollback
+{
+	// 内置模型每个工作线程任务的最少物体数，物体很少时不值得分发
+	constexpr int32 MinBodiesPerSimulationTask = 256;
+}
+
+void URewindRollbackSubsystem::Deinitialize()
+{
+	Bodies.Empty();
+	Children.Empty();
+	FrameBuffer.Empty();
+	SlotFrames.Empty();
+	WorldState.Empty();
+	ScratchState.Empty();
+	Inputs.Empty();
+	bHasLayout = false;
+	Super::Deinitialize();
+}
+
+bool URewindRollbackSubsystem::IsLayoutCurrent() const
+{
+	const URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	return bHasLayout && Registry && Registry->GetMembershipSerial() == LayoutMembershipSerial;
+}
+
+void URewindRollbackSubsystem::RebuildLayout()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindRollbackSubsystem::RebuildLayout);
+	Bodies.Reset();
+	Children.Reset();
+
+	const URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	LayoutMembershipSerial = Registry ? Registry->GetMembershipSerial() : 0;
+	bHasLayout = true;
+
+	// 物体下标与注册表下标一致（分发期间注销留下的空位也占一个物体），GetBodyIndex不需要查找
+	const FVector Gravity(0.0f, 0.0f, GetWorld()->GetGravityZ());
+	const TConstArrayView<TObjectPtr<URewindComponent>> Components = Registry ? Registry->GetComponents() : TConstArrayView<TObjectPtr<URewindComponent>>();
+	Bodies.SetNum(Components.Num());
+	for (int32 Index = 0; Index < Components.Num(); ++Index)
+	{
+		URewindComponent* Component = Components[Index];
+		FBodyLayout& Layout = Bodies[Index];
+		Layout.FirstChild = Children.Num();
+		if (!Component) continue;
+
+		Layout.Component = Component;
+		const UPrimitiveComponent* Root = Component->OwnerRootComponent;
+		Layout.bSimulatesPhysics = Root && Root->IsSimulatingPhysics();
+		if (Layout.bSimulatesPhysics)
+		{
+			Layout.Model.Gravity = Root->IsGravityEnabled() ? Gravity : FVector::ZeroVector;
+			Layout.Model.LinearDamping = Root->GetLinearDamping();
+			Layout.Model.AngularDamping = Root->GetAngularDamping();
+		}
+		else if (const UCharacterMovementComponent* Movement = Component->OwnerMovementComponent)
+		{
+			// 角色只在下落时受重力
+			Layout.Model.Gravity = Gravity * Movement->GravityScale;
+		}
+
+		for (const FRewindChildTrack& Track : Component->ChildTracks) Children.Add(Track.Component);
+		Layout.NumChildren = Children.Num() - Layout.FirstChild;
+	}
+
+	ChildPosesOffset = Align(Bodies.Num() * sizeof(FRewindRollbackBodyState), alignof(FRewindRollbackChildPose));
+	FrameStride = Align(ChildPosesOffset + Children.Num() * sizeof(FRewindRollbackChildPose), 16);
+	ResetFrames();
+
+	UE_LOG(LogRewind, Verbose, TEXT("Rollback layout rebuilt: %d bodies, %d children, %llu bytes per frame"),
+		Bodies.Num(), Children.Num(), static_cast<uint64>(FrameStride));
+}
+
+void URewindRollbackSubsystem::ResetFrames()
+{
+	LLM_SCOPE_BYTAG(Rewind);
+	const int32 NumSlots = FMath::Max(MaxRollbackFrames, 1);
+	FrameBuffer.SetNumUninitialized(FrameStride * NumSlots, EAllowShrinking::No);
+	SlotFrames.Init(INDEX_NONE, NumSlots);
+	WorldState.SetNumUninitialized(FrameStride, EAllowShrinking::No);
+	ScratchState.SetNumUninitialized(FrameStride, EAllowShrinking::No);
+	Inputs.Reset();
+	LatestSavedFrame = INDEX_NONE;
+	EarliestLateInputFrame = MAX_int32;
+}
+
+TArrayView<FRewindRollbackBodyState> URewindRollbackSubsystem::GetBodyStates(uint8* Block) const
+{
+	return MakeArrayView(reinterpret_cast<FRewindRollbackBodyState*>(Block), Bodies.Num());
+}
+
+TConstArrayView<FRewindRollbackBodyState> URewindRollbackSubsystem::GetBodyStates(const uint8* Block) const
+{
+	return MakeArrayView(reinterpret_cast<const FRewindRollbackBodyState*>(Block), Bodies.Num());
+}
+
+TArrayView<FRewindRollbackChildPose> URewindRollbackSubsystem::GetChildPoses(uint8* Block) const
+{
+	return MakeArrayView(reinterpret_cast<FRewindRollbackChildPose*>(Block + ChildPosesOffset), Children.Num());
+}
+
+TConstArrayView<FRewindRollbackChildPose> URewindRollbackSubsystem::GetChildPoses(const uint8* Block) const
+{
+	return MakeArrayView(reinterpret_cast<const FRewindRollbackChildPose*>(Block + ChildPosesOffset), Children.Num());
+}
+
+int32 URewindRollbackSubsystem::GetSlotIndex(int32 Frame) const
+{
+	const int32 NumSlots = SlotFrames.Num();
+	return (Frame % NumSlots + NumSlots) % NumSlots;
+}
+
+uint8* URewindRollbackSubsystem::FindFrame(int32 Frame)
+{
+	if (SlotFrames.IsEmpty()) return nullptr;
+	const int32 Slot = GetSlotIndex(Frame);
+	return SlotFrames[Slot] == Frame ? FrameBuffer.GetData() + Slot * FrameStride : nullptr;
+}
+
+bool URewindRollbackSubsystem::HasFrame(int32 Frame) const
+{
+	return !SlotFrames.IsEmpty() && SlotFrames[GetSlotIndex(Frame)] == Frame;
+}
+
+void URewindRollbackSubsystem::SaveFrame(int32 Frame)
+{
+	REWIND_SCOPE_CYCLE_COUNTER(RollbackSave);
+	if (!IsLayoutCurrent()) RebuildLayout();
+
+	// 直接从世界读取到槽位中，不经过中间缓冲
+	const int32 Slot = GetSlotIndex(Frame);
+	CaptureWorld(FrameBuffer.GetData() + Slot * FrameStride);
+	SlotFrames[Slot] = Frame;
+	LatestSavedFrame = Frame;
+
+	// 最老的保存帧之前的输入不会再被重放
+	const int32 OldestFrame = Frame - SlotFrames.Num() + 1;
+	const int32 NumExpired = Algo::LowerBoundBy(Inputs, OldestFrame, &FRewindRollbackInput::Frame);
+	if (NumExpired > 0) Inputs.RemoveAt(0, NumExpired, EAllowShrinking::No);
+}
+
+bool URewindRollbackSubsystem::LoadFrame(int32 Frame)
+{
+	REWIND_SCOPE_CYCLE_COUNTER(RollbackLoad);
+	const uint8* Block = FindFrame(Frame);
+	if (!Block) return false;
+
+	WriteWorld(Block);
+	return true;
+}
+
+int32 URewindRollbackSubsystem::GetBodyIndex(const URewindComponent* Component) const
+{
+	if (!Component || !IsLayoutCurrent()) return INDEX_NONE;
+	const int32 Index = Component->RegistryIndex;
+	return Bodies.IsValidIndex(Index) && Bodies[Index].Component == Component ? Index : INDEX_NONE;
+}
+
+void URewindRollbackSubsystem::AddInput(const FRewindRollbackInput& Input)
+{
+	LLM_SCOPE_BYTAG(Rewind);
+	// 同一帧的输入保持到达的顺序
+	Inputs.Insert(Input, Algo::UpperBoundBy(Inputs, Input.Frame, &FRewindRollbackInput::Frame));
+}
+
+void URewindRollbackSubsystem::AddLateInput(const FRewindRollbackInput& Input)
+{
+	AddInput(Input);
+	if (Input.Frame <= LatestSavedFrame) EarliestLateInputFrame = FMath::Min(EarliestLateInputFrame, Input.Frame);
+}
+
+int32 URewindRollbackSubsystem::RollbackForLateInputs()
+{
+	if (EarliestLateInputFrame == MAX_int32) return 0;
+	const int32 Frame = EarliestLateInputFrame;
+	EarliestLateInputFrame = MAX_int32;
+
+	if (!HasFrame(Frame))
+	{
+		UE_LOG(LogRewind, Warning, TEXT("Rollback to frame %d is beyond the %d saved frames, late input ignored"), Frame, SlotFrames.Num());
+		return 0;
+	}
+
+	// 最新保存的帧已经在世界中模拟过，重新模拟到它之后一帧
+	const int32 NumFrames = LatestSavedFrame + 1 - Frame;
+	return Resimulate(Frame, NumFrames) ? NumFrames : 0;
+}
+
+bool URewindRollbackSubsystem::Resimulate(int32 Frame, int32 NumFrames)
+{
+	REWIND_SCOPE_CYCLE_COUNTER(RollbackResimulate);
+	const uint8* Start = FindFrame(Frame);
+	if (!Start || NumFrames <= 0) return false;
+
+	// 弱指针只能在游戏线程解析：重新模拟期间不会销毁组件，开始前解析一次，工作线程只读取结果
+	ResimulatedBodies.Init(false, Bodies.Num());
+	const bool bCorrectAllBodies = OnSimulateFrame.IsBound();
+	if (bCorrectAllBodies)
+	{
+		for (int32 Index = 0; Index < Bodies.Num(); ++Index) ResimulatedBodies[Index] = Bodies[Index].Component.IsValid();
+	}
+	else
+	{
+		// 内置模型不处理接触，重新模拟没有输入的物体只会用更粗糙的结果覆盖世界中的真实状态：只修正有输入的物体
+		int32 NumResimulated = 0;
+		const int32 EndFrame = Frame + NumFrames;
+		for (int32 Index = Algo::LowerBoundBy(Inputs, Frame, &FRewindRollbackInput::Frame); Index < Inputs.Num() && Inputs[Index].Frame < EndFrame; ++Index)
+		{
+			const int32 BodyIndex = Inputs[Index].BodyIndex;
+			if (!Bodies.IsValidIndex(BodyIndex) || ResimulatedBodies[BodyIndex] || !Bodies[BodyIndex].Component.IsValid()) continue;
+			ResimulatedBodies[BodyIndex] = true;
+			++NumResimulated;
+		}
+		if (NumResimulated == 0)
+		{
+			if (Frame <= EarliestLateInputFrame) EarliestLateInputFrame = MAX_int32;
+			return true;
+		}
+	}
+
+	uint8* Scratch = ScratchState.GetData();
+	FMemory::Memcpy(Scratch, Start, FrameStride);
+	for (int32 SimulatedFrame = Frame; SimulatedFrame < Frame + NumFrames; ++SimulatedFrame)
+	{
+		SimulateFrame(Scratch, SimulatedFrame);
+
+		// 修正之后已经保存的帧，再次回滚时从修正后的状态开始；内置模型只覆盖被修正的物体
+		uint8* Saved = FindFrame(SimulatedFrame + 1);
+		if (!Saved) continue;
+		if (bCorrectAllBodies)
+		{
+			FMemory::Memcpy(Saved, Scratch, FrameStride);
+			continue;
+		}
+		const TConstArrayView<FRewindRollbackBodyState> Simulated = GetBodyStates(static_cast<const uint8*>(Scratch));
+		const TArrayView<FRewindRollbackBodyState> SavedStates = GetBodyStates(Saved);
+		for (TConstSetBitIterator<> It(ResimulatedBodies); It; ++It) SavedStates[It.GetIndex()] = Simulated[It.GetIndex()];
+	}
+
+	if (Frame <= EarliestLateInputFrame) EarliestLateInputFrame = MAX_int32;
+	WriteWorld(Scratch, bCorrectAllBodies ? nullptr : &ResimulatedBodies);
+	return true;
+}
+
+void URewindRollbackSubsystem::CaptureWorld(uint8* Block) const
+{
+	const TArrayView<FRewindRollbackBodyState> States = GetBodyStates(Block);
+	const TArrayView<FRewindRollbackChildPose> Poses = GetChildPoses(Block);
+	for (int32 Index = 0; Index < Bodies.Num(); ++Index)
+	{
+		const FBodyLayout& Layout = Bodies[Index];
+		FRewindRollbackBodyState& State = States[Index];
+		const URewindComponent* Component = Layout.Component.Get();
+		if (!Component)
+		{
+			State = FRewindRollbackBodyState();
+			for (int32 Child = 0; Child < Layout.NumChildren; ++Child) Poses[Layout.FirstChild + Child] = FRewindRollbackChildPose();
+			continue;
+		}
+
+		const AActor* Owner = Component->GetOwner();
+		const FTransform& Transform = Owner->GetActorTransform();
+		State.Location = Transform.GetLocation();
+		State.Rotation = Transform.GetRotation();
+
+		const UPrimitiveComponent* Root = Component->OwnerRootComponent;
+		const UCharacterMovementComponent* Movement = Component->OwnerMovementComponent;
+		if (Root && Root->IsSimulatingPhysics())
+		{
+			State.LinearVelocity = Root->GetPhysicsLinearVelocity();
+			State.AngularVelocityInRadians = Root->GetPhysicsAngularVelocityInRadians();
+		}
+		else
+		{
+			State.LinearVelocity = Movement ? Movement->Velocity : Owner->GetVelocity();
+			State.AngularVelocityInRadians = FVector::ZeroVector;
+		}
+		State.MovementMode = Movement ? static_cast<uint8>(Movement->MovementMode) : static_cast<uint8>(MOVE_None);
+
+		for (int32 Child = 0; Child < Layout.NumChildren; ++Child)
+		{
+			FRewindRollbackChildPose& Pose = Poses[Layout.FirstChild + Child];
+			if (const USceneComponent* ChildComponent = Children[Layout.FirstChild + Child].Get())
+			{
+				Pose.Location = ChildComponent->GetRelativeLocation();
+				Pose.Rotation = ChildComponent->GetRelativeRotation().Quaternion();
+				Pose.Scale3D = ChildComponent->GetRelativeScale3D();
+			}
+			else
+			{
+				Pose = FRewindRollbackChildPose();
+			}
+		}
+	}
+}
+
+void URewindRollbackSubsystem::WriteWorld(const uint8* Block, const TBitArray<>* OnlyBodies)
+{
+	// 先读取世界当前的状态（只读，比写入便宜得多），只写入不同的部分；回滚几帧时大部分物体没有变化
+	CaptureWorld(WorldState.GetData());
+	const TConstArrayView<FRewindRollbackBodyState> Current = GetBodyStates(static_cast<const uint8*>(WorldState.GetData()));
+	const TConstArrayView<FRewindRollbackChildPose> CurrentPoses = GetChildPoses(static_cast<const uint8*>(WorldState.GetData()));
+	const TConstArrayView<FRewindRollbackBodyState> Target = GetBodyStates(Block);
+	const TConstArrayView<FRewindRollbackChildPose> TargetPoses = GetChildPoses(Block);
+
+	for (int32 Index = 0; Index < Bodies.Num(); ++Index)
+	{
+		const FBodyLayout& Layout = Bodies[Index];
+		URewindComponent* Component = Layout.Component.Get();
+		if (!Component || (OnlyBodies && !(*OnlyBodies)[Index])) continue;
+
+		// 子组件只写入相对值，随owner的一次层级更新一起生效；owner没有移动时单独更新一次子组件
+		bool bChildrenChanged = false;
+		for (int32 Child = Layout.FirstChild; !OnlyBodies && Child < Layout.FirstChild + Layout.NumChildren; ++Child)
+		{
+			if (TargetPoses[Child] == CurrentPoses[Child]) continue;
+			USceneComponent* ChildComponent = Children[Child].Get();
+			if (!ChildComponent) continue;
+			ChildComponent->SetRelativeLocation_Direct(TargetPoses[Child].Location);
+			ChildComponent->SetRelativeRotation_Direct(TargetPoses[Child].Rotation.Rotator());
+			ChildComponent->SetRelativeScale3D_Direct(TargetPoses[Child].Scale3D);
+			bChildrenChanged = true;
+		}
+
+		const FRewindRollbackBodyState& State = Target[Index];
+		const FRewindRollbackBodyState& CurrentState = Current[Index];
+		USceneComponent* OwnerRoot = Component->GetOwner()->GetRootComponent();
+		const bool bMoves = State.Location != CurrentState.Location || State.Rotation != CurrentState.Rotation;
+		if (bMoves)
+		{
+			OwnerRoot->SetWorldLocationAndRotation(State.Location, State.Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+		}
+		else if (bChildrenChanged)
+		{
+			OwnerRoot->UpdateChildTransforms(EUpdateTransformFlags::None, ETeleportType::TeleportPhysics);
+		}
+
+		if (State.LinearVelocity != CurrentState.LinearVelocity || State.AngularVelocityInRadians != CurrentState.AngularVelocityInRadians ||
+			State.MovementMode != CurrentState.MovementMode)
+		{
+			UPrimitiveComponent* Root = Component->OwnerRootComponent;
+			if (Root && Root->IsSimulatingPhysics())
+			{
+				Root->SetPhysicsLinearVelocity(State.LinearVelocity);
+				Root->SetPhysicsAngularVelocityInRadians(State.AngularVelocityInRadians);
+			}
+			else if (UCharacterMovementComponent* Movement = Component->OwnerMovementComponent)
+			{
+				Movement->Velocity = State.LinearVelocity;
+				if (State.MovementMode != CurrentState.MovementMode) Movement->SetMovementMode(static_cast<EMovementMode>(State.MovementMode));
+			}
+		}
+	}
+}
+
+void URewindRollbackSubsystem::SimulateFrame(uint8* Block, int32 Frame)
+{
+	const TArrayView<FRewindRollbackBodyState> States = GetBodyStates(Block);
+
+	// 本帧的输入在帧开始时施加
+	for (int32 Index = Algo::LowerBoundBy(Inputs, Frame, &FRewindRollbackInput::Frame); Index < Inputs.Num() && Inputs[Index].Frame == Frame; ++Index)
+	{
+		const FRewindRollbackInput& Input = Inputs[Index];
+		if (!States.IsValidIndex(Input.BodyIndex)) continue;
+		States[Input.BodyIndex].LinearVelocity += Input.LinearVelocityChange;
+		States[Input.BodyIndex].AngularVelocityInRadians += Input.AngularVelocityChange;
+	}
+
+	if (OnSimulateFrame.IsBound())
+	{
+		OnSimulateFrame.Execute(Frame, FixedStepSeconds, States);
+		return;
+	}
+
+	// 内置模型：与检查点重新模拟相同的积分，物体之间相互独立，按块并行；只模拟被修正的物体
+	const float DeltaSeconds = FixedStepSeconds;
+	ParallelFor(TEXT("RewindRollbackSimulate"), States.Num(), RewindRollback::MinBodiesPerSimulationTask, [this, States, DeltaSeconds](int32 Index)
+	{
+		if (!ResimulatedBodies[Index]) return;
+		const FBodyLayout& Layout = Bodies[Index];
+		FRewindRollbackBodyState& Body = States[Index];
+
+		// 模拟物理的物体沿重力方向的速度很小时视为被支撑；角色只在下落时受重力
+		bool bSupported = Body.MovementMode != MOVE_Falling;
+		if (Layout.bSimulatesPhysics)
+		{
+			const FVector GravityDirection = Layout.Model.Gravity.GetSafeNormal();
+			bSupported = GravityDirection.IsZero() || FMath::Abs(Body.LinearVelocity | GravityDirection) < FRewindPhysicsResimulator::SupportedSpeedThreshold;
+		}
+
+		FRewindRigidBodyState State;
+		State.Transform = FTransform(Body.Rotation, Body.Location);
+		State.LinearVelocity = Body.LinearVelocity;
+		State.AngularVelocityInRadians = Body.AngularVelocityInRadians;
+		FRewindPhysicsResimulator::Integrate(State, bSupported, Layout.Model, DeltaSeconds);
+		Body.Location = State.Transform.GetLocation();
+		Body.Rotation = State.Transform.GetRotation();
+		Body.LinearVelocity = State.LinearVelocity;
+		Body.AngularVelocityInRadians = State.AngularVelocityInRadians;
+	});
+}
@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Stats/GameplayDebuggerCategory_Rewind.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+#include "Component/RewindComponent.h"
+#include "Stats/RewindMemoryReport.h"
+
+FGameplayDebuggerCategory_Rewind::FGameplayDebuggerCategory_Rewind()
+{
+	CollectDataInterval = 0.5f; // 统计需要遍历所有组件，不需要每帧收集
+}
+
+TSharedRef<FGameplayDebuggerCategory> FGameplayDebuggerCategory_Rewind::MakeInstance()
+{
+	return MakeShareable(new FGameplayDebuggerCategory_Rewind());
+}
+
+void FGameplayDebuggerCategory_Rewind::CollectData(APlayerController* OwnerPC, AActor* DebugActor)
+{
+	// 文本行会由Gameplay Debugger复制给客户端
+	const FRewindMemoryReport Report = FRewindMemoryReport::Gather(OwnerPC ? OwnerPC->GetWorld() : nullptr);
+	AddTextLine(FString::Printf(TEXT("{white}Components: {yellow}%d  {white}Reserved: {yellow}%.1f KB  {white}Used: {yellow}%.1f KB  {white}Samples: {yellow}%d"),
+		Report.NumComponents, Report.Total.BytesReserved / 1024.0, Report.Total.BytesUsed / 1024.0, Report.Total.NumSamples));
+
+	auto AddEntries = [this](const TCHAR* Title, const TArray<FRewindMemoryReportEntry>& Entries)
+	{
+		AddTextLine(FString::Printf(TEXT("{green}%s"), Title));
+		for (int32 Index = 0; Index < FMath::Min(Entries.Num(), MaxEntries); ++Index)
+		{
+			const FRewindMemoryReportEntry& Entry = Entries[Index];
+			AddTextLine(FString::Printf(TEXT("  {white}%s x%d: {yellow}%.1f KB {white}reserved, {yellow}%.1f KB {white}used, {yellow}%.1fs"),
+				*Entry.Name, Entry.NumComponents, Entry.Usage.BytesReserved / 1024.0, Entry.Usage.BytesUsed / 1024.0, Entry.Usage.HistorySeconds));
+		}
+	};
+	AddEntries(TEXT("Top classes"), Report.PerClass);
+	AddEntries(TEXT("Top actors"), Report.PerActor);
+
+	if (const URewindComponent* RewindComponent = DebugActor ? DebugActor->FindComponentByClass<URewindComponent>() : nullptr)
+	{
+		FRewindMemoryUsage Usage;
+		RewindComponent->GetMemoryUsage(Usage);
+		AddTextLine(FString::Printf(TEXT("{green}%s: {white}%d samples, %.2fs of history, %.1f / %.1f KB"),
+			*DebugActor->GetName(), Usage.NumSamples, Usage.HistorySeconds, Usage.BytesUsed / 1024.0, Usage.BytesReserved / 1024.0));
+	}
+}
+#endif
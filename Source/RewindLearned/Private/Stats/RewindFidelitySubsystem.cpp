@@ -0,0 +1,334 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Stats/RewindFidelitySubsystem.h"
+
+#include "RewindLearned.h"
+#include "Algo/BinarySearch.h"
+#include "Component/RewindComponent.h"
+#include "Misc/FileHelper.h"
+#include "Registry/RewindComponentRegistry.h"
+
+namespace RewindFidelity
+{
+	static const TCHAR* PassNames[] = { TEXT("Rewind"), TEXT("FastForward"), TEXT("Resume") };
+	static_assert(UE_ARRAY_COUNT(PassNames) == static_cast<int32>(ERewindFidelityPass::Num), "Missing pass name");
+
+	static URewindFidelitySubsystem* GetSubsystem(const UWorld* World)
+	{
+		return World ? World->GetSubsystem<URewindFidelitySubsystem>() : nullptr;
+	}
+
+	static FAutoConsoleCommandWithWorld StartCommand(
+		TEXT("Rewind.Fidelity.Start"),
+		TEXT("Start recording ground truth and measuring rewind playback and resume errors"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (URewindFidelitySubsystem* Subsystem = GetSubsystem(World)) Subsystem->StartMeasuring();
+		}));
+
+	static FAutoConsoleCommandWithWorld StopCommand(
+		TEXT("Rewind.Fidelity.Stop"),
+		TEXT("Stop recording ground truth, keeping the measured errors"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (URewindFidelitySubsystem* Subsystem = GetSubsystem(World)) Subsystem->StopMeasuring();
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs ReportCommand(
+		TEXT("Rewind.Fidelity.Report"),
+		TEXT("Rewind.Fidelity.Report [CsvPath] - Log rewind fidelity errors per actor and optionally write them to CSV"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const URewindFidelitySubsystem* Subsystem = GetSubsystem(World);
+			if (!Subsystem) return;
+			Subsystem->DumpReport(20);
+			if (Args.Num() > 0) Subsystem->WriteCsv(Args[0]);
+		}));
+}
+
+void FRewindFidelityErrorStats::Add(double PositionError, double RotationErrorDegrees, double VelocityError)
+{
+	++NumSamples;
+	PositionSum += PositionError;
+	PositionSquaredSum += PositionError * PositionError;
+	PositionMax = FMath::Max(PositionMax, PositionError);
+	RotationSum += RotationErrorDegrees;
+	RotationMax = FMath::Max(RotationMax, RotationErrorDegrees);
+	VelocitySum += VelocityError;
+	VelocityMax = FMath::Max(VelocityMax, VelocityError);
+}
+
+void FRewindFidelityErrorStats::Merge(const FRewindFidelityErrorStats& Other)
+{
+	NumSamples += Other.NumSamples;
+	PositionSum += Other.PositionSum;
+	PositionSquaredSum += Other.PositionSquaredSum;
+	PositionMax = FMath::Max(PositionMax, Other.PositionMax);
+	RotationSum += Other.RotationSum;
+	RotationMax = FMath::Max(RotationMax, Other.RotationMax);
+	VelocitySum += Other.VelocitySum;
+	VelocityMax = FMath::Max(VelocityMax, Other.VelocityMax);
+}
+
+void URewindFidelitySubsystem::StartMeasuring()
+{
+	// 重新开始时丢弃之前的真实状态和统计
+	TrackedComponents.Reset();
+	bIsMeasuring = true;
+	UE_LOG(LogRewind, Display, TEXT("Rewind fidelity measurement started"));
+}
+
+void URewindFidelitySubsystem::StopMeasuring()
+{
+	bIsMeasuring = false;
+	for (TPair<TWeakObjectPtr<URewindComponent>, FTrackedComponent>& Pair : TrackedComponents)
+	{
+		Pair.Value.Truth.Empty();
+		Pair.Value.ResumeReference.Empty();
+	}
+}
+
+void URewindFidelitySubsystem::Deinitialize()
+{
+	TrackedComponents.Reset();
+	bIsMeasuring = false;
+	Super::Deinitialize();
+}
+
+TStatId URewindFidelitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(URewindFidelitySubsystem, STATGROUP_Tickables);
+}
+
+void URewindFidelitySubsystem::Tick(float DeltaTime)
+{
+	/* 可Tick对象在所有Tick组之后更新：物理已经完成，回放结果也已经应用 */
+	Super::Tick(DeltaTime);
+	if (!bIsMeasuring) return;
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindFidelitySubsystem::Tick);
+
+	const URewindComponentRegistry* Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	if (!Registry) return;
+
+	for (URewindComponent* Component : Registry->GetComponents())
+	{
+		if (!Component) continue;
+
+		// 跟随服务器回放的客户端组件没有自己的历史
+		float OldestTime = 0.0f;
+		float NewestTime = 0.0f;
+		if (!Component->GetHistoryTimeRange(OldestTime, NewestTime)) continue;
+
+		FTrackedComponent& Tracked = TrackedComponents.FindOrAdd(Component);
+		if (Tracked.Name.IsEmpty()) Tracked.Name = Component->GetOwner()->GetName();
+		TickComponent(*Component, Tracked, DeltaTime);
+
+		// 与历史一起淘汰：保留决定最老时刻状态的最后一个样本
+		const int32 FirstLater = Algo::UpperBoundBy(Tracked.Truth, OldestTime, &FTruthSample::Time);
+		if (FirstLater > 1) Tracked.Truth.RemoveAt(0, FirstLater - 1, EAllowShrinking::No);
+	}
+
+	// 被销毁的组件只保留统计
+	for (TPair<TWeakObjectPtr<URewindComponent>, FTrackedComponent>& Pair : TrackedComponents)
+	{
+		if (Pair.Key.IsValid() || Pair.Value.Truth.IsEmpty()) continue;
+		Pair.Value.Truth.Empty();
+		Pair.Value.ResumeReference.Empty();
+	}
+}
+
+void URewindFidelitySubsystem::TickComponent(URewindComponent& Component, FTrackedComponent& Tracked, float DeltaTime)
+{
+	const float Now = GetWorld()->GetTimeSeconds();
+
+	if (Component.IsTimeBeingManipulated())
+	{
+		// 回放：应用的快照与它在时间线上的时刻的真实状态比较；时停中的回溯和快进同样统计
+		const bool bNewlyApplied = Component.GetAppliedSnapshotSerial() != Tracked.LastAppliedSnapshotSerial;
+		Tracked.LastAppliedSnapshotSerial = Component.GetAppliedSnapshotSerial();
+		if (bNewlyApplied && (Component.IsRewinding() || Component.IsFastForwarding()))
+		{
+			const FTransformAndVelocitySnapshot& Applied = Component.GetLastAppliedSnapshot();
+			FTruthSample Truth;
+			if (SampleTruth(Tracked.Truth, Applied.RecordedTime, Truth))
+			{
+				const ERewindFidelityPass Pass = Component.IsRewinding() ? ERewindFidelityPass::Rewind : ERewindFidelityPass::FastForward;
+				AddError(Tracked.Passes[static_cast<int32>(Pass)], Truth, Applied.Transform.GetLocation(), Applied.Transform.GetRotation(), Applied.LinearVelocity);
+			}
+		}
+		Tracked.bWasManipulating = true;
+		return;
+	}
+
+	if (Tracked.bWasManipulating)
+	{
+		/*
+		 * 刚恢复正常时间：组件的时间线从最后应用的快照处继续（之后的快照成为分支）；
+		 * 原来从恢复点开始的轨迹作为漂移的参照，真实状态与组件的时间线一样截断到恢复点
+		 */
+		Tracked.bWasManipulating = false;
+		const float ResumeTime = Component.GetLastAppliedSnapshot().RecordedTime;
+		const int32 FirstLater = Algo::UpperBoundBy(Tracked.Truth, ResumeTime, &FTruthSample::Time);
+
+		FTruthSample AtResume;
+		const bool bHasTruthAtResume = SampleTruth(Tracked.Truth, ResumeTime, AtResume);
+		Tracked.ResumeReference.Reset();
+		if (bHasTruthAtResume && FirstLater < Tracked.Truth.Num())
+		{
+			Tracked.ResumeReference.Add(AtResume);
+			Tracked.ResumeReference.Append(Tracked.Truth.GetData() + FirstLater, Tracked.Truth.Num() - FirstLater);
+		}
+		Tracked.Truth.SetNum(FirstLater, EAllowShrinking::No);
+		if (bHasTruthAtResume && (Tracked.Truth.IsEmpty() || Tracked.Truth.Last().Time < ResumeTime)) Tracked.Truth.Add(AtResume);
+
+		// 状态在本帧开始前切换，物理从上一帧结束时恢复
+		Tracked.ResumePlaybackTime = ResumeTime;
+		Tracked.ResumeWorldTime = Now - DeltaTime;
+	}
+
+	const FTruthSample Current = CaptureTruth(Component, Now);
+	if (!Tracked.ResumeReference.IsEmpty())
+	{
+		// 恢复后的漂移：新轨迹与原轨迹在恢复后经过相同时间的状态比较
+		const float Elapsed = Now - Tracked.ResumeWorldTime;
+		FTruthSample Reference;
+		if (Elapsed > DriftWindowSeconds || !SampleTruth(Tracked.ResumeReference, Tracked.ResumePlaybackTime + Elapsed, Reference))
+		{
+			Tracked.ResumeReference.Empty();
+		}
+		else
+		{
+			AddError(Tracked.Passes[static_cast<int32>(ERewindFidelityPass::Resume)], Reference, Current.Location, Current.Rotation, Current.LinearVelocity);
+		}
+	}
+
+	if (Tracked.Truth.IsEmpty() || Tracked.Truth.Last().Time < Now) Tracked.Truth.Add(Current);
+}
+
+URewindFidelitySubsystem::FTruthSample URewindFidelitySubsystem::CaptureTruth(const URewindComponent& Component, float Time)
+{
+	const AActor* Owner = Component.GetOwner();
+	const UPrimitiveComponent* Root = Component.GetOwnerRootComponent();
+	const FTransform& Transform = Owner->GetActorTransform();
+
+	FTruthSample Sample;
+	Sample.Time = Time;
+	Sample.Location = Transform.GetLocation();
+	Sample.Rotation = Transform.GetRotation();
+	Sample.LinearVelocity = Root && Root->IsSimulatingPhysics() ? Root->GetPhysicsLinearVelocity() : Owner->GetVelocity();
+	return Sample;
+}
+
+bool URewindFidelitySubsystem::SampleTruth(const TArray<FTruthSample>& Samples, float Time, FTruthSample& OutSample)
+{
+	constexpr float TimeTolerance = 1.0e-3f;
+	if (Samples.IsEmpty() || Time < Samples[0].Time - TimeTolerance || Time > Samples.Last().Time + TimeTolerance) return false;
+
+	const int32 Next = Algo::UpperBoundBy(Samples, Time, &FTruthSample::Time);
+	if (Next == 0)
+	{
+		OutSample = Samples[0];
+		return true;
+	}
+	if (Next >= Samples.Num())
+	{
+		OutSample = Samples.Last();
+		return true;
+	}
+
+	const FTruthSample& Previous = Samples[Next - 1];
+	const FTruthSample& Later = Samples[Next];
+	const float Interval = Later.Time - Previous.Time;
+	const float Alpha = Interval > UE_KINDA_SMALL_NUMBER ? (Time - Previous.Time) / Interval : 1.0f;
+	OutSample.Time = Time;
+	OutSample.Location = FMath::Lerp(Previous.Location, Later.Location, Alpha);
+	OutSample.Rotation = FQuat::Slerp(Previous.Rotation, Later.Rotation, Alpha);
+	OutSample.LinearVelocity = FMath::Lerp(Previous.LinearVelocity, Later.LinearVelocity, Alpha);
+	return true;
+}
+
+void URewindFidelitySubsystem::AddError(FRewindFidelityErrorStats& Stats, const FTruthSample& Truth, const FVector& Location,
+	const FQuat& Rotation, const FVector& LinearVelocity)
+{
+	Stats.Add(
+		FVector::Dist(Truth.Location, Location),
+		FMath::RadiansToDegrees(Truth.Rotation.AngularDistance(Rotation)),
+		FVector::Dist(Truth.LinearVelocity, LinearVelocity));
+}
+
+void URewindFidelitySubsystem::GatherReport(TArray<FRewindFidelityReportEntry>& OutPerActor, FRewindFidelityReportEntry& OutTotal) const
+{
+	OutPerActor.Reset(TrackedComponents.Num());
+	OutTotal = FRewindFidelityReportEntry();
+	OutTotal.Name = TEXT("Total");
+	for (const TPair<TWeakObjectPtr<URewindComponent>, FTrackedComponent>& Pair : TrackedComponents)
+	{
+		FRewindFidelityReportEntry& Entry = OutPerActor.AddDefaulted_GetRef();
+		Entry.Name = Pair.Value.Name;
+		for (int32 Pass = 0; Pass < static_cast<int32>(ERewindFidelityPass::Num); ++Pass)
+		{
+			Entry.Passes[Pass] = Pair.Value.Passes[Pass];
+			OutTotal.Passes[Pass].Merge(Pair.Value.Passes[Pass]);
+		}
+	}
+
+	OutPerActor.Sort([](const FRewindFidelityReportEntry& A, const FRewindFidelityReportEntry& B)
+	{
+		constexpr int32 RewindPass = static_cast<int32>(ERewindFidelityPass::Rewind);
+		return A.Passes[RewindPass].PositionMax > B.Passes[RewindPass].PositionMax;
+	});
+}
+
+void URewindFidelitySubsystem::DumpReport(int32 MaxEntries) const
+{
+	TArray<FRewindFidelityReportEntry> PerActor;
+	FRewindFidelityReportEntry Total;
+	GatherReport(PerActor, Total);
+
+	auto LogEntry = [](const FRewindFidelityReportEntry& Entry)
+	{
+		for (int32 Pass = 0; Pass < static_cast<int32>(ERewindFidelityPass::Num); ++Pass)
+		{
+			const FRewindFidelityErrorStats& Stats = Entry.Passes[Pass];
+			if (Stats.NumSamples == 0) continue;
+			UE_LOG(LogRewind, Display, TEXT("%-32s %-12s n %6d  pos mean %7.2f rms %7.2f max %7.2f cm  rot mean %6.2f max %6.2f deg  vel mean %7.1f max %7.1f cm/s"),
+				*Entry.Name, RewindFidelity::PassNames[Pass], Stats.NumSamples,
+				Stats.GetPositionMean(), Stats.GetPositionRms(), Stats.PositionMax,
+				Stats.GetRotationMean(), Stats.RotationMax, Stats.GetVelocityMean(), Stats.VelocityMax);
+		}
+	};
+
+	UE_LOG(LogRewind, Display, TEXT("Rewind fidelity: %d actors"), PerActor.Num());
+	LogEntry(Total);
+	for (int32 Index = 0; Index < FMath::Min(PerActor.Num(), MaxEntries); ++Index) LogEntry(PerActor[Index]);
+}
+
+bool URewindFidelitySubsystem::WriteCsv(const FString& Path) const
+{
+	TArray<FRewindFidelityReportEntry> PerActor;
+	FRewindFidelityReportEntry Total;
+	GatherReport(PerActor, Total);
+	PerActor.Insert(MoveTemp(Total), 0);
+
+	FString Csv = TEXT("Actor,Pass,Samples,PosMeanCm,PosRmsCm,PosMaxCm,RotMeanDeg,RotMaxDeg,VelMeanCmS,VelMaxCmS\n");
+	for (const FRewindFidelityReportEntry& Entry : PerActor)
+	{
+		for (int32 Pass = 0; Pass < static_cast<int32>(ERewindFidelityPass::Num); ++Pass)
+		{
+			const FRewindFidelityErrorStats& Stats = Entry.Passes[Pass];
+			Csv += FString::Printf(TEXT("%s,%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n"),
+				*Entry.Name, RewindFidelity::PassNames[Pass], Stats.NumSamples,
+				Stats.GetPositionMean(), Stats.GetPositionRms(), Stats.PositionMax,
+				Stats.GetRotationMean(), Stats.RotationMax, Stats.GetVelocityMean(), Stats.VelocityMax);
+		}
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *Path))
+	{
+		UE_LOG(LogRewind, Error, TEXT("Failed to write rewind fidelity report to %s"), *Path);
+		return false;
+	}
+	UE_LOG(LogRewind, Display, TEXT("Rewind fidelity report written to %s"), *Path);
+	return true;
+}
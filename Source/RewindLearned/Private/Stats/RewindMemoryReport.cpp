@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Stats/RewindMemoryReport.h"
+
+#include "RewindLearned.h"
+#include "UObject/UObjectIterator.h"
+
+namespace RewindMemoryReport
+{
+	static FAutoConsoleCommandWithWorldAndArgs DumpMemoryCommand(
+		TEXT("Rewind.DumpMemory"),
+		TEXT("Rewind.DumpMemory [MaxEntries] - Log rewind history memory per actor and per class, sorted by reserved bytes"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const int32 MaxEntries = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 20;
+			FRewindMemoryReport::Gather(World).Dump(MaxEntries > 0 ? MaxEntries : MAX_int32);
+		}));
+
+	static void Accumulate(FRewindMemoryReportEntry& Entry, const FRewindMemoryUsage& Usage)
+	{
+		++Entry.NumComponents;
+		Entry.Usage.BytesReserved += Usage.BytesReserved;
+		Entry.Usage.BytesUsed += Usage.BytesUsed;
+		Entry.Usage.NumSamples += Usage.NumSamples;
+		Entry.Usage.HistorySeconds = FMath::Max(Entry.Usage.HistorySeconds, Usage.HistorySeconds);
+	}
+
+	static void SortBySize(TArray<FRewindMemoryReportEntry>& Entries)
+	{
+		Entries.Sort([](const FRewindMemoryReportEntry& A, const FRewindMemoryReportEntry& B)
+		{
+			return A.Usage.BytesReserved > B.Usage.BytesReserved;
+		});
+	}
+}
+
+FRewindMemoryReport FRewindMemoryReport::Gather(const UWorld* World)
+{
+	FRewindMemoryReport Report;
+	if (!World) return Report;
+
+	TMap<const UClass*, int32> ClassEntryIndices;
+	for (TObjectIterator<URewindComponent> It; It; ++It)
+	{
+		const URewindComponent* RewindComponent = *It;
+		const AActor* Owner = RewindComponent->GetOwner();
+		if (!Owner || RewindComponent->GetWorld() != World) continue;
+
+		FRewindMemoryUsage Usage;
+		RewindComponent->GetMemoryUsage(Usage);
+
+		FRewindMemoryReportEntry& ActorEntry = Report.PerActor.AddDefaulted_GetRef();
+		ActorEntry.Name = Owner->GetName();
+		RewindMemoryReport::Accumulate(ActorEntry, Usage);
+
+		const int32* ClassEntryIndex = ClassEntryIndices.Find(Owner->GetClass());
+		if (!ClassEntryIndex)
+		{
+			const int32 NewIndex = Report.PerClass.AddDefaulted();
+			Report.PerClass[NewIndex].Name = Owner->GetClass()->GetName();
+			ClassEntryIndex = &ClassEntryIndices.Add(Owner->GetClass(), NewIndex);
+		}
+		RewindMemoryReport::Accumulate(Report.PerClass[*ClassEntryIndex], Usage);
+
+		Report.Total.BytesReserved += Usage.BytesReserved;
+		Report.Total.BytesUsed += Usage.BytesUsed;
+		Report.Total.NumSamples += Usage.NumSamples;
+		Report.Total.HistorySeconds = FMath::Max(Report.Total.HistorySeconds, Usage.HistorySeconds);
+		++Report.NumComponents;
+	}
+
+	RewindMemoryReport::SortBySize(Report.PerActor);
+	RewindMemoryReport::SortBySize(Report.PerClass);
+	return Report;
+}
+
+void FRewindMemoryReport::Dump(int32 MaxEntries) const
+{
+	constexpr double BytesToKilobytes = 1.0 / 1024.0;
+	auto DumpEntries = [MaxEntries](const TCHAR* Title, const TArray<FRewindMemoryReportEntry>& Entries)
+	{
+		UE_LOG(LogRewind, Display, TEXT("---- %s ----"), Title);
+		UE_LOG(LogRewind, Display, TEXT("%-48s %6s %12s %12s %9s %9s"), TEXT("Name"), TEXT("Count"), TEXT("ReservedKB"), TEXT("UsedKB"), TEXT("Samples"), TEXT("Seconds"));
+		for (int32 Index = 0; Index < FMath::Min(Entries.Num(), MaxEntries); ++Index)
+		{
+			const FRewindMemoryReportEntry& Entry = Entries[Index];
+			UE_LOG(LogRewind, Display, TEXT("%-48s %6d %12.1f %12.1f %9d %9.2f"), *Entry.Name, Entry.NumComponents,
+				Entry.Usage.BytesReserved * BytesToKilobytes, Entry.Usage.BytesUsed * BytesToKilobytes,
+				Entry.Usage.NumSamples, Entry.Usage.HistorySeconds);
+		}
+		if (Entries.Num() > MaxEntries) UE_LOG(LogRewind, Display, TEXT("... %d more"), Entries.Num() - MaxEntries);
+	};
+
+	DumpEntries(TEXT("Rewind memory per class"), PerClass);
+	DumpEntries(TEXT("Rewind memory per actor"), PerActor);
+	UE_LOG(LogRewind, Display, TEXT("Total: %d components, %.1f KB reserved, %.1f KB used, %d samples"),
+		NumComponents, Total.BytesReserved * BytesToKilobytes, Total.BytesUsed * BytesToKilobytes, Total.NumSamples);
+}
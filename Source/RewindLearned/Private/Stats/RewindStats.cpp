@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Stats/RewindStats.h"
+
+#include "Misc/CoreDelegates.h"
+
+DEFINE_STAT(STAT_RewindRecord);
+DEFINE_STAT(STAT_RewindSeek);
+DEFINE_STAT(STAT_RewindBlend);
+DEFINE_STAT(STAT_RewindApply);
+DEFINE_STAT(STAT_RewindPhysicsTransition);
+DEFINE_STAT(STAT_RewindRollbackSave);
+DEFINE_STAT(STAT_RewindRollbackLoad);
+DEFINE_STAT(STAT_RewindRollbackResimulate);
+DEFINE_STAT(STAT_RewindEventSeek);
+
+DEFINE_STAT(STAT_RewindRecordingComponents);
+DEFINE_STAT(STAT_RewindRewindingComponents);
+DEFINE_STAT(STAT_RewindFastForwardingComponents);
+DEFINE_STAT(STAT_RewindScrubbingComponents);
+DEFINE_STAT(STAT_RewindSamplesRecorded);
+DEFINE_STAT(STAT_RewindSamplesSkipped);
+
+CSV_DEFINE_CATEGORY_MODULE(REWINDLEARNED_API, Rewind, true);
+
+LLM_DEFINE_TAG(Rewind);
+
+#if REWIND_STATS_ENABLED
+UE_TRACE_CHANNEL_DEFINE(RewindChannel);
+
+// 每帧一条的汇总事件
+UE_TRACE_EVENT_BEGIN(Rewind, FrameStats)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, RecordingComponents)
+	UE_TRACE_EVENT_FIELD(uint32, RewindingComponents)
+	UE_TRACE_EVENT_FIELD(uint32, FastForwardingComponents)
+	UE_TRACE_EVENT_FIELD(uint32, ScrubbingComponents)
+	UE_TRACE_EVENT_FIELD(uint32, SamplesRecorded)
+	UE_TRACE_EVENT_FIELD(uint32, SamplesSkipped)
+UE_TRACE_EVENT_END()
+#endif
+
+uint32 FRewindFrameStats::ActiveComponents[static_cast<int32>(ERewindStatsState::Num)] = {};
+uint32 FRewindFrameStats::SamplesRecorded = 0;
+uint32 FRewindFrameStats::SamplesSkipped = 0;
+FDelegateHandle FRewindFrameStats::EndFrameHandle;
+
+void FRewindFrameStats::Startup()
+{
+#if REWIND_STATS_ENABLED
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddStatic(&FRewindFrameStats::OnEndFrame);
+#endif
+}
+
+void FRewindFrameStats::Shutdown()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+	EndFrameHandle.Reset();
+}
+
+void FRewindFrameStats::AddActiveComponent(ERewindStatsState State)
+{
+	check(IsInGameThread());
+	++ActiveComponents[static_cast<int32>(State)];
+	switch (State)
+	{
+	case ERewindStatsState::Recording: INC_DWORD_STAT(STAT_RewindRecordingComponents); break;
+	case ERewindStatsState::Rewinding: INC_DWORD_STAT(STAT_RewindRewindingComponents); break;
+	case ERewindStatsState::FastForwarding: INC_DWORD_STAT(STAT_RewindFastForwardingComponents); break;
+	case ERewindStatsState::Scrubbing: INC_DWORD_STAT(STAT_RewindScrubbingComponents); break;
+	default: checkNoEntry();
+	}
+}
+
+void FRewindFrameStats::AddSampleRecorded()
+{
+	check(IsInGameThread());
+	++SamplesRecorded;
+	INC_DWORD_STAT(STAT_RewindSamplesRecorded);
+}
+
+void FRewindFrameStats::AddSampleSkipped()
+{
+	check(IsInGameThread());
+	++SamplesSkipped;
+	INC_DWORD_STAT(STAT_RewindSamplesSkipped);
+}
+
+void FRewindFrameStats::OnEndFrame()
+{
+	const uint32 Recording = ActiveComponents[static_cast<int32>(ERewindStatsState::Recording)];
+	const uint32 Rewinding = ActiveComponents[static_cast<int32>(ERewindStatsState::Rewinding)];
+	const uint32 FastForwarding = ActiveComponents[static_cast<int32>(ERewindStatsState::FastForwarding)];
+	const uint32 Scrubbing = ActiveComponents[static_cast<int32>(ERewindStatsState::Scrubbing)];
+
+	CSV_CUSTOM_STAT(Rewind, RecordingComponents, static_cast<int32>(Recording), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Rewind, RewindingComponents, static_cast<int32>(Rewinding), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Rewind, FastForwardingComponents, static_cast<int32>(FastForwarding), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Rewind, ScrubbingComponents, static_cast<int32>(Scrubbing), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Rewind, SamplesRecorded, static_cast<int32>(SamplesRecorded), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(Rewind, SamplesSkipped, static_cast<int32>(SamplesSkipped), ECsvCustomStatOp::Set);
+
+#if REWIND_STATS_ENABLED
+	// 没有任何回溯组件工作的帧不发送事件
+	if (Recording + Rewinding + FastForwarding + Scrubbing > 0)
+	{
+		UE_TRACE_LOG(Rewind, FrameStats, RewindChannel)
+			<< FrameStats.Cycle(FPlatformTime::Cycles64())
+			<< FrameStats.RecordingComponents(Recording)
+			<< FrameStats.RewindingComponents(Rewinding)
+			<< FrameStats.FastForwardingComponents(FastForwarding)
+			<< FrameStats.ScrubbingComponents(Scrubbing)
+			<< FrameStats.SamplesRecorded(SamplesRecorded)
+			<< FrameStats.SamplesSkipped(SamplesSkipped);
+	}
+#endif
+
+	FMemory::Memzero(ActiveComponents);
+	SamplesRecorded = 0;
+	SamplesSkipped = 0;
+}
@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Streaming/RewindHistoryColdStorage.h"
+
+#include "Async/Async.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Stats/RewindStats.h"
+
+namespace RewindColdStorage
+{
+	// 冷历史的格式版本，修改序列化布局时递增
+	constexpr uint32 FormatVersion = 2;
+
+	// 单精度存储：冷历史只用于回放，不需要双精度
+	void SerializeSnapshot(FArchive& Ar, FTransformAndVelocitySnapshot& Snapshot)
+	{
+		FVector3f Location(Snapshot.Transform.GetLocation());
+		FQuat4f Rotation(Snapshot.Transform.GetRotation());
+		FVector3f Scale(Snapshot.Transform.GetScale3D());
+		FVector3f LinearVelocity(Snapshot.LinearVelocity);
+		FVector3f AngularVelocityInRadians(Snapshot.AngularVelocityInRadians);
+		uint8 bIsSleeping = Snapshot.bIsSleeping;
+		Ar << Snapshot.TimeSinceLastSnapshot << Snapshot.RecordedTime << Location << Rotation << Scale << LinearVelocity << AngularVelocityInRadians << bIsSleeping;
+		if (Ar.IsLoading())
+		{
+			Snapshot.bIsSleeping = bIsSleeping != 0;
+			Snapshot.Transform = FTransform(FQuat(Rotation), FVector(Location), FVector(Scale));
+			Snapshot.LinearVelocity = FVector(LinearVelocity);
+			Snapshot.AngularVelocityInRadians = FVector(AngularVelocityInRadians);
+		}
+	}
+
+	void SerializeSnapshot(FArchive& Ar, FMovementVelocityAndModeSnapshot& Snapshot)
+	{
+		FVector3f MovementVelocity(Snapshot.MovementVelocity);
+		uint8 MovementMode = Snapshot.MovementMode;
+		Ar << Snapshot.TimeSinceLastSnapshot << MovementVelocity << MovementMode;
+		if (Ar.IsLoading())
+		{
+			Snapshot.MovementVelocity = FVector(MovementVelocity);
+			Snapshot.MovementMode = static_cast<EMovementMode>(MovementMode);
+		}
+	}
+
+	template <typename SnapshotType>
+	void SerializeSnapshots(FArchive& Ar, TArray<SnapshotType>& Snapshots)
+	{
+		int32 NumSnapshots = Snapshots.Num();
+		Ar << NumSnapshots;
+		if (Ar.IsLoading())
+		{
+			if (NumSnapshots < 0 || Ar.IsError())
+			{
+				Ar.SetError();
+				return;
+			}
+			Snapshots.SetNum(NumSnapshots);
+		}
+		for (SnapshotType& Snapshot : Snapshots) SerializeSnapshot(Ar, Snapshot);
+	}
+}
+
+void URewindHistoryColdStorage::Deinitialize()
+{
+	// 等待线程池中的压缩结束，任务只持有自己的数据，不会访问子系统
+	for (TPair<FString, FEntry>& Pair : Entries)
+	{
+		if (Pair.Value.PendingEncode.IsValid()) Pair.Value.PendingEncode.Wait();
+	}
+	Entries.Reset();
+
+	Super::Deinitialize();
+}
+
+FString URewindHistoryColdStorage::GetActorKey(const AActor* Actor)
+{
+	// World Partition单元中的Actor每次加载的路径名相同；运行时生成的Actor重新生成后是另一个对象，没有可以对应的历史
+	if (!Actor || !Actor->IsNetStartupActor()) return FString();
+	return Actor->GetPathName();
+}
+
+void URewindHistoryColdStorage::Store(const FString& ActorKey, FRewindColdHistory&& History, float HorizonSeconds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindHistoryColdStorage::Store);
+	RemoveExpiredEntries();
+	if (ActorKey.IsEmpty() || History.TransformSnapshots.IsEmpty()) return;
+
+	FEntry& Entry = Entries.FindOrAdd(ActorKey);
+	Entry.ExpireTime = GetWorld()->GetTimeSeconds() + HorizonSeconds;
+	Entry.Encoded = FEncodedHistory();
+	Entry.PendingEncode = Async(EAsyncExecution::ThreadPool, [History = MoveTemp(History)]() mutable
+	{
+		return Encode(History);
+	});
+}
+
+bool URewindHistoryColdStorage::Contains(const FString& ActorKey) const
+{
+	const FEntry* Entry = Entries.Find(ActorKey);
+	return Entry && Entry->ExpireTime > GetWorld()->GetTimeSeconds();
+}
+
+bool URewindHistoryColdStorage::Retrieve(const FString& ActorKey, FRewindColdHistory& OutHistory)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindHistoryColdStorage::Retrieve);
+	FEntry Entry;
+	if (!Entries.RemoveAndCopyValue(ActorKey, Entry) || Entry.ExpireTime <= GetWorld()->GetTimeSeconds()) return false;
+
+	if (Entry.PendingEncode.IsValid()) Entry.Encoded = Entry.PendingEncode.Consume();
+	return Decode(Entry.Encoded, OutHistory);
+}
+
+SIZE_T URewindHistoryColdStorage::GetAllocatedSize() const
+{
+	SIZE_T Size = Entries.GetAllocatedSize();
+	for (const TPair<FString, FEntry>& Pair : Entries) Size += Pair.Key.GetAllocatedSize() + Pair.Value.Encoded.CompressedData.GetAllocatedSize();
+	return Size;
+}
+
+void URewindHistoryColdStorage::RemoveExpiredEntries()
+{
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (auto It = Entries.CreateIterator(); It; ++It)
+	{
+		FEntry& Entry = It.Value();
+		if (Entry.PendingEncode.IsValid() && Entry.PendingEncode.IsReady()) Entry.Encoded = Entry.PendingEncode.Consume();
+
+		// 还在压缩的冷历史等压缩完成后再删除
+		if (Entry.ExpireTime <= Now && !Entry.PendingEncode.IsValid()) It.RemoveCurrent();
+	}
+}
+
+URewindHistoryColdStorage::FEncodedHistory URewindHistoryColdStorage::Encode(FRewindColdHistory& History)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindHistoryColdStorage::Encode);
+	LLM_SCOPE_BYTAG(Rewind);
+
+	TArray<uint8> RawData;
+	FMemoryWriter Writer(RawData);
+	uint32 FormatVersion = RewindColdStorage::FormatVersion;
+	int32 NumSimplifiedSnapshots = History.NumSimplifiedSnapshots;
+	Writer << FormatVersion << NumSimplifiedSnapshots;
+	RewindColdStorage::SerializeSnapshots(Writer, History.TransformSnapshots);
+	RewindColdStorage::SerializeSnapshots(Writer, History.MovementSnapshots);
+
+	FEncodedHistory Encoded;
+	Encoded.UncompressedSize = RawData.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, RawData.Num());
+	Encoded.CompressedData.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Encoded.CompressedData.GetData(), CompressedSize, RawData.GetData(), RawData.Num()))
+	{
+		// 压缩失败时保存原始数据
+		Encoded.CompressedData = MoveTemp(RawData);
+		Encoded.UncompressedSize = INDEX_NONE;
+		return Encoded;
+	}
+	Encoded.CompressedData.SetNum(CompressedSize);
+	return Encoded;
+}
+
+bool URewindHistoryColdStorage::Decode(const FEncodedHistory& Encoded, FRewindColdHistory& OutHistory)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(URewindHistoryColdStorage::Decode);
+	TArray<uint8> RawData;
+	if (Encoded.UncompressedSize == INDEX_NONE)
+	{
+		RawData = Encoded.CompressedData;
+	}
+	else
+	{
+		RawData.SetNumUninitialized(Encoded.UncompressedSize);
+		if (!FCompression::UncompressMemory(NAME_Zlib, RawData.GetData(), RawData.Num(), Encoded.CompressedData.GetData(), Encoded.CompressedData.Num())) return false;
+	}
+
+	FMemoryReader Reader(RawData);
+	uint32 FormatVersion = 0;
+	Reader << FormatVersion << OutHistory.NumSimplifiedSnapshots;
+	if (FormatVersion != RewindColdStorage::FormatVersion) return false;
+	RewindColdStorage::SerializeSnapshots(Reader, OutHistory.TransformSnapshots);
+	RewindColdStorage::SerializeSnapshots(Reader, OutHistory.MovementSnapshots);
+	return !Reader.IsError();
+}
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Component/RewindHistorySimplifier.h"
+
+namespace RewindHistorySimplifierTest
+{
+	static constexpr int32 NumSnapshots = 240;
+	static constexpr float Interval = 1.0f / 30.0f;
+
+	// 误差比较时允许的浮点余量
+	static constexpr float PositionSlack = 1.e-3f;
+	static constexpr float RotationSlackRadians = 1.e-4f;
+
+	// 沿X匀速前进，Y方向按正弦摆动并绕Z轴来回转动：直线段可以删除，弯曲处必须保留
+	static FRewindHistorySimplificationInput MakeInput(ERewindInterpolationMode Mode)
+	{
+		FRewindHistorySimplificationInput Input;
+		Input.InterpolationMode = Mode;
+		Input.PositionTolerance = 1.0f;
+		Input.RotationToleranceRadians = FMath::DegreesToRadians(1.0f);
+
+		for (int32 Index = 0; Index < NumSnapshots; ++Index)
+		{
+			const float Time = Index * Interval;
+			const float Wave = Index < NumSnapshots / 2 ? 0.0f : FMath::Sin(Time * 3.0f);
+
+			FTransformAndVelocitySnapshot& Snapshot = Input.TransformSnapshots.AddDefaulted_GetRef();
+			Snapshot.TimeSinceLastSnapshot = Index == 0 ? 0.0f : Interval;
+			Snapshot.RecordedTime = 100.0f + Time;
+			Snapshot.Transform = FTransform(FQuat(FVector::UpVector, Wave * 0.5f), FVector(Time * 200.0f, Wave * 50.0f, 0.0f));
+			Snapshot.LinearVelocity = FVector(200.0f, Index < NumSnapshots / 2 ? 0.0f : FMath::Cos(Time * 3.0f) * 150.0f, 0.0f);
+			Snapshot.AngularVelocityInRadians = FVector(0.0f, 0.0f, Index < NumSnapshots / 2 ? 0.0f : FMath::Cos(Time * 3.0f) * 1.5f);
+		}
+		return Input;
+	}
+
+	// 每个被删除的快照都能由前后保留的快照在容差内重建
+	static void TestReconstructionBounds(FAutomationTestBase* Test, const FRewindHistorySimplificationInput& Input, const TBitArray<>& Removable)
+	{
+		const int32 Num = Input.TransformSnapshots.Num();
+		Test->TestFalse(TEXT("First snapshot is kept"), Removable[0]);
+		Test->TestFalse(TEXT("Last snapshot is kept"), Removable[Num - 1]);
+
+		TArray<float> Timeline;
+		Timeline.Add(0.0f);
+		for (int32 Index = 1; Index < Num; ++Index) Timeline.Add(Timeline.Last() + Input.TransformSnapshots[Index].TimeSinceLastSnapshot);
+
+		int32 PreviousKept = 0;
+		for (int32 NextKept = 1; NextKept < Num; ++NextKept)
+		{
+			if (Removable[NextKept]) continue;
+
+			FTransformAndVelocitySnapshot LastSnapshot = Input.TransformSnapshots[NextKept];
+			LastSnapshot.TimeSinceLastSnapshot = Timeline[NextKept] - Timeline[PreviousKept];
+			for (int32 Index = PreviousKept + 1; Index < NextKept; ++Index)
+			{
+				const float Alpha = (Timeline[Index] - Timeline[PreviousKept]) / LastSnapshot.TimeSinceLastSnapshot;
+				const FTransform Rebuilt = URewindComponent::BlendSnapshots(Input.TransformSnapshots[PreviousKept], LastSnapshot, Alpha, Input.InterpolationMode).Transform;
+				const FTransform& Original = Input.TransformSnapshots[Index].Transform;
+
+				Test->TestTrue(FString::Printf(TEXT("Snapshot %d position within tolerance"), Index),
+					FVector::Dist(Rebuilt.GetLocation(), Original.GetLocation()) <= Input.PositionTolerance + PositionSlack);
+				Test->TestTrue(FString::Printf(TEXT("Snapshot %d rotation within tolerance"), Index),
+					Rebuilt.GetRotation().AngularDistance(Original.GetRotation()) <= Input.RotationToleranceRadians + RotationSlackRadians);
+			}
+			PreviousKept = NextKept;
+		}
+	}
+
+	// 被删除的快照与前后保留的快照处于同一离散状态，状态切换点都保留了下来
+	static void TestDiscreteStatesPreserved(FAutomationTestBase* Test, const FRewindHistorySimplificationInput& Input, const TBitArray<>& Removable)
+	{
+		int32 PreviousKept = 0;
+		for (int32 NextKept = 1; NextKept < Input.TransformSnapshots.Num(); ++NextKept)
+		{
+			if (Removable[NextKept]) continue;
+			for (int32 Index = PreviousKept + 1; Index < NextKept; ++Index)
+			{
+				const bool bIsSleeping = Input.TransformSnapshots[Index].bIsSleeping;
+				Test->TestTrue(FString::Printf(TEXT("Removed snapshot %d shares the sleep state of its kept neighbours"), Index),
+					bIsSleeping == Input.TransformSnapshots[PreviousKept].bIsSleeping && bIsSleeping == Input.TransformSnapshots[NextKept].bIsSleeping);
+
+				const TEnumAsByte<EMovementMode> Mode = Input.MovementSnapshots[Index].MovementMode;
+				Test->TestTrue(FString::Printf(TEXT("Removed snapshot %d shares the movement mode of its kept neighbours"), Index),
+					Mode == Input.MovementSnapshots[PreviousKept].MovementMode && Mode == Input.MovementSnapshots[NextKept].MovementMode);
+			}
+			PreviousKept = NextKept;
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRewindHistorySimplifierBoundsTest, "RewindLearned.History.SimplifierBounds",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRewindHistorySimplifierBoundsTest::RunTest(const FString& Parameters)
+{
+	using namespace RewindHistorySimplifierTest;
+
+	// 容差：两种插值模式下删除的快照都能在容差内重建，直线段被化简，弯曲处有保留
+	for (const ERewindInterpolationMode Mode : { ERewindInterpolationMode::Linear, ERewindInterpolationMode::Hermite })
+	{
+		const FRewindHistorySimplificationInput Input = MakeInput(Mode);
+		const TBitArray<> Removable = FRewindHistorySimplifier::FindRemovableSnapshots(Input);
+		TestReconstructionBounds(this, Input, Removable);
+
+		const int32 NumRemoved = Removable.CountSetBits();
+		TestTrue(TEXT("Straight segment is simplified"), NumRemoved >= NumSnapshots / 3);
+		TestTrue(TEXT("Curved segment keeps snapshots"), NumRemoved < NumSnapshots - 2);
+	}
+
+	// 离散状态：静止的刚体在中间入睡后又被唤醒，角色在同一段时间内起跳和落地；位置不变，只有状态切换
+	{
+		FRewindHistorySimplificationInput Input = MakeInput(ERewindInterpolationMode::Linear);
+		for (int32 Index = 0; Index < NumSnapshots; ++Index)
+		{
+			FTransformAndVelocitySnapshot& Snapshot = Input.TransformSnapshots[Index];
+			Snapshot.Transform = FTransform(FVector(0.0f, 0.0f, 100.0f));
+			Snapshot.LinearVelocity = FVector::ZeroVector;
+			Snapshot.AngularVelocityInRadians = FVector::ZeroVector;
+			Snapshot.bIsSleeping = Index >= 60 && Index < 150;
+
+			FMovementVelocityAndModeSnapshot& Movement = Input.MovementSnapshots.AddDefaulted_GetRef();
+			Movement.TimeSinceLastSnapshot = Snapshot.TimeSinceLastSnapshot;
+			Movement.MovementMode = Index >= 100 && Index < 200 ? MOVE_Falling : MOVE_Walking;
+		}
+
+		const TBitArray<> Removable = FRewindHistorySimplifier::FindRemovableSnapshots(Input);
+		TestDiscreteStatesPreserved(this, Input, Removable);
+		TestTrue(TEXT("Still snapshots between transitions are simplified"), Removable.CountSetBits() > 0);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Component/RewindComponent.h"
+
+namespace RewindInterpolationTest
+{
+	static constexpr float Interval = 1.0f / 15.0f;
+	static constexpr int32 NumSteps = 16;
+
+	// 四元数的符号不影响旋转
+	static constexpr double RotationTolerance = 1.e-5;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRewindHermiteConstantAngularVelocityTest, "RewindLearned.Interpolation.HermiteConstantAngularVelocityMatchesSlerp",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRewindHermiteConstantAngularVelocityTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * 角速度恒定的相邻快照：Hermite模式的旋转必须与两端的Slerp一致，正序（快进）和倒序（回溯）混合都一样；
+	 * 覆盖小角度、接近半圈和绕斜轴旋转的情况
+	 */
+	using namespace RewindInterpolationTest;
+
+	const FQuat StartRotations[] = { FQuat::Identity, FQuat(FRotator(30.0f, -70.0f, 15.0f)) };
+	const FVector AngularVelocities[] = { FVector(0.0, 0.0, 2.0), FVector(1.0, -2.0, 0.5), FVector(0.0, 40.0, 0.0) };
+
+	for (const FQuat& StartRotation : StartRotations)
+	{
+		for (const FVector& AngularVelocity : AngularVelocities)
+		{
+			FTransformAndVelocitySnapshot A;
+			A.RecordedTime = 10.0f;
+			A.Transform = FTransform(StartRotation);
+			A.AngularVelocityInRadians = AngularVelocity;
+
+			FTransformAndVelocitySnapshot B = A;
+			B.RecordedTime = A.RecordedTime + Interval;
+			B.TimeSinceLastSnapshot = Interval;
+			B.Transform = FTransform(FQuat::MakeFromRotationVector(AngularVelocity * Interval) * StartRotation);
+
+			for (int32 Step = 0; Step <= NumSteps; ++Step)
+			{
+				const float Alpha = static_cast<float>(Step) / NumSteps;
+				const FQuat Expected = FQuat::Slerp(A.Transform.GetRotation(), B.Transform.GetRotation(), Alpha);
+				const FQuat Forward = URewindComponent::BlendSnapshots(A, B, Alpha, ERewindInterpolationMode::Hermite).Transform.GetRotation();
+				const FQuat Backward = URewindComponent::BlendSnapshots(B, A, 1.0f - Alpha, ERewindInterpolationMode::Hermite).Transform.GetRotation();
+
+				const FString Context = FString::Printf(TEXT("w=%s alpha=%.3f"), *AngularVelocity.ToString(), Alpha);
+				TestTrue(FString::Printf(TEXT("Forward blend matches Slerp (%s)"), *Context), Forward.Equals(Expected, RotationTolerance) || Forward.Equals(-Expected, RotationTolerance));
+				TestTrue(FString::Printf(TEXT("Backward blend matches Slerp (%s)"), *Context), Backward.Equals(Expected, RotationTolerance) || Backward.Equals(-Expected, RotationTolerance));
+			}
+		}
+	}
+	return true;
+}
+
+#endif
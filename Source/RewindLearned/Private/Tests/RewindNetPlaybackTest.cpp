@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS && WITH_EDITOR
+
+#include "Algo/AllOf.h"
+#include "Component/RewindComponent.h"
+#include "Editor.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameMode/RewindGameMode.h"
+#include "GameMode/RewindGameState.h"
+#include "Settings/LevelEditorPlaySettings.h"
+#include "Tests/AutomationCommon.h"
+#include "Tests/AutomationEditorCommon.h"
+
+namespace RewindNetPlaybackTest
+{
+	static const TCHAR* MapPath = TEXT("/Game/FirstPerson/Maps/FirstPersonMap");
+
+	// 等待客户端连接的最长时间
+	static constexpr double ConnectTimeoutSeconds = 30.0;
+
+	// 偏移量化精度为0.1cm，锚点以整数精度复制
+	static constexpr double LocationTolerance = 2.0;
+	static constexpr double RotationToleranceDegrees = 1.0;
+
+	static void GetPIEWorlds(UWorld*& OutServer, TArray<UWorld*>& OutClients)
+	{
+		OutServer = nullptr;
+		OutClients.Reset();
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			UWorld* World = Context.World();
+			if (Context.WorldType != EWorldType::PIE || !World) continue;
+			if (World->GetNetMode() == NM_ListenServer) OutServer = World;
+			else if (World->GetNetMode() == NM_Client) OutClients.Add(World);
+		}
+	}
+
+	static bool IsClientReady(UWorld* Client)
+	{
+		const APlayerController* PlayerController = Client->GetFirstPlayerController();
+		return Client->GetGameState<ARewindGameState>() && PlayerController && PlayerController->GetPawn();
+	}
+
+	static void ExecuteOnServer(FAutomationTestBase* Test, ERewindTimeCommand Command)
+	{
+		UWorld* Server = nullptr;
+		TArray<UWorld*> Clients;
+		GetPIEWorlds(Server, Clients);
+		ARewindGameMode* GameMode = Server ? Server->GetAuthGameMode<ARewindGameMode>() : nullptr;
+		if (!GameMode)
+		{
+			Test->AddError(TEXT("The listen server is not running ARewindGameMode"));
+			return;
+		}
+		GameMode->ExecuteTimeCommand(Command);
+	}
+
+	// 客户端上跟随服务器回放的Actor与服务器的回放位置一致，本地控制的Pawn不跟随
+	static void VerifyClients(FAutomationTestBase* Test)
+	{
+		UWorld* Server = nullptr;
+		TArray<UWorld*> Clients;
+		GetPIEWorlds(Server, Clients);
+		if (!Server || Clients.Num() == 0)
+		{
+			Test->AddError(TEXT("PIE session ended before verification"));
+			return;
+		}
+
+		for (UWorld* Client : Clients)
+		{
+			const APlayerController* PlayerController = Client->GetFirstPlayerController();
+			const APawn* LocalPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+			if (const URewindComponent* LocalComponent = LocalPawn ? LocalPawn->FindComponentByClass<URewindComponent>() : nullptr)
+			{
+				Test->TestFalse(TEXT("Locally controlled pawn follows server playback"), LocalComponent->IsNetPlaybackFollower());
+			}
+
+			int32 NumCompared = 0;
+			for (TActorIterator<AActor> It(Server); It; ++It)
+			{
+				const AActor* ServerActor = *It;
+				if (!ServerActor->GetIsReplicated() || !ServerActor->FindComponentByClass<URewindComponent>()) continue;
+
+				// 关卡中放置的Actor在两端同名，动态生成的Actor（Pawn等）跳过
+				const AActor* ClientActor = FindObject<AActor>(Client->PersistentLevel, *ServerActor->GetName());
+				const URewindComponent* ClientComponent = ClientActor ? ClientActor->FindComponentByClass<URewindComponent>() : nullptr;
+				if (!ClientComponent || !ClientComponent->IsNetPlaybackFollower()) continue;
+
+				++NumCompared;
+				const FString Name = ServerActor->GetName();
+				Test->TestTrue(FString::Printf(TEXT("%s location matches server playback"), *Name),
+					ServerActor->GetActorLocation().Equals(ClientActor->GetActorLocation(), LocationTolerance));
+				Test->TestTrue(FString::Printf(TEXT("%s rotation matches server playback"), *Name),
+					ServerActor->GetActorQuat().AngularDistance(ClientActor->GetActorQuat()) <= FMath::DegreesToRadians(RotationToleranceDegrees));
+			}
+			Test->TestTrue(TEXT("Client has replicated rewindable actors following server playback"), NumCompared > 0);
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRewindNetPlaybackPIETest, "RewindLearned.Net.PlaybackStreamsToClients",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ProductFilter)
+
+bool FRewindNetPlaybackPIETest::RunTest(const FString& Parameters)
+{
+	/*
+	 * 同一进程中的监听服务器 + 客户端：记录一段时间后在服务器上时停并回溯，
+	 * 停止回溯（仍在时停中）后比较客户端上跟随回放的Actor与服务器的位置
+	 */
+	using namespace RewindNetPlaybackTest;
+
+	if (!FAutomationEditorCommonUtils::LoadMap(MapPath))
+	{
+		AddError(FString::Printf(TEXT("Failed to load %s"), MapPath));
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([]()
+	{
+		ULevelEditorPlaySettings* PlaySettings = NewObject<ULevelEditorPlaySettings>();
+		PlaySettings->SetPlayNetMode(EPlayNetMode::PIE_ListenServer);
+		PlaySettings->SetPlayNumberOfClients(2);
+		PlaySettings->bLaunchSeparateServer = false;
+		PlaySettings->SetRunUnderOneProcess(true);
+
+		FRequestPlaySessionParams Params;
+		Params.WorldType = EPlaySessionWorldType::PlayInEditor;
+		Params.EditorPlaySettings = PlaySettings;
+		GEditor->RequestPlaySession(Params);
+		return true;
+	}));
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, Deadline = 0.0]() mutable
+	{
+		const double Now = FPlatformTime::Seconds();
+		if (Deadline == 0.0) Deadline = Now + ConnectTimeoutSeconds;
+
+		UWorld* Server = nullptr;
+		TArray<UWorld*> Clients;
+		GetPIEWorlds(Server, Clients);
+		if (Server && Clients.Num() > 0 && Algo::AllOf(Clients, &IsClientReady)) return true;
+
+		if (Now > Deadline)
+		{
+			AddError(TEXT("Timed out waiting for the PIE client to connect"));
+			return true;
+		}
+		return false;
+	}));
+
+	// 先记录一段历史
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(2.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this]()
+	{
+		ExecuteOnServer(this, ERewindTimeCommand::ToggleTimeScrub);
+		ExecuteOnServer(this, ERewindTimeCommand::StartRewind);
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(1.0f));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this]()
+	{
+		ExecuteOnServer(this, ERewindTimeCommand::StopRewind);
+		return true;
+	}));
+
+	// 等待最后的回放结果复制到客户端
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitLatentCommand(0.5f));
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this]()
+	{
+		VerifyClients(this);
+		ExecuteOnServer(this, ERewindTimeCommand::ToggleTimeScrub);
+		return true;
+	}));
+	ADD_LATENT_AUTOMATION_COMMAND(FEndPlayMapCommand());
+	return true;
+}
+
+#endif
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Async/Async.h"
+#include "Component/RewindSnapshotHistory.h"
+
+namespace RewindSnapshotHistoryTest
+{
+	struct FStressSnapshot
+	{
+		// Mirror始终等于~Value，读到一半被修改或已经释放的数据会破坏这个关系
+		int64 Value = 0;
+		int64 Mirror = 0;
+
+		FStressSnapshot() = default;
+		explicit FStressSnapshot(int64 InValue) : Value(InValue), Mirror(~InValue) {}
+
+		bool IsIntact() const { return Mirror == ~Value; }
+	};
+
+	static constexpr int32 NumReaders = 4;
+	static constexpr int32 NumWriterIterations = 200000;
+	static constexpr int32 HistoryCapacity = 300;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRewindSnapshotHistoryStressTest, "RewindLearned.History.ConcurrentReadersStress",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRewindSnapshotHistoryStressTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * 游戏线程（本线程）不断追加、丢弃、分叉、切换分支和压缩历史，分段表被频繁替换；
+	 * 工作线程同时通过seqlock读取相邻的两个快照，读到的一致结果必须完整并且按追加顺序递增
+	 */
+	using namespace RewindSnapshotHistoryTest;
+	using FHistory = TRewindSnapshotHistory<FStressSnapshot>;
+
+	FRewindHistorySequenceLock Lock;
+	FHistory History;
+	{
+		FRewindHistorySequenceLock::FWriteScope WriteScope(Lock);
+		History.Reserve(HistoryCapacity, Lock);
+	}
+
+	std::atomic<bool> bStop{false};
+	std::atomic<int32> NumCorruptReads{0};
+	std::atomic<int64> NumReads{0};
+
+	TArray<TFuture<void>> Readers;
+	for (int32 ReaderIndex = 0; ReaderIndex < NumReaders; ++ReaderIndex)
+	{
+		Readers.Add(Async(EAsyncExecution::Thread, [&, ReaderIndex]()
+		{
+			FRandomStream Random(ReaderIndex + 1);
+			while (!bStop.load(std::memory_order_relaxed))
+			{
+				const TTuple<bool, FStressSnapshot, FStressSnapshot> Result = Lock.Read([&History, &Random]()
+				{
+					const int32 Num = History.Num();
+					if (Num < 2 || Num > History.Max()) return MakeTuple(false, FStressSnapshot(), FStressSnapshot());
+					const int32 Index = Random.RandHelper(Num - 1);
+					return MakeTuple(true, History.ReadUnchecked(Index), History.ReadUnchecked(Index + 1));
+				});
+				if (!Result.Get<0>()) continue;
+
+				const FStressSnapshot& Earlier = Result.Get<1>();
+				const FStressSnapshot& Later = Result.Get<2>();
+				if (!Earlier.IsIntact() || !Later.IsIntact() || Earlier.Value >= Later.Value) NumCorruptReads.fetch_add(1);
+				NumReads.fetch_add(1, std::memory_order_relaxed);
+			}
+		}));
+	}
+
+	int64 NextValue = 1;
+	TArray<FHistory::FBranchView> Branches;
+	for (int32 Iteration = 0; Iteration < NumWriterIterations; ++Iteration)
+	{
+		FRewindHistorySequenceLock::FWriteScope WriteScope(Lock);
+		if (History.Num() == History.Max()) History.PopFront();
+		History.Emplace(NextValue++);
+
+		if (Iteration % 97 == 0 && History.Num() > 2)
+		{
+			// 分叉：保存当前时间线，截断到一半继续记录
+			Branches.Add(History.CaptureBranch());
+			if (Branches.Num() > 2) Branches.RemoveAt(0);
+			History.Truncate(History.Num() / 2);
+		}
+		else if (Iteration % 211 == 0 && Branches.Num() > 0)
+		{
+			// 切换回保存的时间线，之后追加的值仍然更大
+			History.RestoreBranch(Branches.Pop());
+		}
+		else if (Iteration % 503 == 0 && History.Num() > 4)
+		{
+			// 压缩：删除前半部分中的奇数位置
+			TBitArray<> RemoveMask(false, History.Num() / 2);
+			for (int32 Index = 1; Index < RemoveMask.Num(); Index += 2) RemoveMask[Index] = true;
+			History.Compact(0, RemoveMask, [](FStressSnapshot&, const FStressSnapshot&) {});
+		}
+		else if (Iteration % 1999 == 0)
+		{
+			History.Reset();
+		}
+	}
+
+	bStop.store(true);
+	for (TFuture<void>& Reader : Readers) Reader.Wait();
+
+	TestEqual(TEXT("Corrupt or out-of-order reads"), NumCorruptReads.load(), 0);
+	TestTrue(TEXT("Readers completed reads concurrently with the writer"), NumReads.load() > 0);
+
+	// 分段在替换时立即释放：清空分支后只剩当前时间线引用的分段
+	Branches.Reset();
+	const SIZE_T MaxAllocatedSize = (FMath::DivideAndRoundUp(HistoryCapacity, FHistory::SegmentCapacity) + 2) * (sizeof(FHistory::FSegmentRef) + sizeof(FHistory::FSegment));
+	TestTrue(TEXT("History memory stays bounded"), History.GetAllocatedSize() <= MaxAllocatedSize);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRewindSnapshotHistoryCompactTest, "RewindLearned.History.CompactKeepsSharedSegments",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FRewindSnapshotHistoryCompactTest::RunTest(const FString& Parameters)
+{
+	/*
+	 * 压缩只重写第一个被删除的元素所在的分段到最后一个被删除的元素之后的部分：
+	 * 之前的分段仍与保存的分支共享，删除数量是分段大小的整数倍时之后的分段也直接复用；被删除的元素合并到下一个保留的元素
+	 */
+	using namespace RewindSnapshotHistoryTest;
+	using FHistory = TRewindSnapshotHistory<FStressSnapshot>;
+	constexpr int32 SegmentCapacity = FHistory::SegmentCapacity;
+
+	for (const int32 NumRemoved : {SegmentCapacity, 3})
+	{
+		FRewindHistorySequenceLock Lock;
+		FHistory History;
+		{
+			FRewindHistorySequenceLock::FWriteScope WriteScope(Lock);
+			History.Reserve(SegmentCapacity * 6, Lock);
+			for (int32 Value = 0; Value < SegmentCapacity * 5 + 1; ++Value) History.Emplace(Value);
+			// 头部偏移不为0
+			History.PopFront();
+		}
+		const FHistory::FBranchView Before = History.CaptureBranch();
+
+		// 从第二个分段中间开始删除NumRemoved个元素
+		const int32 FirstIndex = SegmentCapacity + 10;
+		TBitArray<> RemoveMask(false, NumRemoved + 1);
+		for (int32 MaskIndex = 0; MaskIndex < NumRemoved; ++MaskIndex) RemoveMask[MaskIndex] = true;
+		int64 MergedSum = 0;
+		{
+			FRewindHistorySequenceLock::FWriteScope WriteScope(Lock);
+			History.Compact(FirstIndex, RemoveMask, [this, &MergedSum](FStressSnapshot& Kept, const FStressSnapshot& Removed)
+			{
+				TestTrue(TEXT("Removed snapshots merge into the next kept one"), Kept.Value > Removed.Value);
+				MergedSum += Removed.Value;
+			});
+		}
+		const FHistory::FBranchView After = History.CaptureBranch();
+
+		TestEqual(TEXT("Compacted count"), History.Num(), Before.Count - NumRemoved);
+		TestEqual(TEXT("Head offset is unchanged"), After.HeadOffset, Before.HeadOffset);
+		int64 ExpectedMergedSum = 0;
+		for (int32 Index = 0; Index < NumRemoved; ++Index) ExpectedMergedSum += FirstIndex + 1 + Index;
+		TestEqual(TEXT("Every removed snapshot was merged"), MergedSum, ExpectedMergedSum);
+
+		bool bInOrder = true;
+		for (int32 Index = 0; Index < History.Num(); ++Index)
+		{
+			const int64 Expected = Index < FirstIndex ? Index + 1 : Index + 1 + NumRemoved;
+			bInOrder &= History[Index].IsIntact() && History[Index].Value == Expected;
+		}
+		TestTrue(TEXT("Kept snapshots stay in order"), bInOrder);
+
+		const int32 FirstRewrittenSegment = (Before.HeadOffset + FirstIndex) / SegmentCapacity;
+		for (int32 SegmentIndex = 0; SegmentIndex < FirstRewrittenSegment; ++SegmentIndex)
+		{
+			TestTrue(TEXT("Segments before the first removal stay shared"), After.Segments[SegmentIndex] == Before.Segments[SegmentIndex]);
+		}
+		TestTrue(TEXT("The segment holding the first removal is rewritten"), After.Segments[FirstRewrittenSegment] != Before.Segments[FirstRewrittenSegment]);
+
+		const int32 NumSharedTailSegments = After.Segments.Num() - FirstRewrittenSegment - 2;
+		for (int32 TailIndex = 1; TailIndex <= NumSharedTailSegments; ++TailIndex)
+		{
+			const bool bShared = After.Segments.Last(TailIndex - 1) == Before.Segments.Last(TailIndex - 1);
+			TestEqual(TEXT("Aligned tail segments are reused"), bShared, NumRemoved % SegmentCapacity == 0);
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TimeBubble/RewindTimeBubbleVolume.h"
+
+#include "Components/SphereComponent.h"
+#include "Net/UnrealNetwork.h"
+#include "Registry/RewindComponentRegistry.h"
+
+ARewindTimeBubbleVolume::ARewindTimeBubbleVolume()
+{
+	// 分组只由重叠事件驱动，不需要Tick
+	PrimaryActorTick.bCanEverTick = false;
+
+	BubbleSphere = CreateDefaultSubobject<USphereComponent>(TEXT("BubbleSphere"));
+	BubbleSphere->InitSphereRadius(500.0f);
+	BubbleSphere->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+	BubbleSphere->SetGenerateOverlapEvents(true);
+	RootComponent = BubbleSphere;
+
+	// 时钟状态由服务器设置，复制到客户端
+	bReplicates = true;
+	bAlwaysRelevant = true;
+}
+
+void ARewindTimeBubbleVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Registry = GetWorld()->GetSubsystem<URewindComponentRegistry>();
+	if (!Registry) return;
+
+	ClockIndex = Registry->AddClock(this);
+	PushClockState();
+
+	// 已经在泡内的Actor不会再收到开始重叠事件
+	TArray<AActor*> OverlappingActors;
+	GetOverlappingActors(OverlappingActors);
+	for (AActor* Actor : OverlappingActors) Registry->NotifyActorEnteredBubble(Actor, ClockIndex);
+
+	BubbleSphere->OnComponentBeginOverlap.AddUniqueDynamic(this, &ARewindTimeBubbleVolume::OnBubbleBeginOverlap);
+	BubbleSphere->OnComponentEndOverlap.AddUniqueDynamic(this, &ARewindTimeBubbleVolume::OnBubbleEndOverlap);
+}
+
+void ARewindTimeBubbleVolume::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Registry && ClockIndex != INDEX_NONE) Registry->RemoveClock(ClockIndex);
+	ClockIndex = INDEX_NONE;
+	Registry = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARewindTimeBubbleVolume::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ARewindTimeBubbleVolume, ClockState);
+	DOREPLIFETIME(ARewindTimeBubbleVolume, TimeDilation);
+}
+
+void ARewindTimeBubbleVolume::OnRep_ClockState()
+{
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::PushClockState()
+{
+	if (Registry && ClockIndex != INDEX_NONE) Registry->SetClockState(ClockIndex, ClockState, TimeDilation);
+}
+
+void ARewindTimeBubbleVolume::OnBubbleBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+{
+	if (Registry && ClockIndex != INDEX_NONE) Registry->NotifyActorEnteredBubble(OtherActor, ClockIndex);
+}
+
+void ARewindTimeBubbleVolume::OnBubbleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor,
+	UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+{
+	// Actor的其他组件仍在泡内时不离开
+	if (Registry && ClockIndex != INDEX_NONE && !IsOverlappingActor(OtherActor)) Registry->NotifyActorLeftBubble(OtherActor, ClockIndex);
+}
+
+/* ---------------------时间操纵相关函数--------------------- */
+void ARewindTimeBubbleVolume::StartLocalRewind()
+{
+	if (!HasAuthority()) return;
+	ClockState.bIsRewinding = true;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::StopLocalRewind()
+{
+	if (!HasAuthority()) return;
+	ClockState.bIsRewinding = false;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::StartLocalFastForward()
+{
+	if (!HasAuthority()) return;
+	ClockState.bIsFastForwarding = true;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::StopLocalFastForward()
+{
+	if (!HasAuthority()) return;
+	ClockState.bIsFastForwarding = false;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::ToggleLocalTimeScrub()
+{
+	if (!HasAuthority()) return;
+	ClockState.bIsTimeScrubbing = !ClockState.bIsTimeScrubbing;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::SetLocalRewindSpeed(float NewRewindSpeed)
+{
+	if (!HasAuthority()) return;
+	ClockState.GlobalRewindSpeed = NewRewindSpeed;
+	PushClockState();
+}
+
+void ARewindTimeBubbleVolume::SetLocalTimeDilation(float NewTimeDilation)
+{
+	if (!HasAuthority()) return;
+	TimeDilation = FMath::Max(NewTimeDilation, 0.01f);
+	PushClockState();
+}
@@ -0,0 +1,260 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Visualization/RewindGhostTrailActor.h"
+
+#include "EngineUtils.h"
+#include "Component/RewindComponent.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "GameMode/RewindGameState.h"
+#include "RewindableActor/RewindableStaticMeshActor.h"
+#include "UObject/ConstructorHelpers.h"
+
+ARewindGhostTrailActor::ARewindGhostTrailActor()
+{
+	// 只在时间暂停期间Tick，平时没有任何开销
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> CylinderMesh(TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+	if (CylinderMesh.Succeeded()) PathMesh = CylinderMesh.Object;
+}
+
+void ARewindGhostTrailActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// 纯可视化功能，专用服务器上不需要
+	if (GetNetMode() == NM_DedicatedServer) return;
+
+	GameState = GetWorld()->GetGameState<ARewindGameState>();
+	if (!GameState) return;
+
+	GameState->OnGlobalTimeScrubStarted.AddUniqueDynamic(this, &ARewindGhostTrailActor::OnGlobalTimeScrubStarted);
+	GameState->OnGlobalTimeScrubCompleted.AddUniqueDynamic(this, &ARewindGhostTrailActor::OnGlobalTimeScrubCompleted);
+	if (GameState->IsGlobalTimeScrubbing()) OnGlobalTimeScrubStarted();
+}
+
+void ARewindGhostTrailActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (GameState)
+	{
+		GameState->OnGlobalTimeScrubStarted.RemoveDynamic(this, &ARewindGhostTrailActor::OnGlobalTimeScrubStarted);
+		GameState->OnGlobalTimeScrubCompleted.RemoveDynamic(this, &ARewindGhostTrailActor::OnGlobalTimeScrubCompleted);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARewindGhostTrailActor::OnGlobalTimeScrubStarted()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ARewindGhostTrailActor::OnGlobalTimeScrubStarted);
+	BuildGhostBatches();
+	SetActorTickEnabled(Entries.Num() > 0);
+}
+
+void ARewindGhostTrailActor::OnGlobalTimeScrubCompleted()
+{
+	SetActorTickEnabled(false);
+	ClearGhostBatches();
+}
+
+void ARewindGhostTrailActor::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	/* 每个Actor的回放时刻没有跨过残影间隔时不做任何工作；跨过时只更新进入窗口的残影，再用缓存的位置重建路径 */
+	TBitArray<> DirtyBatches(false, Batches.Num());
+	bool bPathDirty = false;
+	const int64 NumFrames = NumOnionSkinFrames;
+
+	for (FGhostTrailEntry& Entry : Entries)
+	{
+		const URewindComponent* RewindComponent = Entry.RewindComponent.Get();
+		if (!RewindComponent) continue;
+
+		const int64 NewGridIndex = FMath::FloorToInt64(RewindComponent->GetPlaybackTime() / OnionSkinIntervalSeconds);
+		if (Entry.VisibleGridIndex.IsSet() && Entry.VisibleGridIndex.GetValue() == NewGridIndex) continue;
+
+		TRACE_CPUPROFILER_EVENT_SCOPE(ARewindGhostTrailActor::UpdateGhostTrail);
+		const int64 OldGridIndex = Entry.VisibleGridIndex.Get(NewGridIndex - NumFrames);
+		if (FMath::Abs(NewGridIndex - OldGridIndex) >= NumFrames)
+		{
+			// 跳跃超过整个窗口，所有残影都需要更新
+			UpdateGhostFrames(Entry, NewGridIndex - NumFrames + 1, NewGridIndex);
+		}
+		else if (NewGridIndex > OldGridIndex)
+		{
+			// 向未来移动：新残影从窗口前端进入
+			UpdateGhostFrames(Entry, OldGridIndex + 1, NewGridIndex);
+		}
+		else
+		{
+			// 向过去移动：新残影从窗口后端进入
+			UpdateGhostFrames(Entry, NewGridIndex - NumFrames + 1, OldGridIndex - NumFrames);
+		}
+		Entry.VisibleGridIndex = NewGridIndex;
+		DirtyBatches[Entry.BatchIndex] = true;
+
+		if (PathBatch)
+		{
+			UpdatePath(Entry, NewGridIndex);
+			bPathDirty = true;
+		}
+	}
+
+	// 每个批次只提交一次渲染状态
+	for (TConstSetBitIterator<> It(DirtyBatches); It; ++It)
+	{
+		Batches[It.GetIndex()]->MarkRenderStateDirty();
+	}
+	if (bPathDirty) PathBatch->MarkRenderStateDirty();
+}
+
+void ARewindGhostTrailActor::BuildGhostBatches()
+{
+	ClearGhostBatches();
+
+	if (PathMesh && !PathBatch)
+	{
+		PathBatch = NewObject<UInstancedStaticMeshComponent>(this);
+		PathBatch->SetupAttachment(RootComponent);
+		PathBatch->SetMobility(EComponentMobility::Movable);
+		PathBatch->SetStaticMesh(PathMesh);
+		PathBatch->SetMaterial(0, PathMaterial ? PathMaterial : GhostMaterial);
+		PathBatch->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		PathBatch->SetCastShadow(false);
+		PathBatch->RegisterComponent();
+	}
+
+	for (TActorIterator<ARewindableStaticMeshActor> It(GetWorld()); It; ++It)
+	{
+		ARewindableStaticMeshActor* RewindableActor = *It;
+		UStaticMeshComponent* MeshComponent = RewindableActor->GetStaticMeshComponent();
+		URewindComponent* RewindComponent = RewindableActor->RewindComponent;
+		if (!MeshComponent || !MeshComponent->GetStaticMesh() || !RewindComponent) continue;
+
+		float OldestTime, NewestTime;
+		if (!RewindComponent->GetHistoryTimeRange(OldestTime, NewestTime)) continue;
+
+		UMaterialInterface* Material = GhostMaterial ? GhostMaterial : MeshComponent->GetMaterial(0);
+		UInstancedStaticMeshComponent* Batch = FindOrAddBatch(MeshComponent->GetStaticMesh(), Material);
+		if (!GhostMaterial)
+		{
+			// 使用原材质时，其余材质槽也保持一致
+			for (int32 MaterialIndex = 1; MaterialIndex < MeshComponent->GetNumMaterials(); ++MaterialIndex)
+			{
+				Batch->SetMaterial(MaterialIndex, MeshComponent->GetMaterial(MaterialIndex));
+			}
+		}
+
+		// 预先为该Actor分配所有残影实例（初始为隐藏），之后只更新Transform
+		FGhostTrailEntry& Entry = Entries.AddDefaulted_GetRef();
+		Entry.RewindComponent = RewindComponent;
+		Entry.BatchIndex = BatchLookup.FindChecked(TPair<UStaticMesh*, UMaterialInterface*>(MeshComponent->GetStaticMesh(), Material));
+		Entry.FirstInstanceIndex = Batch->GetInstanceCount();
+		Entry.GhostLocations.SetNum(NumOnionSkinFrames);
+
+		TArray<FTransform> HiddenTransforms;
+		HiddenTransforms.Init(FTransform(FQuat::Identity, RewindableActor->GetActorLocation(), FVector::ZeroVector), NumOnionSkinFrames);
+		Batch->AddInstances(HiddenTransforms, false, true);
+		if (PathBatch)
+		{
+			Entry.FirstPathInstanceIndex = PathBatch->GetInstanceCount();
+			PathBatch->AddInstances(HiddenTransforms, false, true);
+		}
+	}
+}
+
+void ARewindGhostTrailActor::ClearGhostBatches()
+{
+	for (UInstancedStaticMeshComponent* Batch : Batches)
+	{
+		if (Batch) Batch->ClearInstances();
+	}
+	if (PathBatch) PathBatch->ClearInstances();
+	Entries.Reset();
+}
+
+int32 ARewindGhostTrailActor::GetFrameSlot(int64 GridIndex) const
+{
+	const int64 NumFrames = NumOnionSkinFrames;
+	return static_cast<int32>(((GridIndex % NumFrames) + NumFrames) % NumFrames);
+}
+
+void ARewindGhostTrailActor::UpdateGhostFrames(FGhostTrailEntry& Entry, int64 FirstGridIndex, int64 LastGridIndex)
+{
+	/*
+	 * 网格序号为G的残影显示历史中G * OnionSkinIntervalSeconds时刻的姿态，并固定使用第(G mod NumOnionSkinFrames)个实例，
+	 * 因此窗口移动时，离开窗口的残影实例正好被进入窗口的残影复用
+	 */
+	const URewindComponent* RewindComponent = Entry.RewindComponent.Get();
+	UInstancedStaticMeshComponent* Batch = Batches[Entry.BatchIndex];
+
+	for (int64 GridIndex = FirstGridIndex; GridIndex <= LastGridIndex; ++GridIndex)
+	{
+		const int32 Slot = GetFrameSlot(GridIndex);
+
+		FTransform GhostTransform;
+		if (RewindComponent->GetTransformAtTime(GridIndex * OnionSkinIntervalSeconds, GhostTransform))
+		{
+			Entry.GhostLocations[Slot] = GhostTransform.GetLocation();
+		}
+		else
+		{
+			// 超出历史范围的残影缩放为0隐藏
+			GhostTransform = FTransform(FQuat::Identity, RewindComponent->GetOwner()->GetActorLocation(), FVector::ZeroVector);
+			Entry.GhostLocations[Slot].Reset();
+		}
+		Batch->UpdateInstanceTransform(Entry.FirstInstanceIndex + Slot, GhostTransform, true, false, true);
+	}
+}
+
+void ARewindGhostTrailActor::UpdatePath(const FGhostTrailEntry& Entry, int64 NewestGridIndex)
+{
+	/* 槽位为G的线段连接残影G-1和G；窗口中最老的残影没有前一个残影，它的线段隐藏 */
+	const int64 OldestGridIndex = NewestGridIndex - NumOnionSkinFrames + 1;
+	const float ThicknessScale = PathThickness / 100.0f;
+	const FVector HiddenLocation = Entry.RewindComponent.IsValid() ? Entry.RewindComponent->GetOwner()->GetActorLocation() : FVector::ZeroVector;
+
+	for (int64 GridIndex = OldestGridIndex; GridIndex <= NewestGridIndex; ++GridIndex)
+	{
+		const int32 Slot = GetFrameSlot(GridIndex);
+		const TOptional<FVector>& End = Entry.GhostLocations[Slot];
+		const TOptional<FVector> Start = GridIndex > OldestGridIndex ? Entry.GhostLocations[GetFrameSlot(GridIndex - 1)] : TOptional<FVector>();
+
+		FTransform SegmentTransform(FQuat::Identity, HiddenLocation, FVector::ZeroVector);
+		if (Start.IsSet() && End.IsSet())
+		{
+			const FVector Segment = End.GetValue() - Start.GetValue();
+			const float Length = Segment.Size();
+			if (Length > UE_KINDA_SMALL_NUMBER)
+			{
+				// 圆柱体的中心在原点、沿Z轴，缩放到线段的长度并对齐线段方向
+				SegmentTransform = FTransform(FRotationMatrix::MakeFromZ(Segment / Length).ToQuat(), (Start.GetValue() + End.GetValue()) * 0.5f,
+					FVector(ThicknessScale, ThicknessScale, Length / 100.0f));
+			}
+		}
+		PathBatch->UpdateInstanceTransform(Entry.FirstPathInstanceIndex + Slot, SegmentTransform, true, false, true);
+	}
+}
+
+UInstancedStaticMeshComponent* ARewindGhostTrailActor::FindOrAddBatch(UStaticMesh* StaticMesh, UMaterialInterface* Material)
+{
+	const TPair<UStaticMesh*, UMaterialInterface*> Key(StaticMesh, Material);
+	if (const int32* BatchIndex = BatchLookup.Find(Key)) return Batches[*BatchIndex];
+
+	UInstancedStaticMeshComponent* Batch = NewObject<UInstancedStaticMeshComponent>(this);
+	Batch->SetupAttachment(RootComponent);
+	Batch->SetMobility(EComponentMobility::Movable);
+	Batch->SetStaticMesh(StaticMesh);
+	Batch->SetMaterial(0, Material);
+	Batch->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Batch->SetCastShadow(false);
+	Batch->RegisterComponent();
+
+	BatchLookup.Add(Key, Batches.Add(Batch));
+	return Batch;
+}
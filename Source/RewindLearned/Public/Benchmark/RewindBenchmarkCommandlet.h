@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "RewindBenchmarkCommandlet.generated.h"
+
+class ARewindGameMode;
+
+
+UCLASS()
+class REWINDLEARNED_API URewindBenchmarkCommandlet : public UCommandlet
+{
+	/*
+	 * 无头回溯性能测试：
+	 *   UnrealEditor-Cmd RewindLearned.uproject -run=RewindBenchmark -nullrhi -unattended -N=1000 -M=10 [-Baseline=<json>] [-Threshold=0.1] [-Fidelity] [-Rollback=8]
+	 * 生成N个可回溯静态网格体和M个回溯角色，按脚本依次执行记录、各档速度回溯、时停、时停中回溯/快进等阶段，
+	 * 输出每个阶段的帧耗时、内存和状态切换的尖峰（CSV和JSON），并可以与保存的基准结果比较
+	 */
+	GENERATED_BODY()
+
+public:
+	URewindBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+public:
+	struct FPhase
+	{
+		FString Name;
+		float DurationSeconds = 1.0f;
+		TFunction<void(ARewindGameMode&)> Enter; // 阶段开始时执行的时间操作
+	};
+
+	struct FPhaseResult
+	{
+		FString Name;
+		TArray<double> FrameMilliseconds;
+		double TransitionMilliseconds = 0.0; // 阶段切换时的时间操作 + 第一帧
+		double AverageMilliseconds = 0.0;
+		double P95Milliseconds = 0.0;
+		double MaxMilliseconds = 0.0;
+		uint64 PeakUsedPhysicalBytes = 0;
+		uint64 EndUsedPhysicalBytes = 0;
+	};
+
+	struct FConfig
+	{
+		int32 NumStaticMeshActors = 1000;
+		int32 NumCharacters = 10;
+		float FrameRate = 60.0f;
+		float RecordSeconds = 10.0f;
+		float PhaseSeconds = 1.0f;
+		FString OutputDirectory;
+		FString BaselinePath;
+		float RegressionThreshold = 0.1f; // 相对基准的允许退化比例
+		bool bMeasureFidelity = false; // 同时测量回溯保真度，记录真实状态的开销会计入帧时间
+		int32 RollbackFrames = 0; // 大于0时在脚本之后测量回滚的保存、恢复和每帧重新模拟的耗时
+	};
+
+	// 可供其他测试复用的场景生成与脚本
+	static UWorld* CreateBenchmarkWorld();
+	static void DestroyBenchmarkWorld(UWorld* World);
+	static void SpawnScene(UWorld* World, int32 NumStaticMeshActors, int32 NumCharacters);
+	static TArray<FPhase> MakeDefaultPhases(const FConfig& Config);
+
+private:
+	static void RunPhases(UWorld* World, const FConfig& Config, const TArray<FPhase>& Phases, TArray<FPhaseResult>& OutResults);
+	// 每帧保存世界状态，然后回滚RollbackFrames帧并重新模拟，结果作为三个阶段加入OutResults
+	static void RunRollbackBenchmark(UWorld* World, const FConfig& Config, TArray<FPhaseResult>& OutResults);
+	static void FinalizePhaseResult(FPhaseResult& Result);
+	static void WriteReports(const FConfig& Config, const TArray<FPhaseResult>& Results, const FString& BaseFileName);
+	// 返回是否有阶段的耗时超过基准的允许范围
+	static bool CompareWithBaseline(const FConfig& Config, const TArray<FPhaseResult>& Results);
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "GameMode/RewindGameMode.h"
 #include "RewindCharacter.generated.h"
 
 struct FInputActionValue;
@@ -88,6 +89,17 @@ public:
 	
 	void ToggleRewindParticipation(const FInputActionValue& Value);
 
+private:
+	/* ------------------------------- 网络：时间操作只在服务器执行 ------------------------------- */
+	// 服务器直接执行，客户端通过RPC请求服务器执行
+	void IssueTimeCommand(ERewindTimeCommand Command);
+
+	UFUNCTION(Server, Reliable)
+	void ServerIssueTimeCommand(ERewindTimeCommand Command);
+
+	UFUNCTION(Server, Reliable)
+	void ServerToggleRewindParticipation();
+
 public:	
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -3,13 +3,20 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "Components/ActorComponent.h"
-#include "Containers/RingBuffer.h"
+#include "Component/RewindPhysicsResimulation.h"
+#include "Component/RewindSnapshotHistory.h"
+#include "Engine/NetSerialization.h"
+#include "GameMode/RewindGameMode.h"
+#include "Registry/RewindComponentRegistry.h"
 #include "RewindComponent.generated.h"
 
 
-class ARewindGameMode;
+class ARewindGameState;
 class UCharacterMovementComponent;
+class APawn;
+class AController;
 
 // 声明一些时间类型
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTimeManipulationStarted);
@@ -24,6 +31,28 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnFastForwardCompleted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTimeScrubStarted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTimeScrubCompleted);
 
+/* 快照之间的插值方式 */
+UENUM(BlueprintType)
+enum class ERewindInterpolationMode : uint8
+{
+	// 位置线性插值，旋转球面线性插值；需要较高的记录频率才能表现平滑的弧线
+	Linear,
+
+	// 以记录的速度为切线：位置三次Hermite插值，旋转按角速度构造的四元数Bezier插值；较低的记录频率（10-15Hz）即可保持平滑
+	Hermite,
+};
+
+/* 记录快照的时机 */
+UENUM(BlueprintType)
+enum class ERewindSamplingMode : uint8
+{
+	// 按SnapshotFrequencySeconds固定频率记录
+	FixedRate,
+
+	// 用上一个快照和它的速度预测当前状态，误差超出容差或超过最大间隔时才记录；内存和记录开销随运动的复杂程度变化
+	Adaptive,
+};
+
 USTRUCT()
 struct FTransformAndVelocitySnapshot
 {
@@ -33,6 +62,9 @@ struct FTransformAndVelocitySnapshot
 	UPROPERTY(Transient)
 	float TimeSinceLastSnapshot = 0.0f;  // 记录当前与上一次快照的时间间隔，用于之后的插值计算
 
+	UPROPERTY(Transient)
+	float RecordedTime = 0.0f; // 记录快照时的世界时间（GetTimeSeconds），用于按时间查询历史
+
 	UPROPERTY(Transient)
 	FTransform Transform{FVector::ZeroVector}; //// 记录Transform（位置，旋转，缩放）
 
@@ -41,6 +73,9 @@ struct FTransformAndVelocitySnapshot
 
 	UPROPERTY(Transient)
 	FVector AngularVelocityInRadians = FVector::ZeroVector; // 记录角速度
+
+	UPROPERTY(Transient)
+	bool bIsSleeping = false; // 模拟物理的刚体是否在休眠，结束时间操作时休眠的刚体直接恢复休眠
 };
 
 USTRUCT()
@@ -62,6 +97,101 @@ struct FMovementVelocityAndModeSnapshot
 	TEnumAsByte<enum EMovementMode> MovementMode = EMovementMode::MOVE_None;
 };
 
+USTRUCT()
+struct FRewindNetPlaybackState
+{
+	/*
+	 * 回放期间服务器发送给客户端的压缩Transform
+	 * 位置存储为相对于锚点（NetPlaybackAnchor）的偏移，旋转使用16位压缩，缩放不参与回放
+	 */
+	GENERATED_BODY();
+
+	// 相对于锚点的位置偏移，精度0.1cm
+	UPROPERTY()
+	FVector LocationOffset = FVector::ZeroVector;
+
+	UPROPERTY()
+	FRotator Rotation = FRotator::ZeroRotator;
+
+	// 偏移超过该距离时服务器需要重新设置锚点，保证偏移可以用较少的位数表示
+	static constexpr float MaxLocationOffset = 10000.0f;
+
+	// 将数据量化到网络精度，服务器写入前调用，保证未变化的量化结果不会被重复发送
+	void Quantize();
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FRewindNetPlaybackState& Other) const
+	{
+		return LocationOffset == Other.LocationOffset && Rotation == Other.Rotation;
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FRewindTimelineBranchInfo
+{
+	/* 被放弃的时间线（回溯后重新记录时分出），用于在时停期间选择要恢复的分支 */
+	GENERATED_BODY();
+
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind|Timeline")
+	int32 BranchId = INDEX_NONE;
+
+	// 分叉点的世界时间，分叉点之前的历史与当前时间线共享
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind|Timeline")
+	float ForkTime = 0.0f;
+
+	// 分支最后一个快照的世界时间
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind|Timeline")
+	float EndTime = 0.0f;
+};
+
+struct FRewindChildTransformSample
+{
+	/* 子组件的相对Transform，只在变化时记录 */
+	float RecordedTime = 0.0f; // 记录时的世界时间，与快照的RecordedTime对应
+	FTransform RelativeTransform;
+};
+
+struct FRewindChildTrack
+{
+	/* 一个被记录的子组件：样本按时间排序，两个样本之间插值 */
+	TWeakObjectPtr<USceneComponent> Component;
+	TArray<FRewindChildTransformSample> Samples;
+};
+
+struct FRewindTimelineBranch
+{
+	/* 保留的时间线：只持有历史分段的引用，与当前时间线共享分叉点之前的分段 */
+	FRewindTimelineBranchInfo Info;
+	TRewindSnapshotHistory<FTransformAndVelocitySnapshot>::FBranchView TransformAndVelocitySnapshots;
+	TRewindSnapshotHistory<FMovementVelocityAndModeSnapshot>::FBranchView MovementVelocityAndModeSnapshots;
+
+	// 分支开头已经化简过的快照数量，切换回来后不会重复化简
+	int32 NumSimplifiedSnapshots = 0;
+
+	// 子组件的样本（稀疏，直接复制），与RecordedChildComponents一一对应
+	TArray<TArray<FRewindChildTransformSample>> ChildTransformSamples;
+};
+
+struct FRewindMemoryUsage
+{
+	/* 一个回溯组件的历史内存占用，用于内存统计 */
+	SIZE_T BytesReserved = 0; // 当前时间线和保留的分支分配的内存
+	SIZE_T BytesUsed = 0;     // 已写入快照占用的内存
+	int32 NumSamples = 0;
+	float HistorySeconds = 0.0f; // 历史实际覆盖的时间长度
+};
+
+template<>
+struct TStructOpsTypeTraits<FRewindNetPlaybackState> : public TStructOpsTypeTraitsBase2<FRewindNetPlaybackState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true,
+	};
+};
+
 
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class REWINDLEARNED_API URewindComponent : public UActorComponent
@@ -76,10 +206,17 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 public:	
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// 只有在时间操作期间才复制回放数据，平时由Actor默认的移动复制负责同步
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 public:
 	/* ----------------------------- 委托事件 ----------------------------- */
 	/* 时间操作通用事件、时间回溯、时间快进、时间暂停 的动态多播处理 */
@@ -133,12 +270,87 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
 	bool IsTimeBeingManipulated() const { return bIsRewinding || bIsFastForwarding || bIsTimeScrubbing; };
 
+public:
+	/* ----------------------------- 历史查询接口（线程安全，可在工作线程中与记录同时进行） ----------------------------- */
+	// 获得Time时刻（世界时间）插值后的快照，不会移动owner；Time超出历史范围时返回false
+	bool GetSnapshotAtTime(float Time, FTransformAndVelocitySnapshot& OutSnapshot) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|History")
+	bool GetTransformAtTime(float Time, FTransform& OutTransform) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|History")
+	bool GetVelocityAtTime(float Time, FVector& OutLinearVelocity, FVector& OutAngularVelocityInRadians) const;
+
+	// 批量查询：多个组件在同一时刻的快照，OutSnapshots/OutValid与Components一一对应
+	static void GetSnapshotsAtTime(TConstArrayView<const URewindComponent*> Components, float Time, TArray<FTransformAndVelocitySnapshot>& OutSnapshots, TBitArray<>& OutValid);
+
+	// 混合Transform等信息，A和B必须是相邻的快照（可以按时间倒序）
+	static FTransformAndVelocitySnapshot BlendSnapshots(
+		const FTransformAndVelocitySnapshot& A,
+		const FTransformAndVelocitySnapshot& B,
+		float Alpha,
+		ERewindInterpolationMode Mode = ERewindInterpolationMode::Linear);
+
+	// 历史覆盖的时间范围（世界时间），没有历史时返回false
+	bool GetHistoryTimeRange(float& OutOldestTime, float& OutNewestTime) const;
+
+	// owner当前所在的时刻（与快照的RecordedTime同一基准）：正常时间流逝时为世界时间，时间操作期间为回放到的时刻（游戏线程）
+	float GetPlaybackTime() const;
+
+	// owner的位置在[StartTime, EndTime]内经过的包围盒（包含两端所在区间的快照），没有历史时返回false
+	bool GetLocationBoundsInTimeRange(float StartTime, float EndTime, FBox& OutBounds) const;
+
+	// 复制全部历史（按时间排序），用于保存回放文件；没有运动快照时OutMovementSnapshots为空
+	void CopyHistory(TArray<FTransformAndVelocitySnapshot>& OutTransformSnapshots, TArray<FMovementVelocityAndModeSnapshot>& OutMovementSnapshots) const;
+
+	UPrimitiveComponent* GetOwnerRootComponent() const { return OwnerRootComponent; }
+
+	// 客户端上跟随服务器回放，没有本地历史
+	bool IsNetPlaybackFollower() const { return bIsNetPlaybackFollower; }
+
+	// 历史的内存占用（游戏线程）
+	void GetMemoryUsage(FRewindMemoryUsage& OutUsage) const;
+
+	// 最近一次应用到owner上的快照（RecordedTime是它在时间线上的时刻），以及每次应用递增的序号；用于保真度测试
+	const FTransformAndVelocitySnapshot& GetLastAppliedSnapshot() const { return LastAppliedSnapshot; }
+	uint32 GetAppliedSnapshotSerial() const { return AppliedSnapshotSerial; }
+
+public:
+	/* ----------------------------- 时间线分支接口 ----------------------------- */
+	// 保留的被放弃的时间线，最近放弃的在最后
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Timeline")
+	void GetTimelineBranches(TArray<FRewindTimelineBranchInfo>& OutBranches) const;
+
+	// 时停期间切换到保留的时间线（只交换分段引用，不复制快照），当前时间线作为新的分支保留
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Timeline")
+	bool SwitchToTimelineBranch(int32 BranchId);
+
+	// 切换到最近放弃的时间线（撤销回溯后的重做），再次调用会切换回来
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Timeline")
+	bool SwitchToLatestTimelineBranch();
+
+public:
+	/* ----------------------------- 检查点+重新模拟接口 ----------------------------- */
+	// 关卡开启了检查点模式并且owner模拟物理
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Physics")
+	bool IsUsingPhysicsResimulation() const { return bUsePhysicsResimulation; }
+
+	// 记录施加到owner上的外部冲量（在施加冲量的地方调用），回放重新模拟时在同一时刻施加；不在检查点模式时忽略
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Physics")
+	void RecordExternalImpulse(FVector Impulse, FVector Location);
+
 private:
 	/* ----------------------------- 功能性开关变量 ----------------------------- */
 	// Whether rewinding is currently enabled（这是个功能开启变量，而之前的bIsRewinding是状态变量）
-	UPROPERTY(VisibleAnywhere, Category = "Rewind")
+	UPROPERTY(VisibleAnywhere, ReplicatedUsing = OnRep_IsRewindingEnabled, Category = "Rewind")
 	bool bIsRewindingEnabled = true;
 
+	UFUNCTION()
+	void OnRep_IsRewindingEnabled();
+
+	// 根据bIsRewindingEnabled终止或同步时间操作
+	void ApplyRewindingEnabledState();
+
 public:
 	/* ----------------------------- 功能性开关函数 ----------------------------- */
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
@@ -146,34 +358,208 @@ public:
 	
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
 	void SetIsRewindingEnabled(bool bEnabled);
+
+public:
+	/* ----------------------------- 外部回放接口 ----------------------------- */
+	// 回放文件等外部系统接管owner的姿势：终止时间操作，暂停记录、角色移动和物理模拟，期间不响应全局时间操作
+	void BeginExternalPlayback();
+
+	// 恢复移动和物理，从当前姿势继续记录；外部回放的姿势不属于时间线，与之前的历史之间是不连续的
+	void EndExternalPlayback();
+
+	bool IsExternalPlaybackActive() const { return bIsExternalPlayback; }
 	
 public:
 	/* ----------------------------- 一些预设值 ----------------------------- */
 	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
 	float SnapshotFrequencySeconds = 1.0f / 30.f;  // snapshot的频率设置，这里设置30hz
 
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Sampling")
+	ERewindSamplingMode SamplingMode = ERewindSamplingMode::FixedRate; // 自适应采样时SnapshotFrequencySeconds不再使用
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Sampling", meta = (ClampMin = "0.001", EditCondition = "SamplingMode == ERewindSamplingMode::Adaptive"))
+	float MinSnapshotIntervalSeconds = 1.0f / 60.0f; // 剧烈运动时的最小记录间隔，也是检查预测误差的间隔
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Sampling", meta = (ClampMin = "0.001", EditCondition = "SamplingMode == ERewindSamplingMode::Adaptive"))
+	float MaxSnapshotIntervalSeconds = 0.5f; // 预测一直准确时的最大记录间隔
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Sampling", meta = (ClampMin = "0", EditCondition = "SamplingMode == ERewindSamplingMode::Adaptive"))
+	float AdaptiveSamplingPositionTolerance = 2.0f; // 预测位置与实际位置的最大距离（cm）
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Sampling", meta = (ClampMin = "0", EditCondition = "SamplingMode == ERewindSamplingMode::Adaptive"))
+	float AdaptiveSamplingRotationToleranceDegrees = 2.0f; // 预测旋转与实际旋转的最大夹角（度）
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
+	ERewindInterpolationMode InterpolationMode = ERewindInterpolationMode::Linear; // 回放和历史查询时快照之间的插值方式
+
 	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
 	bool bSnapshotMovementVelocityAndMode = false; // 是否snapshot运动组件的数据，回溯角色时需要用到
 
 	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
 	bool bPauseAnimationDuringTimeScrubbing = false; // 时间暂停时是否暂停动画, 回溯角色时需要用到
 
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Children")
+	TArray<FName> RecordedChildComponents; // 需要记录相对Transform的子场景组件（门、轮子、附加的道具等），按组件名匹配
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Timeline", meta = (ClampMin = "0"))
+	int32 MaxTimelineBranches = 4; // 最多保留的被放弃的时间线，0表示不保留（结束回溯后丢弃未来的快照）
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Timeline", meta = (ClampMin = "0"))
+	int32 TimelineBranchMemoryBudgetKB = 256; // 保留的分支独占的内存上限，共享的历史前缀不计入
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Simplification")
+	bool bSimplifyAgedHistory = false; // 在工作线程中化简较老的历史：删除插值可以在容差内重建的快照，历史按时长而不是数量淘汰
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Simplification", meta = (ClampMin = "0", EditCondition = "bSimplifyAgedHistory"))
+	float SimplifyHistoryOlderThanSeconds = 5.0f; // 只化简早于该时长的历史，最近的历史保持完整的记录频率
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Simplification", meta = (ClampMin = "0", EditCondition = "bSimplifyAgedHistory"))
+	float SimplificationPositionTolerance = 1.0f; // 重建的位置与原快照的最大距离（cm）
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind|Simplification", meta = (ClampMin = "0", EditCondition = "bSimplifyAgedHistory"))
+	float SimplificationRotationToleranceDegrees = 1.0f; // 重建的旋转与原快照的最大夹角（度）
+
 private:
 	/* ----------------------------- 实现时间操作功能所需要的一些结构和变量 ----------------------------- */
-	// 存储snapshots中Transform等数据的环形缓冲区
-	TRingBuffer<FTransformAndVelocitySnapshot> TransformAndVelocitySnapshots;
+	// 存储snapshots中Transform等数据的历史（当前时间线）
+	TRewindSnapshotHistory<FTransformAndVelocitySnapshot> TransformAndVelocitySnapshots;
+
+	// 存储snapshots中角色的运动数据的历史（当前时间线）
+	TRewindSnapshotHistory<FMovementVelocityAndModeSnapshot> MovementVelocityAndModeSnapshots;
+
+	// 保护上面两个历史：游戏线程修改时持有写作用域，其他线程的历史查询通过它检测并重试，替换分段时等待正在进行的查询
+	FRewindHistorySequenceLock HistoryLock;
 
-	// 存储snapshots中角色的运动数据的环形缓冲区
-	TRingBuffer<FMovementVelocityAndModeSnapshot> MovementVelocityAndModeSnapshots;
+	// 保留的被放弃的时间线，最老的在最前
+	TArray<FRewindTimelineBranch> TimelineBranches;
+
+	// 下一个分支的编号
+	int32 NextTimelineBranchId = 0;
+
+	// 丢弃最老的快照时有分段移出了当前时间线，下次记录后重新检查分支的内存预算
+	bool bReleasedFrontSegment = false;
+
+	/* ----------------------------- 较老历史的化简 ----------------------------- */
+	// 工作线程中正在计算的化简，结果是从PendingSimplificationFirstIndex开始可以删除的快照
+	TFuture<TBitArray<>> PendingSimplification;
+	int32 PendingSimplificationFirstIndex = 0;
+	int64 PendingSimplificationDroppedSnapshots = 0;
+	uint32 PendingSimplificationGeneration = 0;
+
+	// 历史开头已经化简过的快照数量，之后只化简新变老的部分
+	int32 NumSimplifiedSnapshots = 0;
+
+	// 从历史开头丢弃的快照总数，计算期间丢弃的快照用于修正化简结果的下标
+	int64 NumDroppedSnapshots = 0;
+
+	// 分叉或切换分支时递增，使计算中的化简结果失效
+	uint32 HistoryGeneration = 0;
+
+	// 历史覆盖的回放时长（快照间隔之和，不受分叉处世界时间跳变的影响）和上限
+	float HistoryDurationSeconds = 0.0f;
+	float HistoryHorizonSeconds = 0.0f;
+
+	// 应用已完成的化简，需要时开始新的化简（记录快照后调用）
+	void UpdateHistorySimplification();
+
+	// 在游戏线程中删除化简结果标记的快照
+	void ApplyHistorySimplification(const TBitArray<>& Removable);
+
+	// 丢弃最老的快照，只能在写作用域中调用
+	void DropOldestSnapshot();
+
+	// 按时长淘汰超出回溯上限的快照（只在化简或自适应采样时），只能在写作用域中调用；返回是否丢弃了快照
+	bool DropSnapshotsBeyondHorizon();
+
+	// 截断、切换分支或化简后重新计算HistoryDurationSeconds
+	void RecalculateHistoryDuration();
+
+	/* ----------------------------- 子组件的相对Transform ----------------------------- */
+	// 在BeginPlay中按RecordedChildComponents查找
+	TArray<FRewindChildTrack> ChildTracks;
+
+	// 上一次检查子组件的世界时间：静止后开始运动时在这一时刻补记静止的姿势
+	float LastChildCheckTime = 0.0f;
+
+	// 记录相对Transform发生变化的子组件（每次到期的记录检查都调用）
+	void RecordChildTransforms();
+
+	// 把子组件设置到Time时刻的相对Transform，只写入相对值不更新层级；返回是否有子组件变化
+	bool WriteChildTransforms(float Time);
+
+	// 丢弃最老快照之前的样本，保留决定最老时刻姿势的最后一个
+	void TrimChildTracks(float OldestTime);
+
+	// 截断Time之后的样本（分叉时），Time时刻的姿势作为最后一个样本
+	void TruncateChildTracks(float Time);
+
+	// Time时刻的相对Transform
+	static FTransform GetChildTransformAtTime(const TArray<FRewindChildTransformSample>& Samples, float Time);
+
+	/* ----------------------------- 跨流送的冷历史 ----------------------------- */
+	// owner在冷存储中的稳定标识，运行时生成的owner为空
+	FString ColdHistoryKey;
+
+	// 上次卸载时留下的历史还在冷存储中，尚未接回
+	bool bHasColdHistory = false;
+
+	// 把冷历史解压并接到当前历史的开头（进入时间操作前调用）
+	void ReattachColdHistory();
+
+	// 所在单元被卸载时把历史存入冷存储
+	void StoreColdHistory();
+
+	/* ----------------------------- 检查点+重新模拟 ----------------------------- */
+	// 历史中只有检查点，中间状态在回放时从检查点重新模拟；BeginPlay中按关卡设置和owner是否模拟物理确定
+	bool bUsePhysicsResimulation = false;
+	FRewindPhysicsResimulationSettings PhysicsResimulationSettings;
+	FRewindRigidBodyModel ResimulationModel;
+
+	// 检查点之后的外部输入，按检查点序号和时间排序
+	TArray<FRewindPhysicsInput> PhysicsInputs;
+
+	// 记录时从最新检查点开始的预测，与回放时的重新模拟步进相同
+	FRewindResimulationCursor ResimulationPrediction;
+
+	// 重新模拟的区间缓存，键是区间起点检查点的绝对序号；向回放方向预先在工作线程中计算下一个区间
+	struct FResimulatedInterval
+	{
+		int64 CheckpointSerial = 0;
+		uint32 Generation = 0;
+		TFuture<TArray<FRewindRigidBodyState>> Pending;
+		TArray<FRewindRigidBodyState> Samples;
+	};
+	TArray<FResimulatedInterval> ResimulatedIntervals;
+
+	// 检查点模式：按重新模拟的结果判断是否需要新的检查点（记录时调用）
+	bool IsResimulationPredictionWithinTolerance();
+
+	// 从新记录的检查点重新开始预测
+	void ResetResimulationPrediction();
+
+	// 某个检查点之后的输入
+	TConstArrayView<FRewindPhysicsInput> GetPhysicsInputs(int64 CheckpointSerial) const;
+
+	// 删除序号在[FirstSerial, LastSerial]之外的输入
+	void TrimPhysicsInputs(int64 FirstSerial, int64 LastSerial);
+
+	// 在工作线程中开始重新模拟从FirstIndex开始的区间（已在缓存中时不做任何事）
+	void PrefetchResimulatedInterval(int32 FirstIndex);
+
+	// 从FirstIndex开始的区间中Time时刻的状态；结果还没有算完时等待，缓存中没有时在游戏线程中计算
+	FTransformAndVelocitySnapshot GetResimulatedSnapshot(int32 FirstIndex, float Time);
+
+	// 不加锁的历史查询实现，只能在HistoryLock.Read中调用
+	bool FindSnapshotAtTimeUnsynchronized(float Time, FTransformAndVelocitySnapshot& OutSnapshot) const;
 
 	UPROPERTY(Transient, VisibleAnywhere, Category="Rewind|Debug")
-	uint32 MaxSnapshots = 1; // Snapshots的最大存储数目数量，在BeginPlay中的环形缓冲区初始化时计算该变量
+	uint32 MaxSnapshots = 1; // Snapshots的最大存储数目数量，在BeginPlay中初始化历史时计算该变量
 
 	UPROPERTY(Transient, VisibleAnywhere, Category="Rewind|Debug")
 	float TimeSinceSnapshotsChanged = 0.0f; // 跟踪快照记录的时间间隔，用于判断是否需要生成新快照（达到阈值后触发 RecordSnapshot）
 	
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
-	int32 LatestSnapshotIndex = -1;  // 最新快照的索引，快速定位环形缓冲区中的最新数据
+	int32 LatestSnapshotIndex = -1;  // 最新快照的索引，快速定位历史中的最新数据
 	
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	UPrimitiveComponent* OwnerRootComponent;
@@ -184,51 +570,165 @@ private:
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	USkeletalMeshComponent* OwnerSkeletalMesh;
 	
+	// 最近一次应用的快照
+	FTransformAndVelocitySnapshot LastAppliedSnapshot;
+	uint32 AppliedSnapshotSerial = 0;
+
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	bool bPausedPhysics = false; // 标记是否暂停物理模拟，时间暂停时可能用到
 	
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	bool bPausedAnimation = false; // 标记是否暂停动画播放，时间暂停时可能用到
 	
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bIsExternalPlayback = false; // 外部回放接管owner期间为true
+
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bPausedMovementComponent = false; // 外部回放期间暂停了角色运动组件的Tick
+
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	bool bAnimationsPausedAtStartOfTimeManipulation = false; // 记录在时间操作开始时（如倒带、快进）动画是否已被暂停。
 
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	float SnapshotPhase = 0.0f; // 记录相位[0, 1)，注册时由注册表分配，把组件的记录时刻均匀错开
+
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bAwaitingSnapshotPhase = false; // 正在等待第一次到达记录相位
+
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bIsPauseSettled = false; // 时停时已经停在最终的插值位置，之后不需要每帧更新，直到下一次状态变化
+
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
 	bool bLastTimeManipulationWasRewind = true;  //记录上一次时间操作的类型（回溯或快进），用于时间暂停（Time Scrubbing）时的插值方向控制。
 
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
-	ARewindGameMode* GameMode;  // GameMode全局控制时需要用到
+	ARewindGameState* GameState;  // 全局时间状态，服务器和客户端都存在
 
 private:
-	/* ----------------------------- 功能函数 ----------------------------- */
+	/* ----------------------------- 网络回放相关变量 ----------------------------- */
+	// 服务器端：回放期间需要把回放结果流式发送给客户端
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bIsNetPlaybackAuthority = false;
+
+	// 客户端：owner是复制的Actor，时间操作期间不在本地记录和回放，而是跟随服务器发送的回放数据
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bIsNetPlaybackFollower = false;
+
+	// 开始时间操作前owner是否开启了移动复制，结束时间操作时恢复
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind|Debug")
+	bool bOwnerReplicatedMovementBeforeManipulation = false;
+
+	// 回放位置的锚点，偏移过大时才会更新，因此很少需要发送
+	UPROPERTY(Transient, Replicated)
+	FVector_NetQuantize NetPlaybackAnchor = FVector::ZeroVector;
+
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_NetPlaybackState)
+	FRewindNetPlaybackState NetPlaybackState;
+
 	UFUNCTION()
+	void OnRep_NetPlaybackState();
+
+	// 客户端：复制的Actor跟随服务器回放，本地控制的Pawn除外
+	bool ShouldFollowNetPlayback() const;
+
+	// 客户端获得或失去对owner的控制时重新判断网络角色
+	UFUNCTION()
+	void OnOwnerControllerChanged(APawn* Pawn, AController* OldController, AController* NewController);
+
+	// 分配本地历史，跟随服务器回放的组件没有本地历史
+	void InitializeLocalHistory();
+	bool bHasLocalHistory = false;
+
+	// 服务器：把当前回放结果写入复制变量，量化后与上次相同则不会产生网络流量
+	void UpdateNetPlaybackState();
+
+	// 服务器：时间操作开始/结束时切换owner的默认移动复制
+	void BeginNetPlayback();
+	void EndNetPlayback();
+
+private:
+	/* ----------------------------- 功能函数 ----------------------------- */
+	friend class URewindComponentRegistry;
+
+	// 化简时使用与回放相同的插值计算误差
+	friend class FRewindHistorySimplifier;
+
+	// 回滚时按注册表下标直接读写owner、移动组件和子组件
+	friend class URewindRollbackSubsystem;
+
+	// 由注册表直接调用（原生调用，不经过反射）
+	void HandleGlobalTransition(ERewindGlobalTransition Transition);
+
+	// 移到另一个时钟分组后，从旧时钟的状态过渡到新时钟的状态
+	void SyncToClockState(const FRewindGlobalTimeState& OldState, const FRewindGlobalTimeState& NewState);
+
+	// 正常时间流逝时按所在时钟设置owner的时间膨胀，时间操作期间恢复
+	void ApplyClockTimeDilation();
+
+	// 所在时钟的回放速度
+	float GetClockRewindSpeed() const;
+
+	// 在注册表紧凑数组中的下标，未注册时为INDEX_NONE
+	int32 RegistryIndex = INDEX_NONE;
+
+	// 所在的时钟（全局时钟或时间泡）和在其成员数组中的下标
+	int32 ClockIndex = URewindComponentRegistry::GlobalClockIndex;
+	int32 ClockMemberIndex = INDEX_NONE;
+
+	// owner自身的时间膨胀，时间泡的时间膨胀乘在它上面
+	float OwnerBaseTimeDilation = 1.0f;
+	bool bAppliedClockTimeDilation = false;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindComponentRegistry> Registry;
+
+	// 回放调度：由注册表每帧规划
+	bool bHighPlaybackPriority = false;
+	uint32 PlaybackTurnSerial = 0;
+
+	// 本帧没有轮到：只推进时间轴，不混合也不应用到owner
+	bool bDeferPlaybackApply = false;
+
 	void OnGlobalRewindStarted();
 	
-	UFUNCTION()
 	void OnGlobalFastForwardStarted();
 	
-	UFUNCTION()
 	void OnGlobalTimeScrubStarted();
 	
-	UFUNCTION()
 	void OnGlobalRewindCompleted();
 	
-	UFUNCTION()
 	void OnGlobalFastForwardCompleted();
 	
-	UFUNCTION()
 	void OnGlobalTimeScrubCompleted();
 
 private:
 	/* ----------------------------- 辅助函数 ----------------------------- */
 	// 初始化缓冲区大小
-	void InitializeRingBuffers(float MaxRewindSeconds);
+	void InitializeSnapshotHistory(float MaxRewindSeconds);
+
+	// 记录snapshot并将snapshot存入缓冲区，bForceRecord时不检查是否到期
+	void RecordSnapshot(float DeltaTime, bool bForceRecord = false);
+
+	// 记录时的Tick间隔：固定频率时为快照频率，自适应采样时为最小记录间隔
+	float GetRecordTickIntervalSeconds() const;
 
-	// 记录snapshot并将snapshot存入缓冲区
-	void RecordSnapshot(float DeltaTime);
+	// 去掉owner的CustomTimeDilation，换算成与快照RecordedTime一致的世界时间
+	float GetUndilatedDeltaTime(float DeltaTime) const;
 
-	// 删除最新snapshot之后的所有snapshots
-	void EraseFutureSnapshots();
+	// 自适应采样：从最新快照按速度外推到现在，是否仍在容差之内
+	bool IsSnapshotPredictionWithinTolerance() const;
+
+	// 立即记录当前时刻的快照（进入时间操作前调用）
+	void RecordCurrentSnapshot();
+
+	// 从最新snapshot处分出新的时间线：之后的snapshots保存为分支，当前时间线只保留到最新snapshot
+	void ForkTimeline();
+
+	// 按内存预算和数量上限删除最老的分支
+	void PruneTimelineBranches();
+
+	// 保留的分支独占（不与当前时间线共享）的内存；OutBranchSizes与TimelineBranches一一对应，分支之间共享的分段计入较新的分支
+	SIZE_T GetTimelineBranchesAllocatedSize(TArray<SIZE_T>* OutBranchSizes = nullptr) const;
 
 	// 播放snapshots，第二个变量用于控制向前还是向后播放
 	void PlaySnapshots(float DeltaTime, bool bRewinding);
@@ -236,6 +736,12 @@ private:
 	// Advances to the next snapshot if rewinding or fast forwarding, then freezes time
 	void PauseTime(float DeltaTime, bool bRewinding);
 
+	// 根据当前状态安排Tick：记录时只在快照到期时Tick，时间操作期间每帧Tick，时停稳定后和跟随服务器时不Tick
+	void UpdateTickSchedule();
+
+	// 时停插值完成，停止每帧的工作
+	void SettlePause();
+
 	// 开始时间操作时要用到的辅助函数
 	bool TryStartTimeManipulation(bool& bStateToSet, bool bResetTimeSinceSnapshotsChanged);
 
@@ -245,8 +751,11 @@ private:
 	// 暂停物理模拟特性
 	void PausePhysics();
 
-	// 恢复物理模拟特性和运动状态
-	void UnpausePhysics();
+	// 恢复物理模拟，并在最终快照上恢复运动状态：休眠的刚体直接休眠，不重建物理状态
+	void UnpausePhysics(const FTransformAndVelocitySnapshot* FinalSnapshot);
+
+	// owner模拟物理且刚体在休眠
+	bool IsOwnerBodySleeping() const;
 
 	// 暂停动画播放
 	void PauseAnimation();
@@ -260,20 +769,14 @@ private:
 	// 对snapshot进行线性插值处理
 	void InterpolateAndApplySnapshots(bool bRewinding);
 
-	// 线性插值混合Transform等信息
-	FTransformAndVelocitySnapshot BlendSnapshots(
-		const FTransformAndVelocitySnapshot& A,
-		const FTransformAndVelocitySnapshot& B,
-		float Alpha);
-
 	// 线性插值混合运动组件信息
-	FMovementVelocityAndModeSnapshot BlendSnapshots(
+	static FMovementVelocityAndModeSnapshot BlendSnapshots(
 		const FMovementVelocityAndModeSnapshot& A,
 		const FMovementVelocityAndModeSnapshot& B,
 		float Alpha);
 
 	// 将snapshot的Transform等信息信息应用到owner上
-	void ApplySnapshot(const FTransformAndVelocitySnapshot& Snapshot, bool bApplyPhysics);
+	void ApplySnapshot(const FTransformAndVelocitySnapshot& Snapshot);
 
 	// 将snapshot的角色运动信息应用到owner上
 	void ApplySnapshot(const FMovementVelocityAndModeSnapshot& Snapshot, bool bApplyTimeDilationToVelocity);
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Component/RewindComponent.h"
+
+
+/* 一次化简的输入：游戏线程复制出的一段较老的历史，在工作线程中计算 */
+struct FRewindHistorySimplificationInput
+{
+	TArray<FTransformAndVelocitySnapshot> TransformSnapshots;
+
+	// 与TransformSnapshots一一对应，为空时不检查运动组件数据
+	TArray<FMovementVelocityAndModeSnapshot> MovementSnapshots;
+
+	ERewindInterpolationMode InterpolationMode = ERewindInterpolationMode::Linear;
+	float PositionTolerance = 1.0f;
+	float RotationToleranceRadians = 0.0f;
+};
+
+class REWINDLEARNED_API FRewindHistorySimplifier
+{
+	/*
+	 * 按时间做Douglas-Peucker化简：区间内与首尾插值结果误差最大的快照超出容差时保留它并拆分区间，否则删除区间内的所有快照。
+	 * 误差使用与回放相同的插值（BlendSnapshots）计算，删除的快照的时间间隔合并到下一个保留的快照，回放时间保持不变。
+	 * 纯函数，不访问组件，可以在任意线程调用
+	 */
+public:
+	// 返回可以删除的快照（下标与输入一致），首尾快照总是保留
+	static TBitArray<> FindRemovableSnapshots(const FRewindHistorySimplificationInput& Input);
+
+private:
+	// 用First和Last插值重建Index处的快照，返回相对容差的误差（大于1表示超出容差）
+	static float GetReconstructionError(const FRewindHistorySimplificationInput& Input, const TArray<float>& Timeline, int32 First, int32 Last, int32 Index);
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/* 重新模拟使用的刚体状态 */
+struct FRewindRigidBodyState
+{
+	FTransform Transform{FVector::ZeroVector};
+	FVector LinearVelocity = FVector::ZeroVector;
+	FVector AngularVelocityInRadians = FVector::ZeroVector;
+};
+
+/* 检查点之后的外部输入（例如投射物命中的冲量），记录时已经换算成速度变化 */
+struct FRewindPhysicsInput
+{
+	// 之前检查点的绝对序号（已丢弃的快照数 + 下标），丢弃最老的检查点时下标前移而序号不变
+	int64 CheckpointSerial = 0;
+
+	// 距离该检查点的时间
+	float TimeAfterCheckpoint = 0.0f;
+
+	FVector LinearVelocityChange = FVector::ZeroVector;
+	FVector AngularVelocityChange = FVector::ZeroVector;
+};
+
+/* 重新模拟使用的刚体模型：重力和阻尼，接触和摩擦不模拟，由误差触发的检查点覆盖 */
+struct FRewindRigidBodyModel
+{
+	FVector Gravity = FVector::ZeroVector;
+	float LinearDamping = 0.0f;
+	float AngularDamping = 0.0f;
+};
+
+struct FRewindResimulationCursor
+{
+	/*
+	 * 从检查点开始按固定步长积分的状态
+	 * 记录时用它预测当前状态（判断是否需要新检查点），回放时用它重建中间状态；两者的步进完全相同，容差内的预测就是回放的结果
+	 */
+	FRewindRigidBodyState State;
+	float Time = 0.0f;
+	int32 NextInput = 0;
+
+	// 检查点沿重力方向的速度很小时视为被支撑（静止或在地面滑动），整个区间不施加重力
+	bool bSupported = false;
+
+	void Reset(const FRewindRigidBodyState& Checkpoint, const FRewindRigidBodyModel& Model);
+
+	// 按完整的固定步长推进到不超过TargetTime的最后一步；Inputs是该检查点之后的输入，按时间排序
+	void AdvanceTo(float TargetTime, TConstArrayView<FRewindPhysicsInput> Inputs, const FRewindRigidBodyModel& Model, float StepSeconds);
+
+	// 用不足一步的剩余时间得到TargetTime时刻的状态，不修改游标
+	FRewindRigidBodyState Extrapolate(float TargetTime, TConstArrayView<FRewindPhysicsInput> Inputs, const FRewindRigidBodyModel& Model) const;
+};
+
+class REWINDLEARNED_API FRewindPhysicsResimulator
+{
+	/* 纯函数，不访问组件，可以在任意线程调用 */
+public:
+	// 沿重力方向的速度低于该值（cm/s）时视为被支撑
+	static constexpr float SupportedSpeedThreshold = 5.0f;
+
+	// 从From重新模拟到To（间隔Interval），每StepSeconds输出一个样本，最后一个样本在Interval处；
+	// 终点误差按时间线性分摊到各样本，首尾与两个检查点完全一致，回放跨过检查点时不会跳变
+	static void ResimulateInterval(const FRewindRigidBodyState& From, const FRewindRigidBodyState& To, float Interval,
+		TConstArrayView<FRewindPhysicsInput> Inputs, const FRewindRigidBodyModel& Model, float StepSeconds,
+		TArray<FRewindRigidBodyState>& OutSamples);
+
+	// 在ResimulateInterval的样本中取区间内Time时刻的状态
+	static FRewindRigidBodyState SampleInterval(TConstArrayView<FRewindRigidBodyState> Samples, float Interval, float StepSeconds, float Time);
+
+	// 半隐式欧拉积分一步
+	static void Integrate(FRewindRigidBodyState& State, bool bSupported, const FRewindRigidBodyModel& Model, float DeltaSeconds);
+
+	// 把Time之前（含）尚未应用的输入加到速度上
+	static void ApplyInputs(FRewindRigidBodyState& State, int32& NextInput, float Time, TConstArrayView<FRewindPhysicsInput> Inputs);
+};
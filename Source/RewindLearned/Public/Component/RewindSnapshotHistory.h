@@ -0,0 +1,410 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+
+/*
+ * seqlock：写者（游戏线程）在修改期间把序号变为奇数，读者在读取前后比较序号，不一致则重试。
+ * 读者不会阻塞写入快照数据；
+ * 分段表（分段指针）另外由读写锁保护：读者在执行读取函数期间持有读锁，写者替换或释放分段时持有写锁，
+ * 因此读者拿到的分段指针在读取结束前不会被释放，分段从时间线中移除后也可以立即释放，不需要延迟回收。
+ */
+class FRewindHistorySequenceLock
+{
+public:
+	// 写者作用域
+	struct FWriteScope
+	{
+		explicit FWriteScope(FRewindHistorySequenceLock& InLock) : Lock(InLock)
+		{
+			Lock.Sequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		~FWriteScope()
+		{
+			Lock.Sequence.fetch_add(1, std::memory_order_release);
+		}
+
+	private:
+		FRewindHistorySequenceLock& Lock;
+	};
+
+	// 替换分段表的作用域（写者），只等待正在执行的读取函数结束；Lock为空时历史还没有分配，不会有读者
+	struct FSegmentTableWriteScope
+	{
+		explicit FSegmentTableWriteScope(FRewindHistorySequenceLock* InLock) : Lock(InLock)
+		{
+			if (Lock) Lock->SegmentTableLock.WriteLock();
+		}
+
+		~FSegmentTableWriteScope()
+		{
+			if (Lock) Lock->SegmentTableLock.WriteUnlock();
+		}
+
+	private:
+		FRewindHistorySequenceLock* Lock;
+	};
+
+	// 执行读取函数直到读到一致的数据，ReadFunction需要能够容忍读到被并发修改的快照数据
+	template <typename FunctionType>
+	auto Read(FunctionType&& ReadFunction) const
+	{
+		for (;;)
+		{
+			const uint32 SequenceBefore = Sequence.load(std::memory_order_acquire);
+			if (SequenceBefore & 1u)
+			{
+				// 写者正在修改，稍后重试（等待期间不持有读锁，写者可以替换分段表）
+				FPlatformProcess::YieldThread();
+				continue;
+			}
+
+			auto Result = [this, &ReadFunction]()
+			{
+				FReadScopeLock ReadLock(SegmentTableLock);
+				return ReadFunction();
+			}();
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Sequence.load(std::memory_order_relaxed) == SequenceBefore) return Result;
+		}
+	}
+
+private:
+	std::atomic<uint32> Sequence{0};
+	mutable FRWLock SegmentTableLock;
+};
+
+
+/*
+ * 分段存储的快照历史：接口与TRingBuffer一致（Emplace/PopFront/Pop/operator[]），数据存放在固定大小的分段中。
+ * 分段通过引用计数在多个分支（时间线）之间共享：
+ *   - 分支只复制分段指针，不复制快照数据，共同的历史前缀只存一份；
+ *   - 向被共享的分段追加数据时才复制该分段（写时复制），最多复制一个分段；
+ *   - 分段表的大小在Reserve时确定；替换分段表或其中的指针时持有FRewindHistorySequenceLock的写锁，
+ *     其他线程可以在seqlock（持有读锁）的保护下通过ReadUnchecked读取。
+ */
+template <typename ElementType>
+class TRewindSnapshotHistory
+{
+public:
+	// 每个分段的快照数量
+	static constexpr int32 SegmentCapacity = 64;
+
+	struct FSegment
+	{
+		ElementType Items[SegmentCapacity];
+
+		// 已写入的数量，所有共享该分段的分支共用；分支的末尾不等于它时说明其他分支已经写入了后面的位置
+		int32 NumWritten = 0;
+	};
+
+	using FSegmentRef = TSharedPtr<FSegment, ESPMode::ThreadSafe>;
+
+	// 一个分支对分段的引用，保存和恢复分支时只复制这些指针
+	struct FBranchView
+	{
+		TArray<FSegmentRef> Segments;
+		int32 HeadOffset = 0;
+		int32 Count = 0;
+	};
+
+public:
+	TRewindSnapshotHistory() = default;
+	TRewindSnapshotHistory(const TRewindSnapshotHistory&) = delete;
+	TRewindSnapshotHistory& operator=(const TRewindSnapshotHistory&) = delete;
+
+	// 分配分段表，只能在历史为空时调用；InLock是读者读取时使用的锁
+	void Reserve(int32 InCapacity, FRewindHistorySequenceLock& InLock)
+	{
+		check(Num() == 0);
+		Lock = &InLock;
+		Capacity = FMath::Max(InCapacity, 1);
+		// 头部偏移最多占用一个分段，再留一个分段的余量
+		FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+		SegmentTable.SetNum(FMath::DivideAndRoundUp(Capacity, SegmentCapacity) + 2);
+	}
+
+	int32 Num() const { return Count.load(std::memory_order_relaxed); }
+
+	int32 Max() const { return Capacity; }
+
+	// 当前时间线引用的分段占用的内存
+	SIZE_T GetAllocatedSize() const
+	{
+		SIZE_T Size = SegmentTable.GetAllocatedSize();
+		for (const FSegmentRef& Segment : SegmentTable)
+		{
+			if (Segment.IsValid()) Size += sizeof(FSegment);
+		}
+		return Size;
+	}
+
+	const ElementType& operator[](int32 Index) const
+	{
+		check(Index >= 0 && Index < Num());
+		const int32 Position = HeadOffset.load(std::memory_order_relaxed) + Index;
+		return SegmentTable[Position / SegmentCapacity]->Items[Position % SegmentCapacity];
+	}
+
+	// 无断言读取，只供seqlock的读者使用：读者持有读锁期间分段表不会被修改，分段也不会被释放
+	ElementType ReadUnchecked(int32 Index) const
+	{
+		const int32 Position = HeadOffset.load(std::memory_order_relaxed) + Index;
+		const int32 SegmentIndex = Position / SegmentCapacity;
+		if (Position < 0 || SegmentIndex >= SegmentTable.Num()) return ElementType();
+
+		const FSegment* Segment = SegmentTable.GetData()[SegmentIndex].Get();
+		return Segment ? Segment->Items[Position % SegmentCapacity] : ElementType();
+	}
+
+	// 在尾部构造新元素，返回其下标
+	template <typename... ArgsType>
+	int32 Emplace(ArgsType&&... Args)
+	{
+		const int32 Index = Num();
+		check(Index < Max());
+		const int32 Position = HeadOffset.load(std::memory_order_relaxed) + Index;
+		const int32 SegmentIndex = Position / SegmentCapacity;
+		const int32 Offset = Position % SegmentCapacity;
+
+		FSegmentRef& Segment = SegmentTable[SegmentIndex];
+		if (Offset == 0)
+		{
+			// 新分段
+			ReplaceSegment(SegmentIndex, MakeShared<FSegment, ESPMode::ThreadSafe>());
+		}
+		else if (!Segment.IsUnique() || Segment->NumWritten != Offset)
+		{
+			// 分段被其他分支共享：复制已写入的部分，之后只修改自己的副本
+			FSegmentRef Copy = MakeShared<FSegment, ESPMode::ThreadSafe>();
+			for (int32 ItemIndex = 0; ItemIndex < Offset; ++ItemIndex) Copy->Items[ItemIndex] = Segment->Items[ItemIndex];
+			ReplaceSegment(SegmentIndex, MoveTemp(Copy));
+		}
+
+		Segment->Items[Offset] = ElementType(Forward<ArgsType>(Args)...);
+		Segment->NumWritten = Offset + 1;
+		Count.store(Index + 1, std::memory_order_relaxed);
+		return Index;
+	}
+
+	// 丢弃最老的元素，第一个分段用完、移出当前时间线时返回true
+	bool PopFront()
+	{
+		check(Num() > 0);
+		const int32 NewHeadOffset = HeadOffset.load(std::memory_order_relaxed) + 1;
+		Count.store(Num() - 1, std::memory_order_relaxed);
+		if (NewHeadOffset < SegmentCapacity)
+		{
+			HeadOffset.store(NewHeadOffset, std::memory_order_relaxed);
+			return false;
+		}
+
+		// 第一个分段已经用完，整体前移分段表；用完的分段在释放写锁之后释放
+		FSegmentRef Released;
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			Released = MoveTemp(SegmentTable[0]);
+			for (int32 SegmentIndex = 1; SegmentIndex < SegmentTable.Num(); ++SegmentIndex)
+			{
+				SegmentTable[SegmentIndex - 1] = MoveTemp(SegmentTable[SegmentIndex]);
+			}
+			SegmentTable.Last().Reset();
+			HeadOffset.store(0, std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	// 丢弃最新的元素
+	void Pop()
+	{
+		check(Num() > 0);
+		Truncate(Num() - 1);
+	}
+
+	// 只保留前NewCount个元素，释放不再引用的分段
+	void Truncate(int32 NewCount)
+	{
+		check(NewCount >= 0 && NewCount <= Num());
+		Count.store(NewCount, std::memory_order_relaxed);
+
+		const int32 EndPosition = HeadOffset.load(std::memory_order_relaxed) + NewCount;
+		const int32 FirstUnusedSegment = FMath::DivideAndRoundUp(EndPosition, SegmentCapacity);
+		TArray<FSegmentRef, TInlineAllocator<4>> Released;
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			for (int32 SegmentIndex = FirstUnusedSegment; SegmentIndex < SegmentTable.Num(); ++SegmentIndex)
+			{
+				if (SegmentTable[SegmentIndex].IsValid()) Released.Add(MoveTemp(SegmentTable[SegmentIndex]));
+			}
+		}
+	}
+
+	/*
+	 * 删除从FirstIndex开始、RemoveMask中标记的元素，被删除的元素通过MergeRemoved(下一个保留的元素, 被删除的元素)合并到下一个保留的元素。
+	 * 只重写第一个被删除的元素所在的分段到最后一个被删除的元素之后的部分：之前的分段指针原样保留，仍与分支共享；
+	 * 之后的元素前移，读写位置重新对齐到分段边界时（删除的数量是分段大小的整数倍）剩余的旧分段也直接复用
+	 */
+	template <typename MergeFunctionType>
+	void Compact(int32 FirstIndex, const TBitArray<>& RemoveMask, MergeFunctionType&& MergeRemoved)
+	{
+		const int32 OldCount = Num();
+		check(FirstIndex >= 0 && FirstIndex + RemoveMask.Num() <= OldCount);
+
+		const int32 FirstRemoved = RemoveMask.Find(true);
+		if (FirstRemoved == INDEX_NONE) return;
+		const int32 EndRemovedIndex = FirstIndex + RemoveMask.FindLast(true) + 1;
+
+		const int32 Head = HeadOffset.load(std::memory_order_relaxed);
+		const int32 FirstSegmentIndex = (Head + FirstIndex + FirstRemoved) / SegmentCapacity;
+
+		TArray<FSegmentRef> NewSegments;
+		int32 WritePosition = FirstSegmentIndex * SegmentCapacity;
+		auto Write = [&NewSegments, &WritePosition](const ElementType& Item) -> ElementType&
+		{
+			const int32 Offset = WritePosition % SegmentCapacity;
+			if (Offset == 0) NewSegments.Add(MakeShared<FSegment, ESPMode::ThreadSafe>());
+			FSegment& Segment = *NewSegments.Last();
+			Segment.Items[Offset] = Item;
+			Segment.NumWritten = Offset + 1;
+			++WritePosition;
+			return Segment.Items[Offset];
+		};
+
+		// 第一个被重写的分段中，第一个被删除的元素之前的部分原样复制
+		const FSegment& FirstOldSegment = *SegmentTable[FirstSegmentIndex];
+		for (int32 Position = WritePosition; Position < Head + FirstIndex + FirstRemoved; ++Position) Write(FirstOldSegment.Items[Position % SegmentCapacity]);
+
+		TArray<int32, TInlineAllocator<SegmentCapacity>> PendingRemoved;
+		int32 NumRemoved = 0;
+		int32 ReusedSegmentIndex = INDEX_NONE;
+		for (int32 Index = FirstIndex + FirstRemoved; Index < OldCount; ++Index)
+		{
+			const int32 ReadPosition = Head + Index;
+			if (Index >= EndRemovedIndex && PendingRemoved.IsEmpty() && ReadPosition % SegmentCapacity == 0 && WritePosition % SegmentCapacity == 0)
+			{
+				// 之后没有删除，新旧位置都在分段边界上：剩余的旧分段整体前移即可
+				ReusedSegmentIndex = ReadPosition / SegmentCapacity;
+				break;
+			}
+
+			const int32 MaskIndex = Index - FirstIndex;
+			if (MaskIndex < RemoveMask.Num() && RemoveMask[MaskIndex])
+			{
+				PendingRemoved.Add(Index);
+				++NumRemoved;
+				continue;
+			}
+
+			ElementType& Kept = Write((*this)[Index]);
+			for (const int32 RemovedIndex : PendingRemoved) MergeRemoved(Kept, (*this)[RemovedIndex]);
+			PendingRemoved.Reset();
+		}
+
+		// 交换之后NewTable持有被替换的旧分段，在释放写锁之后释放
+		TArray<FSegmentRef> NewTable;
+		NewTable.Reserve(SegmentTable.Num());
+		for (int32 SegmentIndex = 0; SegmentIndex < FirstSegmentIndex; ++SegmentIndex) NewTable.Add(SegmentTable[SegmentIndex]);
+		NewTable.Append(MoveTemp(NewSegments));
+		if (ReusedSegmentIndex != INDEX_NONE)
+		{
+			for (int32 SegmentIndex = ReusedSegmentIndex; SegmentIndex < SegmentTable.Num(); ++SegmentIndex) NewTable.Add(SegmentTable[SegmentIndex]);
+		}
+		check(NewTable.Num() <= SegmentTable.Num());
+		NewTable.SetNum(SegmentTable.Num());
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			Swap(SegmentTable, NewTable);
+			Count.store(OldCount - NumRemoved, std::memory_order_relaxed);
+		}
+	}
+
+	void Reset()
+	{
+		TArray<FSegmentRef> Released;
+		Released.SetNum(SegmentTable.Num());
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			Count.store(0, std::memory_order_relaxed);
+			HeadOffset.store(0, std::memory_order_relaxed);
+			Swap(SegmentTable, Released);
+		}
+	}
+
+	/* ----------------------------- 分支 ----------------------------- */
+	// 保存当前时间线：只增加分段的引用计数
+	FBranchView CaptureBranch() const
+	{
+		FBranchView Branch;
+		Branch.HeadOffset = HeadOffset.load(std::memory_order_relaxed);
+		Branch.Count = Num();
+		const int32 NumUsedSegments = FMath::DivideAndRoundUp(Branch.HeadOffset + Branch.Count, SegmentCapacity);
+		Branch.Segments.Reserve(NumUsedSegments);
+		for (int32 SegmentIndex = 0; SegmentIndex < NumUsedSegments; ++SegmentIndex) Branch.Segments.Add(SegmentTable[SegmentIndex]);
+		return Branch;
+	}
+
+	// 切换到保存的时间线：只替换分段指针，不复制快照数据
+	void RestoreBranch(const FBranchView& Branch)
+	{
+		check(Branch.Segments.Num() <= SegmentTable.Num());
+		TArray<FSegmentRef> NewSegments(Branch.Segments);
+		NewSegments.SetNum(SegmentTable.Num());
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			Swap(SegmentTable, NewSegments);
+			HeadOffset.store(Branch.HeadOffset, std::memory_order_relaxed);
+			Count.store(Branch.Count, std::memory_order_relaxed);
+		}
+	}
+
+	// 把当前时间线引用的分段加入集合，用于计算分支独占的内存
+	void GatherActiveSegments(TSet<const void*>& OutSegments) const
+	{
+		for (const FSegmentRef& Segment : SegmentTable)
+		{
+			if (Segment.IsValid()) OutSegments.Add(Segment.Get());
+		}
+	}
+
+	// 分支中不在CountedSegments里的分段的内存，计算后加入CountedSegments
+	static SIZE_T GetUniqueAllocatedSize(const FBranchView& Branch, TSet<const void*>& CountedSegments)
+	{
+		SIZE_T Size = 0;
+		for (const FSegmentRef& Segment : Branch.Segments)
+		{
+			bool bAlreadyCounted = false;
+			CountedSegments.Add(Segment.Get(), &bAlreadyCounted);
+			if (!bAlreadyCounted) Size += sizeof(FSegment);
+		}
+		return Size;
+	}
+
+private:
+	// 在写锁中替换一个分段，被替换的分段在释放写锁之后释放
+	void ReplaceSegment(int32 SegmentIndex, FSegmentRef NewSegment)
+	{
+		FSegmentRef Released;
+		{
+			FRewindHistorySequenceLock::FSegmentTableWriteScope TableScope(Lock);
+			Released = MoveTemp(SegmentTable[SegmentIndex]);
+			SegmentTable[SegmentIndex] = MoveTemp(NewSegment);
+		}
+	}
+
+	// 固定大小的分段表，只在持有写锁时修改
+	TArray<FSegmentRef> SegmentTable;
+	int32 Capacity = 0;
+
+	// 读者使用的锁，Reserve时设置
+	FRewindHistorySequenceLock* Lock = nullptr;
+
+	// 使用原子变量保存游标，读者线程读取时不存在数据竞争
+	std::atomic<int32> HeadOffset{0};
+	std::atomic<int32> Count{0};
+};
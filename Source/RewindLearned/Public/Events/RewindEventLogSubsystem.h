@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindEventLogSubsystem.generated.h"
+
+class ARewindGameState;
+class URewindComponent;
+
+// 时间线状态变化：时间操作期间每帧在撤销/重做之后广播一次，恢复时广播一次；参数为是否处于时间操作中和播放位置
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnRewindTimelinePlayback, bool /*bManipulating*/, float /*PlaybackTime*/);
+
+struct FRewindGameplayEvent
+{
+	/* 一个离散的游戏事件（拾取、装备、开火、命中、参与回溯的开关），事件本身已经发生，Undo/Redo负责撤销和重做它对世界的影响 */
+	float Time = 0.0f;   // 发生时的世界时间，与回溯组件快照的RecordedTime同一基准
+	uint32 Sequence = 0; // 记录顺序，同一时刻的多个事件按它排列
+	FName Type;
+	TWeakObjectPtr<UObject> Subject; // 只用于日志输出
+
+	// 回溯越过该事件时调用，可以为空
+	TFunction<void()> Undo;
+
+	// 快进越过该事件时调用，参数为快进的目标时刻距离事件的时间线秒数（不含恢复时跳过的间隙），可以为空
+	TFunction<void(float /*SecondsSinceEvent*/)> Redo;
+};
+
+UCLASS()
+class REWINDLEARNED_API URewindEventLogSubsystem : public UTickableWorldSubsystem
+{
+	/*
+	 * 全局时钟下的离散游戏事件日志，与回溯组件的连续历史互补：
+	 * 事件按发生时的世界时间追加，数组本身就是按时间排序的索引；
+	 * 时间操作期间的播放位置取自全局时钟成员实际回放到的时刻（与时间泡和时钟速度无关），
+	 * 回溯时按相反顺序撤销(播放位置, 上次位置]中的事件，快进时按原顺序重做(上次位置, 播放位置]中的事件，区间的两端都通过二分查找定位；
+	 * 时间操作结束后，恢复点之后的事件与组件被截断的历史一样被丢弃，恢复点到当前世界时间之间记为时间线上的间隙。
+	 * 只在正常时间流逝时记录，时间操作期间（包括撤销和重做本身引起的）事件不进入日志。
+	 * 日志不复制，每台机器记录自己发生的事件
+	 * 控制台命令：Rewind.Events.Dump
+	 */
+	GENERATED_BODY()
+
+public:
+	// 记录一个刚刚发生的事件，时间操作期间或撤销/重做过程中返回false，不记录
+	bool RecordEvent(FName Type, UObject* Subject, TFunction<void()> Undo, TFunction<void(float)> Redo);
+
+	// 全局时钟是否处于时间操作中（回溯、快进、时间拖动），期间发生的事件不属于时间线
+	bool IsTimelineManipulated() const;
+
+	// 当前播放位置（世界时间）
+	float GetPlaybackTime() const { return AppliedTime; }
+
+	// From与To之间经过的时间线秒数，减去其中恢复时跳过的间隙
+	float GetTimelineSeconds(float From, float To) const;
+
+	FOnRewindTimelinePlayback OnTimelinePlayback;
+
+	const TArray<FRewindGameplayEvent>& GetEvents() const { return Events; }
+
+	// 输出到日志，MaxEntries限制最近事件的行数
+	void DumpEvents(int32 MaxEntries) const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FTimelineGap
+	{
+		// 从Start（恢复点）跳到End（恢复时的世界时间），中间的世界时间不属于时间线
+		float Start = 0.0f;
+		float End = 0.0f;
+	};
+
+	// 按时间排序；正常时间流逝时只在末尾追加，超出MaxRewindSeconds时间线秒数的事件从头部移除
+	TArray<FRewindGameplayEvent> Events;
+	uint32 NextSequence = 0;
+
+	// 按时间排序，互不重叠
+	TArray<FTimelineGap> Gaps;
+
+	// 已经应用到世界的时刻：正常时间流逝时跟随世界时间，时间操作期间为播放位置
+	float AppliedTime = 0.0f;
+
+	// 时间操作开始时的世界时间，没有参考组件时游标从这里往回计算
+	float ManipulationLiveTime = 0.0f;
+
+	// 时间操作期间提供播放位置的全局时钟成员：历史最早开始的一个，不会比其他成员先停在历史的尽头
+	TWeakObjectPtr<const URewindComponent> TimeReference;
+
+	bool bWasManipulating = false;
+
+	// 撤销和重做期间为true，其中引起的事件不记录
+	bool bIsApplying = false;
+
+	const ARewindGameState* GetGameState() const;
+
+	// 时间操作开始时选择TimeReference，全局时钟没有自己记录历史的成员（例如只有跟随者的客户端）时为空
+	void SelectTimeReference();
+
+	// 时间操作期间的播放位置
+	float GetManipulatedPlaybackTime() const;
+
+	// 从To往前数TimelineSeconds秒时间线（跳过间隙）得到的世界时间
+	float GetTimeBefore(float To, float TimelineSeconds) const;
+
+	// 撤销或重做AppliedTime与TargetTime之间的事件
+	void SeekTo(float TargetTime);
+
+	// 二分查找：第一个时刻大于Time的事件
+	int32 UpperBound(float Time) const;
+};
@@ -7,7 +7,7 @@
 #include "RewindGameMode.generated.h"
 
 
-/* 定义一些事件回溯事件类型 */ 
+/* 定义一些事件回溯事件类型（由ARewindGameState在服务器和客户端广播） */
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGlobalRewindStarted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGlobalRewindCompleted);
 
@@ -17,6 +17,51 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGlobalFastForwardCompleted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGlobalTimeScrubStarted);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGlobalTimeScrubCompleted);
 
+/* 客户端通过RPC请求服务器执行的时间操作指令 */
+UENUM(BlueprintType)
+enum class ERewindTimeCommand : uint8
+{
+	StartRewind,
+	StopRewind,
+	StartFastForward,
+	StopFastForward,
+	ToggleTimeScrub,
+	SetSpeedSlowest,
+	SetSpeedSlower,
+	SetSpeedNormal,
+	SetSpeedFaster,
+	SetSpeedFastest,
+	RestoreAbandonedTimeline,
+};
+
+USTRUCT(BlueprintType)
+struct FRewindPhysicsResimulationSettings
+{
+	/*
+	 * 检查点+重新模拟模式：模拟物理的回溯物体只存储稀疏的检查点和外部冲量，回放时从检查点按固定步长重新模拟中间状态
+	 * 用CPU换内存，在关卡的GameMode覆盖中按关卡开启
+	 */
+	GENERATED_BODY();
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind|Physics")
+	bool bEnabled = false;
+
+	// 预测一直准确时检查点的最大间隔
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind|Physics", meta = (ClampMin = "0.01", EditCondition = "bEnabled"))
+	float MaxCheckpointIntervalSeconds = 2.0f;
+
+	// 重新模拟的位置与实际位置的最大距离（cm），超出时记录新的检查点
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind|Physics", meta = (ClampMin = "0", EditCondition = "bEnabled"))
+	float PositionTolerance = 2.0f;
+
+	// 重新模拟的旋转与实际旋转的最大夹角（度）
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind|Physics", meta = (ClampMin = "0", EditCondition = "bEnabled"))
+	float RotationToleranceDegrees = 3.0f;
+
+	// 重新模拟的固定步长
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind|Physics", meta = (ClampMin = "0.001", EditCondition = "bEnabled"))
+	float FixedStepSeconds = 1.0f / 60.0f;
+};
 
 UCLASS()
 class REWINDLEARNED_API ARewindGameMode : public AGameModeBase
@@ -27,9 +72,16 @@ public:
 	/* --------------------- 预设置 ---------------------*/
 	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
 	float MaxRewindSeconds = 120.0f;  // 最长回溯长度，用于初始化回溯缓存区大小
+
+	UPROPERTY(EditDefaultsOnly, Category = "Rewind")
+	FRewindPhysicsResimulationSettings PhysicsResimulation; // 物理物体的检查点+重新模拟模式，默认关闭
 	
 	ARewindGameMode();
 
+	virtual void InitGameState() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
 public:
 	/* --------------------- 时间回溯的速度相关参数 ---------------------*/
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Rewind")
@@ -63,6 +115,15 @@ public:
 	
 	void SetRewindSpeedFastest();
 
+public:
+	/* --------------------- 网络 --------------------- */
+	// 执行客户端（或本地玩家）发来的时间操作指令
+	void ExecuteTimeCommand(ERewindTimeCommand Command);
+
+private:
+	// 将当前全局状态写入GameState，由GameState复制给客户端
+	void PushTimeStateToGameState();
+
 public:
 	/* --------------------- 时间操作函数 --------------------- */
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
@@ -80,27 +141,11 @@ public:
 	// 事件暂停开关函数
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
 	void ToggleTimeScrub();
-	
-public:
-	/* --------------------- 事件 --------------------- */
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalRewindStarted OnGlobalRewindStarted;
-
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalRewindCompleted OnGlobalRewindCompleted;
-
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalFastForwardStarted OnGlobalFastForwardStarted;
-
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalFastForwardCompleted OnGlobalFastForwardCompleted;
-
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalTimeScrubStarted OnGlobalTimeScrubStarted;
-
-	UPROPERTY(BlueprintAssignable, Category = "Rewind")
-	FOnGlobalTimeScrubCompleted OnGlobalTimeScrubCompleted;
 
+	// 时停期间切换到最近放弃的时间线（撤销回溯后的重做），再次调用会切换回来
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	void RestoreAbandonedTimeline();
+	
 private:
 	/* --------------------- 状态相关参数 --------------------- */
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind")
@@ -112,6 +157,10 @@ private:
 	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind")
 	bool bIsGlobalFastForwarding = false;
 
+	// 时间轴游标：当前播放位置距离最新记录点的秒数，回溯时增加，快进时减少；由GameState复制的状态外推，每帧取回
+	UPROPERTY(Transient, VisibleAnywhere, Category = "Rewind")
+	float TimelineCursorSeconds = 0.0f;
+
 public:
 	/* --------------------- 获取状态相关函数 --------------------- */
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
@@ -125,4 +174,7 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = "Rewind")
 	float GetGlobalRewindSpeed() const { return GlobalRewindSpeed; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	float GetTimelineCursorSeconds() const { return TimelineCursorSeconds; }
 };
@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameMode/RewindGameMode.h"
+#include "RewindGameState.generated.h"
+
+
+USTRUCT(BlueprintType)
+struct FRewindGlobalTimeState
+{
+	/* 时间操作状态，全局状态由服务器的GameMode写入，通过GameState复制到所有客户端；时间泡的局部时钟也使用该结构 */
+	GENERATED_BODY();
+
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind")
+	bool bIsRewinding = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind")
+	bool bIsFastForwarding = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind")
+	bool bIsTimeScrubbing = false;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind")
+	float GlobalRewindSpeed = 1.0f;
+
+	// 时间轴游标：CursorServerTime时播放位置距离最新记录点（实时）的秒数，0表示处于实时；只在状态变化时写入，之后按速度外推
+	UPROPERTY(BlueprintReadOnly, Category = "Rewind")
+	float TimelineCursorSeconds = 0.0f;
+
+	// 写入TimelineCursorSeconds时服务器的世界时间
+	UPROPERTY()
+	double CursorServerTime = 0.0;
+
+	// 外推到服务器时间ServerTime的游标：两次状态变化之间方向和速度不变，回溯时远离实时，快进时靠近实时
+	float GetCursorSecondsAt(double ServerTime, float MaxRewindSeconds) const;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API ARewindGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	ARewindGameState();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+public:
+	/* --------------------- 服务器写入接口 --------------------- */
+	// 只能在服务器调用：更新全局状态，并在本地广播状态变化（客户端在OnRep中广播）
+	void SetTimeState(const FRewindGlobalTimeState& NewTimeState);
+
+	void SetMaxRewindSeconds(float InMaxRewindSeconds) { MaxRewindSeconds = InMaxRewindSeconds; }
+
+	void SetPhysicsResimulationSettings(const FRewindPhysicsResimulationSettings& InSettings) { PhysicsResimulationSettings = InSettings; }
+
+public:
+	/* --------------------- 事件：全局时间状态变化，在服务器和客户端都会触发（蓝图和其他Actor在这里绑定） --------------------- */
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalRewindStarted OnGlobalRewindStarted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalRewindCompleted OnGlobalRewindCompleted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalFastForwardStarted OnGlobalFastForwardStarted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalFastForwardCompleted OnGlobalFastForwardCompleted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalTimeScrubStarted OnGlobalTimeScrubStarted;
+
+	UPROPERTY(BlueprintAssignable, Category = "Rewind")
+	FOnGlobalTimeScrubCompleted OnGlobalTimeScrubCompleted;
+
+private:
+	/* --------------------- 复制的状态 --------------------- */
+	UPROPERTY(Transient, VisibleAnywhere, ReplicatedUsing = OnRep_TimeState, Category = "Rewind")
+	FRewindGlobalTimeState TimeState;
+
+	// 最长回溯长度，客户端用它来初始化本地缓冲区
+	UPROPERTY(Transient, VisibleAnywhere, Replicated, Category = "Rewind")
+	float MaxRewindSeconds = 120.0f;
+
+	// 关卡的检查点+重新模拟设置，客户端本地记录的物理物体同样使用
+	UPROPERTY(Transient, VisibleAnywhere, Replicated, Category = "Rewind")
+	FRewindPhysicsResimulationSettings PhysicsResimulationSettings;
+
+	UFUNCTION()
+	void OnRep_TimeState(const FRewindGlobalTimeState& OldTimeState);
+
+	// 比较新旧状态并按顺序广播：先开始时停，再开始回溯/快进；先结束回溯/快进，再结束时停
+	void BroadcastTimeStateChanges(const FRewindGlobalTimeState& OldTimeState);
+
+public:
+	/* --------------------- 获取状态相关函数 --------------------- */
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	FRewindGlobalTimeState GetTimeState() const { return TimeState; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	bool IsGlobalTimeScrubbing() const { return TimeState.bIsTimeScrubbing; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	bool IsGlobalRewinding() const { return TimeState.bIsRewinding; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	bool IsGlobalFastForwarding() const { return TimeState.bIsFastForwarding; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	float GetGlobalRewindSpeed() const { return TimeState.GlobalRewindSpeed; }
+
+	// 由复制的状态按服务器时间外推，客户端的服务器时间由AGameStateBase低频校正
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	float GetTimelineCursorSeconds() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind")
+	float GetMaxRewindSeconds() const { return MaxRewindSeconds; }
+
+	const FRewindPhysicsResimulationSettings& GetPhysicsResimulationSettings() const { return PhysicsResimulationSettings; }
+};
@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindLagCompensationSubsystem.generated.h"
+
+class URewindComponent;
+
+
+/* 历史碰撞形状的类型 */
+enum class ERewindGhostShapeType : uint8
+{
+	Box,
+	Sphere,
+	Capsule,
+};
+
+struct FRewindGhost
+{
+	/* 某个Actor在过去某一时刻的碰撞体（“幽灵”），只用于查询，不会影响世界中的Actor */
+	TWeakObjectPtr<AActor> Actor;
+	TWeakObjectPtr<UPrimitiveComponent> Component;
+
+	// 过去时刻的Transform（来自回溯组件的历史插值）
+	FTransform Transform;
+
+	ERewindGhostShapeType ShapeType = ERewindGhostShapeType::Box;
+
+	// Box：局部空间中心和半长；Sphere/Capsule：半径与半高（局部空间，未缩放）
+	FVector LocalCenter = FVector::ZeroVector;
+	FVector BoxExtent = FVector::ZeroVector;
+	float Radius = 0.0f;
+	float HalfHeight = 0.0f;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API URewindLagCompensationSubsystem : public UWorldSubsystem
+{
+	/*
+	 * 延迟补偿查询：在回溯历史上重建过去某一时刻的碰撞体，并对这些“幽灵”做射线/球形扫掠检测，
+	 * 全程不调用SetActorTransform。
+	 * 候选Actor先从注册表按时间分桶的空间网格中取出（只访问查询范围覆盖的格子），再用各自历史在[Time, 现在]内经过的包围盒判断，移动再快的物体也不会漏掉；
+	 * 幽灵包括根组件和开启了查询碰撞的子组件（子组件使用当前相对根组件的姿势），骨骼网格的物理资产不重建，角色以胶囊体命中
+	 */
+	GENERATED_BODY()
+
+public:
+	/* --------------------- 查询接口（Time为服务器世界时间） --------------------- */
+	UFUNCTION(BlueprintCallable, Category = "Rewind|LagCompensation")
+	bool LineTraceAtTime(float Time, const FVector& Start, const FVector& End, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore);
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|LagCompensation")
+	bool SphereSweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore);
+
+	// 重建一组Actor在Time时刻的幽灵，没有回溯组件或历史不覆盖Time的Actor会被跳过
+	void BuildGhostsAtTime(float Time, TConstArrayView<AActor*> Actors, TArray<FRewindGhost>& OutGhosts) const;
+
+	// 粗检测：从Time到现在经过的范围（扩展碰撞体的半径）与QueryBounds相交的带有回溯组件的Actor
+	void GatherCandidateActors(float Time, const FBox& QueryBounds, TArray<AActor*>& OutActors) const;
+
+public:
+	/* --------------------- 预设值 --------------------- */
+	// 粗检测包围盒的额外扩展距离，覆盖相邻快照之间偏离直线的运动（例如抛物线的顶点）
+	UPROPERTY(Transient, BlueprintReadWrite, Category = "Rewind|LagCompensation")
+	float BroadphaseMargin = 50.0f;
+
+private:
+	bool SweepAtTime(float Time, const FVector& Start, const FVector& End, float SweepRadius, FHitResult& OutHit, const TArray<AActor*>& ActorsToIgnore);
+
+	// 根组件与开启了查询碰撞的子组件
+	static void GetGhostComponents(const AActor* Actor, const UPrimitiveComponent* RootComponent, TArray<UPrimitiveComponent*>& OutComponents);
+
+	// 根据组件的碰撞体构建幽灵的形状
+	static bool InitializeGhostShape(const UPrimitiveComponent* Component, FRewindGhost& OutGhost);
+
+	// 对单个幽灵做扫掠（SweepRadius为0时即射线），命中时返回true以及命中距离和法线
+	static bool SweepGhost(const FRewindGhost& Ghost, const FVector& Start, const FVector& Direction, float Length, float SweepRadius, float& OutDistance, FVector& OutNormal);
+};
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "RewindMassFragments.generated.h"
+
+
+USTRUCT()
+struct REWINDLEARNED_API FRewindMassHistoryFragment : public FMassFragment
+{
+	/* 实体在人群历史中的槽位：每一帧的采样按槽位连续存放在URewindMassSubsystem中，片段本身只有几个字节，不占用原型块的空间 */
+	GENERATED_BODY()
+
+	// 由观察者处理器在实体创建时分配，销毁时回收
+	int32 Slot = INDEX_NONE;
+
+	// 实体创建后记录的第一帧的序号，更早的帧中该槽位属于其他实体
+	int64 FirstFrameSerial = 0;
+};
+
+struct FRewindMassSample
+{
+	/* 紧凑的人群采样（24字节）：单精度位置，半精度速度，16位压缩的欧拉角 */
+	FVector3f Location = FVector3f::ZeroVector;
+	FFloat16 Velocity[3];
+	uint16 Rotation[3] = {0, 0, 0};
+
+	void Encode(const FTransform& Transform, const FVector& InVelocity)
+	{
+		Location = FVector3f(Transform.GetLocation());
+		const FVector3f Velocity3f(InVelocity);
+		Velocity[0] = Velocity3f.X;
+		Velocity[1] = Velocity3f.Y;
+		Velocity[2] = Velocity3f.Z;
+		const FRotator Rotator = Transform.Rotator();
+		Rotation[0] = FRotator::CompressAxisToShort(Rotator.Pitch);
+		Rotation[1] = FRotator::CompressAxisToShort(Rotator.Yaw);
+		Rotation[2] = FRotator::CompressAxisToShort(Rotator.Roll);
+	}
+
+	FVector GetLocation() const { return FVector(Location); }
+
+	FVector GetVelocity() const { return FVector(Velocity[0].GetFloat(), Velocity[1].GetFloat(), Velocity[2].GetFloat()); }
+
+	FQuat GetRotation() const
+	{
+		return FRotator(FRotator::DecompressAxisFromShort(Rotation[0]), FRotator::DecompressAxisFromShort(Rotation[1]), FRotator::DecompressAxisFromShort(Rotation[2])).Quaternion();
+	}
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassObserverProcessor.h"
+#include "MassProcessor.h"
+#include "RewindMassProcessors.generated.h"
+
+class URewindMassSubsystem;
+
+/*
+ * 执行顺序：PrePhysics中 时间线 -> 移动处理器 -> 回放（覆盖移动的结果）；PostPhysics中记录物理之后的最终状态
+ */
+
+UCLASS()
+class REWINDLEARNED_API URewindMassTimelineProcessor : public UMassProcessor
+{
+	/* 每帧在游戏线程推进一次人群时间线，不处理实体 */
+	GENERATED_BODY()
+
+public:
+	URewindMassTimelineProcessor();
+
+protected:
+	virtual void Initialize(UObject& Owner) override;
+	virtual void ConfigureQueries() override {}
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindMassSubsystem> RewindMassSubsystem;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API URewindMassRecordProcessor : public UMassProcessor
+{
+	/* 物理之后把实体的Transform和速度写入本帧的采样，按块并行 */
+	GENERATED_BODY()
+
+public:
+	URewindMassRecordProcessor();
+
+protected:
+	virtual void Initialize(UObject& Owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindMassSubsystem> RewindMassSubsystem;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API URewindMassPlaybackProcessor : public UMassProcessor
+{
+	/* 时间操作期间在移动处理器之后用插值后的采样覆盖实体的Transform和速度，按块并行 */
+	GENERATED_BODY()
+
+public:
+	URewindMassPlaybackProcessor();
+
+protected:
+	virtual void Initialize(UObject& Owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindMassSubsystem> RewindMassSubsystem;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API URewindMassSlotInitializer : public UMassObserverProcessor
+{
+	/* 实体获得FRewindMassHistoryFragment时分配历史槽位 */
+	GENERATED_BODY()
+
+public:
+	URewindMassSlotInitializer();
+
+protected:
+	virtual void Initialize(UObject& Owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindMassSubsystem> RewindMassSubsystem;
+};
+
+
+UCLASS()
+class REWINDLEARNED_API URewindMassSlotDeinitializer : public UMassObserverProcessor
+{
+	/* 实体失去FRewindMassHistoryFragment（包括被销毁）时回收历史槽位 */
+	GENERATED_BODY()
+
+public:
+	URewindMassSlotDeinitializer();
+
+protected:
+	virtual void Initialize(UObject& Owner) override;
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindMassSubsystem> RewindMassSubsystem;
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Mass/RewindMassFragments.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindMassSubsystem.generated.h"
+
+class ARewindGameState;
+
+
+UCLASS(Config = Game)
+class REWINDLEARNED_API URewindMassSubsystem : public UWorldSubsystem
+{
+	/*
+	 * Mass人群的回溯历史：与URewindComponent相同的时间线语义（正常时间记录，回溯/快进/时停按ARewindGameMode的全局状态回放，恢复时从回放位置继续记录并丢弃未来的帧），
+	 * 但所有实体共享同一组记录时刻，每一帧是按槽位排列的连续采样数组（结构数组），记录和回放处理器按块并行地读写各自的槽位。
+	 * 时间线由URewindMassTimelineProcessor每帧在游戏线程推进一次，记录和回放处理器只读取本帧的结果
+	 */
+	GENERATED_BODY()
+
+public:
+	/* --------------------- 设置（DefaultGame.ini） --------------------- */
+	// 人群的记录间隔，所有实体在同一时刻记录
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Rewind|Mass")
+	float FrameFrequencySeconds = 0.1f;
+
+	// 人群可以回溯的时长：内存约为 时长/间隔 * 实体数 * 24字节，5万个实体10秒约120MB
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Rewind|Mass")
+	float MaxRewindSeconds = 10.0f;
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	virtual void Deinitialize() override;
+
+	/* --------------------- 槽位（观察者处理器在游戏线程调用） --------------------- */
+	int32 AllocateSlot();
+
+	void ReleaseSlot(int32 Slot);
+
+	// 下一个记录的帧的序号，新实体只使用序号不小于它的帧
+	int64 GetNextFrameSerial() const { return NextFrameSerial; }
+
+	/* --------------------- 时间线（URewindMassTimelineProcessor在游戏线程调用） --------------------- */
+	void AdvanceTimeline(float DeltaTime);
+
+	/* --------------------- 本帧的结果（记录/回放处理器在工作线程读取） --------------------- */
+	// 本帧需要记录时返回要写入的帧，按槽位写入
+	bool ShouldRecord() const { return RecordFrame != INDEX_NONE; }
+	TArrayView<FRewindMassSample> GetRecordSamples() { return Frames[RecordFrame].Samples; }
+
+	// 本帧是否回放，以及回放位置两侧的帧
+	bool ShouldApplyPlayback() const { return bApplyPlayback; }
+	TConstArrayView<FRewindMassSample> GetPlaybackSamplesFrom() const { return Frames[PlaybackFrameFrom].Samples; }
+	TConstArrayView<FRewindMassSample> GetPlaybackSamplesTo() const { return Frames[PlaybackFrameTo].Samples; }
+	int64 GetPlaybackSerialFrom() const { return Frames[PlaybackFrameFrom].Serial; }
+	int64 GetPlaybackSerialTo() const { return Frames[PlaybackFrameTo].Serial; }
+	float GetPlaybackAlpha() const { return PlaybackAlpha; }
+
+	/* --------------------- 统计 --------------------- */
+	int32 GetNumFrames() const { return NumFrames; }
+	int32 GetNumActiveSlots() const { return SlotCapacity - FreeSlots.Num(); }
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FFrame
+	{
+		// 时间线上的时间：只在正常时间流逝时增加，恢复时回到回放位置，因此与世界时间无关
+		double TimelineTime = 0.0;
+		int64 Serial = 0;
+		TArray<FRewindMassSample> Samples;
+	};
+
+	// 第Index老的帧在环形数组中的下标
+	int32 GetFrameIndex(int32 Index) const { return (OldestFrame + Index) % Frames.Num(); }
+
+	const FFrame& GetFrame(int32 Index) const { return Frames[GetFrameIndex(Index)]; }
+
+	// 开始记录新的一帧，历史满时覆盖最老的帧
+	void BeginRecordFrame();
+
+	// 从回放位置继续：丢弃之后的帧
+	void ForkAtPlaybackTime();
+
+	// 找到回放位置两侧的帧和插值进度
+	void UpdatePlaybackFrames();
+
+	// 所有帧的采样数组都需要容纳SlotCapacity个槽位
+	void GrowSlotCapacity(int32 NewCapacity);
+
+	UPROPERTY(Transient)
+	TObjectPtr<ARewindGameState> GameState;
+
+	// 环形数组：OldestFrame开始的NumFrames帧有效
+	TArray<FFrame> Frames;
+	int32 OldestFrame = 0;
+	int32 NumFrames = 0;
+	int64 NextFrameSerial = 0;
+
+	int32 SlotCapacity = 0;
+	TArray<int32> FreeSlots;
+
+	double TimelineTime = 0.0;
+	float TimeSinceLastFrame = 0.0f;
+
+	// 时间操作开始时的时间线时间，回放位置 = 它 - 全局时间轴游标
+	double ManipulationStartTime = 0.0;
+	double PlaybackTime = 0.0;
+	bool bWasManipulatingTime = false;
+
+	int32 RecordFrame = INDEX_NONE;
+	bool bApplyPlayback = false;
+	int32 PlaybackFrameFrom = 0;
+	int32 PlaybackFrameTo = 0;
+	float PlaybackAlpha = 0.0f;
+};
@@ -0,0 +1,18 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTraitBase.h"
+#include "RewindMassTrait.generated.h"
+
+
+UCLASS(meta = (DisplayName = "Rewind"))
+class REWINDLEARNED_API URewindMassTrait : public UMassEntityTraitBase
+{
+	/* 加到MassEntityConfig中即可让实体参与全局回溯；有速度片段时同时记录和回放速度 */
+	GENERATED_BODY()
+
+protected:
+	virtual void BuildTemplate(FMassEntityTemplateBuildContext& BuildContext, const UWorld& World) const override;
+};
@@ -0,0 +1,187 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameMode/RewindGameState.h"
+#include "Registry/RewindSweptBoundsGrid.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindComponentRegistry.generated.h"
+
+class ARewindTimeBubbleVolume;
+class URewindComponent;
+
+/* 时钟（全局或时间泡）状态的变化，按枚举顺序分发（先开始时停，再开始回溯/快进；先结束回溯/快进，再结束时停） */
+UENUM()
+enum class ERewindGlobalTransition : uint8
+{
+	TimeScrubStarted,
+	RewindStarted,
+	FastForwardStarted,
+	RewindCompleted,
+	FastForwardCompleted,
+	TimeScrubCompleted,
+};
+
+struct FRewindClock
+{
+	/* 一组共享时间状态的组件：0号是全局时钟（状态来自GameState），其余由时间泡体积拥有 */
+	FRewindGlobalTimeState State;
+
+	// 正常时间流逝时成员Actor的时间膨胀（慢动作区域），时间操作期间不生效
+	float TimeDilation = 1.0f;
+
+	// 拥有该时钟的时间泡，全局时钟为空
+	TWeakObjectPtr<ARewindTimeBubbleVolume> Bubble;
+
+	// 成员组件，组件记录自己的下标，移出时与末尾交换删除
+	TArray<URewindComponent*> Members;
+
+	bool bInUse = false;
+	bool bHasPendingRemovals = false; // 分发期间移出的成员只置空，分发结束后再统一删除
+
+	bool IsTimeBeingManipulated() const { return State.bIsRewinding || State.bIsFastForwarding || State.bIsTimeScrubbing; }
+};
+
+UCLASS()
+class REWINDLEARNED_API URewindComponentRegistry : public UTickableWorldSubsystem
+{
+	/*
+	 * 世界中所有回溯组件的注册表：
+	 * 时间状态变化时由GameState或时间泡调用一次SetClockState，在紧凑数组上直接调用组件的原生函数，
+	 * 不再需要每个组件各自绑定GameState的动态多播委托；
+	 * 注册时为组件分配记录相位，把所有组件的记录时刻均匀分散到快照间隔中；
+	 * 时间操作期间按帧预算调度回放：玩家角色和附近可见的Actor每帧更新，其余Actor在剩余预算内轮流更新；
+	 * 组件按时钟分组（全局时钟和各个时间泡），状态变化只分发给对应时钟的成员，进出时间泡时只在分组之间移动一次；
+	 * 服务器上维护最近一段时间内组件经过的空间网格，延迟补偿的粗检测只查询附近的组件
+	 */
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	void Register(URewindComponent* Component);
+
+	void Unregister(URewindComponent* Component);
+
+	// 把状态变化分发给时钟的所有成员
+	void DispatchTransition(ERewindGlobalTransition Transition, int32 ClockIndex = GlobalClockIndex);
+
+	// 按固定顺序列出从OldState到NewState需要的状态变化：先开始时停，再开始回溯/快进；先结束回溯/快进，再结束时停
+	static void GetTransitions(const FRewindGlobalTimeState& OldState, const FRewindGlobalTimeState& NewState, TArray<ERewindGlobalTransition, TInlineAllocator<6>>& OutTransitions);
+
+	// 已注册的组件（分发期间可能包含被注销的空位）
+	TConstArrayView<TObjectPtr<URewindComponent>> GetComponents() const { return Components; }
+
+	int32 Num() const { return Components.Num() - NumPendingRemovals; }
+
+	// 每次注册或注销时递增，用于判断按注册表下标建立的缓存是否过期
+	uint32 GetMembershipSerial() const { return MembershipSerial; }
+
+public:
+	/* --------------------- 时钟分组 --------------------- */
+	static constexpr int32 GlobalClockIndex = 0;
+
+	// 时间泡开始/结束时创建和移除时钟，移除时成员回到其他重叠的时间泡或全局时钟
+	int32 AddClock(ARewindTimeBubbleVolume* Bubble);
+	void RemoveClock(int32 ClockIndex);
+
+	// 更新时钟状态并按顺序分发给成员，时钟回到正常时间后重新检查成员所在的时间泡
+	void SetClockState(int32 ClockIndex, const FRewindGlobalTimeState& NewState, float TimeDilation = 1.0f);
+
+	const FRewindClock& GetClock(int32 ClockIndex) const { return Clocks[ClockIndex]; }
+
+	// Actor进入/离开时间泡（由时间泡的重叠事件调用）；组件所在的时钟正在操作时间时不移动，等该时钟回到正常时间后再检查
+	void NotifyActorEnteredBubble(AActor* Actor, int32 ClockIndex);
+	void NotifyActorLeftBubble(AActor* Actor, int32 ClockIndex);
+
+public:
+	/* --------------------- 延迟补偿的粗检测 --------------------- */
+	// 组件记录快照时调用，只在服务器上维护
+	void RecordSweptLocation(URewindComponent* Component, const FVector& Location);
+
+	// [Time, 现在]内可能经过QueryBounds的组件；网格的窗口（Rewind.LagCompensation.MaxSeconds）不覆盖Time时返回false
+	bool GatherSweptBoundsCandidates(float Time, const FBox& QueryBounds, TArray<URewindComponent*>& OutComponents) const;
+
+public:
+	/* --------------------- 回放调度 --------------------- */
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	// 本帧是否应该把组件的回放结果应用到owner上；不应用的组件只推进时间轴，轮到它时直接应用到正确的位置
+	bool ShouldApplyPlayback(const URewindComponent* Component) const;
+
+	// 组件报告本帧回放（推进、混合、应用）的耗时，用于估计下一帧能轮到多少个低优先级组件
+	void ReportPlaybackCost(const URewindComponent* Component, double Seconds);
+
+private:
+	// 删除分发期间注销留下的空位
+	void CompactComponents();
+	void CompactClock(FRewindClock& Clock);
+
+	// 分发结束后处理分发期间推迟的删除、时钟移除和分组变化
+	void FinishDispatch();
+
+	// 把组件移到另一个时钟，并让组件的状态与新时钟一致；分发期间推迟到分发结束后执行
+	void MoveToClock(URewindComponent* Component, int32 ClockIndex);
+
+	// 从时钟的成员中移除（不改变组件的状态）
+	void RemoveFromClock(URewindComponent* Component);
+
+	// Actor所在的时间泡的时钟，优先保留PreferredClockIndex，不在任何时间泡中时为全局时钟
+	int32 FindClockForActor(const AActor* Actor, int32 PreferredClockIndex, int32 ExcludedClockIndex = INDEX_NONE) const;
+
+	// 时钟回到正常时间后，把已经离开（或进入了其他时间泡）的成员移到正确的时钟
+	void ReevaluateClockMembers(int32 ClockIndex);
+
+	bool IsAnyClockManipulatingTime() const;
+
+	bool ShouldMaintainSweptBounds() const;
+
+	FRewindSweptBoundsGrid SweptBoundsGrid;
+
+	// 所有时钟，下标是时钟编号，移除的时钟留下空位等待复用
+	TArray<FRewindClock> Clocks;
+	TArray<int32> FreeClockIndices;
+
+	// 分发期间的分组变化和时钟移除
+	TArray<TPair<TWeakObjectPtr<URewindComponent>, int32>> PendingClockMoves;
+	TArray<int32> PendingClockRemovals;
+
+	// 紧凑数组，组件记录自己的下标，注销时与末尾交换删除
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<URewindComponent>> Components;
+
+	// 为新注册的组件分配记录相位
+	static float ComputeSnapshotPhase(uint32 RegistrationIndex);
+
+	// 累计注册次数，用于生成相位序列
+	uint32 NumRegistrations = 0;
+
+	uint32 MembershipSerial = 0;
+
+	// 在帧末为下一帧分配回放时间片
+	void PlanPlayback();
+
+	// 玩家控制的Pawn，或离玩家视点较近且最近被渲染过（专用服务器上只看距离）的Actor
+	static bool IsHighPlaybackPriority(const URewindComponent* Component, TConstArrayView<FVector> ViewLocations);
+
+	bool bPlaybackBudgetEnabled = false;
+	uint32 PlanSerial = 0; // 每次规划递增，组件的PlaybackTurnSerial等于它时表示本帧轮到该组件
+	int32 RoundRobinCursor = 0;
+	TArray<URewindComponent*> LowPriorityComponents; // 每次规划时重建，组件的生命周期由Components保证
+
+	// 本帧累计的回放耗时
+	double FrameHighPriorityMilliseconds = 0.0;
+	double FrameLowPriorityMilliseconds = 0.0;
+	int32 FrameNumLowPriorityApplied = 0;
+
+	// 平滑后的耗时估计
+	double AverageHighPriorityMilliseconds = 0.0;
+	double AverageLowPriorityMillisecondsPerComponent = 0.01;
+
+	// 分发期间注销的组件只置空，分发结束后再统一删除，保证遍历时数组不变
+	bool bIsDispatching = false;
+	int32 NumPendingRemovals = 0;
+};
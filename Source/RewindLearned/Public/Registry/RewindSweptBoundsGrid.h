@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+class URewindComponent;
+
+class FRewindSweptBoundsGrid
+{
+	/*
+	 * 延迟补偿的粗检测网格：按时间分桶的空间哈希，每个桶记录这段时间内每个格子里经过过哪些回溯组件；
+	 * 组件记录快照时把它与上一个位置之间的线段（扩展碰撞体的半径）写入当前桶覆盖的格子，
+	 * 每个新桶开始时再写入一次所有组件现在的位置，记录间隔较长或停止记录的组件也不会从最近的桶中消失；
+	 * 查询只访问与查询包围盒相交的格子，开销与附近的组件数量成正比，而不是与世界中的回溯组件总数成正比。
+	 * 结果是保守的（可能多出附近的组件，不会漏掉），调用方再用组件自己的历史做精确判断
+	 */
+public:
+	// 组件记录了新的位置
+	void Add(URewindComponent* Component, const FVector& Location);
+
+	void Remove(const URewindComponent* Component);
+
+	// 时间推进到Now：进入新的桶时写入所有组件现在的位置，丢弃超出窗口的桶
+	void Tick(float Now);
+
+	// [Time, 现在]内可能经过QueryBounds的组件（不重复）；保存的桶不覆盖Time时返回false，调用方需要退回到其他方法
+	bool Query(float Time, const FBox& QueryBounds, TArray<URewindComponent*>& OutComponents) const;
+
+	void Reset();
+
+private:
+	struct FBucket
+	{
+		float StartTime = 0.0f;
+		TMap<FIntVector, TArray<TWeakObjectPtr<URewindComponent>, TInlineAllocator<4>>> Cells;
+	};
+
+	struct FTrackedComponent
+	{
+		TWeakObjectPtr<URewindComponent> Component;
+		FVector Location = FVector::ZeroVector;
+
+		// 碰撞体相对位置的半径，每个桶开始时更新
+		float Radius = 0.0f;
+
+		// 当前桶中已经写入的格子范围，范围不变时不重复写入
+		uint32 BucketSerial = 0;
+		FIntVector MinCell = FIntVector::ZeroValue;
+		FIntVector MaxCell = FIntVector::ZeroValue;
+	};
+
+	// 把From到To的线段写入当前桶
+	void Insert(FTrackedComponent& Tracked, const FVector& From, const FVector& To);
+
+	static FIntVector GetCell(const FVector& Location);
+
+	// 按开始时间排序，最后一个是当前桶
+	TArray<FBucket> Buckets;
+	uint32 BucketSerial = 0;
+
+	TMap<TObjectKey<URewindComponent>, FTrackedComponent> TrackedComponents;
+};
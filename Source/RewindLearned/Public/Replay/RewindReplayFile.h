@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FTransformAndVelocitySnapshot;
+struct FMovementVelocityAndModeSnapshot;
+
+/*
+ * 回放文件格式（小端）：
+ *   文件头：Magic + 格式版本
+ *   若干自描述块：[块ID(uint32) | 块大小(int64) | 数据]，读取时跳过不认识的块
+ *     HEAD：全局信息（时间范围、轨道数量、分段时长）
+ *     TRAK：轨道表，每个Actor一条轨道
+ *     SEGM：分段的采样数据，每段覆盖一个时间窗口内所有轨道的采样
+ *     SIDX：分段的定位索引（时间范围 -> 文件偏移）
+ *   文件尾：SIDX块的偏移 + 尾部Magic，打开文件时直接定位索引，不需要扫描整个文件
+ */
+namespace RewindReplay
+{
+	constexpr uint32 MakeChunkId(char A, char B, char C, char D)
+	{
+		return static_cast<uint32>(A) | (static_cast<uint32>(B) << 8) | (static_cast<uint32>(C) << 16) | (static_cast<uint32>(D) << 24);
+	}
+
+	constexpr uint32 FileMagic = MakeChunkId('R', 'W', 'N', 'D');
+	constexpr uint32 FooterMagic = MakeChunkId('R', 'W', 'F', 'T');
+	constexpr uint32 HeaderChunkId = MakeChunkId('H', 'E', 'A', 'D');
+	constexpr uint32 TrackTableChunkId = MakeChunkId('T', 'R', 'A', 'K');
+	constexpr uint32 SegmentChunkId = MakeChunkId('S', 'E', 'G', 'M');
+	constexpr uint32 SeekIndexChunkId = MakeChunkId('S', 'I', 'D', 'X');
+
+	// 格式版本，修改文件布局时递增
+	constexpr uint32 FormatVersion = 1;
+
+	// 文件扩展名
+	inline const TCHAR* FileExtension = TEXT(".rwnd");
+}
+
+struct FRewindReplayHeader
+{
+	uint32 FormatVersion = RewindReplay::FormatVersion;
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+	float SegmentDurationSeconds = 2.0f;
+	int32 NumTracks = 0;
+	int32 NumSegments = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FRewindReplayHeader& Header);
+};
+
+struct FRewindReplayTrackInfo
+{
+	/* 一条轨道对应一个Actor，使用路径名作为稳定的标识 */
+	FString ActorPath;
+	FString ActorClassPath;
+	bool bHasMovement = false;
+	int32 NumSamples = 0;
+	float FirstTime = 0.0f;
+	float LastTime = 0.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FRewindReplayTrackInfo& TrackInfo);
+};
+
+struct FRewindReplaySample
+{
+	/* 紧凑的采样：单精度存储，角色运动数据只在轨道带有运动信息时写入 */
+	float Time = 0.0f;
+	FVector3f Location = FVector3f::ZeroVector;
+	FQuat4f Rotation = FQuat4f::Identity;
+	FVector3f Scale = FVector3f::OneVector;
+	FVector3f LinearVelocity = FVector3f::ZeroVector;
+	FVector3f AngularVelocityInRadians = FVector3f::ZeroVector;
+	FVector3f MovementVelocity = FVector3f::ZeroVector;
+	uint8 MovementMode = 0;
+
+	void Serialize(FArchive& Ar, bool bHasMovement);
+
+	FTransform GetTransform() const;
+
+	static FRewindReplaySample Blend(const FRewindReplaySample& A, const FRewindReplaySample& B, float Alpha);
+};
+
+struct FRewindReplaySegmentIndexEntry
+{
+	float StartTime = 0.0f;
+	float EndTime = 0.0f;
+	int64 FileOffset = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FRewindReplaySegmentIndexEntry& Entry);
+};
+
+struct FRewindReplayCapture
+{
+	/* 在游戏线程上从回溯组件复制出的全部历史，之后交给后台线程写入文件 */
+	struct FTrack
+	{
+		FRewindReplayTrackInfo Info;
+		TArray<FRewindReplaySample> Samples; // 按时间排序
+	};
+
+	TArray<FTrack> Tracks;
+
+	// 把一个组件的历史转换为轨道，MovementSnapshots为空时表示没有运动信息
+	void AddTrack(const AActor* Actor, TConstArrayView<FTransformAndVelocitySnapshot> TransformSnapshots, TConstArrayView<FMovementVelocityAndModeSnapshot> MovementSnapshots);
+};
+
+
+class REWINDLEARNED_API FRewindReplayWriter
+{
+public:
+	// 把采集到的历史写入文件（可在任意线程调用）：先写临时文件，成功后再替换目标文件
+	static bool WriteToFile(const FRewindReplayCapture& Capture, const FString& FilePath, float SegmentDurationSeconds = 2.0f);
+};
+
+
+class REWINDLEARNED_API FRewindReplayReader
+{
+	/* 流式读取：打开时只读取文件头、轨道表和定位索引，采样数据按分段读取，并只缓存最近使用的几个分段 */
+public:
+	~FRewindReplayReader();
+
+	bool Open(const FString& FilePath);
+
+	void Close();
+
+	bool IsOpen() const { return FileReader.IsValid(); }
+
+	const FRewindReplayHeader& GetHeader() const { return Header; }
+
+	const TArray<FRewindReplayTrackInfo>& GetTracks() const { return Tracks; }
+
+	// 获得轨道在Time时刻插值后的采样，Time不在该轨道的时间范围内时返回false
+	bool SampleTrack(int32 TrackIndex, float Time, FRewindReplaySample& OutSample);
+
+	// 最多同时缓存的分段数量
+	static constexpr int32 MaxCachedSegments = 3;
+
+private:
+	struct FLoadedSegment
+	{
+		int32 SegmentIndex = INDEX_NONE;
+		uint64 LastUsedCounter = 0;
+		TMap<int32, TArray<FRewindReplaySample>> TrackSamples;
+	};
+
+	// 读取块头，返回false表示已到文件末尾或数据损坏
+	bool ReadChunkHeader(uint32& OutChunkId, int64& OutChunkSize);
+
+	int32 FindSegmentIndex(float Time) const;
+
+	const FLoadedSegment* LoadSegment(int32 SegmentIndex);
+
+	TUniquePtr<FArchive> FileReader;
+	FRewindReplayHeader Header;
+	TArray<FRewindReplayTrackInfo> Tracks;
+	TArray<FRewindReplaySegmentIndexEntry> SeekIndex;
+
+	TArray<TUniquePtr<FLoadedSegment>> CachedSegments;
+	uint64 UseCounter = 0;
+};
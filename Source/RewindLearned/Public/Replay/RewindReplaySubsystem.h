@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Replay/RewindReplayFile.h"
+#include "RewindReplaySubsystem.generated.h"
+
+class URewindComponent;
+
+
+UCLASS()
+class REWINDLEARNED_API URewindReplaySubsystem : public UTickableWorldSubsystem
+{
+	/*
+	 * 保存/回放整个世界的回溯历史：
+	 * 保存时在游戏线程复制历史，再由后台线程写入文件；回放时从磁盘按分段流式读取，可用于击杀回放或问题复现
+	 */
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+public:
+	/* --------------------- 保存 --------------------- */
+	// 异步保存当前世界的全部回溯历史到Saved/Rewind/<ReplayName>.rwnd，上一次保存未完成时返回false
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	bool SaveReplayAsync(const FString& ReplayName);
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	bool IsSavingReplay() const { return PendingSave.IsValid() && !PendingSave.IsReady(); }
+
+	/* --------------------- 回放 --------------------- */
+	// 打开回放文件，并把轨道应用到世界中路径相同的Actor上；没有对应Actor的轨道仍可通过GetReplayReader读取
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	bool StartReplayPlayback(const FString& ReplayName);
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	void StopReplayPlayback();
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	bool IsPlayingReplay() const { return bIsPlayingReplay; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|Replay")
+	float GetReplayPlaybackTime() const { return PlaybackTime; }
+
+	// 无头模式下直接读取回放数据
+	FRewindReplayReader* GetReplayReader() const { return ReplayReader.Get(); }
+
+	static FString GetReplayFilePath(const FString& ReplayName);
+
+private:
+	// 在游戏线程上复制世界中所有回溯组件的历史
+	void CaptureWorldHistory(FRewindReplayCapture& OutCapture) const;
+
+	TFuture<bool> PendingSave;
+
+	TUniquePtr<FRewindReplayReader> ReplayReader;
+
+	// 与轨道一一对应，没有找到的Actor为空
+	TArray<TWeakObjectPtr<AActor>> PlaybackActors;
+
+	// 回放期间暂停了记录和模拟的回溯组件，回放结束后恢复
+	TArray<TWeakObjectPtr<URewindComponent>> SuspendedComponents;
+
+	bool bIsPlayingReplay = false;
+
+	float PlaybackTime = 0.0f;
+};
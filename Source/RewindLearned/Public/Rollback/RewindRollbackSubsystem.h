@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Component/RewindPhysicsResimulation.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindRollbackSubsystem.generated.h"
+
+class URewindComponent;
+
+
+struct FRewindRollbackBodyState
+{
+	/* 一个回溯组件的owner在一帧开始时的状态，平凡可复制，一帧的状态是按物体下标排列的连续数组 */
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector LinearVelocity = FVector::ZeroVector; // 模拟物理时是刚体速度，角色是移动组件的速度，其他Actor是GetVelocity
+	FVector AngularVelocityInRadians = FVector::ZeroVector;
+	uint8 MovementMode = 0; // EMovementMode，没有角色移动组件时为MOVE_None
+
+	bool operator==(const FRewindRollbackBodyState& Other) const
+	{
+		return Location == Other.Location && Rotation == Other.Rotation && LinearVelocity == Other.LinearVelocity &&
+			AngularVelocityInRadians == Other.AngularVelocityInRadians && MovementMode == Other.MovementMode;
+	}
+};
+
+struct FRewindRollbackChildPose
+{
+	/* RecordedChildComponents中子组件的相对Transform */
+	FVector Location = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	FVector Scale3D = FVector::OneVector;
+
+	bool operator==(const FRewindRollbackChildPose& Other) const
+	{
+		return Location == Other.Location && Rotation == Other.Rotation && Scale3D == Other.Scale3D;
+	}
+};
+
+static_assert(std::is_trivially_copyable_v<FRewindRollbackBodyState> && std::is_trivially_copyable_v<FRewindRollbackChildPose>,
+	"Rollback frames are copied as raw bytes");
+
+struct FRewindRollbackInput
+{
+	/* 一帧开始时施加到某个物体上的输入（例如玩家的推力、投射物的冲量），已经换算成速度变化 */
+	int32 Frame = 0;
+	int32 BodyIndex = INDEX_NONE; // URewindRollbackSubsystem::GetBodyIndex
+	FVector LinearVelocityChange = FVector::ZeroVector;
+	FVector AngularVelocityChange = FVector::ZeroVector;
+};
+
+// 在POD状态上模拟一帧（输入已经施加），绑定后代替内置的刚体模型
+DECLARE_DELEGATE_ThreeParams(FRewindRollbackSimulateFrame, int32 /*Frame*/, float /*DeltaSeconds*/, TArrayView<FRewindRollbackBodyState> /*Bodies*/);
+
+
+UCLASS(Config = Game)
+class REWINDLEARNED_API URewindRollbackSubsystem : public UWorldSubsystem
+{
+	/*
+	 * 回滚网络同步（GGPO式）的基础：保存和恢复整个世界中所有回溯组件的状态
+	 * 一帧的状态是一块连续内存（物体状态数组 + 子组件姿势数组），保存的帧按槽位放在环形缓冲中，读取和修正一帧都是一次内存复制；
+	 * 写回世界时只处理与世界当前状态不同的物体，不经过SetActorTransform；
+	 * 迟到的输入到达后从受影响的帧开始，在POD状态上逐帧施加输入并模拟到当前帧，中间帧不写入世界，最后只写入一次。
+	 * 内置的刚体模型不处理接触，只修正这段时间内有输入的物体，其他物体保留保存的帧和世界中的状态；
+	 * 绑定OnSimulateFrame（游戏自己的确定性模拟）时修正所有物体。
+	 * 与回溯组件的历史相互独立：回滚的修正在回溯历史中表现为一次瞬移
+	 */
+	GENERATED_BODY()
+
+public:
+	/* --------------------- 设置（DefaultGame.ini） --------------------- */
+	// 保存的帧数，即最多可以回滚的帧数
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Rewind|Rollback")
+	int32 MaxRollbackFrames = 8;
+
+	// 重新模拟的固定步长，应与游戏的固定帧率一致
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Rewind|Rollback")
+	float FixedStepSeconds = 1.0f / 60.0f;
+
+public:
+	virtual void Deinitialize() override;
+
+	/* --------------------- 保存与恢复（游戏线程） --------------------- */
+	// 保存世界在Frame开始时（施加该帧的输入之前）的状态；注册的组件变化后重建布局，并清空已保存的帧和输入
+	void SaveFrame(int32 Frame);
+
+	// 把世界恢复到Frame开始时的状态，Frame没有保存时返回false
+	bool LoadFrame(int32 Frame);
+
+	bool HasFrame(int32 Frame) const;
+
+	int32 GetLatestSavedFrame() const { return LatestSavedFrame; }
+
+	/* --------------------- 输入与重新模拟 --------------------- */
+	// 物体在状态数组中的下标，布局中没有该组件时为INDEX_NONE；布局重建后下标失效
+	int32 GetBodyIndex(const URewindComponent* Component) const;
+
+	// 记录本帧施加到世界上的输入（由游戏自己施加），重新模拟时按帧重放
+	void AddInput(const FRewindRollbackInput& Input);
+
+	// 记录已经模拟过的帧的输入（迟到的远端输入或预测错误的修正），记下需要回滚的最早帧
+	void AddLateInput(const FRewindRollbackInput& Input);
+
+	// 从Frame开始重新模拟NumFrames帧：逐帧施加输入并模拟，更新保存的帧，最后把Frame + NumFrames的状态写入世界；
+	// 没有绑定OnSimulateFrame时只修正[Frame, Frame + NumFrames)内有输入的物体（包括它们的保存帧），子组件的姿势不变
+	bool Resimulate(int32 Frame, int32 NumFrames);
+
+	// 有迟到的输入时从受影响的最早帧重新模拟到最新保存的帧之后（在新的一帧开始、SaveFrame之前调用），返回重新模拟的帧数
+	int32 RollbackForLateInputs();
+
+	// 绑定后由游戏模拟一帧，修正所有物体；不绑定时使用内置的刚体模型：重力、阻尼和输入，不处理接触，因此只修正有输入的物体
+	FRewindRollbackSimulateFrame OnSimulateFrame;
+
+	/* --------------------- 统计 --------------------- */
+	int32 GetNumBodies() const { return Bodies.Num(); }
+
+	// 一帧状态的字节数
+	SIZE_T GetFrameSizeBytes() const { return FrameStride; }
+
+private:
+	struct FBodyLayout
+	{
+		TWeakObjectPtr<URewindComponent> Component;
+		FRewindRigidBodyModel Model;
+		bool bSimulatesPhysics = false;
+		int32 FirstChild = 0;
+		int32 NumChildren = 0;
+	};
+
+	// 布局：物体和子组件在一帧状态中的位置，注册表的成员变化后重建
+	TArray<FBodyLayout> Bodies;
+	TArray<TWeakObjectPtr<USceneComponent>> Children;
+	uint32 LayoutMembershipSerial = 0;
+	bool bHasLayout = false;
+	SIZE_T ChildPosesOffset = 0;
+	SIZE_T FrameStride = 0;
+
+	bool IsLayoutCurrent() const;
+	void RebuildLayout();
+
+	// 一帧状态中的两个数组
+	TArrayView<FRewindRollbackBodyState> GetBodyStates(uint8* Block) const;
+	TConstArrayView<FRewindRollbackBodyState> GetBodyStates(const uint8* Block) const;
+	TArrayView<FRewindRollbackChildPose> GetChildPoses(uint8* Block) const;
+	TConstArrayView<FRewindRollbackChildPose> GetChildPoses(const uint8* Block) const;
+
+	// 保存的帧，第Frame帧在槽位Frame % MaxRollbackFrames中
+	TArray<uint8, TAlignedHeapAllocator<16>> FrameBuffer;
+	TArray<int32> SlotFrames; // 槽位中的帧号，空槽位为INDEX_NONE
+	int32 LatestSavedFrame = INDEX_NONE;
+
+	int32 GetSlotIndex(int32 Frame) const;
+	uint8* FindFrame(int32 Frame);
+
+	// 写回世界前读取的世界当前状态，只写入与它不同的物体
+	TArray<uint8, TAlignedHeapAllocator<16>> WorldState;
+
+	// 重新模拟的工作状态
+	TArray<uint8, TAlignedHeapAllocator<16>> ScratchState;
+
+	// 与Bodies一一对应，重新模拟时修正的物体：组件仍然存在（开始时在游戏线程解析），使用内置模型时还需要在重新模拟的帧内有输入
+	TBitArray<> ResimulatedBodies;
+
+	// 从世界读取状态
+	void CaptureWorld(uint8* Block) const;
+
+	// 把状态写入世界，只写入与世界当前状态不同的物体和子组件；给出OnlyBodies时只写入其中物体的状态，不写入子组件
+	void WriteWorld(const uint8* Block, const TBitArray<>* OnlyBodies = nullptr);
+
+	// 施加Frame的输入并模拟一帧
+	void SimulateFrame(uint8* Block, int32 Frame);
+
+	// 按帧排序，早于最老的保存帧的输入被丢弃
+	TArray<FRewindRollbackInput> Inputs;
+
+	// 迟到的输入影响的最早帧
+	int32 EarliestLateInputFrame = MAX_int32;
+
+	void ResetFrames();
+};
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_GAMEPLAY_DEBUGGER
+#include "GameplayDebuggerCategory.h"
+
+class FGameplayDebuggerCategory_Rewind : public FGameplayDebuggerCategory
+{
+	/* Gameplay Debugger（'键）中的Rewind分类：显示回溯内存总量、占用最多的类和Actor，以及当前调试Actor的历史 */
+public:
+	FGameplayDebuggerCategory_Rewind();
+
+	virtual void CollectData(APlayerController* OwnerPC, AActor* DebugActor) override;
+
+	static TSharedRef<FGameplayDebuggerCategory> MakeInstance();
+
+	// 每张表显示的行数
+	static constexpr int32 MaxEntries = 5;
+};
+#endif
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindFidelitySubsystem.generated.h"
+
+class URewindComponent;
+
+/* 误差统计的阶段 */
+enum class ERewindFidelityPass : uint8
+{
+	Rewind,      // 回溯中应用的快照与同一时刻的真实状态比较
+	FastForward, // 快进中应用的快照与同一时刻的真实状态比较
+	Resume,      // 恢复物理后的新轨迹与原来的轨迹比较（漂移）
+	Num
+};
+
+struct FRewindFidelityErrorStats
+{
+	/* 位置（cm）、旋转（度）、线速度（cm/s）误差的均值、均方根和最大值 */
+	int32 NumSamples = 0;
+	double PositionSum = 0.0;
+	double PositionSquaredSum = 0.0;
+	double PositionMax = 0.0;
+	double RotationSum = 0.0;
+	double RotationMax = 0.0;
+	double VelocitySum = 0.0;
+	double VelocityMax = 0.0;
+
+	void Add(double PositionError, double RotationErrorDegrees, double VelocityError);
+	void Merge(const FRewindFidelityErrorStats& Other);
+
+	double GetPositionMean() const { return NumSamples > 0 ? PositionSum / NumSamples : 0.0; }
+	double GetPositionRms() const { return NumSamples > 0 ? FMath::Sqrt(PositionSquaredSum / NumSamples) : 0.0; }
+	double GetRotationMean() const { return NumSamples > 0 ? RotationSum / NumSamples : 0.0; }
+	double GetVelocityMean() const { return NumSamples > 0 ? VelocitySum / NumSamples : 0.0; }
+};
+
+struct FRewindFidelityReportEntry
+{
+	FString Name; // Actor名，汇总行为"Total"
+	FRewindFidelityErrorStats Passes[static_cast<int32>(ERewindFidelityPass::Num)];
+};
+
+UCLASS()
+class REWINDLEARNED_API URewindFidelitySubsystem : public UTickableWorldSubsystem
+{
+	/*
+	 * 回溯保真度测试模式（默认关闭，只用于调整内存与保真度的取舍）：
+	 * 每帧在物理之后记录每个回溯组件的真实状态，与组件自己的历史并行；
+	 * 回溯和快进期间把组件应用的快照与真实状态在同一时刻（快照的RecordedTime）比较；
+	 * 恢复物理（UnpausePhysics）后的DriftWindowSeconds内，把新的轨迹与原来从恢复点开始的轨迹比较，得到恢复后的漂移
+	 * 控制台命令：Rewind.Fidelity.Start / Rewind.Fidelity.Stop / Rewind.Fidelity.Report [CsvPath]
+	 */
+	GENERATED_BODY()
+
+public:
+	void StartMeasuring();
+
+	// 停止记录，保留已经统计的误差
+	void StopMeasuring();
+
+	bool IsMeasuring() const { return bIsMeasuring; }
+
+	// 恢复物理后比较漂移的时长
+	float DriftWindowSeconds = 2.0f;
+
+	// 按Actor统计的误差（按回溯位置误差的最大值从大到小排序）和汇总
+	void GatherReport(TArray<FRewindFidelityReportEntry>& OutPerActor, FRewindFidelityReportEntry& OutTotal) const;
+
+	// 输出到日志，MaxEntries限制Actor的行数
+	void DumpReport(int32 MaxEntries) const;
+
+	// 每个Actor每个阶段一行
+	bool WriteCsv(const FString& Path) const;
+
+	virtual void Tick(float DeltaTime) override;
+
+	virtual TStatId GetStatId() const override;
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FTruthSample
+	{
+		float Time = 0.0f; // 世界时间，与快照的RecordedTime对应
+		FVector Location = FVector::ZeroVector;
+		FQuat Rotation = FQuat::Identity;
+		FVector LinearVelocity = FVector::ZeroVector;
+	};
+
+	struct FTrackedComponent
+	{
+		FString Name;
+
+		// 与组件的时间线结构相同：恢复时截断到恢复点，之后继续追加
+		TArray<FTruthSample> Truth;
+
+		// 恢复前的原轨迹（从恢复点开始），漂移窗口结束后释放
+		TArray<FTruthSample> ResumeReference;
+		float ResumePlaybackTime = 0.0f;
+		float ResumeWorldTime = 0.0f;
+
+		bool bWasManipulating = false;
+		uint32 LastAppliedSnapshotSerial = 0; // 回放没有轮到组件的帧不重复统计
+		FRewindFidelityErrorStats Passes[static_cast<int32>(ERewindFidelityPass::Num)];
+	};
+
+	void TickComponent(URewindComponent& Component, FTrackedComponent& Tracked, float DeltaTime);
+
+	// 当前的真实状态
+	static FTruthSample CaptureTruth(const URewindComponent& Component, float Time);
+
+	// 在按时间排序的样本中插值，Time超出范围时返回false
+	static bool SampleTruth(const TArray<FTruthSample>& Samples, float Time, FTruthSample& OutSample);
+
+	static void AddError(FRewindFidelityErrorStats& Stats, const FTruthSample& Truth, const FVector& Location, const FQuat& Rotation, const FVector& LinearVelocity);
+
+	TMap<TWeakObjectPtr<URewindComponent>, FTrackedComponent> TrackedComponents;
+
+	bool bIsMeasuring = false;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Component/RewindComponent.h"
+
+struct FRewindMemoryReportEntry
+{
+	FString Name; // Actor名或类名
+	int32 NumComponents = 0;
+	FRewindMemoryUsage Usage; // 按类汇总时HistorySeconds为最大值
+};
+
+struct REWINDLEARNED_API FRewindMemoryReport
+{
+	/*
+	 * 世界中所有回溯组件的历史内存，按Actor和按类统计，均按预留内存从大到小排序
+	 * 控制台命令：Rewind.DumpMemory [显示条数]
+	 */
+	TArray<FRewindMemoryReportEntry> PerActor;
+	TArray<FRewindMemoryReportEntry> PerClass;
+	FRewindMemoryUsage Total;
+	int32 NumComponents = 0;
+
+	// 在游戏线程上收集World中的回溯组件
+	static FRewindMemoryReport Gather(const UWorld* World);
+
+	// 输出到日志，MaxEntries限制每张表的行数
+	void Dump(int32 MaxEntries) const;
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+
+/*
+ * 回溯的性能统计：
+ *   stat Rewind                         -> 各阶段的耗时（记录、查找、混合、应用、物理切换、回滚、事件）和每帧的组件/采样计数
+ *   csvprofile start / -csvCategories=Rewind -> 同样的数据写入CSV，用于自动化采集
+ *   -trace=cpu,Rewind                   -> Insights中每帧一条汇总事件
+ * Shipping中全部编译为空
+ */
+#define REWIND_STATS_ENABLED (!UE_BUILD_SHIPPING)
+
+DECLARE_STATS_GROUP(TEXT("Rewind"), STATGROUP_Rewind, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Record"), STAT_RewindRecord, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Seek"), STAT_RewindSeek, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Blend"), STAT_RewindBlend, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply"), STAT_RewindApply, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Physics Transition"), STAT_RewindPhysicsTransition, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rollback Save"), STAT_RewindRollbackSave, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rollback Load"), STAT_RewindRollbackLoad, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Rollback Resimulate"), STAT_RewindRollbackResimulate, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Event Seek"), STAT_RewindEventSeek, STATGROUP_Rewind, REWINDLEARNED_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Recording Components"), STAT_RewindRecordingComponents, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rewinding Components"), STAT_RewindRewindingComponents, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fast Forwarding Components"), STAT_RewindFastForwardingComponents, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scrubbing Components"), STAT_RewindScrubbingComponents, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Samples Recorded"), STAT_RewindSamplesRecorded, STATGROUP_Rewind, REWINDLEARNED_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Samples Skipped"), STAT_RewindSamplesSkipped, STATGROUP_Rewind, REWINDLEARNED_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(REWINDLEARNED_API, Rewind);
+
+// 回溯历史的内存（-llm 下的 Rewind 标签）
+LLM_DECLARE_TAG_API(Rewind, REWINDLEARNED_API);
+
+#if REWIND_STATS_ENABLED
+UE_TRACE_CHANNEL_EXTERN(RewindChannel, REWINDLEARNED_API);
+#endif
+
+// 组件在本帧所处的状态，用于按状态计数
+enum class ERewindStatsState : uint8
+{
+	Recording,
+	Rewinding,
+	FastForwarding,
+	Scrubbing,
+	Num
+};
+
+class REWINDLEARNED_API FRewindFrameStats
+{
+	/* 游戏线程上按帧累加的计数，帧结束时写入CSV和Trace并清零 */
+public:
+	static void Startup();
+	static void Shutdown();
+
+	static void AddActiveComponent(ERewindStatsState State);
+	static void AddSampleRecorded();
+	static void AddSampleSkipped();
+
+private:
+	static void OnEndFrame();
+
+	static uint32 ActiveComponents[static_cast<int32>(ERewindStatsState::Num)];
+	static uint32 SamplesRecorded;
+	static uint32 SamplesSkipped;
+	static FDelegateHandle EndFrameHandle;
+};
+
+#if REWIND_STATS_ENABLED
+// 同时计入stat Rewind和CSV的耗时区间
+#define REWIND_SCOPE_CYCLE_COUNTER(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Rewind##Name); \
+	CSV_SCOPED_TIMING_STAT(Rewind, Name)
+#define REWIND_STATS_ACTIVE_COMPONENT(State) FRewindFrameStats::AddActiveComponent(State)
+#define REWIND_STATS_SAMPLE_RECORDED() FRewindFrameStats::AddSampleRecorded()
+#define REWIND_STATS_SAMPLE_SKIPPED() FRewindFrameStats::AddSampleSkipped()
+#else
+#define REWIND_SCOPE_CYCLE_COUNTER(Name)
+#define REWIND_STATS_ACTIVE_COMPONENT(State)
+#define REWIND_STATS_SAMPLE_RECORDED()
+#define REWIND_STATS_SAMPLE_SKIPPED()
+#endif
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Component/RewindComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "RewindHistoryColdStorage.generated.h"
+
+
+/* 一个Actor被卸载时的历史（解压后的形式） */
+struct FRewindColdHistory
+{
+	TArray<FTransformAndVelocitySnapshot> TransformSnapshots;
+
+	// 与TransformSnapshots一一对应，没有记录运动组件数据时为空
+	TArray<FMovementVelocityAndModeSnapshot> MovementSnapshots;
+
+	// 开头已经化简过的快照数量
+	int32 NumSimplifiedSnapshots = 0;
+};
+
+UCLASS()
+class REWINDLEARNED_API URewindHistoryColdStorage : public UWorldSubsystem
+{
+	/*
+	 * World Partition的单元卸载时其中的Actor被销毁，回溯组件把历史压缩后存放在这里，按稳定的Actor标识（路径名）索引；
+	 * 单元重新加载后组件只记录是否有冷历史，第一次进入时间操作时才解压并接回到历史开头，不需要保持单元加载也能跨越流送边界回溯。
+	 * 压缩在线程池中进行；超过回溯上限的冷历史不再可能被回放，存入新历史时顺带删除
+	 */
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	// 关卡中放置的Actor才有跨流送稳定的标识，运行时生成的Actor返回空字符串
+	static FString GetActorKey(const AActor* Actor);
+
+	// 存入卸载的Actor的历史，HorizonSeconds之后过期
+	void Store(const FString& ActorKey, FRewindColdHistory&& History, float HorizonSeconds);
+
+	bool Contains(const FString& ActorKey) const;
+
+	// 取出并删除冷历史，不存在或已过期时返回false；压缩还没有完成时等待它完成
+	bool Retrieve(const FString& ActorKey, FRewindColdHistory& OutHistory);
+
+	int32 Num() const { return Entries.Num(); }
+
+	// 已经完成压缩的冷历史占用的内存
+	SIZE_T GetAllocatedSize() const;
+
+private:
+	struct FEncodedHistory
+	{
+		TArray<uint8> CompressedData;
+		int32 UncompressedSize = 0;
+	};
+
+	struct FEntry
+	{
+		TFuture<FEncodedHistory> PendingEncode;
+		FEncodedHistory Encoded;
+		double ExpireTime = 0.0;
+	};
+
+	// 序列化使用同一套读写代码，因此需要非const引用；History不会被修改
+	static FEncodedHistory Encode(FRewindColdHistory& History);
+	static bool Decode(const FEncodedHistory& Encoded, FRewindColdHistory& OutHistory);
+
+	// 完成已经结束的压缩，删除过期的冷历史
+	void RemoveExpiredEntries();
+
+	TMap<FString, FEntry> Entries;
+};
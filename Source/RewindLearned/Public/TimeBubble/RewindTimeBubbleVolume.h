@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "GameMode/RewindGameState.h"
+#include "RewindTimeBubbleVolume.generated.h"
+
+class URewindComponentRegistry;
+class USphereComponent;
+
+
+UCLASS()
+class REWINDLEARNED_API ARewindTimeBubbleVolume : public AActor
+{
+	/*
+	 * 时间泡：球形区域内的回溯组件使用自己的时钟（时间状态、回溯速度和时间膨胀），例如慢动作区域或局部回溯力场
+	 * 进入/离开区域时由重叠事件在注册表中移动一次分组，平时没有每帧查询
+	 * 状态由服务器设置并复制，服务器和客户端各自根据本地的重叠在注册表中分组
+	 */
+	GENERATED_BODY()
+
+public:
+	ARewindTimeBubbleVolume();
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+public:
+	/* --------------------- 组件 --------------------- */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Rewind|TimeBubble")
+	USphereComponent* BubbleSphere;
+
+public:
+	/* --------------------- 时间操作函数（只在服务器调用） --------------------- */
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void StartLocalRewind();
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void StopLocalRewind();
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void StartLocalFastForward();
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void StopLocalFastForward();
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void ToggleLocalTimeScrub();
+
+	// 时间操作期间的回放速度
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void SetLocalRewindSpeed(float NewRewindSpeed);
+
+	// 正常时间流逝时泡内Actor的时间膨胀，小于1为慢动作
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	void SetLocalTimeDilation(float NewTimeDilation);
+
+public:
+	/* --------------------- 获取状态相关函数 --------------------- */
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	FRewindGlobalTimeState GetClockState() const { return ClockState; }
+
+	UFUNCTION(BlueprintCallable, Category = "Rewind|TimeBubble")
+	float GetTimeDilation() const { return TimeDilation; }
+
+private:
+	/* --------------------- 复制的状态 --------------------- */
+	UPROPERTY(Transient, VisibleAnywhere, ReplicatedUsing = OnRep_ClockState, Category = "Rewind|TimeBubble")
+	FRewindGlobalTimeState ClockState;
+
+	UPROPERTY(EditAnywhere, ReplicatedUsing = OnRep_ClockState, Category = "Rewind|TimeBubble", meta = (ClampMin = "0.01"))
+	float TimeDilation = 1.0f;
+
+	UFUNCTION()
+	void OnRep_ClockState();
+
+	// 把状态写入注册表中的时钟，由注册表分发给泡内的组件
+	void PushClockState();
+
+private:
+	/* --------------------- 分组 --------------------- */
+	UFUNCTION()
+	void OnBubbleBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult);
+
+	UFUNCTION()
+	void OnBubbleEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
+
+	UPROPERTY(Transient)
+	TObjectPtr<URewindComponentRegistry> Registry;
+
+	// 在注册表中的时钟编号
+	int32 ClockIndex = INDEX_NONE;
+};
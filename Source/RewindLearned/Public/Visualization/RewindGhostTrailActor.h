@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "RewindGhostTrailActor.generated.h"
+
+class ARewindGameState;
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class URewindComponent;
+class UStaticMesh;
+
+
+UCLASS()
+class REWINDLEARNED_API ARewindGhostTrailActor : public AActor
+{
+	/*
+	 * 时间暂停（ToggleTimeScrub）期间显示可回溯静态网格体的历史轨迹（洋葱皮）和经过的路径
+	 * 同一网格体/材质的所有残影共用一个实例化静态网格体组件，所有路径线段共用一个，只更新发生变化的实例：
+	 * 每个Actor的残影窗口跟随它自己的回放时刻（时间泡、时钟速度和较短的历史都会让各个Actor停在不同的时刻），
+	 * 残影时刻对齐到固定间隔的网格上，回放时刻移动时只有进入/离开窗口的残影需要读取历史，开销与残影数量无关；
+	 * 路径由相邻残影之间的线段组成，复用残影读到的位置，不再单独读取历史
+	 */
+	GENERATED_BODY()
+
+public:
+	ARewindGhostTrailActor();
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaSeconds) override;
+
+public:
+	/* --------------------- 预设值 --------------------- */
+	// 每个Actor显示的残影数量
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail", meta = (ClampMin = "1"))
+	int32 NumOnionSkinFrames = 8;
+
+	// 相邻残影之间的时间间隔
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail", meta = (ClampMin = "0.01"))
+	float OnionSkinIntervalSeconds = 0.25f;
+
+	// 残影使用的材质（通常是半透明材质），为空时使用原网格体的材质
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail")
+	UMaterialInterface* GhostMaterial = nullptr;
+
+	// 路径线段使用的网格体（沿Z轴、高和直径都为100的圆柱体，默认使用引擎的基础圆柱体），为空时不显示路径
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail")
+	UStaticMesh* PathMesh = nullptr;
+
+	// 路径线段的材质，为空时使用GhostMaterial
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail")
+	UMaterialInterface* PathMaterial = nullptr;
+
+	// 路径线段的粗细
+	UPROPERTY(EditAnywhere, Category = "Rewind|GhostTrail", meta = (ClampMin = "0.1"))
+	float PathThickness = 2.0f;
+
+private:
+	/* --------------------- 事件回调 --------------------- */
+	UFUNCTION()
+	void OnGlobalTimeScrubStarted();
+
+	UFUNCTION()
+	void OnGlobalTimeScrubCompleted();
+
+private:
+	/* --------------------- 辅助函数 --------------------- */
+	// 收集所有可回溯的静态网格体，并为每个网格体/材质组合创建一个实例化组件
+	void BuildGhostBatches();
+
+	// 清空所有残影实例
+	void ClearGhostBatches();
+
+	struct FGhostTrailEntry;
+
+	// 更新一个Actor网格序号落在[FirstGridIndex, LastGridIndex]内的残影
+	void UpdateGhostFrames(FGhostTrailEntry& Entry, int64 FirstGridIndex, int64 LastGridIndex);
+
+	// 用残影的位置重建一个Actor窗口内的路径线段，NewestGridIndex是窗口中最新的残影
+	void UpdatePath(const FGhostTrailEntry& Entry, int64 NewestGridIndex);
+
+	// 网格序号对应的实例槽位
+	int32 GetFrameSlot(int64 GridIndex) const;
+
+	UInstancedStaticMeshComponent* FindOrAddBatch(UStaticMesh* StaticMesh, UMaterialInterface* Material);
+
+private:
+	struct FGhostTrailEntry
+	{
+		TWeakObjectPtr<URewindComponent> RewindComponent;
+		int32 BatchIndex = INDEX_NONE;
+		int32 FirstInstanceIndex = INDEX_NONE; // 该Actor的残影在批次中占用[First, First + NumOnionSkinFrames)
+		int32 FirstPathInstanceIndex = INDEX_NONE; // 该Actor的路径线段在PathBatch中占用[First, First + NumOnionSkinFrames)
+
+		// 当前显示的最新残影的网格序号，没有显示时为空
+		TOptional<int64> VisibleGridIndex;
+
+		// 残影的位置，按槽位存放，超出历史范围的残影为空
+		TArray<TOptional<FVector>> GhostLocations;
+	};
+
+	TArray<FGhostTrailEntry> Entries;
+
+	// 每个网格体/材质组合对应一个实例化组件
+	UPROPERTY(Transient)
+	TArray<UInstancedStaticMeshComponent*> Batches;
+
+	TMap<TPair<UStaticMesh*, UMaterialInterface*>, int32> BatchLookup;
+
+	// 所有Actor的路径线段
+	UPROPERTY(Transient)
+	UInstancedStaticMeshComponent* PathBatch = nullptr;
+
+	UPROPERTY(Transient)
+	ARewindGameState* GameState;
+};
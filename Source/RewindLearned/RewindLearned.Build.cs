@@ -8,6 +8,17 @@ public class RewindLearned : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput", "MassEntity" });
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "MassCommon", "MassMovement", "MassSpawner" });
+
+		// 只在支持Gameplay Debugger的目标上添加依赖，并定义WITH_GAMEPLAY_DEBUGGER
+		SetupGameplayDebuggerSupport(Target);
+
+		// 自动化测试中的多客户端PIE需要编辑器
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("UnrealEd");
+		}
 	}
 }
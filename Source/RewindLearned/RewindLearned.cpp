@@ -2,6 +2,44 @@
 
 #include "RewindLearned.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/RewindStats.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, RewindLearned, "RewindLearned" );
- 
\ No newline at end of file
+#if WITH_GAMEPLAY_DEBUGGER
+#include "GameplayDebugger.h"
+#include "Stats/GameplayDebuggerCategory_Rewind.h"
+#endif
+
+class FRewindLearnedModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FRewindFrameStats::Startup();
+
+#if WITH_GAMEPLAY_DEBUGGER
+		IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+		GameplayDebugger.RegisterCategory(TEXT("Rewind"),
+			IGameplayDebugger::FOnGetCategory::CreateStatic(&FGameplayDebuggerCategory_Rewind::MakeInstance),
+			EGameplayDebuggerCategoryState::EnabledInGameAndSimulate);
+		GameplayDebugger.NotifyCategoriesChanged();
+#endif
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FRewindFrameStats::Shutdown();
+
+#if WITH_GAMEPLAY_DEBUGGER
+		if (IGameplayDebugger::IsAvailable())
+		{
+			IGameplayDebugger& GameplayDebugger = IGameplayDebugger::Get();
+			GameplayDebugger.UnregisterCategory(TEXT("Rewind"));
+			GameplayDebugger.NotifyCategoriesChanged();
+		}
+#endif
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FRewindLearnedModule, RewindLearned, "RewindLearned" );
+
+DEFINE_LOG_CATEGORY(LogRewind);
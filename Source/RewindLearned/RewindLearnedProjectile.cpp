@@ -3,9 +3,36 @@
 #include "RewindLearnedProjectile.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Algo/BinarySearch.h"
+#include "Component/RewindComponent.h"
+#include "Events/RewindEventLogSubsystem.h"
+
+bool FRewindFiredShot::GetStateAtTime(float Time, FVector& OutLocation, FVector& OutVelocity) const
+{
+	if (Flight.Num() == 0) return false;
+	if (Flight.Num() == 1)
+	{
+		OutLocation = Flight[0].Location;
+		OutVelocity = Flight[0].Velocity;
+		return true;
+	}
+
+	const int32 NextIndex = FMath::Clamp(Algo::UpperBoundBy(Flight, Time, &FFlightSample::Time), 1, Flight.Num() - 1);
+	const FFlightSample& Previous = Flight[NextIndex - 1];
+	const FFlightSample& Next = Flight[NextIndex];
+	const float Interval = Next.Time - Previous.Time;
+	const float Alpha = Interval > UE_KINDA_SMALL_NUMBER ? FMath::Clamp((Time - Previous.Time) / Interval, 0.0f, 1.0f) : 1.0f;
+	OutLocation = FMath::Lerp(Previous.Location, Next.Location, Alpha);
+	OutVelocity = FMath::Lerp(Previous.Velocity, Next.Velocity, Alpha);
+	return true;
+}
 
 ARewindLearnedProjectile::ARewindLearnedProjectile() 
 {
+	// 在移动组件之后记录飞行
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
 	// Use a sphere as a simple collision representation
 	CollisionComp = CreateDefaultSubobject<USphereComponent>(TEXT("SphereComp"));
 	CollisionComp->InitSphereRadius(5.0f);
@@ -36,8 +63,157 @@ void ARewindLearnedProjectile::OnHit(UPrimitiveComponent* HitComp, AActor* Other
 	// Only add impulse and destroy projectile if we hit a physics
 	if ((OtherActor != nullptr) && (OtherActor != this) && (OtherComp != nullptr) && OtherComp->IsSimulatingPhysics())
 	{
-		OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+		const FVector Impulse = GetVelocity() * 100.0f;
+		OtherComp->AddImpulseAtLocation(Impulse, GetActorLocation());
+
+		// 检查点模式的回溯物体需要记录外部冲量，回放重新模拟时在同一时刻施加
+		URewindComponent* RewindComponent = OtherActor->FindComponentByClass<URewindComponent>();
+		if (RewindComponent && OtherComp == OtherActor->GetRootComponent()) RewindComponent->RecordExternalImpulse(Impulse, GetActorLocation());
+
+		// 冲量由被击中物体的回溯历史还原；撤销命中时投射物回到命中时刻的飞行状态，快进越过命中时销毁重新生成的投射物
+		URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>();
+		if (EventLog && FiredShot.IsValid())
+		{
+			EventLog->RecordEvent(TEXT("Hit"), OtherActor,
+				[Shot = FiredShot, HitTime = GetWorld()->GetTimeSeconds()]()
+				{
+					RestoreShot(Shot, HitTime);
+				},
+				[Shot = FiredShot](float)
+				{
+					if (ARewindLearnedProjectile* Fired = Shot->Projectile.Get()) Fired->Destroy();
+				});
+		}
+
+		Destroy();
+	}
+}
+
+void ARewindLearnedProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>())
+	{
+		TimelinePlaybackHandle = EventLog->OnTimelinePlayback.AddUObject(this, &ARewindLearnedProjectile::OnTimelinePlayback);
+	}
+}
+
+void ARewindLearnedProjectile::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// 命中或寿命结束时补上最后的状态，撤销命中时从这里重新生成
+	if (EndPlayReason == EEndPlayReason::Destroyed && ShouldRecordFlight()) RecordFlightSample();
+
+	if (URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>())
+	{
+		EventLog->OnTimelinePlayback.Remove(TimelinePlaybackHandle);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void ARewindLearnedProjectile::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+	if (ShouldRecordFlight()) RecordFlightSample();
+}
+
+bool ARewindLearnedProjectile::ShouldRecordFlight() const
+{
+	const URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>();
+	return FiredShot.IsValid() && !bIsFrozen && !(EventLog && EventLog->IsTimelineManipulated());
+}
+
+void ARewindLearnedProjectile::RecordFlightSample()
+{
+	if (!FiredShot.IsValid()) return;
+
+	// 同一帧内只保留最后的状态
+	const float Time = GetWorld()->GetTimeSeconds();
+	TArray<FRewindFiredShot::FFlightSample>& Flight = FiredShot->Flight;
+	if (Flight.Num() == 0 || Flight.Last().Time < Time) Flight.AddDefaulted();
+	Flight.Last() = {Time, GetActorLocation(), GetVelocity()};
+}
+
+ARewindLearnedProjectile* ARewindLearnedProjectile::RestoreShot(const TSharedPtr<FRewindFiredShot>& Shot, float Time)
+{
+	if (ARewindLearnedProjectile* Existing = Shot->Projectile.Get()) return Existing;
+
+	UWorld* World = Shot->World.Get();
+	UClass* Class = Shot->Class.Get();
+	FVector Location;
+	FVector Velocity;
+	if (!World || !Class || !Shot->GetStateAtTime(Time, Location, Velocity)) return nullptr;
+
+	// 直接放在记录的位置上，不再按枪口的规则处理生成时的碰撞
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	ARewindLearnedProjectile* Restored = World->SpawnActor<ARewindLearnedProjectile>(Class, Location, Velocity.Rotation(), SpawnParams);
+	if (!Restored) return nullptr;
+
+	Restored->FiredShot = Shot;
+	Shot->Projectile = Restored;
+	Restored->Freeze();
+	Restored->ApplyFlightState(Time);
+	return Restored;
+}
+
+void ARewindLearnedProjectile::Freeze()
+{
+	// 停在播放位置上，也不与回放中的物体发生碰撞
+	ProjectileMovement->Deactivate();
+	SetActorEnableCollision(false);
+	SetLifeSpan(0.0f);
+	bIsFrozen = true;
+}
+
+void ARewindLearnedProjectile::ApplyFlightState(float Time)
+{
+	FVector Location;
+	FVector Velocity;
+	if (!FiredShot.IsValid() || !FiredShot->GetStateAtTime(Time, Location, Velocity)) return;
+
+	const FQuat Rotation = Velocity.IsNearlyZero() ? GetActorQuat() : Velocity.ToOrientationQuat();
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	ProjectileMovement->Velocity = Velocity;
+}
+
+void ARewindLearnedProjectile::OnTimelinePlayback(bool bManipulating, float PlaybackTime)
+{
+	if (!FiredShot.IsValid()) return;
+
+	if (bManipulating)
+	{
+		if (!bIsFrozen) Freeze();
+		ApplyFlightState(PlaybackTime);
+		return;
+	}
+	if (!bIsFrozen) return;
 
+	// 已经飞行的时间线秒数（不含恢复时跳过的间隙）用完了寿命
+	const URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>();
+	const float RemainingLifeSpan = InitialLifeSpan - (EventLog ? EventLog->GetTimelineSeconds(FiredShot->FireTime, PlaybackTime) : 0.0f);
+	if (InitialLifeSpan > 0.0f && RemainingLifeSpan <= 0.0f)
+	{
 		Destroy();
+		return;
 	}
-}
\ No newline at end of file
+
+	/* 从恢复点继续：之后的飞行属于被放弃的未来，恢复点的状态一直保持到当前时刻 */
+	ApplyFlightState(PlaybackTime);
+	TArray<FRewindFiredShot::FFlightSample>& Flight = FiredShot->Flight;
+	Flight.SetNum(Algo::UpperBoundBy(Flight, PlaybackTime, &FRewindFiredShot::FFlightSample::Time));
+	Flight.Add({PlaybackTime, GetActorLocation(), ProjectileMovement->Velocity});
+
+	bIsFrozen = false;
+	SetActorEnableCollision(true);
+	if (InitialLifeSpan > 0.0f) SetLifeSpan(RemainingLifeSpan);
+
+	// 已经停下的投射物保持静止
+	if (!ProjectileMovement->Velocity.IsNearlyZero())
+	{
+		if (!ProjectileMovement->UpdatedComponent) ProjectileMovement->SetUpdatedComponent(CollisionComp);
+		ProjectileMovement->Activate(true);
+		ProjectileMovement->UpdateComponentVelocity();
+	}
+	RecordFlightSample();
+}
@@ -8,6 +8,29 @@
 
 class USphereComponent;
 class UProjectileMovementComponent;
+class ARewindLearnedProjectile;
+
+/** 一次开火的记录，由开火事件、命中事件和这次开火生成的投射物共享；撤销或重做重新生成的投射物接着使用它 */
+struct FRewindFiredShot
+{
+	struct FFlightSample
+	{
+		float Time = 0.0f; // 世界时间，与事件日志的时间同一基准
+		FVector Location = FVector::ZeroVector;
+		FVector Velocity = FVector::ZeroVector;
+	};
+
+	TWeakObjectPtr<ARewindLearnedProjectile> Projectile;
+	TWeakObjectPtr<UWorld> World;
+	TWeakObjectPtr<UClass> Class;
+	float FireTime = 0.0f;
+
+	/** 按时间排序，正常时间流逝时投射物每帧追加一个；从播放位置恢复后，之后的样本与回溯历史一样被丢弃 */
+	TArray<FFlightSample> Flight;
+
+	/** Time时刻的位置和速度：在相邻样本之间线性插值，超出记录的范围时取两端，没有样本时返回false */
+	bool GetStateAtTime(float Time, FVector& OutLocation, FVector& OutVelocity) const;
+};
 
 UCLASS(config=Game)
 class ARewindLearnedProjectile : public AActor
@@ -33,5 +56,36 @@ public:
 	USphereComponent* GetCollisionComp() const { return CollisionComp; }
 	/** Returns ProjectileMovement subobject **/
 	UProjectileMovementComponent* GetProjectileMovement() const { return ProjectileMovement; }
+
+	/** 开火事件记录成功时设置；为空的投射物（时间操作期间射出的）不跟随时间线 */
+	TSharedPtr<FRewindFiredShot> FiredShot;
+
+	/** 把当前的位置和速度追加到FiredShot的飞行记录 */
+	void RecordFlightSample();
+
+	/** 在Time时刻（世界时间）的飞行状态上重新生成Shot的投射物（撤销命中、快进越过开火时），投射物还在时直接返回它；
+	 *  在时间操作中调用，生成后冻结，随后由事件日志的播放位置广播放到准确的位置 */
+	static ARewindLearnedProjectile* RestoreShot(const TSharedPtr<FRewindFiredShot>& Shot, float Time);
+
+	virtual void Tick(float DeltaSeconds) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+private:
+	/** 时间操作期间停止移动和寿命计时，跟随播放位置；恢复时从恢复点的飞行状态继续，寿命按已经飞行的时间线秒数计算 */
+	void OnTimelinePlayback(bool bManipulating, float PlaybackTime);
+
+	void ApplyFlightState(float Time);
+
+	void Freeze();
+
+	bool ShouldRecordFlight() const;
+
+	FDelegateHandle TimelinePlaybackHandle;
+
+	bool bIsFrozen = false;
 };
 
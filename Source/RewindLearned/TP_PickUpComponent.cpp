@@ -1,6 +1,7 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "TP_PickUpComponent.h"
+#include "Events/RewindEventLogSubsystem.h"
 
 UTP_PickUpComponent::UTP_PickUpComponent()
 {
@@ -20,8 +21,25 @@ void UTP_PickUpComponent::OnSphereBeginOverlap(UPrimitiveComponent* OverlappedCo
 {
 	// Checking if it is a First Person Character overlapping
 	ARewindLearnedCharacter* Character = Cast<ARewindLearnedCharacter>(OtherActor);
-	if(Character != nullptr)
+	URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>();
+	// 时间操作期间回放中的角色会穿过拾取物，拾取只在正常时间流逝时发生
+	if(Character != nullptr && !(EventLog && EventLog->IsTimelineManipulated()))
 	{
+		// 拾取事件先于Broadcast中的AttachWeapon记录，撤销时后撤销
+		if (EventLog)
+		{
+			TWeakObjectPtr<UTP_PickUpComponent> WeakThis(this);
+			EventLog->RecordEvent(TEXT("PickUp"), this,
+				[WeakThis]()
+				{
+					if (UTP_PickUpComponent* PickUp = WeakThis.Get()) PickUp->OnComponentBeginOverlap.AddUniqueDynamic(PickUp, &UTP_PickUpComponent::OnSphereBeginOverlap);
+				},
+				[WeakThis](float)
+				{
+					if (UTP_PickUpComponent* PickUp = WeakThis.Get()) PickUp->OnComponentBeginOverlap.RemoveAll(PickUp);
+				});
+		}
+
 		// Notify that the actor is being picked up
 		OnPickUp2.Broadcast(Character);
 
@@ -12,6 +12,7 @@
 #include "Animation/AnimInstance.h"
 #include "Engine/LocalPlayer.h"
 #include "Engine/World.h"
+#include "Events/RewindEventLogSubsystem.h"
 
 // Sets default values for this component's properties
 UTP_WeaponComponent::UTP_WeaponComponent()
@@ -44,7 +45,37 @@ void UTP_WeaponComponent::Fire()
 			ActorSpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
 	
 			// Spawn the projectile at the muzzle
-			World->SpawnActor<ARewindLearnedProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+			ARewindLearnedProjectile* Projectile = World->SpawnActor<ARewindLearnedProjectile>(ProjectileClass, SpawnLocation, SpawnRotation, ActorSpawnParams);
+
+			// 回溯越过开火时移除投射物；快进越过时按记录的飞行重新生成，放到目标时刻的位置和速度上（命中事件会销毁重新生成的投射物）
+			URewindEventLogSubsystem* EventLog = World->GetSubsystem<URewindEventLogSubsystem>();
+			if (Projectile && EventLog)
+			{
+				const TSharedPtr<FRewindFiredShot> Shot = MakeShared<FRewindFiredShot>();
+				Shot->Projectile = Projectile;
+				Shot->World = World;
+				Shot->Class = ProjectileClass.Get();
+				Shot->FireTime = World->GetTimeSeconds();
+				const bool bRecorded = EventLog->RecordEvent(TEXT("Fire"), this,
+					[Shot]()
+					{
+						if (ARewindLearnedProjectile* Fired = Shot->Projectile.Get()) Fired->Destroy();
+					},
+					[Shot](float SecondsSinceEvent)
+					{
+						const UClass* Class = Shot->Class.Get();
+						const float LifeSpan = Class ? Class->GetDefaultObject<AActor>()->InitialLifeSpan : 0.0f;
+						if (LifeSpan > 0.0f && SecondsSinceEvent >= LifeSpan) return;
+						ARewindLearnedProjectile::RestoreShot(Shot, Shot->FireTime);
+					});
+
+				// 没有进入日志的投射物不跟随时间线
+				if (bRecorded)
+				{
+					Projectile->FiredShot = Shot;
+					Projectile->RecordFlightSample();
+				}
+			}
 		}
 	}
 	
@@ -76,6 +107,11 @@ bool UTP_WeaponComponent::AttachWeapon(ARewindLearnedCharacter* TargetCharacter)
 		return false;
 	}
 
+	// 撤销时挂回拾取物上原来的位置
+	USceneComponent* const PreviousParent = GetAttachParent();
+	const FName PreviousSocketName = GetAttachSocketName();
+	const FTransform PreviousRelativeTransform = GetRelativeTransform();
+
 	// Attach the weapon to the First Person Character
 	FAttachmentTransformRules AttachmentRules(EAttachmentRule::SnapToTarget, true);
 	AttachToComponent(Character->GetMesh1P(), AttachmentRules, FName(TEXT("GripPoint")));
@@ -95,25 +131,73 @@ bool UTP_WeaponComponent::AttachWeapon(ARewindLearnedCharacter* TargetCharacter)
 		if (UEnhancedInputComponent* EnhancedInputComponent = Cast<UEnhancedInputComponent>(PlayerController->InputComponent))
 		{
 			// Fire
-			EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::Fire);
+			FireBindingHandle = EnhancedInputComponent->BindAction(FireAction, ETriggerEvent::Triggered, this, &UTP_WeaponComponent::Fire).GetHandle();
 		}
 	}
 
+	if (URewindEventLogSubsystem* EventLog = GetWorld()->GetSubsystem<URewindEventLogSubsystem>())
+	{
+		TWeakObjectPtr<UTP_WeaponComponent> WeakThis(this);
+		TWeakObjectPtr<ARewindLearnedCharacter> WeakCharacter(Character);
+		TWeakObjectPtr<USceneComponent> WeakParent(PreviousParent);
+		EventLog->RecordEvent(TEXT("AttachWeapon"), this,
+			[WeakThis, WeakParent, PreviousSocketName, PreviousRelativeTransform]()
+			{
+				if (UTP_WeaponComponent* Weapon = WeakThis.Get()) Weapon->DetachWeapon(WeakParent.Get(), PreviousSocketName, PreviousRelativeTransform);
+			},
+			[WeakThis, WeakCharacter](float)
+			{
+				if (UTP_WeaponComponent* Weapon = WeakThis.Get()) Weapon->AttachWeapon(WeakCharacter.Get());
+			});
+	}
+
 	return true;
 }
 
-void UTP_WeaponComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+void UTP_WeaponComponent::DetachWeapon(USceneComponent* Parent, FName SocketName, const FTransform& RelativeTransform)
 {
 	if (Character == nullptr)
 	{
 		return;
 	}
 
+	RemoveFireInput();
+	Character->RemoveInstanceComponent(this);
+	Character = nullptr;
+
+	if (Parent)
+	{
+		AttachToComponent(Parent, FAttachmentTransformRules::KeepRelativeTransform, SocketName);
+		SetRelativeTransform(RelativeTransform);
+	}
+	else
+	{
+		DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+}
+
+void UTP_WeaponComponent::RemoveFireInput()
+{
 	if (APlayerController* PlayerController = Cast<APlayerController>(Character->GetController()))
 	{
 		if (UEnhancedInputLocalPlayerSubsystem* Subsystem = ULocalPlayer::GetSubsystem<UEnhancedInputLocalPlayerSubsystem>(PlayerController->GetLocalPlayer()))
 		{
 			Subsystem->RemoveMappingContext(FireMappingContext);
 		}
+
+		if (UEnhancedInputComponent* EnhancedInputComponent = Cast<UEnhancedInputComponent>(PlayerController->InputComponent))
+		{
+			EnhancedInputComponent->RemoveBindingByHandle(FireBindingHandle);
+		}
+	}
+}
+
+void UTP_WeaponComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (Character == nullptr)
+	{
+		return;
 	}
+
+	RemoveFireInput();
 }
\ No newline at end of file
@@ -57,4 +57,12 @@ protected:
 private:
 	/** The Character holding this weapon*/
 	ARewindLearnedCharacter* Character;
+
+	/** 开火输入绑定的句柄，卸下武器时移除 */
+	uint32 FireBindingHandle = 0;
+
+	/** 撤销AttachWeapon：移除输入，挂回原来的父组件 */
+	void DetachWeapon(USceneComponent* Parent, FName SocketName, const FTransform& RelativeTransform);
+
+	void RemoveFireInput();
 };